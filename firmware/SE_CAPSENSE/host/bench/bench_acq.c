@@ -0,0 +1,140 @@
+#include "bench_util.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "sim_mqtt.h"
+#include "sim_sch.h"
+#include "sim_sd.h"
+#include "acq.h"
+#include "board.h"
+#include "config.h"
+#include "drain.h"
+#include "fdc1004.h"
+#include "mqtt_svc.h"
+#include "record.h"
+#include "sampler.h"
+#include "scheduler.h"
+#include "sd_logger.h"
+#include "bme280_drv.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+// Acquisition timing under I/O stalls: the firmware's pipeline (sampler,
+// drain, SD log on a modelled card, MQTT to the fake broker) on the
+// scheduler loop, with a job that blocks the loop for STALL_MS every
+// STALL_EVERY_MS (a slow publish or log line, an SD card busy with garbage
+// collection).
+//
+//  - job loop: sampler_poll_job and sampler_job are scheduler jobs, as
+//    before the acquisition task
+//  - acquisition task: acq.c, preempting the loop on the virtual clock
+//
+// It prints FDC poll jitter, the worst deviation of the record interval
+// from SAMPLE_PERIOD_MS, and FDC conversions overwritten before they were
+// read (each is lost to the filter).
+//
+// usage: bench_acq [seconds]
+
+#define IMG "bench_acq.img"
+#define STALL_MS 150
+#define STALL_EVERY_MS 3070   // off the sampler grid, so stalls hit every phase
+
+static uint64_t s_last_t_ms;
+static uint32_t s_rec_dev_max_ms, s_records;
+
+static void job_stall(void){ sim_clock_advance_ms(STALL_MS); }
+
+static size_t collect(const sample_t *s, size_t n){
+    for (size_t i = 0; i < n; i++, s_records++){
+        if (s_records){
+            int64_t d = (int64_t)(s[i].t_ms - s_last_t_ms) - SAMPLE_PERIOD_MS;
+            uint32_t dev = (uint32_t)(d < 0 ? -d : d);
+            if (dev > s_rec_dev_max_ms) s_rec_dev_max_ms = dev;
+        }
+        s_last_t_ms = s[i].t_ms;
+    }
+    return n;
+}
+
+static void run(const char *name, bool task, unsigned long secs){
+    sim_board_init();
+    sim_i2c_set_bus_hz(I2C_FREQ_HZ);
+    sim_sch_reset();
+    sim_sd_reset();
+    sim_sd_set_path(IMG);
+    unlink(IMG);
+    sim_sd_set_capacity(1024 * SD_FRAME_SECTORS);
+    sim_sd_set_latency_us(1500, 250);
+    sim_mqtt_reset();
+    sim_mqtt_set_ack_delay_ms(50);
+    sample_t s;
+    while (record_pop(&s)) {}
+    s_records = s_rec_dev_max_ms = 0;
+
+    bme_init();
+    sch_init();
+    sampler_init();
+    int poll = -1;
+    if (task) acq_start();
+    else {
+        poll = sch_add("sampler_poll", sampler_poll_job, SCH_MS(SAMPLE_POLL_MS), SCH_SKIP);
+        sch_add("sampler", sampler_job, SCH_MS(SAMPLE_PERIOD_MS), SCH_SKIP);
+    }
+    sdlog_init();
+    drain_add_sink(collect);
+    drain_add_sink(sdlog_append);
+    sch_add("sdlog_flush", sdlog_job_flush, SCH_MS(RECORD_DRAIN_PERIOD_MS), SCH_SKIP);
+    sch_add("drain", drain_job, SCH_MS(RECORD_DRAIN_PERIOD_MS), SCH_SKIP);
+    mqtt_svc_init();
+    drain_add_sink(mqtt_svc_append);
+    sch_add("mqtt", mqtt_svc_job_drain, SCH_MS(MQTT_PUB_PERIOD_MS), SCH_SKIP);
+    sch_add("stall", job_stall, SCH_MS(STALL_EVERY_MS), SCH_SKIP);
+
+    fdc_stats_t f0;
+    fdc_get_stats(&f0);
+    uint64_t conv0 = sim_board_fdc.conversions;
+    uint64_t end = sim_clock_now_ns() + (uint64_t)secs * 1000000000ull;
+    while (sim_clock_now_ns() < end){
+        sch_wait_us(sch_run_due());
+        sim_sd_run_pending();
+        sim_mqtt_run_pending();
+    }
+
+    fdc_stats_t f;
+    fdc_get_stats(&f);
+    uint64_t lost = sim_board_fdc.conversions - conv0 - (f.results - f0.results);
+    uint32_t jit_max, late;
+    double jit_avg;
+    if (task){
+        acq_stats_t st;
+        acq_get_stats(&st);
+        jit_max = st.jitter_max_us;
+        jit_avg = st.wakeups ? (double)st.jitter_total_us / st.wakeups : 0.0;
+        late = st.late;
+    } else {
+        sch_job_stats_t st;
+        sch_get_job_stats(poll, &st);
+        jit_max = st.jitter_max_us;
+        jit_avg = st.runs ? (double)st.jitter_total_us / st.runs : 0.0;
+        late = st.missed;
+    }
+    printf("  %-20s %9.3f %9.3f %7u %9u %7u %10.2f%%\n", name, jit_avg / 1000.0, jit_max / 1000.0,
+           (unsigned)late, (unsigned)s_rec_dev_max_ms, (unsigned)s_records,
+           100.0 * (double)lost / (double)(sim_board_fdc.conversions - conv0));
+    unlink(IMG);
+}
+
+int main(int argc, char **argv){
+    unsigned long secs = argc > 1 ? strtoul(argv[1], NULL, 0) : 600ul;
+    if (!secs) secs = 1;
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    printf("bench_acq: %lu s, loop blocked %d ms every %d ms, SD 1.5 ms + 0.25 ms/sector, MQTT 50 ms RTT\n",
+           secs, STALL_MS, STALL_EVERY_MS);
+    printf("  %-20s %9s %9s %7s %9s %7s %11s\n", "", "poll avg", "poll max", "late", "rec dev", "records",
+           "conv lost");
+    printf("  %-20s %9s %9s %7s %9s %7s %11s\n", "", "ms", "ms", "", "ms", "", "");
+    run("job loop", false, secs);
+    run("acquisition task", true, secs);
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "acq.h"
+#include "adapt.h"
+#include "board.h"
+#include "bme280_drv.h"
+#include "config.h"
+#include "fdc1004.h"
+#include "record.h"
+#include "sampler.h"
+#include "esp_log.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Records spent against events caught by the adaptive record period
+// (src/adapt.c), next to fixed periods, on a kiln run from the simulated
+// board: the moisture electrode drying from 10 to 4 pF with a 6 h time
+// constant and 2 fF of conversion noise, with three events a quarter of
+// the run apart:
+//
+//   insert   a board pressed onto the electrode, +1.5 pF at once
+//   door     the kiln door opened, 8 degC down over 2 min and back with a
+//            10 min time constant
+//   remove   the board taken off again, -1.5 pF
+//
+// Per mode it prints the records made, the share saved against 1 s
+// records, when each step was first seen (the first record at least half
+// way to the new value) and how much of the door's dip the records show.
+//
+// usage: bench_adapt [hours]
+
+#define TAU_S (6 * 3600.0)
+#define STEP_PF 1.5
+#define DIP_C 8.0
+
+static double s_ev[3];   // insert, door, remove (s)
+
+static double drying_pf(double t){ return 4.0 + 6.0 * exp(-t / TAU_S); }
+
+static double temp_c(double t){
+    double d = t - s_ev[1], dip = 0;
+    if (d >= 0 && d < 120) dip = DIP_C * d / 120.0;
+    else if (d >= 120) dip = DIP_C * exp(-(d - 120) / 600.0);
+    return 60.0 - dip;
+}
+
+static float kiln_input(void *ctx, int cin, uint64_t t_ns){
+    (void)ctx;
+    double t = (double)t_ns / 1e9;
+    if (cin != WMC_MEAS) return (float)(2.0 + cin);
+    double pf = drying_pf(t) + 0.02 * (temp_c(t) - 60.0);
+    if (t >= s_ev[0] && t < s_ev[2]) pf += STEP_PF;
+    return (float)pf;
+}
+
+typedef struct {
+    uint32_t records;
+    double seen_s[2];     // insert, remove: first record showing the step, after the event
+    double dip_c;         // deepest door dip in the records
+} result_t;
+
+static void run(const char *name, uint32_t period_ms, const adapt_cfg_t *cfg, double hours, uint32_t base){
+    sim_board_init();
+    sim_board_fdc.input = kiln_input;
+    sim_board_fdc.noise_pf = 0.002f;
+    sim_i2c_set_bus_hz(I2C_FREQ_HZ);
+    sample_t s;
+    while (record_pop(&s)) {}
+    bme_init();
+    sampler_init();
+    sampler_set_adapt(NULL);
+    sampler_set_period_ms(period_ms);
+    if (cfg) sampler_set_adapt(cfg);
+    acq_start();
+
+    result_t r = { .seen_s = { -1, -1 } };
+    double end_s = hours * 3600.0, before[2] = { 0, 0 };
+    while ((double)sim_clock_now_ns() / 1e9 < end_s){
+        double t = (double)sim_clock_now_ns() / 1e9;
+        sim_board_bme.temp_c = (float)temp_c(t);
+        sim_clock_advance_ms(SAMPLE_POLL_MS);
+        while (record_pop(&s)){
+            double ts = (double)s.t_ms / 1000.0, pf = (double)s.cap_raw[WMC_MEAS] / FDC_CODES_PER_PF;
+            r.records++;
+            for (int e = 0; e < 2; e++){
+                double t_ev = s_ev[e ? 2 : 0];
+                if (ts < t_ev) before[e] = pf;
+                else if (r.seen_s[e] < 0 && fabs(pf - before[e]) >= STEP_PF / 2) r.seen_s[e] = ts - t_ev;
+            }
+            double dip = 60.0 - s.temp_cdeg / 100.0;
+            if (ts >= s_ev[1] && dip > r.dip_c) r.dip_c = dip;
+        }
+    }
+    sim_clock_set_task(NULL, 0);
+
+    adapt_stats_t st = {};
+    sampler_get_adapt_stats(&st);
+    char seen[2][16];
+    for (int e = 0; e < 2; e++){
+        if (r.seen_s[e] < 0) snprintf(seen[e], sizeof(seen[e]), "missed");
+        else snprintf(seen[e], sizeof(seen[e]), "%.2f s", r.seen_s[e]);
+    }
+    printf("  %-18s %8u %7.1f %% %10s %10s %6.1f/%.0f %6u %6u\n", name, (unsigned)r.records,
+           base ? 100.0 * (1.0 - (double)r.records / base) : 0.0, seen[0], seen[1], r.dip_c, DIP_C,
+           (unsigned)st.speedups, (unsigned)st.jumps);
+}
+
+int main(int argc, char **argv){
+    double hours = argc > 1 ? strtod(argv[1], NULL) : 6;
+    if (hours <= 0) hours = 1;
+    for (int e = 0; e < 3; e++) s_ev[e] = hours * 3600.0 * (e + 1) / 4.0;
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    adapt_cfg_t cfg;
+    adapt_default_cfg(&cfg);
+    uint32_t base = (uint32_t)(hours * 3600.0);
+    printf("bench_adapt: %.1f h kiln run, events at %.0f / %.0f / %.0f min, adaptive %u..%u ms\n", hours,
+           s_ev[0] / 60, s_ev[1] / 60, s_ev[2] / 60, (unsigned)cfg.min_ms, (unsigned)cfg.max_ms);
+    printf("  %-18s %8s %9s %10s %10s %8s %6s %6s\n", "mode", "records", "saved", "insert", "remove", "dip degC",
+           "speed", "jumps");
+    run("fixed 1 s", 1000, NULL, hours, base);
+    run("fixed 10 s", 10000, NULL, hours, base);
+    run("fixed 60 s", 60000, NULL, hours, base);
+    run("adaptive", SAMPLE_PERIOD_MS, &cfg, hours, base);
+    cfg.jump = 0;
+    run("adaptive, no jump", SAMPLE_PERIOD_MS, &cfg, hours, base);
+    return 0;
+}
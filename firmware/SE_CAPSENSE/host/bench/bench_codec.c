@@ -0,0 +1,165 @@
+#include "bench_util.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "acq.h"
+#include "board.h"
+#include "config.h"
+#include "bme280_drv.h"
+#include "reccodec.h"
+#include "record.h"
+#include "sampler.h"
+#include "tscodec.h"
+#include "wmc.h"
+#include "esp_log.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Size and speed of the record codecs, reccodec.c (byte-aligned deltas) and
+// tscodec.c (bit-packed, Gorilla-style), on records from the simulated
+// board sampled by the acquisition task:
+//
+//  - drying: the wood electrode (WMC_MEAS) falls from 10 to 4 pF with a
+//    2 h time constant, the others track temperature, which swings 3 degC
+//    over the day, with 2 fF of conversion noise
+//  - worst case: random values in every field, the codecs' upper bound
+//
+// Records are coded in blocks of one MQTT message (MQTT_BATCH_RECORDS) and
+// of 256. Host ns are CPU per record; "h/64KiB" is how many hours of
+// SAMPLE_PERIOD_MS data fit in 64 KiB of RAM or flash.
+//
+// usage: bench_codec [records]
+
+#define TAU_S (2 * 3600.0)
+
+typedef struct {
+    const char *name;
+    size_t (*code)(const sample_t *in, size_t k, uint8_t *buf, size_t cap, uint64_t *enc_ns, uint64_t *dec_ns,
+                   unsigned *bad);
+} codec_t;
+
+static size_t code_rc(const sample_t *in, size_t k, uint8_t *buf, size_t cap, uint64_t *enc_ns, uint64_t *dec_ns,
+                      unsigned *bad){
+    rc_enc_t e;
+    uint64_t t0 = bench_now_ns();
+    rc_enc_init(&e, buf, cap, SAMPLE_PERIOD_MS);
+    for (size_t j = 0; j < k; j++) rc_enc_add(&e, &in[j]);
+    uint64_t t1 = bench_now_ns();
+    rc_dec_t d;
+    sample_t s;
+    rc_dec_init(&d, buf, rc_enc_len(&e));
+    for (size_t j = 0; j < k; j++)
+        if (rc_dec_next(&d, &s) != ESP_OK || memcmp(&s, &in[j], sizeof(s))) (*bad)++;
+    *enc_ns += t1 - t0;
+    *dec_ns += bench_now_ns() - t1;
+    return rc_enc_len(&e);
+}
+
+static size_t code_tsc(const sample_t *in, size_t k, uint8_t *buf, size_t cap, uint64_t *enc_ns, uint64_t *dec_ns,
+                       unsigned *bad){
+    tsc_enc_t e;
+    uint64_t t0 = bench_now_ns();
+    tsc_enc_init(&e, buf, cap, SAMPLE_PERIOD_MS);
+    for (size_t j = 0; j < k; j++) tsc_enc_add(&e, &in[j]);
+    uint64_t t1 = bench_now_ns();
+    tsc_dec_t d;
+    sample_t s;
+    tsc_dec_init(&d, buf, tsc_enc_len(&e));
+    for (size_t j = 0; j < k; j++)
+        if (tsc_dec_next(&d, &s) != ESP_OK || memcmp(&s, &in[j], sizeof(s))) (*bad)++;
+    *enc_ns += t1 - t0;
+    *dec_ns += bench_now_ns() - t1;
+    return tsc_enc_len(&e);
+}
+
+static const codec_t CODECS[] = { { "reccodec", code_rc }, { "tscodec", code_tsc } };
+
+static void run(const char *set, const codec_t *c, const sample_t *in, size_t n, uint16_t block){
+    static uint8_t buf[RC_HEADER_MAX + 256 * RC_RECORD_MAX + TSC_HEADER_BYTES + 256 * TSC_RECORD_MAX];
+    int rounds = n < 100000 ? (int)(100000 / n) + 1 : 1;
+    size_t bytes = 0;
+    uint64_t enc_ns = 0, dec_ns = 0;
+    unsigned bad = 0;
+    for (int r = 0; r < rounds; r++){
+        bytes = 0;
+        for (size_t i = 0; i < n; i += block){
+            size_t k = n - i < block ? n - i : block;
+            bytes += c->code(&in[i], k, buf, sizeof(buf), &enc_ns, &dec_ns, &bad);
+        }
+    }
+    double per = (double)bytes / (double)n;
+    printf("  %-10s %-9s %5u %9.2f %6.1fx %8.1f %8.1f %8.2f %5u\n", set, c->name, (unsigned)block, per,
+           sizeof(sample_t) / per, (double)enc_ns / ((double)n * rounds), (double)dec_ns / ((double)n * rounds),
+           65536.0 / per * SAMPLE_PERIOD_MS / 3600000.0, bad);
+    if (bad) exit(1);
+}
+
+static float drying_input(void *ctx, int cin, uint64_t t_ns){
+    (void)ctx;
+    double t = (double)t_ns / 1e9;
+    double temp = 3.0 * sin(2.0 * M_PI * t / 86400.0);
+    if (cin == WMC_MEAS) return (float)(4.0 + 6.0 * exp(-t / TAU_S) + 0.02 * temp);
+    return (float)(2.0 + cin + 0.005 * temp);
+}
+
+static void sample_drying(sample_t *out, size_t n){
+    sim_board_init();
+    sim_board_fdc.input = drying_input;
+    sim_board_fdc.noise_pf = 0.002f;
+    sim_i2c_set_bus_hz(I2C_FREQ_HZ);
+    sample_t s;
+    while (record_pop(&s)) {}
+    bme_init();
+    sampler_init();
+    acq_start();
+    for (size_t i = 0; i < n;){
+        double t = (double)sim_clock_now_ns() / 1e9;
+        sim_board_bme.temp_c = (float)(21.0 + 3.0 * sin(2.0 * M_PI * t / 86400.0));
+        sim_board_bme.hum_pct = (float)(55.0 + 10.0 * exp(-t / TAU_S));
+        sim_clock_advance_ms(SAMPLE_PERIOD_MS);
+        while (i < n && record_pop(&out[i])) i++;
+    }
+    sim_clock_set_task(NULL, 0);
+}
+
+static uint32_t rnd32(void){ return (uint32_t)rand() << 16 ^ (uint32_t)rand(); }
+
+static void sample_random(sample_t *out, size_t n){
+    srand(1);
+    for (size_t i = 0; i < n; i++){
+        sample_t s = {};
+        s.t_ms = (uint64_t)rnd32() << 32 | rnd32();
+        for (int c = 0; c < 4; c++){
+            s.cap_raw[c] = (int32_t)rnd32();
+            s.capdac[c] = (uint8_t)rand();
+        }
+        s.temp_cdeg = (int32_t)rnd32();
+        s.hum_q10 = rnd32();
+        s.pres_q8 = rnd32();
+        s.mc_cpct = (uint16_t)rand();
+        s.flags = (uint16_t)rand();
+        out[i] = s;
+    }
+}
+
+int main(int argc, char **argv){
+    unsigned long n = argc > 1 ? strtoul(argv[1], NULL, 0) : 14400ul;
+    if (!n) n = 1;
+    esp_log_level_set("*", ESP_LOG_WARN);
+    sample_t *in = malloc(n * sizeof(*in));
+    if (!in) return 1;
+
+    printf("bench_codec: %lu records, sample_t %u bytes\n", n, (unsigned)sizeof(sample_t));
+    printf("  %-10s %-9s %5s %9s %7s %8s %8s %8s %5s\n", "data", "codec", "block", "bytes/rec", "ratio", "enc ns",
+           "dec ns", "h/64KiB", "bad");
+    sample_drying(in, n);
+    for (size_t c = 0; c < 2; c++){
+        run("drying", &CODECS[c], in, n, MQTT_BATCH_RECORDS);
+        run("drying", &CODECS[c], in, n, 256);
+    }
+    sample_random(in, n);
+    for (size_t c = 0; c < 2; c++) run("worst case", &CODECS[c], in, n, 256);
+    free(in);
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "bench_util.h"
+#include "cycles.h"
+#include "dsp.h"
+#include "fdc1004.h"
+#include <math.h>
+#include <stdlib.h>
+
+// Cost and effect of the per-measurement filter chain (src/dsp.c): cycles
+// and ns per input sample for several configurations, and the noise left
+// after decimating 0.01 pF-rms conversions by the ratios the sampler uses
+// (25 = 100 S/s over four measurements, 100 and 400 at 400 S/s).
+//
+// usage: bench_dsp [inputs]
+
+typedef struct { const char *name; dsp_cfg_t cfg; } case_t;
+
+static volatile int64_t s_sink;
+
+static uint32_t s_seed = 0x5eed;
+
+// ~N(0, 1) from four uniforms, as the FDC sim does
+static double noise(void){
+    double acc = 0;
+    for (int i = 0; i < 4; i++){
+        s_seed = s_seed * 1664525u + 1013904223u;
+        acc += (double)(s_seed >> 8) / 16777216.0;
+    }
+    return (acc - 2.0) * 1.7320508;
+}
+
+int main(int argc, char **argv){
+    unsigned long n = argc > 1 ? strtoul(argv[1], NULL, 0) : 2000000;
+    if (n < 1000) n = 1000;
+
+    static const case_t cases[] = {
+        { "passthrough",              { .median = 1, .decim = 1,   .cic_order = 1, .iir_shift = 0 } },
+        { "boxcar R=100",             { .median = 1, .decim = 100, .cic_order = 1, .iir_shift = 0 } },
+        { "median3 + boxcar R=100",   { .median = 3, .decim = 100, .cic_order = 1, .iir_shift = 0 } },
+        { "CIC3 R=100",               { .median = 1, .decim = 100, .cic_order = 3, .iir_shift = 0 } },
+        { "median7 + CIC3 + IIR",     { .median = 7, .decim = 100, .cic_order = 3, .iir_shift = 3 } },
+    };
+
+    int32_t *in = malloc(n * sizeof(int32_t));
+    for (unsigned long i = 0; i < n; i++) in[i] = 2 * FDC_CODES_PER_PF + (int32_t)(noise() * 0.01 * FDC_CODES_PER_PF);
+
+    printf("bench_dsp: %lu inputs per case\n", n);
+    printf("  %-26s %12s %10s\n", "filter", "cycles/in", "ns/in");
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++){
+        dsp_chan_t ch;
+        dsp_init(&ch, &cases[c].cfg);
+        int64_t sink = 0;
+        int32_t y;
+        uint64_t t0 = bench_now_ns();
+        uint32_t c0 = cyc_now();
+        for (unsigned long i = 0; i < n; i++) if (dsp_push(&ch, in[i], &y)) sink += y;
+        uint32_t cyc = cyc_now() - c0;
+        uint64_t ns = bench_now_ns() - t0;
+        s_sink = sink;
+        printf("  %-26s %12.1f %10.2f\n", cases[c].name, (double)cyc / (double)n, (double)ns / (double)n);
+    }
+
+    printf("noise after decimation (input 10000 aF rms, boxcar + median3):\n");
+    printf("  %6s %14s %12s\n", "R", "out_rms_aF", "reduction");
+    static const uint16_t ratios[] = { 1, 25, 100, 400 };
+    for (size_t r = 0; r < sizeof(ratios) / sizeof(ratios[0]); r++){
+        dsp_chan_t ch;
+        dsp_cfg_t cfg = { .median = ratios[r] > 1 ? 3 : 1, .decim = ratios[r], .cic_order = 1 };
+        dsp_init(&ch, &cfg);
+        double sq = 0;
+        unsigned long outs = 0;
+        int32_t y;
+        for (unsigned long i = 0; i < n; i++){
+            if (dsp_push(&ch, in[i], &y)){
+                double e = (double)(y - 2 * FDC_CODES_PER_PF) * 1e6 / FDC_CODES_PER_PF;
+                sq += e * e;
+                outs++;
+            }
+        }
+        double rms = sqrt(sq / (double)outs);
+        printf("  %6u %14.1f %11.1fx\n", ratios[r], rms, 10000.0 / rms);
+    }
+    free(in);
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include "bench_util.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "board.h"
+#include "fdc1004.h"
+#include "esp_log.h"
+#include <stdlib.h>
+
+// FDC1004 acquisition engine against the simulated part: four measurements
+// in repeat mode at 400 S/s, polled on the DONE bits at several periods.
+// Reports delivered results/s against conversions the part completed, the
+// modelled I2C time per result at I2C_FREQ_HZ and host CPU per poll.
+//
+// usage: bench_fdc [virtual_seconds]
+
+int main(int argc, char **argv){
+    unsigned secs = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 0) : 60;
+    if (!secs) secs = 1;
+    esp_log_level_set("*", ESP_LOG_WARN);
+    static const uint32_t periods_us[] = { 500, 1000, 2500, 5000, 10000 };
+
+    printf("bench_fdc: 4 measurements @ 400 S/s repeat, %u s virtual per run, i2c %u Hz\n",
+           secs, (unsigned)I2C_FREQ_HZ);
+    printf("  %9s %12s %12s %8s %14s %12s\n", "poll_us", "results/s", "converted/s", "missed", "bus_us/result", "cpu_ns/poll");
+
+    for (size_t i = 0; i < sizeof(periods_us) / sizeof(periods_us[0]); i++){
+        sim_board_init();
+        for (int c = 0; c < 4; c++) sim_board_fdc.cin_pf[c] = 1.0f + (float)c;
+        sim_i2c_set_bus_hz(I2C_FREQ_HZ);
+        fdc_init();
+        fdc_config_t cfg = { .rate = FDC_RATE_400SPS, .repeat = true };
+        for (int m = 0; m < FDC_NUM_MEAS; m++)
+            cfg.meas[m] = (fdc_meas_cfg_t){ .enabled = true, .cha = (fdc_input_t)m, .chb = FDC_IN_DISABLED };
+        fdc_configure(&cfg);
+
+        sim_i2c_reset_stats();
+        uint64_t conv0 = sim_board_fdc.conversions;
+        uint64_t end_ns = sim_clock_now_ns() + (uint64_t)secs * 1000000000ULL;
+        uint64_t next = sim_clock_now_ns();
+        uint64_t results = 0, polls = 0, cpu_ns = 0;
+        fdc_result_t res[FDC_NUM_MEAS];
+        while (next < end_ns){
+            next += (uint64_t)periods_us[i] * 1000ULL;
+            if (sim_clock_now_ns() < next) sim_clock_set_ns(next);
+            size_t n;
+            uint64_t t0 = bench_now_ns();
+            fdc_poll(res, FDC_NUM_MEAS, &n);
+            cpu_ns += bench_now_ns() - t0;
+            results += n;
+            polls++;
+        }
+        sim_i2c_stats_t bus;
+        sim_i2c_get_stats(&bus);
+        uint64_t conv = sim_board_fdc.conversions - conv0;
+        printf("  %9u %12.1f %12.1f %8llu %14.1f %12.1f\n", (unsigned)periods_us[i],
+               (double)results / secs, (double)conv / secs,
+               (unsigned long long)(conv > results ? conv - results : 0),
+               results ? (double)bus.wire_ns / 1000.0 / (double)results : 0.0,
+               (double)cpu_ns / (double)polls);
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "acq.h"
+#include "board.h"
+#include "config.h"
+#include "fdc1004.h"
+#include "i2cmux.h"
+#include "record.h"
+#include "sampler.h"
+#include "bme280_drv.h"
+#include "esp_log.h"
+#include <stdlib.h>
+
+// Throughput with several FDC1004s behind the TCA9548A: the firmware built
+// for FDC_DEVICES=8 (capsense_fw_mux), its acquisition task on the virtual
+// clock and a 400 kHz bus, with 1, 2, 4 and 8 devices on the mux.
+//
+// The devices convert side by side in repeat mode; each poll switches the
+// mux to one after the other and reads what they finished. It prints
+// channel samples read per second, their scaling against one device, bus
+// utilisation, and conversions overwritten before they were read.
+//
+// usage: bench_fdcmux [seconds]
+
+static double s_base;
+
+static void run(int n, unsigned long secs){
+    sim_board_init_mux(n);
+    sim_i2c_set_bus_hz(I2C_FREQ_HZ);
+    sample_t s;
+    while (record_pop(&s)) {}
+
+    bme_init();
+    sampler_init();
+    acq_start();
+
+    fdc_stats_t f0[FDC_DEVICES];
+    uint64_t conv0[FDC_DEVICES];
+    for (int d = 0; d < n; d++){
+        fdc_select((uint8_t)d);
+        fdc_get_stats(&f0[d]);
+        conv0[d] = sim_board_fdcs[d].conversions;
+    }
+    fdc_select(0);
+    sim_i2c_stats_t b0;
+    sim_i2c_get_stats(&b0);
+    i2cmux_stats_t m0;
+    i2cmux_get_stats(&m0);
+    uint32_t records = 0;
+    uint64_t t0 = sim_clock_now_ns(), end = t0 + (uint64_t)secs * 1000000000ull;
+    while (sim_clock_now_ns() < end){
+        sim_clock_advance_ms(SAMPLE_PERIOD_MS);
+        while (record_pop(&s)) records++;
+    }
+    double span = (double)(sim_clock_now_ns() - t0) / 1e9;
+
+    uint64_t results = 0, conv = 0;
+    for (int d = 0; d < n; d++){
+        fdc_stats_t f;
+        fdc_select((uint8_t)d);
+        fdc_get_stats(&f);
+        results += f.results - f0[d].results;
+        conv += sim_board_fdcs[d].conversions - conv0[d];
+    }
+    fdc_select(0);
+    sim_i2c_stats_t b;
+    sim_i2c_get_stats(&b);
+    i2cmux_stats_t m;
+    i2cmux_get_stats(&m);
+
+    double rate = (double)results / span;
+    if (n == 1) s_base = rate;
+    printf("  %7d %9.0f %9.1f%% %8.1f%% %9.0f %8u %9.2f%%\n", n, rate, 100.0 * rate / (s_base * n),
+           100.0 * (double)(b.wire_ns - b0.wire_ns) / (span * 1e9), (double)(m.writes - m0.writes) / span,
+           (unsigned)records, conv ? 100.0 * (double)(conv - results) / (double)conv : 0.0);
+    sim_clock_set_task(NULL, 0);
+}
+
+int main(int argc, char **argv){
+    unsigned long secs = argc > 1 ? strtoul(argv[1], NULL, 0) : 600ul;
+    if (!secs) secs = 1;
+    esp_log_level_set("*", ESP_LOG_NONE);   // the channels left empty fail their probe
+    printf("bench_fdcmux: %lu s, %d Hz bus, FDC1004s at %d S/s behind a TCA9548A\n", secs, I2C_FREQ_HZ, FDC_RATE_HZ);
+    printf("  %7s %9s %10s %9s %9s %8s %10s\n", "devices", "ch S/s", "scaling", "bus", "mux wr/s", "records",
+           "conv lost");
+    for (int n = 1; n <= FDC_DEVICES; n *= 2) run(n, secs);
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include "bench_util.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "sim_mqtt.h"
+#include "sim_sd.h"
+#include "board.h"
+#include "config.h"
+#include "drain.h"
+#include "forward.h"
+#include "mqtt_svc.h"
+#include "record.h"
+#include "sampler.h"
+#include "scheduler.h"
+#include "sd_logger.h"
+#include "bme280_drv.h"
+#include "i2c_bus.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+// Store-and-forward across a broker outage, with app_main's job layout on
+// the real scheduler and the simulated board, card and broker.
+//
+//  1. boot with the broker unreachable: time to the first record
+//  2. outage: records are logged to the modelled card; what the publisher
+//     cannot queue is left there while the ring stays empty
+//  3. link back (RTT_MS round trip): time until the backlog is replayed,
+//     against FWD_REPLAY_PER_S; host ns are the CPU cost of fwd_job_replay
+//     (card reads and queueing) per replayed record
+//
+// usage: bench_forward [outage seconds]
+
+#define IMG "bench_forward.img"
+#define RTT_MS 50
+#define CARD_WRITE_US 1500
+#define CARD_SECTOR_US 250
+#define TICK_MS 10          // app_main's loop delay
+
+static uint64_t s_replay_ns;
+
+static void replay_timed(void){
+    uint64_t t0 = bench_now_ns();
+    fwd_job_replay();
+    s_replay_ns += bench_now_ns() - t0;
+}
+
+static void tick(void){
+    sim_clock_advance_ms(TICK_MS);
+    sch_run_due();
+    sim_sd_run_pending();
+    sim_mqtt_run_pending();
+}
+
+int main(int argc, char **argv){
+    unsigned long outage_s = argc > 1 ? strtoul(argv[1], NULL, 0) : 3600ul;
+    if (!outage_s) outage_s = 1;
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    sim_board_init();
+    sim_i2c_set_bus_hz(I2C_FREQ_HZ);
+    sim_sd_set_path(IMG);
+    unlink(IMG);
+    sim_sd_set_capacity(1024 * SD_FRAME_SECTORS);
+    sim_sd_set_latency_us(CARD_WRITE_US, CARD_SECTOR_US);
+    sim_mqtt_reset();
+    sim_mqtt_set_ack_delay_ms(RTT_MS);
+    sim_mqtt_set_online(false);
+
+    i2c_bus_init();
+    bme_init();
+    sch_init();
+    sampler_init();
+    sch_add("sampler_poll", sampler_poll_job, SCH_MS(SAMPLE_POLL_MS), SCH_SKIP);
+    sch_add("sampler", sampler_job, SCH_MS(SAMPLE_PERIOD_MS), SCH_SKIP);
+    if (sdlog_init() != ESP_OK){
+        fprintf(stderr, "bench_forward: sdlog_init failed\n");
+        return 1;
+    }
+    drain_add_sink(sdlog_append);
+    sch_add("sdlog_flush", sdlog_job_flush, SCH_MS(RECORD_DRAIN_PERIOD_MS), SCH_SKIP);
+    sch_add("drain", drain_job, SCH_MS(RECORD_DRAIN_PERIOD_MS), SCH_SKIP);
+    mqtt_svc_init();
+    fwd_init();
+    drain_add_sink(fwd_append);
+    sch_add("fwd_replay", replay_timed, SCH_MS(MQTT_PUB_PERIOD_MS), SCH_SKIP);
+    sch_add("mqtt", mqtt_svc_job_drain, SCH_MS(MQTT_PUB_PERIOD_MS), SCH_SKIP);
+
+    while (!sampler_first_record_us()) tick();
+    printf("bench_forward: %lu s outage, %u ms round trip, replay at %u records/s\n", outage_s,
+           (unsigned)RTT_MS, (unsigned)FWD_REPLAY_PER_S);
+    printf("  first record            %8.1f ms after boot\n", (double)sampler_first_record_us() / 1000.0);
+
+    uint64_t end_ns = (uint64_t)outage_s * 1000000000ull;
+    while (sim_clock_now_ns() < end_ns) tick();
+    fwd_stats_t fs;
+    record_stats_t rs;
+    fwd_get_stats(&fs);
+    record_get_stats(&rs);
+    printf("  outage                  %8u records queued, %u spilled to SD, ring high water %u/%u, %u rejected\n",
+           (unsigned)fs.live, (unsigned)fs.spilled, (unsigned)rs.high_water, (unsigned)RECORD_RING_CAP,
+           (unsigned)rs.rejected);
+
+    sim_sd_reset_stats();
+    mqtt_svc_reset_stats();
+    s_replay_ns = 0;
+    sim_mqtt_set_online(true);
+    uint64_t back_ns = sim_clock_now_ns();
+    uint32_t replayed0 = fs.replayed;
+    do {
+        tick();
+        fwd_get_stats(&fs);
+    } while (fs.backlog);
+    double secs = (double)(sim_clock_now_ns() - back_ns) / 1e9;
+    uint32_t replayed = fs.replayed - replayed0;
+    sim_sd_stats_t ss;
+    mqtt_stats_t ms;
+    sim_sd_get_stats(&ss);
+    mqtt_svc_get_stats(&ms);
+    printf("  catch-up                %8.1f s, %.0f records/s, %u lost\n", secs, (double)replayed / secs,
+           (unsigned)fs.lost);
+    printf("  card reads              %8.2f sectors/record\n",
+           replayed ? (double)ss.sectors_read / (double)replayed : 0.0);
+    printf("  publish latency         %8.1f ms max, %u messages\n", ms.lat_max_us / 1000.0, (unsigned)ms.msgs);
+    printf("  fwd_job_replay          %8.1f host ns/record\n",
+           replayed ? (double)s_replay_ns / (double)replayed : 0.0);
+    unlink(IMG);
+    return fs.lost ? 1 : 0;
+}
@@ -0,0 +1,112 @@
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "board.h"
+#include "capfe.h"
+#include "config.h"
+#include "record.h"
+#include "sampler.h"
+#include "units.h"
+#include "bme280_drv.h"
+#include "esp_log.h"
+#include <math.h>
+#include <stdlib.h>
+
+// The two capfe.h front-ends side by side: the sampler on the simulated
+// board with an FDC1004, then with a PCAP04 in its place, each at its
+// config.h rate, all four inputs at a steady 5 pF and a 400 kHz bus.
+//
+// For each it prints the results per second a channel gets, the
+// conversions behind each one, the RMS noise of those results and of the
+// records the filter chain makes from them, and bus utilisation. The noise
+// is the models' (noise_pf per conversion, below), not a measurement of the
+// chips: what the comparison shows is what rate and on-chip averaging do
+// with it.
+//
+// usage: bench_frontend [seconds]
+
+#define INPUT_PF 5.0f
+#define FDC_NOISE_PF 0.002f    // per conversion, as the other benches
+#define PCAP_NOISE_PF 0.02f    // per 5 us conversion
+
+typedef struct {
+    double sum, sq;
+    uint32_t n;
+} acc_t;
+
+static void acc_add(acc_t *a, double v){
+    a->sum += v;
+    a->sq += v * v;
+    a->n++;
+}
+
+static double acc_rms(const acc_t *a){
+    if (a->n < 2) return 0.0;
+    double mean = a->sum / a->n, var = a->sq / a->n - mean * mean;
+    return var > 0 ? sqrt(var) : 0.0;
+}
+
+static void run(bool pcap, unsigned long secs){
+    if (pcap){
+        sim_board_init_pcap();
+        for (int m = 0; m < 4; m++) sim_board_pcap.cin_pf[m] = INPUT_PF;
+        sim_board_pcap.noise_pf = PCAP_NOISE_PF;
+    } else {
+        sim_board_init();
+        for (int m = 0; m < 4; m++) sim_board_fdc.cin_pf[m] = INPUT_PF;
+        sim_board_fdc.noise_pf = FDC_NOISE_PF;
+    }
+    sim_i2c_set_bus_hz(I2C_FREQ_HZ);
+    sample_t s;
+    while (record_pop(&s)) {}
+    bme_init();
+    sampler_init();
+    const capfe_t *fe = sampler_frontend();
+
+    // the results themselves, read the way sampler_poll_job does
+    acc_t raw = {0};
+    capfe_result_t res[CAPFE_MEAS];
+    uint64_t t0 = sim_clock_now_ns(), end = t0 + (uint64_t)secs * 1000000000ull;
+    while (sim_clock_now_ns() < end){
+        sim_clock_advance_ms(SAMPLE_POLL_MS);
+        uint8_t done;
+        size_t n;
+        if (fe->ready(&done) != ESP_OK || fe->read_batch(done, res, &n) != ESP_OK) continue;
+        for (size_t i = 0; i < n; i++)
+            if (res[i].meas == 0) acc_add(&raw, units_cap_af(res[i].raw, fe->capdac(0)));
+    }
+    double span = (double)(sim_clock_now_ns() - t0) / 1e9;
+
+    // then records through the filter chain, the first two left out
+    acc_t rec = {0};
+    sim_i2c_stats_t b0, b;
+    sim_i2c_get_stats(&b0);
+    uint64_t r0 = sim_clock_now_ns();
+    for (unsigned long k = 0; k < 2 + secs * 1000ul / SAMPLE_PERIOD_MS; k++){
+        for (int t = 0; t < SAMPLE_PERIOD_MS; t += SAMPLE_POLL_MS){
+            sim_clock_advance_ms(SAMPLE_POLL_MS);
+            sampler_poll_job();
+        }
+        sampler_job();
+        if (record_pop(&s) && k >= 2) acc_add(&rec, units_cap_af(s.cap_raw[0], s.capdac[0]));
+    }
+    sim_i2c_get_stats(&b);
+    double bus = 100.0 * (double)(b.wire_ns - b0.wire_ns) / (double)(sim_clock_now_ns() - r0);
+
+    uint32_t conv = 1;
+    if (fe->caps->averaging) conv = (uint32_t)(1e6 / fe->rate_hz() / fe->caps->conv_us / CAPFE_MEAS);
+    printf("  %-8s %9.0f %6u %10.0f %10.1f %7.1f%%\n", fe->caps->name, raw.n / span, (unsigned)conv,
+           acc_rms(&raw), acc_rms(&rec), bus);
+}
+
+int main(int argc, char **argv){
+    unsigned long secs = argc > 1 ? strtoul(argv[1], NULL, 0) : 60ul;
+    if (!secs) secs = 1;
+    esp_log_level_set("*", ESP_LOG_NONE);   // the PCAP04 board fails the FDC1004 probe
+    printf("bench_frontend: %lu s each, %d Hz bus, %.1f pF inputs, model noise %.1f / %.1f fF per conversion\n",
+           secs, I2C_FREQ_HZ, INPUT_PF, FDC_NOISE_PF * 1e3, PCAP_NOISE_PF * 1e3);
+    printf("  %-8s %9s %6s %10s %10s %8s\n", "", "ch res/s", "avg", "res aF rms", "rec aF rms", "bus");
+    run(false, secs);
+    run(true, secs);
+    return 0;
+}
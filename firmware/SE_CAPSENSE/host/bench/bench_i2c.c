@@ -0,0 +1,109 @@
+#include "bench_util.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "board.h"
+#include "i2c_bus.h"
+#include "fdc1004.h"
+#include "bme280_drv.h"
+#include "esp_log.h"
+#include <stdlib.h>
+
+// Per-sample bus cost of reading the four FDC results and the BME280 data
+// registers three ways:
+//   one-off   one i2c_rd per register, link built and torn down every time
+//   prepared  fdc_read_raw + bme_read, one pre-built transaction per device
+//   burst     both prepared reads chained into one transaction (sampler_job)
+// Host ns are CPU time in the bus layer and drivers; bus figures are the
+// modelled wire time at the clock the bus settled on.
+//
+// usage: bench_i2c [iterations]
+
+typedef struct {
+    const char *name;
+    uint64_t cpu_ns;
+    sim_i2c_stats_t bus;
+} result_t;
+
+static void one_off(void){
+    uint8_t b[8];
+    for (uint8_t reg = 0; reg < 2 * FDC_NUM_MEAS; reg++) i2c_rd(FDC1004_I2C_ADDR, reg, b, 2);
+    i2c_rd(BME280_I2C_ADDR, 0xF7, b, 8);
+}
+
+static void prepared(void){
+    int32_t cap[4], t;
+    uint32_t h, p;
+    bool sat;
+    fdc_read_raw(cap, &sat);
+    bme_read(&t, &h, &p);
+}
+
+static i2c_txn_id_t s_burst;
+
+static void burst(void){
+    int32_t cap[4], t;
+    uint32_t h, p;
+    bool sat;
+    i2c_txn_run(s_burst);
+    fdc_results_raw(cap, &sat);
+    bme_meas_decode(&t, &h, &p);
+}
+
+static result_t run(const char *name, void (*fn)(void), unsigned long iters){
+    result_t r = { .name = name };
+    sim_i2c_reset_stats();
+    uint64_t t0 = bench_now_ns();
+    for (unsigned long i = 0; i < iters; i++){
+        sim_clock_advance_ms(1);
+        fn();
+    }
+    r.cpu_ns = bench_now_ns() - t0;
+    sim_i2c_get_stats(&r.bus);
+    return r;
+}
+
+int main(int argc, char **argv){
+    unsigned long iters = argc > 1 ? strtoul(argv[1], NULL, 0) : 200000;
+    if (!iters) iters = 1;
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    sim_board_init();
+    i2c_bus_init();
+    bme_init();
+    fdc_init();
+    fdc_config_default();
+    i2c_txn_id_t parts[2] = { fdc_results_txn(), bme_meas_txn() };
+    s_burst = i2c_txn_prepare_burst(parts, 2);
+    sim_i2c_set_bus_hz(i2c_bus_speed_hz());
+
+    result_t res[3] = {
+        run("one-off", one_off, iters),
+        run("prepared", prepared, iters),
+        run("burst", burst, iters),
+    };
+
+    printf("bench_i2c: %lu samples (4 FDC results + BME280 data), i2c %u Hz\n",
+           iters, (unsigned)i2c_bus_speed_hz());
+    printf("  %-10s %10s %12s %12s %14s %14s\n", "mode", "xfers", "bytes", "bus_us", "max_samples/s", "cpu_ns");
+    for (int i = 0; i < 3; i++){
+        double bus_us = (double)res[i].bus.wire_ns / 1000.0 / (double)iters;
+        printf("  %-10s %10.2f %12.1f %12.1f %14.0f %14.1f\n", res[i].name,
+               (double)res[i].bus.xfers / (double)iters, (double)res[i].bus.bytes / (double)iters,
+               bus_us, 1e6 / bus_us, (double)res[i].cpu_ns / (double)iters);
+    }
+
+    i2c_dev_stats_t st[I2C_STATS_MAX_DEVS];
+    size_t n = i2c_bus_get_stats(st, I2C_STATS_MAX_DEVS);
+    printf("per-device (all modes):\n");
+    printf("  %-6s %10s %8s %8s %10s   latency histogram (bucket: count)\n", "addr", "xfers", "errors", "max_us", "mean_us");
+    for (size_t i = 0; i < n; i++){
+        uint32_t errs = st[i].nacks + st[i].timeouts + st[i].other_errors;
+        printf("  0x%02x   %10u %8u %8u %10.1f  ", st[i].addr, (unsigned)st[i].xfers, (unsigned)errs,
+               (unsigned)st[i].max_us, st[i].xfers ? (double)st[i].total_us / st[i].xfers : 0.0);
+        for (int b = 0; b < I2C_HIST_BUCKETS; b++)
+            if (st[i].hist[b]) printf(" %d:%u", b, (unsigned)st[i].hist[b]);
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include "bench_util.h"
+#include "config.h"
+#include "drain.h"
+#include "mqtt_svc.h"
+#include "record.h"
+#include "sim_clock.h"
+#include "sim_mqtt.h"
+#include "esp_log.h"
+#include <stdlib.h>
+
+// MQTT publisher throughput against the fake broker.
+//
+// A backlog of records (as after a broker outage) is drained through the
+// record ring into mqtt_svc with the firmware's job periods. The broker
+// acknowledges after a fixed round trip, so the link carries at most
+// MQTT_INFLIGHT_MAX messages per round trip or job period, whichever is
+// longer: records/s scale with the batch size. Host ns are the CPU cost of
+// mqtt_svc_job_drain (encoding and handing messages to the client) per
+// record. Latency is publish to the job that collects the PUBACK, so it
+// is quantised to MQTT_PUB_PERIOD_MS.
+//
+// usage: bench_mqtt [records]
+
+#define RTT_MS 50
+
+static void run(const char *name, uint16_t batch, unsigned long n, uint32_t drop_one_in){
+    sim_mqtt_reset();
+    sim_mqtt_set_ack_delay_ms(RTT_MS);
+    mqtt_svc_set_batch(batch);
+    mqtt_svc_init();
+    drain_add_sink(mqtt_svc_append);
+    sample_t s = {0};
+    while (record_pop(&s)) {}
+    sim_mqtt_run_pending();
+    mqtt_svc_job_drain();
+    mqtt_svc_reset_stats();
+
+    uint64_t v0 = sim_clock_now_ns(), cpu_ns = 0;
+    unsigned long pushed = 0;
+    uint32_t dropped = 0;
+    mqtt_stats_t st;
+    for (;;){
+        while (pushed < n && record_count() < RECORD_RING_CAP){
+            s.t_ms = pushed++;
+            s.cap_raw[0] = (int32_t)(pushed * 7919u);
+            record_push(&s);
+        }
+        sim_clock_advance_ms(MQTT_PUB_PERIOD_MS);
+        sim_mqtt_run_pending();
+        drain_job();
+        uint64_t t0 = bench_now_ns();
+        mqtt_svc_job_drain();
+        cpu_ns += bench_now_ns() - t0;
+
+        mqtt_svc_get_stats(&st);
+        if (drop_one_in && st.msgs / drop_one_in > dropped){
+            sim_mqtt_drop_acks(1);
+            dropped++;
+        }
+        if (pushed == n && !record_count() && st.records_sent == n && !st.inflight) break;
+    }
+    double secs = (double)(sim_clock_now_ns() - v0) / 1e9;
+    printf("  %-24s %4u %7u %9.1f %9.0f %8.1f %8.1f %6u %10.1f\n", name, (unsigned)batch, (unsigned)st.msgs,
+           (double)st.bytes / (double)n, (double)n / secs,
+           st.acks ? (double)st.lat_total_us / st.acks / 1000.0 : 0.0, st.lat_max_us / 1000.0,
+           (unsigned)st.retransmits, (double)cpu_ns / (double)n);
+}
+
+int main(int argc, char **argv){
+    unsigned long n = argc > 1 ? strtoul(argv[1], NULL, 0) : 20000ul;
+    n = n / MQTT_BATCH_RECORDS * MQTT_BATCH_RECORDS;   // whole batches, no age timeout at the end
+    if (!n) n = MQTT_BATCH_RECORDS;
+    esp_log_level_set("*", ESP_LOG_WARN);
+    printf("bench_mqtt: %lu records, %u in flight, %u ms round trip, publish job every %u ms\n", n,
+           (unsigned)MQTT_INFLIGHT_MAX, (unsigned)RTT_MS, (unsigned)MQTT_PUB_PERIOD_MS);
+    printf("  %-24s %4s %7s %9s %9s %8s %8s %6s %10s\n", "", "recs", "msgs", "bytes/rec", "rec/s",
+           "lat avg", "lat max", "retx", "host ns/rec");
+    run("one per message", 1, n, 0);
+    run("batch 4", 4, n, 0);
+    run("batch 16", MQTT_BATCH_RECORDS, n, 0);
+    run("batch 16, 2% acks lost", MQTT_BATCH_RECORDS, n, 50);
+    return 0;
+}
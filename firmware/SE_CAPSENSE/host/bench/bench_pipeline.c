@@ -0,0 +1,113 @@
+#include "bench_util.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "sim_mqtt.h"
+#include "board.h"
+#include "config.h"
+#include "sampler.h"
+#include "record.h"
+#include "mqtt_svc.h"
+#include "fdc1004.h"
+#include "bme280_drv.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <string.h>
+
+// End-to-end cost of the sampling hot path against the simulated board:
+//   sampler_job (fdc_read_raw + bme_read + record_push) -> record_pop -> mqtt_svc_enqueue
+//   -> mqtt_svc_job_drain (a batch of MQTT_BATCH_RECORDS is encoded and
+//      published every MQTT_BATCH_RECORDS samples; the fake broker acks at once)
+// Wall-clock ns are host CPU time; I2C figures are the modelled bus traffic
+// per sample at I2C_FREQ_HZ.
+//
+// usage: bench_pipeline [iterations] [-v]   (-v keeps INFO logging enabled)
+
+int main(int argc, char **argv){
+    unsigned long iters = 200000;
+    bool verbose = false;
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "-v") == 0) verbose = true;
+        else iters = strtoul(argv[i], NULL, 0);
+    }
+    if (!iters) iters = 1;
+    esp_log_level_set("*", verbose ? ESP_LOG_INFO : ESP_LOG_WARN);
+
+    sim_board_init();
+    for (int i = 0; i < 4; i++) sim_board_fdc.cin_pf[i] = 2.0f + (float)i;
+    sim_board_fdc.noise_pf = 0.002f;
+    sim_i2c_set_bus_hz(I2C_FREQ_HZ);
+
+    bme_init();
+    sampler_init();
+    mqtt_svc_init();
+    sim_i2c_reset_stats();
+
+    bench_stage_t st_job = { .name = "sampler_job" };
+    bench_stage_t st_pop = { .name = "record_pop" };
+    bench_stage_t st_enq = { .name = "mqtt_svc_enqueue" };
+    bench_stage_t st_pub = { .name = "mqtt_svc_job_drain" };
+    uint64_t e2e_ns = 0;
+    sample_t s;
+
+    for (unsigned long i = 0; i < iters; i++){
+        sim_clock_advance_ms(SAMPLE_PERIOD_MS);
+        uint64_t t0 = bench_now_ns();
+        sampler_job();
+        uint64_t t1 = bench_now_ns();
+        bool ok = record_pop(&s);
+        uint64_t t2 = bench_now_ns();
+        if (ok) mqtt_svc_enqueue(&s);
+        uint64_t t3 = bench_now_ns();
+        sim_mqtt_run_pending();
+        uint64_t t4 = bench_now_ns();
+        mqtt_svc_job_drain();
+        uint64_t t5 = bench_now_ns();
+        bench_stage_add(&st_job, t0, t1);
+        bench_stage_add(&st_pop, t1, t2);
+        bench_stage_add(&st_enq, t2, t3);
+        bench_stage_add(&st_pub, t4, t5);
+        e2e_ns += (t3 - t0) + (t5 - t4);
+    }
+
+    sim_i2c_stats_t bus;
+    sim_i2c_get_stats(&bus);
+
+    // Per-stage breakdown of what sampler_job does internally.
+    bench_stage_t st_fdc = { .name = "fdc_read_raw" };
+    bench_stage_t st_bme = { .name = "bme_read" };
+    bench_stage_t st_push = { .name = "record_push" };
+    int32_t cap[4], t;
+    uint32_t h, p;
+    bool sat;
+    for (unsigned long i = 0; i < iters; i++){
+        sim_clock_advance_ms(SAMPLE_PERIOD_MS);
+        uint64_t t0 = bench_now_ns();
+        fdc_read_raw(cap, &sat);
+        uint64_t t1 = bench_now_ns();
+        bme_read(&t, &h, &p);
+        uint64_t t2 = bench_now_ns();
+        record_push(&s);
+        uint64_t t3 = bench_now_ns();
+        record_pop(&s);
+        bench_stage_add(&st_fdc, t0, t1);
+        bench_stage_add(&st_bme, t1, t2);
+        bench_stage_add(&st_push, t2, t3);
+    }
+
+    printf("bench_pipeline: %lu samples\n", iters);
+    printf("  end-to-end             %10.1f ns/sample %10.0f samples/s\n",
+           (double)e2e_ns / (double)iters, (double)iters * 1e9 / (double)e2e_ns);
+    bench_stage_print(&st_job);
+    bench_stage_print(&st_pop);
+    bench_stage_print(&st_enq);
+    bench_stage_print(&st_pub);
+    printf("sampler_job breakdown:\n");
+    bench_stage_print(&st_fdc);
+    bench_stage_print(&st_bme);
+    bench_stage_print(&st_push);
+    printf("i2c @ %u Hz: %.2f xfers/sample, %.1f bytes/sample, %.1f us bus time/sample, %u nacks\n",
+           (unsigned)I2C_FREQ_HZ, (double)bus.xfers / (double)iters, (double)bus.bytes / (double)iters,
+           (double)bus.wire_ns / 1000.0 / (double)iters, (unsigned)bus.nacks);
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include "bench_util.h"
+#include "sim_board.h"
+#include "bme280_drv.h"
+#include "config.h"
+#include "prof.h"
+#include "record.h"
+#include "sampler.h"
+#include "stats.h"
+#include "esp_log.h"
+#include <stdlib.h>
+
+// Cost of the cycle probes themselves (host ns per call: a bracketed empty
+// section against the bare loop, and prof_record alone), of building the
+// stats snapshot, and the probe table after n simulated sampler runs. Host
+// probe cycles are the TSC's, not the C3's.
+//
+// usage: bench_prof [calls]
+
+static volatile uint32_t s_sink;
+
+int main(int argc, char **argv){
+    unsigned long n = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000000ul;
+    if (!n) n = 1;
+    esp_log_level_set("*", ESP_LOG_NONE);
+    uint64_t t0, bare, probed, rec, snap;
+
+    t0 = bench_now_ns();
+    for (unsigned long i = 0; i < n; i++) s_sink = (uint32_t)i;
+    bare = bench_now_ns() - t0;
+
+    prof_reset();
+    t0 = bench_now_ns();
+    for (unsigned long i = 0; i < n; i++){
+        PROF_START(PROF_SAMPLER_POLL);
+        s_sink = (uint32_t)i;
+        PROF_STOP(PROF_SAMPLER_POLL);
+    }
+    probed = bench_now_ns() - t0;
+
+    t0 = bench_now_ns();
+    for (unsigned long i = 0; i < n; i++) prof_record(PROF_SCH_LOOP, (uint32_t)i);
+    rec = bench_now_ns() - t0;
+
+    sim_board_init();
+    prof_reset();
+    if (bme_init() != ESP_OK) return 1;
+    sampler_init();
+    unsigned long runs = n / 100 ? n / 100 : 1;
+    sample_t s;
+    for (unsigned long i = 0; i < runs; i++){
+        sampler_poll_job();
+        sampler_job();
+        while (record_pop(&s)) {}
+    }
+
+    static char buf[STATS_JSON_MAX];
+    size_t len = 0;
+    t0 = bench_now_ns();
+    for (unsigned long i = 0; i < runs; i++) len = stats_format(buf, sizeof(buf));
+    snap = bench_now_ns() - t0;
+
+    printf("bench_prof: %lu calls, PROF_ENABLE %d\n", n, PROF_ENABLE);
+    printf("  %-24s %10.1f ns/call\n", "bare loop", (double)bare / (double)n);
+    printf("  %-24s %10.1f ns/call\n", "PROF_START/STOP", (double)probed / (double)n);
+    printf("  %-24s %10.1f ns/call\n", "prof_record", (double)rec / (double)n);
+    printf("  %-24s %10.1f ns/call, %u bytes\n", "stats_format", (double)snap / (double)runs, (unsigned)len);
+    printf("  %-14s %8s %10s %10s %10s\n", "probe", "calls", "p50", "p99", "max");
+    for (int i = 0; i < PROF_COUNT; i++){
+        prof_probe_t p;
+        prof_get((prof_id_t)i, &p);
+        printf("  %-14s %8u %10u %10u %10u\n", prof_name((prof_id_t)i), (unsigned)p.count,
+               (unsigned)prof_percentile(&p, 50), (unsigned)prof_percentile(&p, 99), (unsigned)p.max);
+    }
+    return len >= sizeof(buf);
+}
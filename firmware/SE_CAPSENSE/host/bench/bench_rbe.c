@@ -0,0 +1,181 @@
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "acq.h"
+#include "board.h"
+#include "bme280_drv.h"
+#include "config.h"
+#include "rbe.h"
+#include "record.h"
+#include "sampler.h"
+#include "esp_log.h"
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// How much report by exception (src/rbe.c) saves on the MQTT link, on a
+// kiln run from the simulated board sampled by the acquisition task (the
+// moisture electrode falling from 10 to 4 pF with a 6 h time constant,
+// temperature swinging 3 degC a day, 2 fF of conversion noise), or on
+// records from a CSV file (rc2csv or i2creplay -o).
+//
+// For each deadband it prints the records published and suppressed, why
+// they went out, and the messages a board sends per day once they are
+// batched like mqtt_svc.c does (MQTT_BATCH_RECORDS, MQTT_BATCH_MAX_AGE_MS),
+// with the broker's message rate for a fleet of FLEET boards.
+//
+// usage: bench_rbe [hours] [-c records.csv]
+
+#define TAU_S (6 * 3600.0)
+#define FLEET 500
+
+static float drying_input(void *ctx, int cin, uint64_t t_ns){
+    (void)ctx;
+    double t = (double)t_ns / 1e9;
+    double temp = 3.0 * sin(2.0 * M_PI * t / 86400.0);
+    if (cin == WMC_MEAS) return (float)(4.0 + 6.0 * exp(-t / TAU_S) + 0.02 * temp);
+    return (float)(2.0 + cin + 0.005 * temp);
+}
+
+static size_t sample_drying(sample_t *out, size_t n){
+    sim_board_init();
+    sim_board_fdc.input = drying_input;
+    sim_board_fdc.noise_pf = 0.002f;
+    sim_i2c_set_bus_hz(I2C_FREQ_HZ);
+    sample_t s;
+    while (record_pop(&s)) {}
+    bme_init();
+    sampler_init();
+    acq_start();
+    size_t i = 0;
+    while (i < n){
+        double t = (double)sim_clock_now_ns() / 1e9;
+        sim_board_bme.temp_c = (float)(21.0 + 3.0 * sin(2.0 * M_PI * t / 86400.0));
+        sim_board_bme.hum_pct = (float)(55.0 + 10.0 * exp(-t / TAU_S));
+        sim_clock_advance_ms(SAMPLE_PERIOD_MS);
+        while (i < n && record_pop(&out[i])) i++;
+    }
+    sim_clock_set_task(NULL, 0);
+    return i;
+}
+
+static size_t read_csv(const char *path, sample_t **out){
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    size_t n = 0, cap = 4096;
+    sample_t *v = malloc(cap * sizeof(*v));
+    char line[256];
+    while (v && fgets(line, sizeof(line), f)){
+        sample_t s = {};
+        unsigned dac[4], mc, flags;
+        if (sscanf(line, "%" SCNu64 ",%" SCNd32 ",%" SCNd32 ",%" SCNd32 ",%" SCNd32 ",%u,%u,%u,%u,%" SCNd32 ",%" SCNu32
+                   ",%" SCNu32 ",%u,%u", &s.t_ms, &s.cap_raw[0], &s.cap_raw[1], &s.cap_raw[2], &s.cap_raw[3], &dac[0],
+                   &dac[1], &dac[2], &dac[3], &s.temp_cdeg, &s.hum_q10, &s.pres_q8, &mc, &flags) != 14)
+            continue;   // header
+        for (int c = 0; c < 4; c++) s.capdac[c] = (uint8_t)dac[c];
+        s.mc_cpct = (uint16_t)mc;
+        s.flags = (uint16_t)flags;
+        if (n == cap) v = realloc(v, (cap *= 2) * sizeof(*v));
+        if (v) v[n++] = s;
+    }
+    fclose(f);
+    *out = v;
+    return v ? n : 0;
+}
+
+// Messages mqtt_svc would send for the records published at times t.
+static uint32_t batches(const uint64_t *t, size_t n){
+    uint32_t msgs = 0;
+    size_t in = 0;
+    uint64_t open = 0;
+    for (size_t i = 0; i < n; i++){
+        if (in && t[i] - open >= MQTT_BATCH_MAX_AGE_MS){
+            msgs++;
+            in = 0;
+        }
+        if (!in) open = t[i];
+        if (++in == MQTT_BATCH_RECORDS){
+            msgs++;
+            in = 0;
+        }
+    }
+    return msgs + (in ? 1 : 0);
+}
+
+static void run(const char *name, const rbe_cfg_t *cfg, const sample_t *in, size_t n, uint64_t *t){
+    rbe_t r;
+    size_t k = 0;
+    if (cfg){
+        rbe_init(&r, cfg);
+        for (size_t i = 0; i < n; i++){
+            uint16_t why = rbe_test(&r, &in[i]);
+            rbe_note(&r, &in[i], why);
+            if (why) t[k++] = in[i].t_ms;
+        }
+    } else {
+        memset(&r, 0, sizeof(r));
+        for (size_t i = 0; i < n; i++) t[k++] = in[i].t_ms;
+        r.stats.offered = r.stats.published = (uint32_t)n;
+    }
+    double days = (double)(in[n - 1].t_ms - in[0].t_ms + SAMPLE_PERIOD_MS) / 86400000.0;
+    uint32_t msgs = batches(t, k);
+    uint32_t chan = 0;
+    for (int c = 0; c < RBE_CHANNELS; c++) chan += r.stats.why[c];
+    printf("  %-22s %9u %7.2f %% %8u %8u %8u %10.0f %10.2f\n", name, (unsigned)k,
+           100.0 * (1.0 - (double)k / (double)n), (unsigned)chan, (unsigned)r.stats.why[RBE_HEARTBEAT],
+           (unsigned)r.stats.why[RBE_FLAGS], (double)msgs / days, (double)msgs / days * FLEET / 86400.0);
+}
+
+int main(int argc, char **argv){
+    double hours = 24;
+    const char *csv = NULL;
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) csv = argv[++i];
+        else hours = strtod(argv[i], NULL);
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+    sample_t *in = NULL;
+    size_t n;
+    if (csv){
+        n = read_csv(csv, &in);
+        if (!n){
+            fprintf(stderr, "bench_rbe: no records in %s\n", csv);
+            return 1;
+        }
+    } else {
+        n = (size_t)(hours * 3600000.0 / SAMPLE_PERIOD_MS);
+        if (!n) n = 1;
+        in = malloc(n * sizeof(*in));
+        if (!in) return 1;
+        n = sample_drying(in, n);
+    }
+    uint64_t *t = malloc(n * sizeof(*t));
+    if (!t) return 1;
+
+    printf("bench_rbe: %zu records over %.1f h (%s), batches of %u or %u ms, fleet of %u\n", n,
+           (double)(in[n - 1].t_ms - in[0].t_ms + SAMPLE_PERIOD_MS) / 3600000.0, csv ? csv : "simulated drying",
+           (unsigned)MQTT_BATCH_RECORDS, (unsigned)MQTT_BATCH_MAX_AGE_MS, (unsigned)FLEET);
+    printf("  %-22s %9s %9s %8s %8s %8s %10s %10s\n", "deadband", "published", "suppr", "moved", "heartbt", "flags",
+           "msgs/day", "fleet msg/s");
+    rbe_cfg_t def, cfg;
+    rbe_default_cfg(&def);
+    run("off (every record)", NULL, in, n, t);
+    run("RBE_* defaults", &def, in, n, t);
+    cfg = def;
+    cfg.heartbeat_ms = 0;
+    run("defaults, no heartbeat", &cfg, in, n, t);
+    cfg = def;
+    for (int c = 0; c < RBE_CHANNELS; c++) cfg.abs[c] = c < 4 ? def.abs[c] / 2 : def.abs[c];
+    run("capacitance / 2", &cfg, in, n, t);
+    cfg = def;
+    for (int c = 0; c < RBE_CHANNELS; c++) cfg.abs[c] = c == 7 ? def.abs[c] : RBE_IGNORE;
+    run("moisture only", &cfg, in, n, t);
+    cfg = def;
+    for (int c = 0; c < RBE_CHANNELS; c++) cfg.rel_permille[c] = 5;
+    run("defaults or 0.5 %", &cfg, in, n, t);
+    free(t);
+    free(in);
+    return 0;
+}
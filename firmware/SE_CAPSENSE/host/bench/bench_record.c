@@ -0,0 +1,126 @@
+#include "bench_util.h"
+#include "record.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+// Record ring cost: the lock-free SPSC ring in src/record.c against the
+// previous volatile-counter ring (reproduced below), single-threaded, plus
+// the new ring's cross-thread throughput.
+//
+// usage: bench_record [iterations]
+
+// ---- previous implementation (modulo indexing, non-atomic count) ----
+static sample_t legacy_q[RECORD_RING_CAP];
+static volatile size_t legacy_head = 0, legacy_tail = 0, legacy_count = 0;
+
+static bool legacy_push(const sample_t *s){
+    if (legacy_count >= RECORD_RING_CAP) return false;
+    legacy_q[legacy_head] = *s; legacy_head = (legacy_head + 1) % RECORD_RING_CAP; legacy_count++; return true;
+}
+
+static bool legacy_pop(sample_t *s){
+    if (!legacy_count) return false;
+    *s = legacy_q[legacy_tail]; legacy_tail = (legacy_tail + 1) % RECORD_RING_CAP; legacy_count--; return true;
+}
+
+#define BURST 16
+
+static double per_record(uint64_t ns, unsigned long n){ return (double)ns / (double)n; }
+
+static unsigned long s_iters;
+static volatile uint64_t s_sink;
+
+static void *producer(void *arg){
+    (void)arg;
+    sample_t s = {0};
+    for (unsigned long i = 0; i < s_iters; i++){
+        s.t_ms = i;
+        while (!record_push(&s)) sched_yield();
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv){
+    unsigned long iters = argc > 1 ? strtoul(argv[1], NULL, 0) : 4000000ul;
+    iters -= iters % BURST;
+    if (!iters) iters = BURST;
+    sample_t s = {0}, out[BURST];
+    uint64_t sink = 0;
+
+    // push BURST then pop BURST, so both rings see the same fill pattern
+    uint64_t t0 = bench_now_ns();
+    for (unsigned long i = 0; i < iters; i += BURST){
+        for (int k = 0; k < BURST; k++){ s.t_ms = i + k; legacy_push(&s); }
+        for (int k = 0; k < BURST; k++){ legacy_pop(&s); sink += s.t_ms; }
+    }
+    uint64_t t_legacy = bench_now_ns() - t0;
+
+    t0 = bench_now_ns();
+    for (unsigned long i = 0; i < iters; i += BURST){
+        for (int k = 0; k < BURST; k++){ s.t_ms = i + k; record_push(&s); }
+        for (int k = 0; k < BURST; k++){ record_pop(&s); sink += s.t_ms; }
+    }
+    uint64_t t_spsc = bench_now_ns() - t0;
+
+    t0 = bench_now_ns();
+    for (unsigned long i = 0; i < iters; i += BURST){
+        for (int k = 0; k < BURST; k++){ s.t_ms = i + k; record_push(&s); }
+        size_t n = record_pop_batch(out, BURST);
+        sink += out[n - 1].t_ms;
+    }
+    uint64_t t_batch = bench_now_ns() - t0;
+
+    t0 = bench_now_ns();
+    for (unsigned long i = 0; i < iters; i += BURST){
+        for (int k = 0; k < BURST; k++){
+            sample_t *slot = record_reserve();
+            slot->t_ms = i + k;
+            record_publish();
+        }
+        const sample_t *p;
+        size_t n;
+        while ((n = record_peek(&p, BURST)) != 0){
+            for (size_t k = 0; k < n; k++) sink += p[k].t_ms;
+            record_commit(n);
+        }
+        record_commit(0);
+    }
+    uint64_t t_zero = bench_now_ns() - t0;
+
+    record_set_overflow(RECORD_OVERFLOW_DROP_OLDEST);
+    t0 = bench_now_ns();
+    for (unsigned long i = 0; i < iters; i++){ s.t_ms = i; record_push(&s); }
+    uint64_t t_drop = bench_now_ns() - t0;
+    while (record_pop_batch(out, BURST)) {}
+    record_set_overflow(RECORD_OVERFLOW_REJECT);
+
+    s_iters = iters;
+    pthread_t th;
+    t0 = bench_now_ns();
+    pthread_create(&th, NULL, producer, NULL);
+    unsigned long got = 0;
+    while (got < iters){
+        size_t n = record_pop_batch(out, BURST);
+        if (n) sink += out[n - 1].t_ms;
+        else sched_yield();
+        got += n;
+    }
+    pthread_join(th, NULL);
+    uint64_t t_threads = bench_now_ns() - t0;
+    s_sink = sink;
+
+    record_stats_t st;
+    record_get_stats(&st);
+    printf("bench_record: %lu records, sample_t = %zu bytes, cap = %u\n", iters, sizeof(sample_t), (unsigned)RECORD_RING_CAP);
+    printf("  legacy push+pop        %8.2f ns/record\n", per_record(t_legacy, iters));
+    printf("  spsc push+pop          %8.2f ns/record\n", per_record(t_spsc, iters));
+    printf("  spsc push+pop_batch    %8.2f ns/record\n", per_record(t_batch, iters));
+    printf("  spsc reserve+peek      %8.2f ns/record (zero-copy)\n", per_record(t_zero, iters));
+    printf("  spsc push, drop-oldest %8.2f ns/record (always full)\n", per_record(t_drop, iters));
+    printf("  spsc 2 threads         %8.2f ns/record %10.0f records/s\n",
+           per_record(t_threads, iters), (double)iters * 1e9 / (double)t_threads);
+    printf("  stats: pushed=%u rejected=%u dropped=%u high_water=%u\n",
+           (unsigned)st.pushed, (unsigned)st.rejected, (unsigned)st.dropped, (unsigned)st.high_water);
+    return 0;
+}
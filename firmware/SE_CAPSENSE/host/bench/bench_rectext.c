@@ -0,0 +1,180 @@
+#include "bench_util.h"
+#include "config.h"
+#include "fdc1004.h"
+#include "rectext.h"
+#include "record.h"
+#include "units.h"
+#include "wmc.h"
+#include "esp_log.h"
+#include <inttypes.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Text encoding of records, rectext.c against the snprintf it replaces:
+//
+//  - codes JSON: mqtt_svc.h's "/data" record (integers), snprintf as
+//    mqtt_svc.c had it
+//  - units JSON / CSV: the record in pF, degC, %RH, hPa and %, snprintf
+//    with "%.6f" etc. on doubles, the obvious way to write it
+//
+// Records are a plank drying at SAMPLE_PERIOD_MS (the wood electrode from
+// 10 to 4 pF, temperature swinging over the day, a little noise), encoded
+// in batches of MQTT_BATCH_RECORDS into one buffer. Both encoders must give
+// the same bytes ("bad" counts records that differ). Host ns per record;
+// on the ESP32-C3, without an FPU, "%f" runs on soft-float doubles and the
+// gap is wider than here.
+//
+// usage: bench_rectext [records]
+
+#define TAU_S (2 * 3600.0)
+
+typedef size_t (*enc_fn)(char *buf, size_t cap, const sample_t *in, size_t k);
+
+static size_t put_rt(char *buf, size_t cap, const sample_t *in, size_t k, rt_fmt_t fmt){
+    rt_enc_t e;
+    rt_enc_init(&e, buf, cap, fmt);
+    for (size_t i = 0; i < k; i++) rt_enc_add(&e, &in[i]);
+    return rt_enc_len(&e);
+}
+
+static size_t rt_codes(char *buf, size_t cap, const sample_t *in, size_t k){ return put_rt(buf, cap, in, k, RT_JSON_CODES); }
+static size_t rt_json(char *buf, size_t cap, const sample_t *in, size_t k){ return put_rt(buf, cap, in, k, RT_JSON); }
+static size_t rt_csv(char *buf, size_t cap, const sample_t *in, size_t k){ return put_rt(buf, cap, in, k, RT_CSV); }
+
+static size_t pf_codes(char *buf, size_t cap, const sample_t *in, size_t k){
+    int len = 0;
+    for (size_t i = 0; i < k; i++){
+        const sample_t *s = &in[i];
+        len += snprintf(buf + len, cap - (size_t)len, "%s{\"t\":%" PRIu64 ",\"u\":%" PRIu64 ",\"e\":%" PRIu64 ",\"cap\":[",
+                        i ? "," : "", s->t_ms, s->t_us, s->epoch_us);
+        for (int c = 0; c < SAMPLE_CAPS; c++)
+            len += snprintf(buf + len, cap - (size_t)len, "%s%" PRId32, c ? "," : "", s->cap_raw[c]);
+        len += snprintf(buf + len, cap - (size_t)len, "],\"dac\":[");
+        for (int c = 0; c < SAMPLE_CAPS; c++)
+            len += snprintf(buf + len, cap - (size_t)len, "%s%u", c ? "," : "", s->capdac[c]);
+        len += snprintf(buf + len, cap - (size_t)len,
+                        "],\"tc\":%" PRId32 ",\"rh\":%" PRIu32 ",\"pa\":%" PRIu32 ",\"mc\":%u,\"f\":%u}",
+                        s->temp_cdeg, s->hum_q10, s->pres_q8, s->mc_cpct, s->flags);
+    }
+    return (size_t)len;
+}
+
+static int pf_mc(char *p, size_t cap, const sample_t *s){
+    return s->mc_cpct == WMC_INVALID ? snprintf(p, cap, "null") : snprintf(p, cap, "%.2f", s->mc_cpct / 100.0);
+}
+
+static size_t pf_json(char *buf, size_t cap, const sample_t *in, size_t k){
+    int len = 0;
+    for (size_t i = 0; i < k; i++){
+        const sample_t *s = &in[i];
+        len += snprintf(buf + len, cap - (size_t)len, "%s{\"t\":%" PRIu64 ",\"e\":%" PRIu64 ",\"pf\":[", i ? "," : "",
+                        s->t_ms, s->epoch_us);
+        for (int c = 0; c < SAMPLE_CAPS; c++)
+            len += snprintf(buf + len, cap - (size_t)len, "%s%.6f", c ? "," : "",
+                            units_cap_af(s->cap_raw[c], s->capdac[c]) / 1e6);
+        len += snprintf(buf + len, cap - (size_t)len, "],\"degc\":%.2f,\"rh\":%.3f,\"hpa\":%.2f,\"mc\":",
+                        s->temp_cdeg / 100.0, units_hum_mpct(s->hum_q10) / 1000.0, units_pres_pa(s->pres_q8) / 100.0);
+        len += pf_mc(buf + len, cap - (size_t)len, s);
+        len += snprintf(buf + len, cap - (size_t)len, ",\"f\":%u}", s->flags);
+    }
+    return (size_t)len;
+}
+
+static size_t pf_csv(char *buf, size_t cap, const sample_t *in, size_t k){
+    int len = 0;
+    for (size_t i = 0; i < k; i++){
+        const sample_t *s = &in[i];
+        len += snprintf(buf + len, cap - (size_t)len, "%" PRIu64 ",%" PRIu64, s->t_ms, s->epoch_us);
+        for (int c = 0; c < SAMPLE_CAPS; c++)
+            len += snprintf(buf + len, cap - (size_t)len, ",%.6f", units_cap_af(s->cap_raw[c], s->capdac[c]) / 1e6);
+        len += snprintf(buf + len, cap - (size_t)len, ",%.2f,%.3f,%.2f,", s->temp_cdeg / 100.0,
+                        units_hum_mpct(s->hum_q10) / 1000.0, units_pres_pa(s->pres_q8) / 100.0);
+        if (s->mc_cpct != WMC_INVALID) len += snprintf(buf + len, cap - (size_t)len, "%.2f", s->mc_cpct / 100.0);
+        len += snprintf(buf + len, cap - (size_t)len, ",%u\n", s->flags);
+    }
+    return (size_t)len;
+}
+
+typedef struct {
+    const char *name;
+    enc_fn rt, pf;
+} fmt_t;
+
+static const fmt_t FMTS[] = {
+    { "codes JSON", rt_codes, pf_codes },
+    { "units JSON", rt_json, pf_json },
+    { "units CSV", rt_csv, pf_csv },
+};
+
+static char s_a[MQTT_BATCH_RECORDS * RT_RECORD_MAX * 2], s_b[sizeof(s_a)];
+
+static double time_ns(enc_fn f, const sample_t *in, size_t n, int rounds, size_t *bytes){
+    uint64_t t0 = bench_now_ns();
+    for (int r = 0; r < rounds; r++){
+        *bytes = 0;
+        for (size_t i = 0; i < n; i += MQTT_BATCH_RECORDS){
+            size_t k = n - i < MQTT_BATCH_RECORDS ? n - i : MQTT_BATCH_RECORDS;
+            *bytes += f(s_a, sizeof(s_a), &in[i], k);
+        }
+    }
+    return (double)(bench_now_ns() - t0) / ((double)n * rounds);
+}
+
+static unsigned mismatches(const fmt_t *f, const sample_t *in, size_t n){
+    unsigned bad = 0;
+    for (size_t i = 0; i < n; i++){
+        size_t a = f->rt(s_a, sizeof(s_a), &in[i], 1), b = f->pf(s_b, sizeof(s_b), &in[i], 1);
+        if (a != b || memcmp(s_a, s_b, a)) bad++;
+    }
+    return bad;
+}
+
+static void drying(sample_t *out, size_t n){
+    srand(1);
+    for (size_t i = 0; i < n; i++){
+        sample_t s = {};
+        double t = (double)i * SAMPLE_PERIOD_MS / 1000.0, temp = 21.0 + 3.0 * sin(2.0 * M_PI * t / 86400.0);
+        s.t_ms = 1000 + (uint64_t)i * SAMPLE_PERIOD_MS;
+        s.t_us = s.t_ms * 1000u - 3000u - (uint64_t)(rand() % 1000);
+        s.epoch_us = s.t_us + 1767225600000000ull;
+        for (int c = 0; c < SAMPLE_CAPS; c++){
+            double pf = c == WMC_MEAS ? 4.0 + 6.0 * exp(-t / TAU_S) : 2.0 + c % 4;
+            pf += 0.002 * (rand() % 1000 - 500) / 500.0;
+            s.capdac[c] = (uint8_t)(pf > 12.0 ? 1 : 0);
+            s.cap_raw[c] = (int32_t)lround((pf - s.capdac[c] * 3.125) * FDC_CODES_PER_PF);
+        }
+        s.temp_cdeg = (int32_t)lround(temp * 100.0);
+        s.hum_q10 = (uint32_t)lround((55.0 + 10.0 * exp(-t / TAU_S)) * 1024.0);
+        s.pres_q8 = (uint32_t)(101325 * 256 + rand() % 2560);
+        s.mc_cpct = (uint16_t)(i % 500 ? 1200 + 600 * exp(-t / TAU_S) : WMC_INVALID);
+        out[i] = s;
+    }
+}
+
+int main(int argc, char **argv){
+    unsigned long n = argc > 1 ? strtoul(argv[1], NULL, 0) : 14400ul;
+    if (!n) n = 1;
+    esp_log_level_set("*", ESP_LOG_WARN);
+    sample_t *in = malloc(n * sizeof(*in));
+    if (!in) return 1;
+    drying(in, n);
+    int rounds = n < 200000 ? (int)(200000 / n) + 1 : 1;
+
+    printf("bench_rectext: %lu records, batches of %u\n", n, (unsigned)MQTT_BATCH_RECORDS);
+    printf("  %-10s %-9s %9s %8s %11s %7s %5s\n", "format", "encoder", "bytes/rec", "ns/rec", "records/s", "speedup", "bad");
+    int rc = 0;
+    for (size_t f = 0; f < sizeof(FMTS) / sizeof(FMTS[0]); f++){
+        size_t rt_bytes, pf_bytes;
+        double pf_ns = time_ns(FMTS[f].pf, in, n, rounds, &pf_bytes);
+        double rt_ns = time_ns(FMTS[f].rt, in, n, rounds, &rt_bytes);
+        unsigned bad = mismatches(&FMTS[f], in, n);
+        printf("  %-10s %-9s %9.1f %8.1f %11.0f %7s %5s\n", FMTS[f].name, "snprintf", (double)pf_bytes / n, pf_ns,
+               1e9 / pf_ns, "", "");
+        printf("  %-10s %-9s %9.1f %8.1f %11.0f %6.1fx %5u\n", FMTS[f].name, "rectext", (double)rt_bytes / n, rt_ns,
+               1e9 / rt_ns, pf_ns / rt_ns, bad);
+        if (bad) rc = 1;
+    }
+    free(in);
+    return rc;
+}
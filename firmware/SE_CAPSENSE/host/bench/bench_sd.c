@@ -0,0 +1,123 @@
+#include "bench_util.h"
+#include "drain.h"
+#include "record.h"
+#include "sd_logger.h"
+#include "sd_port.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_sd.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+// SD logger throughput and flush latency.
+//
+//  1. file-backed card in real time: every write and fdatasync advances the
+//     virtual clock by its wall time, so the logger's own stats report what
+//     the host file system costs
+//  2. modelled SPI card (fixed cost per write + per sector): sustained rate
+//     of the framed, double-buffered log against one sector write + sync
+//     per record
+//
+// usage: bench_sd [records]
+
+#define IMG "bench_sd.img"
+#define CARD_WRITE_US 1500   // command, busy wait and sync per write
+#define CARD_SECTOR_US 250   // 512 B at 20 MHz SPI plus CRC/token overhead
+
+static void stream(unsigned long n, bool periodic){
+    sample_t s = {0};
+    unsigned long pushed = 0;
+    while (pushed < n || record_count()){
+        // back to back: fill the ring; periodic: one record per SAMPLE_PERIOD_MS
+        while (pushed < n && record_count() < (periodic ? 1u : RECORD_RING_CAP)){
+            s.t_ms = pushed++;
+            s.cap_raw[0] = (int32_t)pushed;
+            record_push(&s);
+        }
+        if (periodic) sim_clock_advance_ms(SAMPLE_PERIOD_MS);
+        drain_job();
+        sdlog_job_flush();
+        sim_sd_run_pending();
+    }
+    sdlog_flush();
+    sim_sd_run_pending();
+}
+
+static void report(const char *name, unsigned long n, uint64_t wall_ns){
+    sdlog_stats_t st;
+    sdlog_get_stats(&st);
+    double wr_s = (double)st.flush_total_us / 1e6;
+    printf("  %-28s %8lu rec %6u writes %8.2f MB/s card %9.0f rec/s wall   flush avg %7.1f us max %7u us\n",
+           name, n, (unsigned)st.writes, wr_s > 0 ? (double)st.bytes / wr_s / 1e6 : 0.0,
+           (double)n * 1e9 / (double)wall_ns,
+           st.writes ? (double)st.flush_total_us / st.writes : 0.0, (unsigned)st.flush_max_us);
+}
+
+static void setup(void){
+    sim_board_init();
+    sim_sd_reset();
+    sim_sd_set_path(IMG);
+    unlink(IMG);
+    sim_sd_set_capacity(32768);   // 16 MB
+    sample_t s;
+    while (record_pop(&s)) {}
+    drain_add_sink(sdlog_append);
+}
+
+int main(int argc, char **argv){
+    unsigned long n = argc > 1 ? strtoul(argv[1], NULL, 0) : 200000ul;
+    esp_log_level_set("*", ESP_LOG_WARN);
+    printf("bench_sd: %lu records of %u B, frames of %u records (%u B)\n", n, (unsigned)sizeof(sample_t),
+           (unsigned)SDLOG_FRAME_RECORDS, (unsigned)SDLOG_FRAME_BYTES);
+
+    // 1. host file, real time
+    setup();
+    sim_sd_set_realtime(true, true);
+    if (sdlog_init() != ESP_OK){ printf("sdlog_init failed\n"); return 1; }
+    sdlog_reset_stats();
+    uint64_t t0 = bench_now_ns();
+    stream(n, false);
+    report("file, fdatasync per write", n, bench_now_ns() - t0);
+
+    // 2. modelled card
+    setup();
+    sim_sd_set_latency_us(CARD_WRITE_US, CARD_SECTOR_US);
+    if (sdlog_init() != ESP_OK){ printf("sdlog_init failed\n"); return 1; }
+    sdlog_reset_stats();
+    t0 = bench_now_ns();
+    stream(n, false);
+    report("model card, back to back", n, bench_now_ns() - t0);
+    sdlog_stats_t st;
+    sdlog_get_stats(&st);
+    double framed = (double)n * 1e6 / (double)st.flush_total_us;
+
+    // at the firmware's sample rate: partial frames every SD_FLUSH_PERIOD_MS
+    unsigned long live = n < 3600 ? n : 3600;
+    setup();
+    sim_sd_set_latency_us(CARD_WRITE_US, CARD_SECTOR_US);
+    sdlog_init();
+    sdlog_reset_stats();
+    t0 = bench_now_ns();
+    stream(live, true);
+    report("model card, 1 rec/s, 1 h", live, bench_now_ns() - t0);
+
+    // baseline: a sector write + sync per record
+    setup();
+    sim_sd_set_latency_us(CARD_WRITE_US, CARD_SECTOR_US);
+    sd_port_open(32768);
+    static uint8_t sector[SD_SECTOR_SIZE];
+    uint64_t v0 = sim_clock_now_ns();
+    unsigned long m = n < 20000 ? n : 20000;
+    for (unsigned long i = 0; i < m; i++){
+        sd_port_write((uint32_t)(i % 32768), sector, 1);
+        sd_port_sync();
+    }
+    double naive = (double)m * 1e9 / (double)(sim_clock_now_ns() - v0);
+    printf("  model card sustained: framed log %.0f rec/s, one write per record %.0f rec/s (%.1fx)\n",
+           framed, naive, framed / naive);
+
+    sim_sd_reset();
+    unlink(IMG);
+    return 0;
+}
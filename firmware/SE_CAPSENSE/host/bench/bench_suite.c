@@ -0,0 +1,161 @@
+#include "bench_kernels.h"
+#include "sim_board.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Regression suite over the core kernels (test/test_bench/bench_kernels.c):
+// cycles per operation, best of `reps` rounds over all of them. -w saves them as a
+// baseline, -b compares with one and fails when a kernel is more than
+// -t percent (default 10) slower. -i reads the "BENCH <kernel> <cycles>"
+// lines test_bench prints (on the target, say) instead of measuring here.
+//
+//     bench_suite -w base.json          before the change
+//     bench_suite -b base.json          after it: exit 1 on a regression
+//     pio test -f test_bench | bench_suite -i - -b c3.json
+//
+// The "calib" kernel measures the machine rather than the firmware; when
+// both sides have it, the others are compared after scaling by its change,
+// so a host running slower or faster overall is not taken for a change in
+// the code.
+//
+// Baseline file: {"unit":"cycles/op","kernels":{"<kernel>":<cycles>,...}}
+// Compare numbers from one machine only: host cycles are the TSC's.
+//
+// usage: bench_suite [-r reps] [-i results|-] [-w out.json] [-b baseline.json] [-t percent]
+
+#define MAX_KERNELS 32
+
+typedef struct {
+    char name[32];
+    double cpo;          // < 0: not measured
+} result_t;
+
+static size_t measure(result_t *res, unsigned rounds){
+    uint32_t cpo[MAX_KERNELS];
+    size_t n = bench_kernel_count < MAX_KERNELS ? bench_kernel_count : MAX_KERNELS;
+    sim_board_init();
+    bench_measure_all(cpo, rounds);
+    for (size_t i = 0; i < n; i++){
+        snprintf(res[i].name, sizeof(res[i].name), "%s", bench_kernels[i].name);
+        res[i].cpo = cpo[i] ? cpo[i] / 100.0 : -1.0;
+    }
+    return n;
+}
+
+static size_t read_results(FILE *f, result_t *res){
+    char line[256], name[32];
+    double v;
+    size_t n = 0;
+    while (n < MAX_KERNELS && fgets(line, sizeof(line), f)){
+        const char *p = strstr(line, "BENCH ");
+        if (!p || sscanf(p + 6, "%31s %lf", name, &v) != 2) continue;
+        snprintf(res[n].name, sizeof(res[n].name), "%s", name);
+        res[n++].cpo = v;
+    }
+    return n;
+}
+
+static char *slurp(const char *path){
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    static char buf[16384];
+    size_t len = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[len] = '\0';
+    return buf;
+}
+
+// The kernel's number in a baseline file, or -1.
+static double lookup(const char *json, const char *name){
+    char key[40];
+    snprintf(key, sizeof(key), "\"%.31s\":", name);
+    const char *p = strstr(json, key);
+    return p ? strtod(p + strlen(key), NULL) : -1.0;
+}
+
+static int write_baseline(const char *path, const result_t *res, size_t n){
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    fprintf(f, "{\"unit\":\"cycles/op\",\"kernels\":{");
+    bool first = true;
+    for (size_t i = 0; i < n; i++){
+        if (res[i].cpo < 0) continue;
+        fprintf(f, "%s\n  \"%s\":%.2f", first ? "" : ",", res[i].name, res[i].cpo);
+        first = false;
+    }
+    fprintf(f, "\n}}\n");
+    return fclose(f);
+}
+
+int main(int argc, char **argv){
+    unsigned reps = 200;
+    const char *in = NULL, *out = NULL, *base = NULL;
+    double pct = 10.0;
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) reps = (unsigned)strtoul(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) in = argv[++i];
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) out = argv[++i];
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) base = argv[++i];
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) pct = strtod(argv[++i], NULL);
+        else {
+            fprintf(stderr, "usage: bench_suite [-r reps] [-i results|-] [-w out.json] [-b baseline.json] [-t percent]\n");
+            return 2;
+        }
+    }
+    if (!reps) reps = 1;
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    static result_t res[MAX_KERNELS];
+    size_t n;
+    if (in){
+        FILE *f = strcmp(in, "-") == 0 ? stdin : fopen(in, "r");
+        if (!f){
+            fprintf(stderr, "bench_suite: cannot read %s\n", in);
+            return 2;
+        }
+        n = read_results(f, res);
+        if (f != stdin) fclose(f);
+    } else {
+        n = measure(res, reps);
+    }
+
+    const char *json = NULL;
+    if (base && !(json = slurp(base))){
+        fprintf(stderr, "bench_suite: cannot read baseline %s\n", base);
+        return 2;
+    }
+
+    double scale = 1.0;
+    for (size_t i = 0; json && i < n; i++){
+        double b = lookup(json, res[i].name);
+        if (strcmp(res[i].name, "calib") == 0 && res[i].cpo > 0 && b > 0) scale = res[i].cpo / b;
+    }
+
+    int regressions = 0;
+    printf("bench_suite: %s, cycles/op%s\n", in ? in : "measured here", json ? ", against baseline" : "");
+    if (scale != 1.0) printf("  machine at %.2fx the baseline's cycles (calib); changes corrected for it\n", scale);
+    printf("  %-18s %12s %12s %9s\n", "kernel", "cycles/op", "baseline", "change");
+    for (size_t i = 0; i < n; i++){
+        if (res[i].cpo < 0){
+            printf("  %-18s %12s\n", res[i].name, "skipped");
+            continue;
+        }
+        double b = json ? lookup(json, res[i].name) : -1.0;
+        if (b <= 0){
+            printf("  %-18s %12.2f %12s\n", res[i].name, res[i].cpo, json ? "new" : "");
+            continue;
+        }
+        double ch = (res[i].cpo / scale - b) * 100.0 / b;
+        bool bad = ch > pct;
+        regressions += bad;
+        printf("  %-18s %12.2f %12.2f %+8.1f%%%s\n", res[i].name, res[i].cpo, b, ch, bad ? "  REGRESSION" : "");
+    }
+    if (out && write_baseline(out, res, n) != 0){
+        fprintf(stderr, "bench_suite: cannot write %s\n", out);
+        return 2;
+    }
+    if (regressions) printf("bench_suite: %d kernel(s) more than %.0f%% slower\n", regressions, pct);
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,79 @@
+#include "bench_util.h"
+#include "sim_clock.h"
+#include "config.h"
+#include "trace.h"
+#include "esp_log.h"
+#include <inttypes.h>
+#include <stdlib.h>
+
+// Cost of one log call on the sampling path: ESP_LOG formatting at the call
+// (the host shim writes to stderr, sent to /dev/null here; on the target it
+// also waits for the UART), the four-float line fdc_read_pf used to log,
+// and TRACE_x, which only stores the event. trace_job_flush's formatting
+// is shown separately: it is the same work, moved to the app_main loop.
+// Host ns per call; disabled rows are the level check alone.
+//
+// usage: bench_trace [calls]
+
+static const char *TAG = "bench";
+
+typedef struct {
+    const char *name;
+    uint64_t ns;
+} row_t;
+
+int main(int argc, char **argv){
+    unsigned long n = argc > 1 ? strtoul(argv[1], NULL, 0) : 200000ul;
+    if (!n) n = 1;
+    if (!freopen("/dev/null", "w", stderr)) return 1;
+    volatile int32_t c[4] = { 2001, -15, 330000, 7 };
+    volatile float f[4] = { 2.001f, 3.5f, 1.25f, 0.007f };
+    row_t rows[7];
+    int k = 0;
+    uint64_t t0;
+
+    esp_log_level_set("*", ESP_LOG_INFO);
+    t0 = bench_now_ns();
+    for (unsigned long i = 0; i < n; i++)
+        ESP_LOGI(TAG, "FDC: %" PRId32 " fF, %" PRId32 " fF, %" PRId32 " fF, %" PRId32 " fF", c[0], c[1], c[2], c[3]);
+    rows[k++] = (row_t){ "ESP_LOGI, 4 ints", bench_now_ns() - t0 };
+
+    t0 = bench_now_ns();
+    for (unsigned long i = 0; i < n; i++)
+        ESP_LOGI(TAG, "CIN: %0.3f pF, %0.3f pF, %0.3f pF, %0.3f pF", f[0], f[1], f[2], f[3]);
+    rows[k++] = (row_t){ "ESP_LOGI, 4 floats", bench_now_ns() - t0 };
+
+    t0 = bench_now_ns();
+    for (unsigned long i = 0; i < n; i++)
+        ESP_LOGD(TAG, "FDC: %" PRId32 " fF, %" PRId32 " fF, %" PRId32 " fF, %" PRId32 " fF", c[0], c[1], c[2], c[3]);
+    rows[k++] = (row_t){ "ESP_LOGD, disabled", bench_now_ns() - t0 };
+
+    trace_init();
+    uint64_t emit = 0, flush = 0;
+    for (unsigned long done = 0; done < n; done += TRACE_RING_LEN){
+        unsigned long m = n - done < TRACE_RING_LEN ? n - done : TRACE_RING_LEN;
+        t0 = bench_now_ns();
+        for (unsigned long i = 0; i < m; i++)
+            TRACE_I(TAG, "FDC: %" PRId32 " fF, %" PRId32 " fF, %" PRId32 " fF, %" PRId32 " fF", c[0], c[1], c[2], c[3]);
+        uint64_t t1 = bench_now_ns();
+        trace_job_flush();
+        emit += t1 - t0;
+        flush += bench_now_ns() - t1;
+    }
+    rows[k++] = (row_t){ "TRACE_I, 4 ints", emit };
+
+    t0 = bench_now_ns();
+    for (unsigned long i = 0; i < n; i++)
+        TRACE_D(TAG, "FDC: %" PRId32 " fF, %" PRId32 " fF, %" PRId32 " fF, %" PRId32 " fF", c[0], c[1], c[2], c[3]);
+    rows[k++] = (row_t){ "TRACE_D, disabled", bench_now_ns() - t0 };
+    rows[k++] = (row_t){ "trace_job_flush/event", flush };
+
+    trace_stats_t st;
+    trace_get_stats(&st);
+    printf("bench_trace: %lu calls each, ring %u events\n", n, (unsigned)TRACE_RING_LEN);
+    printf("  %-24s %10s\n", "", "ns/call");
+    for (int i = 0; i < k; i++) printf("  %-24s %10.1f\n", rows[i].name, (double)rows[i].ns / (double)n);
+    printf("  events %u, dropped %u, formatted %u\n", (unsigned)st.events, (unsigned)st.dropped,
+           (unsigned)st.formatted);
+    return st.dropped || st.formatted != n;
+}
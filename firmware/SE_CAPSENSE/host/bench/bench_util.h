@@ -0,0 +1,34 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// Host wall-clock helpers shared by the benchmark binaries. Benchmarks time
+// real CPU work with CLOCK_MONOTONIC; the firmware itself only ever sees the
+// virtual clock.
+
+static inline uint64_t bench_now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+typedef struct {
+    const char *name;
+    uint64_t calls;
+    uint64_t total_ns;
+} bench_stage_t;
+
+static inline void bench_stage_add(bench_stage_t *s, uint64_t t0, uint64_t t1){
+    s->calls++;
+    s->total_ns += t1 - t0;
+}
+
+static inline double bench_stage_ns(const bench_stage_t *s){
+    return s->calls ? (double)s->total_ns / (double)s->calls : 0.0;
+}
+
+static inline void bench_stage_print(const bench_stage_t *s){
+    printf("  %-22s %10llu calls %10.1f ns/call\n", s->name,
+           (unsigned long long)s->calls, bench_stage_ns(s));
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+// Host stand-in: only the SPI host identifiers board.h refers to.
+typedef enum {
+    SPI1_HOST = 0,
+    SPI2_HOST = 1,
+} spi_host_device_t;
@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+
+// Host stand-in for ESP-IDF logging. The level is checked before any
+// formatting happens, exactly like the target, so a disabled ESP_LOGI costs
+// a compare and nothing else.
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+#ifndef LOG_LOCAL_LEVEL
+#define LOG_LOCAL_LEVEL ESP_LOG_INFO
+#endif
+
+extern esp_log_level_t esp_log_host_level;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+uint32_t esp_log_timestamp(void);
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#define ESP_LOG_LEVEL_LOCAL(level, letter, tag, format, ...) do {                        \
+        if (LOG_LOCAL_LEVEL >= (level) && esp_log_host_level >= (level))                  \
+            esp_log_write((level), (tag), letter " (%u) %s: " format "\n",                 \
+                          (unsigned)esp_log_timestamp(), (tag), ##__VA_ARGS__);           \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_ERROR,   "E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_WARN,    "W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_INFO,    "I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_DEBUG,   "D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_VERBOSE, "V", tag, format, ##__VA_ARGS__)
+
+#define ESP_LOG_LEVEL(level, tag, format, ...) do {                                   \
+        if ((level) == ESP_LOG_ERROR)     ESP_LOGE(tag, format, ##__VA_ARGS__);        \
+        else if ((level) == ESP_LOG_WARN) ESP_LOGW(tag, format, ##__VA_ARGS__);        \
+        else if ((level) == ESP_LOG_INFO) ESP_LOGI(tag, format, ##__VA_ARGS__);        \
+        else if ((level) == ESP_LOG_DEBUG) ESP_LOGD(tag, format, ##__VA_ARGS__);       \
+        else ESP_LOGV(tag, format, ##__VA_ARGS__);                                     \
+    } while (0)
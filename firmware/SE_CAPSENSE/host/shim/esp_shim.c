@@ -0,0 +1,65 @@
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+esp_log_level_t esp_log_host_level = ESP_LOG_INFO;
+
+const char *esp_err_to_name(esp_err_t code){
+    switch (code){
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_INVALID_VERSION: return "ESP_ERR_INVALID_VERSION";
+    default: return "UNKNOWN_ERROR";
+    }
+}
+
+// Per-tag levels are not modelled: the host runs with one global level.
+void esp_log_level_set(const char *tag, esp_log_level_t level){
+    (void)tag;
+    esp_log_host_level = level;
+}
+
+uint32_t esp_log_timestamp(void){ return (uint32_t)(esp_timer_get_time() / 1000); }
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...){
+    (void)level; (void)tag;
+    va_list ap;
+    va_start(ap, format);
+    vfprintf(stderr, format, ap);
+    va_end(ap);
+}
+
+static uint8_t s_gpio_level[GPIO_NUM_MAX];
+
+esp_err_t gpio_reset_pin(gpio_num_t n){
+    if (n < 0 || n >= GPIO_NUM_MAX) return ESP_ERR_INVALID_ARG;
+    s_gpio_level[n] = 0;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t n, gpio_mode_t mode){
+    (void)mode;
+    return (n < 0 || n >= GPIO_NUM_MAX) ? ESP_ERR_INVALID_ARG : ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t n, uint32_t level){
+    if (n < 0 || n >= GPIO_NUM_MAX) return ESP_ERR_INVALID_ARG;
+    s_gpio_level[n] = level ? 1 : 0;
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t n){
+    return (n < 0 || n >= GPIO_NUM_MAX) ? 0 : s_gpio_level[n];
+}
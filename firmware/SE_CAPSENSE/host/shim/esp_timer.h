@@ -0,0 +1,6 @@
+#pragma once
+#include <stdint.h>
+
+// Host stand-in for esp_timer: returns the simulated clock (see sim_clock.h)
+// in microseconds, so timebase.c runs unmodified under a virtual clock.
+int64_t esp_timer_get_time(void);
@@ -0,0 +1,117 @@
+#pragma once
+#include <math.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Host stand-in for the subset of Unity used under test/, so the same test
+// sources run under ctest on the host build. A failed assertion aborts the
+// current test and is reported in Unity's "file:line:test:FAIL" format.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void setUp(void);
+void tearDown(void);
+#ifdef __cplusplus
+}
+#endif
+
+static struct {
+    const char *file;
+    unsigned tests, failures;
+    int failed;
+    jmp_buf jb;
+} Unity;
+
+static inline void unity_begin(const char *file){
+    Unity.file = file;
+    Unity.tests = Unity.failures = 0;
+}
+
+static inline int unity_end(void){
+    printf("\n-----------------------\n%u Tests %u Failures 0 Ignored\n%s\n",
+           Unity.tests, Unity.failures, Unity.failures ? "FAIL" : "OK");
+    return (int)Unity.failures;
+}
+
+static inline void unity_run(void (*fn)(void), const char *name){
+    Unity.tests++;
+    Unity.failed = 0;
+    if (setjmp(Unity.jb) == 0){
+        setUp();
+        fn();
+    }
+    tearDown();
+    if (Unity.failed) Unity.failures++;
+    else printf("%s:%s:PASS\n", Unity.file, name);
+}
+
+static inline void unity_fail(int line, const char *msg){
+    printf("%s:%d:FAIL: %s\n", Unity.file, line, msg);
+    Unity.failed = 1;
+    longjmp(Unity.jb, 1);
+}
+
+#define UNITY_BEGIN() unity_begin(__FILE__)
+#define UNITY_END() unity_end()
+#define RUN_TEST(fn) unity_run(fn, #fn)
+
+#define TEST_FAIL_MESSAGE(msg) unity_fail(__LINE__, (msg))
+#define TEST_ASSERT_MESSAGE(c, msg) do { if (!(c)) unity_fail(__LINE__, (msg)); } while (0)
+#define TEST_ASSERT(c) TEST_ASSERT_MESSAGE((c), #c)
+#define TEST_ASSERT_TRUE(c) TEST_ASSERT_MESSAGE((c), #c " is false")
+#define TEST_ASSERT_FALSE(c) TEST_ASSERT_MESSAGE(!(c), #c " is true")
+#define TEST_ASSERT_NULL(p) TEST_ASSERT_MESSAGE((p) == NULL, #p " is not NULL")
+#define TEST_ASSERT_NOT_NULL(p) TEST_ASSERT_MESSAGE((p) != NULL, #p " is NULL")
+
+#define UNITY_CMP_INT(e, a, op, what) do {                                            \
+        long long e_ = (long long)(e), a_ = (long long)(a);                          \
+        if (!(a_ op e_)) {                                                            \
+            char m_[160];                                                             \
+            snprintf(m_, sizeof(m_), "%s: expected %lld, was %lld", what, e_, a_);   \
+            unity_fail(__LINE__, m_);                                                 \
+        }                                                                             \
+    } while (0)
+
+#define TEST_ASSERT_EQUAL(e, a) UNITY_CMP_INT(e, a, ==, #a)
+#define TEST_ASSERT_EQUAL_INT(e, a) UNITY_CMP_INT(e, a, ==, #a)
+#define TEST_ASSERT_EQUAL_INT32(e, a) UNITY_CMP_INT(e, a, ==, #a)
+#define TEST_ASSERT_EQUAL_INT64(e, a) UNITY_CMP_INT(e, a, ==, #a)
+#define TEST_ASSERT_EQUAL_UINT(e, a) UNITY_CMP_INT(e, a, ==, #a)
+#define TEST_ASSERT_EQUAL_UINT8(e, a) UNITY_CMP_INT(e, a, ==, #a)
+#define TEST_ASSERT_EQUAL_UINT16(e, a) UNITY_CMP_INT(e, a, ==, #a)
+#define TEST_ASSERT_EQUAL_UINT32(e, a) UNITY_CMP_INT(e, a, ==, #a)
+#define TEST_ASSERT_EQUAL_UINT64(e, a) UNITY_CMP_INT(e, a, ==, #a)
+#define TEST_ASSERT_EQUAL_HEX8(e, a) UNITY_CMP_INT(e, a, ==, #a)
+#define TEST_ASSERT_EQUAL_HEX16(e, a) UNITY_CMP_INT(e, a, ==, #a)
+#define TEST_ASSERT_EQUAL_HEX32(e, a) UNITY_CMP_INT(e, a, ==, #a)
+#define TEST_ASSERT_GREATER_THAN(t, a) UNITY_CMP_INT(t, a, >, #a " > threshold")
+#define TEST_ASSERT_GREATER_OR_EQUAL(t, a) UNITY_CMP_INT(t, a, >=, #a " >= threshold")
+#define TEST_ASSERT_LESS_THAN(t, a) UNITY_CMP_INT(t, a, <, #a " < threshold")
+#define TEST_ASSERT_LESS_OR_EQUAL(t, a) UNITY_CMP_INT(t, a, <=, #a " <= threshold")
+
+#define TEST_ASSERT_INT_WITHIN(d, e, a) do {                                           \
+        long long d_ = (long long)(d), e_ = (long long)(e), a_ = (long long)(a);     \
+        if (a_ < e_ - d_ || a_ > e_ + d_) {                                           \
+            char m_[160];                                                             \
+            snprintf(m_, sizeof(m_), "%s: expected %lld +/- %lld, was %lld", #a, e_, d_, a_); \
+            unity_fail(__LINE__, m_);                                                 \
+        }                                                                             \
+    } while (0)
+#define TEST_ASSERT_UINT_WITHIN(d, e, a) TEST_ASSERT_INT_WITHIN(d, e, a)
+
+#define TEST_ASSERT_FLOAT_WITHIN(d, e, a) do {                                         \
+        double d_ = (double)(d), e_ = (double)(e), a_ = (double)(a);                  \
+        if (!(fabs(a_ - e_) <= d_)) {                                                 \
+            char m_[160];                                                             \
+            snprintf(m_, sizeof(m_), "%s: expected %g +/- %g, was %g", #a, e_, d_, a_); \
+            unity_fail(__LINE__, m_);                                                 \
+        }                                                                             \
+    } while (0)
+
+#define TEST_ASSERT_EQUAL_MEMORY(e, a, n) \
+    TEST_ASSERT_MESSAGE(memcmp((e), (a), (n)) == 0, #a " differs from " #e)
+#define TEST_ASSERT_EQUAL_STRING(e, a) \
+    TEST_ASSERT_MESSAGE(strcmp((e), (a)) == 0, #a " differs from " #e)
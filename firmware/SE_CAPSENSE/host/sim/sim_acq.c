@@ -0,0 +1,11 @@
+#include "acq_port.h"
+#include "sim_clock.h"
+
+// The acquisition task on the host: a preempting task on the virtual clock
+// (sim_clock_set_task), so it runs on time through whatever the test or
+// bench spends the clock on, I/O delays included. sim_board_init stops it.
+
+esp_err_t acq_port_start(uint32_t period_us, void (*tick)(void)){
+    sim_clock_set_task(tick, (uint64_t)period_us * 1000u);
+    return ESP_OK;
+}
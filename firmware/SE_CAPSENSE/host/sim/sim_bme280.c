@@ -0,0 +1,181 @@
+#include "sim_bme280.h"
+#include "sim_i2c.h"
+#include <math.h>
+#include <string.h>
+
+#define REG_CALIB0    0x88
+#define REG_CHIPID    0xD0
+#define REG_RESET     0xE0
+#define REG_CALIB26   0xE1
+#define REG_CTRL_HUM  0xF2
+#define REG_STATUS    0xF3
+#define REG_CTRL_MEAS 0xF4
+#define REG_CONFIG    0xF5
+#define REG_DATA      0xF7
+
+// Datasheet example trimming values (BST-BME280-DS002, section 8).
+static const uint16_t T1 = 27504;
+static const int16_t  T2 = 26435, T3 = -1000;
+static const uint16_t P1 = 36477;
+static const int16_t  P2 = -10685, P3 = 3024, P4 = 2855, P5 = 140, P6 = -7, P7 = 15500, P8 = -14600, P9 = 6000;
+static const uint8_t  H1 = 75;
+static const int16_t  H2 = 370;
+static const uint8_t  H3 = 0;
+static const int16_t  H4 = 303, H5 = 50;
+static const int8_t   H6 = 30;
+
+// Reference integer compensation (datasheet section 4.2.3), used to invert
+// the environment into ADC words.
+static int32_t ref_t_fine(int32_t adc_T){
+    int32_t v1 = ((((adc_T >> 3) - ((int32_t)T1 << 1))) * (int32_t)T2) >> 11;
+    int32_t v2 = (((((adc_T >> 4) - (int32_t)T1) * ((adc_T >> 4) - (int32_t)T1)) >> 12) * (int32_t)T3) >> 14;
+    return v1 + v2;
+}
+
+static int32_t ref_temp(int32_t adc_T){ return (ref_t_fine(adc_T) * 5 + 128) >> 8; }
+
+static uint32_t ref_pres(int32_t adc_P, int32_t t_fine){
+    int64_t v1 = (int64_t)t_fine - 128000;
+    int64_t v2 = v1 * v1 * (int64_t)P6;
+    v2 = v2 + ((v1 * (int64_t)P5) << 17);
+    v2 = v2 + (((int64_t)P4) << 35);
+    v1 = ((v1 * v1 * (int64_t)P3) >> 8) + ((v1 * (int64_t)P2) << 12);
+    v1 = (((((int64_t)1) << 47) + v1) * (int64_t)P1) >> 33;
+    if (v1 == 0) return 0;
+    int64_t p = 1048576 - adc_P;
+    p = (((p << 31) - v2) * 3125) / v1;
+    v1 = (((int64_t)P9) * (p >> 13) * (p >> 13)) >> 25;
+    v2 = (((int64_t)P8) * p) >> 19;
+    p = ((p + v1 + v2) >> 8) + (((int64_t)P7) << 4);
+    return (uint32_t)p;
+}
+
+static uint32_t ref_hum(int32_t adc_H, int32_t t_fine){
+    int32_t v = t_fine - 76800;
+    v = (((((adc_H << 14) - (((int32_t)H4) << 20) - (((int32_t)H5) * v)) + 16384) >> 15) *
+         (((((((v * (int32_t)H6) >> 10) * (((v * (int32_t)H3) >> 11) + 32768)) >> 10) + 2097152) *
+           (int32_t)H2 + 8192) >> 14));
+    v = v - (((((v >> 15) * (v >> 15)) >> 7) * (int32_t)H1) >> 4);
+    if (v < 0) v = 0;
+    if (v > 419430400) v = 419430400;
+    return (uint32_t)(v >> 12);
+}
+
+static void encode_env(sim_bme280_t *d){
+    if (d->enc_t == d->temp_c && d->enc_h == d->hum_pct && d->enc_p == d->pres_hpa) return;
+
+    // Smallest ADC word whose compensated value reaches the target; all three
+    // transfer functions are monotonic over the 20/16-bit ADC ranges.
+    int32_t t_target = (int32_t)lroundf(d->temp_c * 100.0f);
+    int32_t lo = 0, hi = 0xFFFFF;
+    while (lo < hi){
+        int32_t mid = (lo + hi) / 2;
+        if (ref_temp(mid) < t_target) lo = mid + 1; else hi = mid;
+    }
+    int32_t adc_T = lo;
+    int32_t t_fine = ref_t_fine(adc_T);
+
+    // Pressure falls as adc_P rises.
+    uint32_t p_target = (uint32_t)llround((double)d->pres_hpa * 100.0 * 256.0);
+    lo = 0; hi = 0xFFFFF;
+    while (lo < hi){
+        int32_t mid = (lo + hi) / 2;
+        if (ref_pres(mid, t_fine) > p_target) lo = mid + 1; else hi = mid;
+    }
+    int32_t adc_P = lo;
+
+    uint32_t h_target = (uint32_t)lroundf(d->hum_pct * 1024.0f);
+    lo = 0; hi = 0xFFFF;
+    while (lo < hi){
+        int32_t mid = (lo + hi) / 2;
+        if (ref_hum(mid, t_fine) < h_target) lo = mid + 1; else hi = mid;
+    }
+    int32_t adc_H = lo;
+
+    uint8_t *r = &d->regs[REG_DATA];
+    r[0] = (uint8_t)(adc_P >> 12); r[1] = (uint8_t)(adc_P >> 4); r[2] = (uint8_t)((adc_P & 0xF) << 4);
+    r[3] = (uint8_t)(adc_T >> 12); r[4] = (uint8_t)(adc_T >> 4); r[5] = (uint8_t)((adc_T & 0xF) << 4);
+    r[6] = (uint8_t)(adc_H >> 8);  r[7] = (uint8_t)adc_H;
+
+    d->enc_t = d->temp_c; d->enc_h = d->hum_pct; d->enc_p = d->pres_hpa;
+}
+
+static void put_le16(uint8_t *b, uint16_t v){ b[0] = (uint8_t)v; b[1] = (uint8_t)(v >> 8); }
+
+static void load_nvm(sim_bme280_t *d){
+    memset(d->regs, 0, sizeof(d->regs));
+    uint8_t *c = &d->regs[REG_CALIB0];
+    put_le16(&c[0], T1);  put_le16(&c[2], (uint16_t)T2);  put_le16(&c[4], (uint16_t)T3);
+    put_le16(&c[6], P1);  put_le16(&c[8], (uint16_t)P2);  put_le16(&c[10], (uint16_t)P3);
+    put_le16(&c[12], (uint16_t)P4); put_le16(&c[14], (uint16_t)P5); put_le16(&c[16], (uint16_t)P6);
+    put_le16(&c[18], (uint16_t)P7); put_le16(&c[20], (uint16_t)P8); put_le16(&c[22], (uint16_t)P9);
+    c[25] = H1;
+    uint8_t *h = &d->regs[REG_CALIB26];
+    put_le16(&h[0], (uint16_t)H2);
+    h[2] = H3;
+    h[3] = (uint8_t)(H4 >> 4);
+    h[4] = (uint8_t)((H4 & 0x0F) | ((H5 & 0x0F) << 4));
+    h[5] = (uint8_t)(H5 >> 4);
+    h[6] = (uint8_t)H6;
+    d->regs[REG_CHIPID] = SIM_BME_CHIP_ID;
+    // Data registers read as "skipped" until the first measurement.
+    d->regs[REG_DATA + 0] = 0x80;
+    d->regs[REG_DATA + 3] = 0x80;
+    d->regs[REG_DATA + 6] = 0x80;
+    d->enc_t = d->enc_h = d->enc_p = NAN;
+}
+
+void sim_bme280_init(sim_bme280_t *d){
+    memset(d, 0, sizeof(*d));
+    d->temp_c = 21.5f;
+    d->hum_pct = 45.0f;
+    d->pres_hpa = 1013.25f;
+    load_nvm(d);
+}
+
+static esp_err_t bme_read(void *ctx, uint8_t reg, uint8_t *buf, size_t len){
+    sim_bme280_t *d = ctx;
+    if ((size_t)reg + len > 0x100) return ESP_FAIL;
+    if (reg + len > REG_DATA && reg <= REG_DATA + 7){
+        // Normal or forced mode produces fresh data; sleep keeps the last one.
+        if (d->regs[REG_CTRL_MEAS] & 0x03) encode_env(d);
+        if ((d->regs[REG_CTRL_MEAS] & 0x03) != 0x03) d->regs[REG_CTRL_MEAS] &= (uint8_t)~0x03;
+        d->data_reads++;
+    }
+    memcpy(buf, &d->regs[reg], len);
+    return ESP_OK;
+}
+
+static esp_err_t write_reg(sim_bme280_t *d, uint8_t r, uint8_t v){
+    switch (r){
+    case REG_RESET:
+        if (v == 0xB6){
+            float t = d->temp_c, h = d->hum_pct, p = d->pres_hpa;
+            load_nvm(d);
+            d->temp_c = t; d->hum_pct = h; d->pres_hpa = p;
+        }
+        return ESP_OK;
+    case REG_CTRL_HUM: d->regs[r] = v & 0x07; return ESP_OK;
+    case REG_CTRL_MEAS:
+    case REG_CONFIG: d->regs[r] = v; return ESP_OK;
+    default: return ESP_FAIL;
+    }
+}
+
+static esp_err_t bme_write(void *ctx, uint8_t reg, const uint8_t *buf, size_t len){
+    sim_bme280_t *d = ctx;
+    // Burst writes are register/value pairs: (reg, buf[0]), (buf[1], buf[2]), ...
+    uint8_t r = reg;
+    size_t i = 0;
+    while (i < len){
+        if (write_reg(d, r, buf[i++]) != ESP_OK) return ESP_FAIL;
+        if (i >= len) break;
+        r = buf[i++];
+    }
+    return ESP_OK;
+}
+
+esp_err_t sim_bme280_attach(sim_bme280_t *d, uint8_t addr){
+    sim_i2c_dev_t dev = { .ctx = d, .read = bme_read, .write = bme_write };
+    return sim_i2c_attach(addr, &dev);
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <esp_err.h>
+#include <stdint.h>
+
+// Register-level model of the Bosch BME280. The register image carries the
+// datasheet example trimming coefficients; reading the data block
+// (0xF7..0xFE) returns raw ADC words that the reference compensation turns
+// back into the environment set below. Reads auto-increment, like the part.
+
+#define SIM_BME_CHIP_ID 0x60
+
+typedef struct {
+    // Environment seen by the sensor.
+    float temp_c;
+    float hum_pct;
+    float pres_hpa;
+
+    uint8_t regs[256];
+
+    // Cache of the last environment encoded into regs[0xF7..0xFE].
+    float enc_t, enc_h, enc_p;
+    uint32_t data_reads;
+} sim_bme280_t;
+
+// Power-on state (sleep mode) at 21.5 C / 45 %RH / 1013.25 hPa.
+void sim_bme280_init(sim_bme280_t *d);
+esp_err_t sim_bme280_attach(sim_bme280_t *d, uint8_t addr);
@@ -0,0 +1,42 @@
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "config.h"
+#include "fdc1004.h"
+#include "bme280_drv.h"
+#include "pcap04.h"
+
+sim_fdc1004_t sim_board_fdcs[SIM_TCA_CHANNELS];
+sim_bme280_t sim_board_bme;
+sim_tca9548_t sim_board_mux;
+sim_pcap04_t sim_board_pcap;
+
+static void board_reset(void){
+    sim_clock_set_task(NULL, 0);
+    sim_clock_set_ns(0);
+    sim_i2c_detach_all();
+    sim_i2c_reset_stats();
+    sim_i2c_set_bus_hz(0);
+
+    for (int i = 0; i < SIM_TCA_CHANNELS; i++) sim_fdc1004_init(&sim_board_fdcs[i]);
+    sim_bme280_init(&sim_board_bme);
+    sim_tca9548_init(&sim_board_mux);
+    sim_pcap04_init(&sim_board_pcap);
+    sim_bme280_attach(&sim_board_bme, BME280_I2C_ADDR);
+}
+
+void sim_board_init(void){
+    board_reset();
+    sim_fdc1004_attach(&sim_board_fdc, FDC1004_I2C_ADDR);
+}
+
+void sim_board_init_mux(int n){
+    board_reset();
+    for (int i = 0; i < n && i < SIM_TCA_CHANNELS; i++) sim_fdc1004_dev(&sim_board_fdcs[i], &sim_board_mux.down[i]);
+    sim_tca9548_attach(&sim_board_mux, FDC_MUX_ADDR, FDC1004_I2C_ADDR);
+}
+
+void sim_board_init_pcap(void){
+    board_reset();
+    sim_pcap04_attach(&sim_board_pcap, PCAP04_I2C_ADDR);
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "sim_fdc1004.h"
+#include "sim_bme280.h"
+#include "sim_pcap04.h"
+#include "sim_tca9548.h"
+
+// The simulated capSensor board: one FDC1004 and one BME280 on the I2C bus
+// at the addresses the firmware expects, and the virtual clock at t=0 with
+// no task on it. sim_board_init_mux builds the FDC_DEVICES > 1 variant
+// instead: a TCA9548A at FDC_MUX_ADDR with n FDC1004s on its channels
+// 0..n-1 (sim_board_fdcs[]), the BME280 on the main bus. sim_board_init_pcap
+// fits a PCAP04 (sim_board_pcap) in place of the FDC1004.
+
+extern sim_fdc1004_t sim_board_fdcs[SIM_TCA_CHANNELS];
+#define sim_board_fdc sim_board_fdcs[0]
+extern sim_bme280_t sim_board_bme;
+extern sim_tca9548_t sim_board_mux;
+extern sim_pcap04_t sim_board_pcap;
+
+void sim_board_init(void);
+void sim_board_init_mux(int n);
+void sim_board_init_pcap(void);
@@ -0,0 +1,41 @@
+#include "sim_clock.h"
+#include "esp_timer.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+static uint64_t s_now_ns;
+
+static void (*s_task_fn)(void);
+static uint64_t s_task_period_ns, s_task_due_ns;
+static bool s_in_task;
+
+uint64_t sim_clock_now_ns(void){ return s_now_ns; }
+void sim_clock_set_ns(uint64_t t_ns){ s_now_ns = t_ns; }
+
+void sim_clock_advance_ns(uint64_t dt_ns){
+    if (!s_task_fn || s_in_task){
+        s_now_ns += dt_ns;
+        return;
+    }
+    // preempt at every due instant inside [now, now + dt]; the time the
+    // task takes pushes the rest of dt out
+    while (s_task_due_ns <= s_now_ns + dt_ns){
+        uint64_t run_to = s_task_due_ns > s_now_ns ? s_task_due_ns : s_now_ns;
+        dt_ns -= run_to - s_now_ns;
+        s_now_ns = run_to;
+        s_in_task = true;
+        s_task_fn();
+        s_in_task = false;
+        s_task_due_ns += s_task_period_ns;
+        if (s_task_due_ns < s_now_ns) s_task_due_ns = s_now_ns;   // overran its period
+    }
+    s_now_ns += dt_ns;
+}
+
+void sim_clock_set_task(void (*fn)(void), uint64_t period_ns){
+    s_task_fn = period_ns ? fn : NULL;
+    s_task_period_ns = period_ns;
+    s_task_due_ns = s_now_ns + period_ns;
+}
+
+int64_t esp_timer_get_time(void){ return (int64_t)(s_now_ns / 1000ULL); }
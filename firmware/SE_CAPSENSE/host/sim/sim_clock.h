@@ -0,0 +1,19 @@
+#pragma once
+#include <stdint.h>
+
+// Virtual clock behind esp_timer_get_time()/tb_now_ms() on the host build.
+// Nothing advances it implicitly except the simulated I2C bus (when a bus
+// rate is set, see sim_i2c_set_bus_hz), so runs are fully deterministic.
+
+uint64_t sim_clock_now_ns(void);
+void sim_clock_set_ns(uint64_t t_ns);
+void sim_clock_advance_ns(uint64_t dt_ns);
+
+// A higher-priority task woken every period_ns (NULL or 0: none). Whenever
+// the clock advances, fn runs at each due instant the advance passes, and
+// the time fn itself takes is added to the advance, as if it had preempted
+// whatever was running. The overrun catch-up is a single late run.
+void sim_clock_set_task(void (*fn)(void), uint64_t period_ns);
+
+static inline void sim_clock_advance_us(uint64_t dt_us){ sim_clock_advance_ns(dt_us * 1000ULL); }
+static inline void sim_clock_advance_ms(uint64_t dt_ms){ sim_clock_advance_ns(dt_ms * 1000000ULL); }
@@ -0,0 +1,196 @@
+#include "sim_fdc1004.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define REG_MEAS1_MSB   0x00
+#define REG_CONF_MEAS1  0x08
+#define REG_FDC_CONF    0x0C
+#define REG_OFFSET_CAL1 0x0D
+#define REG_GAIN_CAL1   0x11
+#define REG_MANUF_ID    0xFE
+#define REG_DEVICE_ID   0xFF
+
+#define CONF_RST        (1u << 15)
+#define CONF_RATE_SHIFT 10
+#define CONF_REPEAT     (1u << 8)
+#define CONF_MEAS_SHIFT 4
+#define CONF_WR_MASK    0x0DF0  // RATE, REPEAT, MEAS_1..4
+
+#define CAPDAC_PF       3.125f
+#define CODES_PER_PF    524288.0f   // 2^19
+#define RESULT_MAX      8388607
+#define RESULT_MIN      (-8388608)
+
+void sim_fdc1004_init(sim_fdc1004_t *d){
+    memset(d, 0, sizeof(*d));
+    for (int i = 0; i < 4; i++){
+        d->conf_meas[i] = 0x1C00;  // CHA=CIN1, CHB=disabled, CAPDAC=0
+        d->gain_cal[i] = 0x4000;   // gain 1.0
+    }
+    d->seed = 0x1004u;
+}
+
+static void soft_reset(sim_fdc1004_t *d){
+    // RST restores the register file but not the input model.
+    float cin[4], noise = d->noise_pf;
+    sim_fdc_input_fn input = d->input;
+    void *ctx = d->input_ctx;
+    uint32_t seed = d->seed;
+    uint64_t conversions = d->conversions;
+    memcpy(cin, d->cin_pf, sizeof(cin));
+    sim_fdc1004_init(d);
+    memcpy(d->cin_pf, cin, sizeof(cin));
+    d->noise_pf = noise;
+    d->input = input;
+    d->input_ctx = ctx;
+    d->seed = seed;
+    d->conversions = conversions;
+}
+
+static float cin_at(sim_fdc1004_t *d, int cin, uint64_t t_ns){
+    float pf = d->input ? d->input(d->input_ctx, cin, t_ns) : d->cin_pf[cin];
+    pf += (float)(int16_t)d->offset_cal[cin] / 2048.0f;
+    pf *= (float)d->gain_cal[cin] / 16384.0f;
+    return pf;
+}
+
+static float noise(sim_fdc1004_t *d){
+    if (d->noise_pf == 0.0f) return 0.0f;
+    // Irwin-Hall(4) approximation of a unit normal from xorshift32.
+    float acc = 0.0f;
+    for (int i = 0; i < 4; i++){
+        uint32_t x = d->seed;
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        d->seed = x;
+        acc += (float)(x >> 8) / 16777216.0f;
+    }
+    return (acc - 2.0f) * 1.7320508f * d->noise_pf;
+}
+
+static void convert(sim_fdc1004_t *d, int m, uint64_t t_ns){
+    uint16_t conf = d->conf_meas[m];
+    int cha = (conf >> 13) & 7;
+    int chb = (conf >> 10) & 7;
+    int capdac = (conf >> 5) & 0x1F;
+    float pf;
+
+    if (cha > 3 || cha == chb){
+        pf = 0.0f;  // invalid configuration, the part reports zero
+    } else if (chb <= 3){
+        pf = cin_at(d, cha, t_ns) - cin_at(d, chb, t_ns);
+    } else if (chb == 4){
+        pf = cin_at(d, cha, t_ns) - (float)capdac * CAPDAC_PF;
+    } else {
+        pf = cin_at(d, cha, t_ns);
+    }
+    pf += noise(d);
+
+    double code = floor((double)pf * CODES_PER_PF + 0.5);
+    if (code > RESULT_MAX) code = RESULT_MAX;
+    if (code < RESULT_MIN) code = RESULT_MIN;
+    d->result[m] = (int32_t)code;
+    d->done |= (uint8_t)(0x8u >> m);
+    d->conversions++;
+}
+
+static uint64_t period_ns(const sim_fdc1004_t *d){
+    switch ((d->fdc_conf >> CONF_RATE_SHIFT) & 3){
+    case 1: return 10000000ULL;  // 100 S/s
+    case 2: return 5000000ULL;   // 200 S/s
+    case 3: return 2500000ULL;   // 400 S/s
+    default: return 0;           // reserved: no conversions
+    }
+}
+
+void sim_fdc1004_update(sim_fdc1004_t *d){
+    uint64_t T = period_ns(d);
+    if (!d->seq_mask || !T) return;
+
+    int order[4], n = 0;
+    for (int m = 0; m < 4; m++) if (d->seq_mask & (1u << m)) order[n++] = m;
+
+    uint64_t now = sim_clock_now_ns();
+    uint64_t k_total = (now - d->seq_start_ns) / T;
+    bool repeat = (d->fdc_conf & CONF_REPEAT) != 0;
+    if (!repeat && k_total > (uint64_t)n) k_total = (uint64_t)n;
+    if (k_total <= d->seq_done) return;
+
+    // Only the latest conversion of each measurement is visible, so jump
+    // straight to it instead of replaying every period that elapsed.
+    for (int p = 0; p < n; p++){
+        if (k_total < (uint64_t)p + 1) continue;
+        uint64_t k_last = k_total - ((k_total - 1 - (uint64_t)p) % (uint64_t)n);
+        if (k_last <= d->seq_done) continue;
+        convert(d, order[p], d->seq_start_ns + k_last * T);
+    }
+    // Conversions that were overwritten before anyone could read them still count.
+    uint64_t fresh = k_total - d->seq_done;
+    if (fresh > (uint64_t)n) d->conversions += fresh - (uint64_t)n;
+    d->seq_done = k_total;
+    if (!repeat && k_total == (uint64_t)n) d->seq_mask = 0;
+}
+
+static uint16_t reg_value(sim_fdc1004_t *d, uint8_t reg){
+    if (reg <= 0x07){
+        int m = reg >> 1;
+        uint32_t code = (uint32_t)d->result[m] & 0xFFFFFFu;
+        if (reg & 1) return (uint16_t)((code & 0xFFu) << 8);
+        d->done &= (uint8_t)~(0x8u >> m);  // reading the result acknowledges DONE
+        return (uint16_t)(code >> 8);
+    }
+    if (reg >= REG_CONF_MEAS1 && reg < REG_CONF_MEAS1 + 4) return d->conf_meas[reg - REG_CONF_MEAS1];
+    if (reg == REG_FDC_CONF) return d->fdc_conf | d->done;
+    if (reg >= REG_OFFSET_CAL1 && reg < REG_OFFSET_CAL1 + 4) return d->offset_cal[reg - REG_OFFSET_CAL1];
+    if (reg >= REG_GAIN_CAL1 && reg < REG_GAIN_CAL1 + 4) return d->gain_cal[reg - REG_GAIN_CAL1];
+    if (reg == REG_MANUF_ID) return SIM_FDC_MANUF_ID;
+    if (reg == REG_DEVICE_ID) return SIM_FDC_DEVICE_ID;
+    return 0;
+}
+
+static esp_err_t fdc_read(void *ctx, uint8_t reg, uint8_t *buf, size_t len){
+    sim_fdc1004_t *d = ctx;
+    sim_fdc1004_update(d);
+    uint16_t v = reg_value(d, reg);
+    for (size_t i = 0; i < len; i++) buf[i] = (i & 1) ? (uint8_t)v : (uint8_t)(v >> 8);
+    return ESP_OK;
+}
+
+static esp_err_t fdc_write(void *ctx, uint8_t reg, const uint8_t *buf, size_t len){
+    sim_fdc1004_t *d = ctx;
+    if (len != 2) return ESP_FAIL;
+    sim_fdc1004_update(d);
+    uint16_t v = (uint16_t)((buf[0] << 8) | buf[1]);
+
+    if (reg >= REG_CONF_MEAS1 && reg < REG_CONF_MEAS1 + 4){
+        d->conf_meas[reg - REG_CONF_MEAS1] = v & 0xFFE0;
+    } else if (reg == REG_FDC_CONF){
+        if (v & CONF_RST){ soft_reset(d); return ESP_OK; }
+        d->fdc_conf = v & CONF_WR_MASK;
+        // Any write to FDC_CONF (re)starts the conversion sequence.
+        d->seq_mask = (uint8_t)0;
+        for (int m = 0; m < 4; m++)
+            if (d->fdc_conf & (0x80u >> m)) d->seq_mask |= (uint8_t)(1u << m);
+        d->seq_start_ns = sim_clock_now_ns();
+        d->seq_done = 0;
+    } else if (reg >= REG_OFFSET_CAL1 && reg < REG_OFFSET_CAL1 + 4){
+        d->offset_cal[reg - REG_OFFSET_CAL1] = v;
+    } else if (reg >= REG_GAIN_CAL1 && reg < REG_GAIN_CAL1 + 4){
+        d->gain_cal[reg - REG_GAIN_CAL1] = v;
+    } else {
+        return ESP_FAIL;  // read-only or reserved
+    }
+    return ESP_OK;
+}
+
+void sim_fdc1004_dev(sim_fdc1004_t *d, sim_i2c_dev_t *out){
+    *out = (sim_i2c_dev_t){ .ctx = d, .read = fdc_read, .write = fdc_write };
+}
+
+esp_err_t sim_fdc1004_attach(sim_fdc1004_t *d, uint8_t addr){
+    sim_i2c_dev_t dev;
+    sim_fdc1004_dev(d, &dev);
+    return sim_i2c_attach(addr, &dev);
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <esp_err.h>
+#include <stdint.h>
+#include "sim_i2c.h"
+
+// Register-level model of the TI FDC1004 4-channel capacitance-to-digital
+// converter, attached to the simulated I2C bus.
+//
+// Modelled: MEAS1..4 MSB/LSB result registers (24-bit two's complement,
+// 2^19 codes per pF), CONF_MEAS1..4 (CHA/CHB/CAPDAC), FDC_CONF (RST, RATE,
+// REPEAT, MEAS_x enables, DONE_x), OFFSET_CAL/GAIN_CAL per input, and the ID
+// registers. Conversions are driven by the virtual clock: each enabled
+// measurement takes one conversion period (1/RATE) and the enabled set is
+// converted round-robin, once (single shot) or continuously (REPEAT=1).
+//
+// Registers are 16 bits and the register pointer does not auto-increment:
+// a read longer than two bytes returns the same register again.
+
+#define SIM_FDC_MANUF_ID  0x5449
+#define SIM_FDC_DEVICE_ID 0x1004
+
+// Optional time-varying input: capacitance on CINx (0..3) in pF at t_ns.
+typedef float (*sim_fdc_input_fn)(void *ctx, int cin, uint64_t t_ns);
+
+typedef struct {
+    // Input model; cin_pf[] is used when input is NULL.
+    float cin_pf[4];
+    sim_fdc_input_fn input;
+    void *input_ctx;
+    float noise_pf;         // RMS noise added to every conversion
+    uint32_t seed;
+
+    // Register file
+    uint16_t conf_meas[4];
+    uint16_t fdc_conf;      // without DONE bits
+    uint16_t offset_cal[4];
+    uint16_t gain_cal[4];
+    int32_t result[4];
+    uint8_t done;           // DONE_1..4 in FDC_CONF bit order (bit 3 = MEAS1)
+
+    // Conversion sequencer
+    uint64_t seq_start_ns;
+    uint64_t seq_done;      // conversions already applied to the registers
+    uint8_t seq_mask;       // measurements in the running sequence
+    uint64_t conversions;   // total conversions completed (for tests/benchmarks)
+} sim_fdc1004_t;
+
+// Power-on reset state with all inputs at 0 pF and no noise.
+void sim_fdc1004_init(sim_fdc1004_t *d);
+esp_err_t sim_fdc1004_attach(sim_fdc1004_t *d, uint8_t addr);
+// The bus callbacks sim_fdc1004_attach installs, for a device that sits
+// behind something else (sim_tca9548.h).
+void sim_fdc1004_dev(sim_fdc1004_t *d, sim_i2c_dev_t *out);
+
+// Bring the register file up to date with the virtual clock. Called on every
+// bus access; tests may call it directly to inspect d->result.
+void sim_fdc1004_update(sim_fdc1004_t *d);
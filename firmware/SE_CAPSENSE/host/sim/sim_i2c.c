@@ -0,0 +1,119 @@
+#include "sim_i2c.h"
+#include "sim_clock.h"
+#include "i2c_port.h"
+#include <stdbool.h>
+#include <string.h>
+
+static sim_i2c_dev_t s_devs[128];
+static bool s_present[128];
+static uint32_t s_bus_hz;
+static uint32_t s_port_hz;
+static sim_i2c_stats_t s_stats;
+
+static struct { uint8_t addr; esp_err_t err; uint32_t count; } s_inject;
+
+#define PENDING_MAX 16
+static struct { void (*fn)(void *); void *arg; } s_pending[PENDING_MAX];
+static size_t s_npending;
+
+esp_err_t sim_i2c_attach(uint8_t addr, const sim_i2c_dev_t *dev){
+    if (addr >= 128 || !dev) return ESP_ERR_INVALID_ARG;
+    s_devs[addr] = *dev;
+    s_present[addr] = true;
+    return ESP_OK;
+}
+
+void sim_i2c_detach_all(void){
+    memset(s_present, 0, sizeof(s_present));
+    s_inject.count = 0;
+}
+
+void sim_i2c_set_bus_hz(uint32_t hz){ s_bus_hz = hz; }
+uint32_t sim_i2c_port_hz(void){ return s_port_hz; }
+
+void sim_i2c_get_stats(sim_i2c_stats_t *out){ *out = s_stats; }
+void sim_i2c_reset_stats(void){ memset(&s_stats, 0, sizeof(s_stats)); }
+
+void sim_i2c_inject_error(uint8_t addr, esp_err_t err, uint32_t count){
+    s_inject.addr = addr;
+    s_inject.err = err;
+    s_inject.count = count;
+}
+
+size_t sim_i2c_run_pending(void){
+    size_t n = 0;
+    while (n < s_npending){
+        s_pending[n].fn(s_pending[n].arg);
+        n++;
+    }
+    s_npending = 0;
+    return n;
+}
+
+// One segment on the wire: (repeated) start + addr + reg [+ repeated start + addr] + data,
+// 9 clocks per byte (8 data + ACK) plus roughly one clock per start condition.
+// Returns wire bytes and adds the start conditions to *conds.
+static esp_err_t do_seg(const i2c_seg_t *s, size_t *bytes, size_t *conds){
+    uint8_t a = s->addr;
+    if (s_inject.count && s_inject.addr == a){
+        s_inject.count--;
+        *bytes += 1; *conds += 1;
+        return s_inject.err;
+    }
+    if (a >= 128 || !s_present[a]){
+        *bytes += 1; *conds += 1;
+        return ESP_FAIL;
+    }
+    if (s->len == 0 && !s->read && !s->buf){  // address-only probe
+        *bytes += 1; *conds += 1;
+        return ESP_OK;
+    }
+    if (s->read){
+        *bytes += 3 + s->len; *conds += 2;
+        return s_devs[a].read ? s_devs[a].read(s_devs[a].ctx, s->reg, s->buf, s->len) : ESP_FAIL;
+    }
+    *bytes += 2 + s->len; *conds += 1;
+    return s_devs[a].write ? s_devs[a].write(s_devs[a].ctx, s->reg, s->buf, s->len) : ESP_FAIL;
+}
+
+// Run segments back to back under a single STOP; like the controller, the
+// transaction aborts at the first failing segment.
+static esp_err_t run(const i2c_seg_t *seg, size_t n){
+    size_t bytes = 0, conds = 1;  // the STOP
+    esp_err_t r = ESP_OK;
+    for (size_t i = 0; i < n && r == ESP_OK; i++) r = do_seg(&seg[i], &bytes, &conds);
+    s_stats.xfers++;
+    s_stats.segments += n;
+    if (r != ESP_OK) s_stats.nacks++;
+    s_stats.bytes += bytes;
+    if (s_bus_hz){
+        uint64_t clocks = (uint64_t)bytes * 9u + conds;
+        uint64_t ns = clocks * 1000000000ULL / s_bus_hz;
+        s_stats.wire_ns += ns;
+        sim_clock_advance_ns(ns);
+    }
+    return r;
+}
+
+esp_err_t i2c_port_init(uint32_t hz){ s_port_hz = hz; return ESP_OK; }
+esp_err_t i2c_port_set_speed(uint32_t hz){ s_port_hz = hz; return ESP_OK; }
+esp_err_t i2c_port_build(i2c_txn_id_t id, const i2c_txn_t *t){ return ESP_OK; }
+
+esp_err_t i2c_port_exec(i2c_txn_id_t id, const i2c_txn_t *t, uint32_t timeout_ms){
+    return run(t->seg, t->nseg);
+}
+
+esp_err_t i2c_port_xfer(const i2c_seg_t *seg, uint32_t timeout_ms){
+    return run(seg, 1);
+}
+
+void i2c_port_lock(void){}
+void i2c_port_unlock(void){}
+
+esp_err_t i2c_port_defer(void (*fn)(void *), void *arg){
+    if (s_npending >= PENDING_MAX) return ESP_ERR_NO_MEM;
+    s_pending[s_npending].fn = fn;
+    s_pending[s_npending].arg = arg;
+    s_npending++;
+    return ESP_OK;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Simulated I2C controller. Implements the bus back-end (i2c_port.h) under
+// the real src/i2c_bus.c on the host and routes every segment to the device
+// model attached at that 7-bit address. An address with nothing attached
+// NACKs (ESP_FAIL), as the ESP-IDF driver reports it.
+
+typedef struct {
+    void *ctx;
+    // Register-pointer write followed by a repeated-start read of len bytes.
+    esp_err_t (*read)(void *ctx, uint8_t reg, uint8_t *buf, size_t len);
+    // Register-pointer write followed by len data bytes (none: i2c_cmd).
+    esp_err_t (*write)(void *ctx, uint8_t reg, const uint8_t *buf, size_t len);
+} sim_i2c_dev_t;
+
+typedef struct {
+    uint32_t xfers;     // bus transactions (one STOP each)
+    uint32_t segments;  // register reads/writes carried by those transactions
+    uint32_t nacks;     // transactions that failed (empty address, device reject, injected error)
+    uint64_t bytes;     // bytes on the wire, address and register bytes included
+    uint64_t wire_ns;   // modelled bus time at the configured clock
+} sim_i2c_stats_t;
+
+esp_err_t sim_i2c_attach(uint8_t addr, const sim_i2c_dev_t *dev);
+void sim_i2c_detach_all(void);
+
+// Bus clock used to model wire time; each transfer advances the virtual clock
+// by that amount. 0 (the default) keeps transfers instantaneous.
+void sim_i2c_set_bus_hz(uint32_t hz);
+// Clock last requested by the bus layer through i2c_port_init/set_speed.
+uint32_t sim_i2c_port_hz(void);
+
+void sim_i2c_get_stats(sim_i2c_stats_t *out);
+void sim_i2c_reset_stats(void);
+
+// Fail the next `count` transactions addressed to `addr` with `err`.
+void sim_i2c_inject_error(uint8_t addr, esp_err_t err, uint32_t count);
+
+// There is no bus task on the host: transfers queued with i2c_txn_submit
+// run, callbacks included, when the test calls this. Returns how many ran.
+size_t sim_i2c_run_pending(void);
@@ -0,0 +1,118 @@
+#include "sim_mqtt.h"
+#include "sim_clock.h"
+#include "mqtt_port.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    uint64_t due_ms;
+    mqtt_port_event_t ev;
+    int msg_id;
+} event_t;
+
+static mqtt_port_cb_t s_cb;
+static bool s_online = true;
+static uint32_t s_ack_delay_ms;
+static uint32_t s_drop_acks;
+static int s_next_id;
+static sim_mqtt_stats_t s_stats;
+
+static event_t *s_ev;
+static size_t s_nev, s_cap_ev;
+static sim_mqtt_msg_t *s_msg;
+static size_t s_nmsg, s_cap_msg;
+
+static void post(mqtt_port_event_t ev, int msg_id, uint32_t delay_ms){
+    if (s_nev == s_cap_ev){
+        s_cap_ev = s_cap_ev ? 2 * s_cap_ev : 64;
+        s_ev = realloc(s_ev, s_cap_ev * sizeof(*s_ev));
+    }
+    s_ev[s_nev++] = (event_t){ .due_ms = sim_clock_now_ns() / 1000000u + delay_ms, .ev = ev, .msg_id = msg_id };
+}
+
+void sim_mqtt_reset(void){
+    for (size_t i = 0; i < s_nmsg; i++) free(s_msg[i].payload);
+    s_nmsg = 0;
+    s_nev = 0;
+    s_cb = NULL;
+    s_online = true;
+    s_ack_delay_ms = 0;
+    s_drop_acks = 0;
+    s_next_id = 0;
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+void sim_mqtt_set_online(bool up){
+    if (up == s_online) return;
+    s_online = up;
+    if (!s_cb) return;
+    if (!up){
+        size_t k = 0;
+        for (size_t i = 0; i < s_nev; i++){
+            if (s_ev[i].ev == MQTT_PORT_PUBACK) s_stats.acks_dropped++;
+            else s_ev[k++] = s_ev[i];
+        }
+        s_nev = k;
+        post(MQTT_PORT_DISCONNECTED, 0, 0);
+    } else {
+        post(MQTT_PORT_CONNECTED, 0, s_ack_delay_ms);
+    }
+}
+
+void sim_mqtt_set_ack_delay_ms(uint32_t ms){ s_ack_delay_ms = ms; }
+void sim_mqtt_drop_acks(uint32_t count){ s_drop_acks = count; }
+
+size_t sim_mqtt_run_pending(void){
+    uint64_t now = sim_clock_now_ns() / 1000000u;
+    size_t n = 0, k = 0;
+    // the callback does not publish, so the list does not change under us
+    for (size_t i = 0; i < s_nev; i++){
+        if (s_ev[i].due_ms <= now){
+            if (s_ev[i].ev == MQTT_PORT_PUBACK) s_stats.acks++;
+            if (s_ev[i].ev == MQTT_PORT_CONNECTED) s_stats.connects++;
+            s_cb(s_ev[i].ev, s_ev[i].msg_id);
+            n++;
+        } else {
+            s_ev[k++] = s_ev[i];
+        }
+    }
+    s_nev = k;
+    return n;
+}
+
+size_t sim_mqtt_messages(void){ return s_nmsg; }
+const sim_mqtt_msg_t *sim_mqtt_message(size_t i){ return i < s_nmsg ? &s_msg[i] : NULL; }
+void sim_mqtt_get_stats(sim_mqtt_stats_t *out){ *out = s_stats; }
+
+esp_err_t mqtt_port_start(const char *uri, const char *client_id, mqtt_port_cb_t cb){
+    s_cb = cb;
+    s_nev = 0;
+    if (s_online) post(MQTT_PORT_CONNECTED, 0, s_ack_delay_ms);
+    return ESP_OK;
+}
+
+int mqtt_port_publish(const char *topic, const void *data, size_t len, int qos){
+    if (!s_online) return -1;
+    if (s_nmsg == s_cap_msg){
+        s_cap_msg = s_cap_msg ? 2 * s_cap_msg : 64;
+        s_msg = realloc(s_msg, s_cap_msg * sizeof(*s_msg));
+    }
+    sim_mqtt_msg_t *m = &s_msg[s_nmsg++];
+    strncpy(m->topic, topic, sizeof(m->topic) - 1);
+    m->topic[sizeof(m->topic) - 1] = '\0';
+    m->payload = malloc(len + 1);
+    memcpy(m->payload, data, len);
+    m->payload[len] = '\0';
+    m->len = len;
+    m->qos = qos;
+    m->t_ns = sim_clock_now_ns();
+    m->msg_id = qos ? (s_next_id % 65535) + 1 : 0;
+    if (qos) s_next_id++;
+    s_stats.publishes++;
+    s_stats.bytes += len;
+    if (qos){
+        if (s_drop_acks) { s_drop_acks--; s_stats.acks_dropped++; }
+        else post(MQTT_PORT_PUBACK, m->msg_id, s_ack_delay_ms);
+    }
+    return m->msg_id;
+}
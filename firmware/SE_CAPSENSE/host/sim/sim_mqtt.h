@@ -0,0 +1,45 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Fake MQTT broker: implements the connection back-end (mqtt_port.h) under
+// the real src/mqtt_svc.c. Published messages are kept for the test to read
+// back; CONNECTED/DISCONNECTED and PUBACK events are scheduled on the
+// virtual clock and delivered to the service when the test calls
+// sim_mqtt_run_pending().
+
+typedef struct {
+    char topic[64];
+    char *payload;       // NUL-terminated copy
+    size_t len;
+    int msg_id;
+    int qos;
+    uint64_t t_ns;       // virtual time of the publish
+} sim_mqtt_msg_t;
+
+typedef struct {
+    uint32_t publishes;
+    uint32_t acks;           // PUBACKs delivered
+    uint32_t acks_dropped;   // by sim_mqtt_drop_acks or a lost link
+    uint32_t connects;
+    uint64_t bytes;
+} sim_mqtt_stats_t;
+
+// Forget messages and events, broker reachable, no ack delay.
+void sim_mqtt_reset(void);
+
+// Link up/down. Going down loses the PUBACKs still on their way.
+void sim_mqtt_set_online(bool up);
+// Round trip from publish to PUBACK.
+void sim_mqtt_set_ack_delay_ms(uint32_t ms);
+// Lose the PUBACKs of the next `count` QoS 1 publishes.
+void sim_mqtt_drop_acks(uint32_t count);
+
+// Deliver the events that are due; returns how many.
+size_t sim_mqtt_run_pending(void);
+
+size_t sim_mqtt_messages(void);
+const sim_mqtt_msg_t *sim_mqtt_message(size_t i);
+
+void sim_mqtt_get_stats(sim_mqtt_stats_t *out);
@@ -0,0 +1,146 @@
+#include "sim_pcap04.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include <math.h>
+#include <string.h>
+
+#define OP_WR_CONFIG 0xA3
+#define OP_RD_RESULT 0x40
+#define OP_TEST_READ 0x7E
+#define OP_POR 0x88
+#define OP_INIT 0x8A
+#define OP_CDC_START 0x8C
+
+#define CFG_CREF 5
+#define CFG_PORT_EN 6
+#define CFG_AVRG 7
+#define CFG_CONV_TIME 9
+#define CFG_TRIG 13
+#define CFG_RUN 47
+#define TRIG_TIMER 2
+
+#define RAM_STATUS0 32
+#define STAT0_EOC 0x08
+
+#define TICK_NS 20000ULL
+
+void sim_pcap04_init(sim_pcap04_t *d){
+    memset(d, 0, sizeof(*d));
+    d->seed = 0x0404u;
+}
+
+static void por(sim_pcap04_t *d){
+    // the configuration and results go, the input model stays
+    memset(d->cfg, 0, sizeof(d->cfg));
+    memset(d->ram, 0, sizeof(d->ram));
+    d->running = 0;
+}
+
+// Same generator as sim_fdc1004.c: Irwin-Hall(4) from xorshift32.
+static float noise(sim_pcap04_t *d){
+    if (d->noise_pf == 0.0f) return 0.0f;
+    float acc = 0.0f;
+    for (int i = 0; i < 4; i++){
+        uint32_t x = d->seed;
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        d->seed = x;
+        acc += (float)(x >> 8) / 16777216.0f;
+    }
+    return (acc - 2.0f) * 1.7320508f;
+}
+
+static uint32_t avrg(const sim_pcap04_t *d){
+    uint32_t a = (d->cfg[CFG_AVRG] | (uint32_t)d->cfg[CFG_AVRG + 1] << 8) & 0x1FFF;
+    return a ? a : 1;
+}
+
+static uint64_t period_ns(const sim_pcap04_t *d){
+    uint32_t t = (d->cfg[CFG_CONV_TIME] | (uint32_t)d->cfg[CFG_CONV_TIME + 1] << 8 |
+                  (uint32_t)d->cfg[CFG_CONV_TIME + 2] << 16) & 0x7FFFFF;
+    return t * TICK_NS;
+}
+
+static void sequence(sim_pcap04_t *d, uint64_t t_ns){
+    uint32_t n = avrg(d);
+    float cref = (float)(d->cfg[CFG_CREF] & 0x1F), scale = 1.0f / sqrtf((float)n);
+    for (int p = 0; p < SIM_PCAP_PORTS; p++){
+        if (!(d->cfg[CFG_PORT_EN] & (1u << p))) continue;
+        float pf = d->input ? d->input(d->input_ctx, p, t_ns) : d->cin_pf[p];
+        pf += noise(d) * d->noise_pf * scale;
+        double q = cref > 0.0f ? floor((double)pf / cref * 134217728.0 + 0.5) : 4294967295.0;   // Q5.27
+        if (q < 0) q = 0;
+        if (q > 4294967295.0) q = 4294967295.0;
+        uint32_t v = (uint32_t)q;
+        for (int i = 0; i < 4; i++) d->ram[4 * p + i] = (uint8_t)(v >> (8 * i));
+        d->conversions += n;
+    }
+    d->ram[RAM_STATUS0] |= STAT0_EOC;
+    d->sequences++;
+}
+
+void sim_pcap04_update(sim_pcap04_t *d){
+    uint64_t T = period_ns(d);
+    if (!d->running || !(d->cfg[CFG_RUN] & 1) || (d->cfg[CFG_TRIG] & 7) != TRIG_TIMER || !T) return;
+    uint64_t k = (sim_clock_now_ns() - d->seq_start_ns) / T;
+    if (k <= d->seq_done) return;
+    // only the last sequence is visible; the ones it overwrote still count
+    uint64_t skipped = k - d->seq_done - 1;
+    d->sequences += skipped;
+    for (int p = 0; p < SIM_PCAP_PORTS; p++)
+        if (d->cfg[CFG_PORT_EN] & (1u << p)) d->conversions += skipped * avrg(d);
+    sequence(d, d->seq_start_ns + k * T);
+    d->seq_done = k;
+}
+
+static esp_err_t pcap_read(void *ctx, uint8_t op, uint8_t *buf, size_t len){
+    sim_pcap04_t *d = ctx;
+    sim_pcap04_update(d);
+    if (op == OP_TEST_READ){
+        memset(buf, 0x11, len);
+        return ESP_OK;
+    }
+    if ((op & 0xC0) == OP_RD_RESULT){
+        size_t a = op & 0x3F;
+        for (size_t i = 0; i < len; i++, a++){
+            buf[i] = a < sizeof(d->ram) ? d->ram[a] : 0;
+            if (a == RAM_STATUS0) d->ram[a] &= (uint8_t)~STAT0_EOC;
+        }
+        return ESP_OK;
+    }
+    return ESP_FAIL;
+}
+
+static esp_err_t pcap_write(void *ctx, uint8_t op, const uint8_t *buf, size_t len){
+    sim_pcap04_t *d = ctx;
+    sim_pcap04_update(d);
+    switch (op){
+    case OP_POR:
+        por(d);
+        return ESP_OK;
+    case OP_INIT:
+        d->running = 0;
+        d->ram[RAM_STATUS0] = 0;
+        return ESP_OK;
+    case OP_CDC_START:
+        d->running = 1;
+        d->seq_start_ns = sim_clock_now_ns();
+        d->seq_done = 0;
+        return ESP_OK;
+    case OP_WR_CONFIG:
+        if (!len || (buf[0] & 0xC0) != 0xC0) return ESP_FAIL;
+        for (size_t i = 1, a = buf[0] & 0x3F; i < len && a < sizeof(d->cfg); i++, a++) d->cfg[a] = buf[i];
+        return ESP_OK;
+    default:
+        return ESP_FAIL;
+    }
+}
+
+void sim_pcap04_dev(sim_pcap04_t *d, sim_i2c_dev_t *out){
+    *out = (sim_i2c_dev_t){ .ctx = d, .read = pcap_read, .write = pcap_write };
+}
+
+esp_err_t sim_pcap04_attach(sim_pcap04_t *d, uint8_t addr){
+    sim_i2c_dev_t dev;
+    sim_pcap04_dev(d, &dev);
+    return sim_i2c_attach(addr, &dev);
+}
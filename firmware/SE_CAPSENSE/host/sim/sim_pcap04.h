@@ -0,0 +1,48 @@
+#pragma once
+#include <esp_err.h>
+#include <stdint.h>
+#include "sim_i2c.h"
+
+// Opcode-level model of the ScioSense PCAP04 capacitance-to-digital
+// converter, attached to the simulated I2C bus: the subset pcap04.c drives.
+//
+// Modelled: the test read (0x11), power-on reset, initialize and CDC start
+// commands, configuration writes (auto-incrementing), and result RAM RES0..RES7 and STATUS_0. Sequences are timer
+// triggered off the virtual clock, one every CONV_TIME ticks of 20 us while
+// RUNBIT is set after a CDC start; each converts the enabled ports C_AVRG
+// times, grounded against the internal reference C_REF_SEL, and stores the
+// averages as Q5.27 ratios. A sequence end latches STATUS_0 EOC until it is
+// read.
+//
+// Noise is per single conversion, so an averaged result shows noise_pf /
+// sqrt(C_AVRG).
+
+#define SIM_PCAP_PORTS 6
+
+// Optional time-varying input: capacitance on port PCx in pF at t_ns.
+typedef float (*sim_pcap_input_fn)(void *ctx, int port, uint64_t t_ns);
+
+typedef struct {
+    // Input model; cin_pf[] is used when input is NULL.
+    float cin_pf[SIM_PCAP_PORTS];
+    sim_pcap_input_fn input;
+    void *input_ctx;
+    float noise_pf;         // RMS noise of one conversion
+    uint32_t seed;
+
+    uint8_t cfg[64];
+    uint8_t ram[36];
+    uint8_t running;        // CDC started
+    uint64_t seq_start_ns;
+    uint64_t seq_done;      // sequences applied to the result RAM
+    uint64_t sequences;     // sequences completed (for tests/benchmarks)
+    uint64_t conversions;   // single conversions in them
+} sim_pcap04_t;
+
+// Power-on state with all inputs at 0 pF and no noise.
+void sim_pcap04_init(sim_pcap04_t *d);
+esp_err_t sim_pcap04_attach(sim_pcap04_t *d, uint8_t addr);
+void sim_pcap04_dev(sim_pcap04_t *d, sim_i2c_dev_t *out);
+
+// Bring the result RAM up to date with the virtual clock.
+void sim_pcap04_update(sim_pcap04_t *d);
@@ -0,0 +1,118 @@
+#include "sim_replay.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "i2ctrace.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define LOOKAHEAD 32
+
+typedef struct {
+    uint32_t *idx;       // records for this address, in order
+    uint32_t n, cap, next;
+} stream_t;
+
+static uint8_t *s_trace;
+static i2ct_rec_t *s_rec;
+static uint32_t s_nrec;
+static stream_t s_stream[128];
+static sim_replay_stats_t s_stats;
+static bool s_done;
+
+static void push(stream_t *s, uint32_t i){
+    if (s->n == s->cap){
+        s->cap = s->cap ? 2 * s->cap : 256;
+        s->idx = realloc(s->idx, s->cap * sizeof(*s->idx));
+    }
+    s->idx[s->n++] = i;
+}
+
+static const i2ct_rec_t *take(uint8_t addr, uint8_t reg, bool read, size_t len){
+    stream_t *s = &s_stream[addr];
+    for (uint32_t k = 0; k < LOOKAHEAD && s->next + k < s->n; k++){
+        const i2ct_rec_t *r = &s_rec[s->idx[s->next + k]];
+        if (r->reg != reg || r->read != read || r->len != len) continue;
+        s_stats.skipped += k;
+        s_stats.matched++;
+        s->next += k + 1;
+        if (s->next == s->n) s_done = true;
+        uint64_t now = sim_clock_now_ns() / 1000u, skew = now > r->t_us ? now - r->t_us : r->t_us - now;
+        if (skew > s_stats.skew_max_us) s_stats.skew_max_us = skew;
+        return r;
+    }
+    s_stats.missed++;
+    return NULL;
+}
+
+static esp_err_t dev_read(void *ctx, uint8_t reg, uint8_t *buf, size_t len){
+    const i2ct_rec_t *r = take((uint8_t)(uintptr_t)ctx, reg, true, len);
+    if (!r) return ESP_FAIL;
+    if (r->status == I2CT_OK) memcpy(buf, r->data, len);
+    return i2ct_err_of(r->status);
+}
+
+static esp_err_t dev_write(void *ctx, uint8_t reg, const uint8_t *buf, size_t len){
+    const i2ct_rec_t *r = take((uint8_t)(uintptr_t)ctx, reg, false, len);
+    if (!r) return ESP_OK;   // the device would have taken it
+    if (len && memcmp(buf, r->data, len)) s_stats.write_diffs++;
+    return i2ct_err_of(r->status);
+}
+
+void sim_replay_unload(void){
+    for (int a = 0; a < 128; a++) free(s_stream[a].idx);
+    memset(s_stream, 0, sizeof(s_stream));
+    free(s_rec);
+    free(s_trace);
+    s_rec = NULL;
+    s_trace = NULL;
+    s_nrec = 0;
+    s_done = false;
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+esp_err_t sim_replay_load(const void *trace, size_t len){
+    sim_replay_unload();
+    s_trace = malloc(len ? len : 1);
+    memcpy(s_trace, trace, len);
+
+    uint32_t cap = 0;
+    size_t off = 0;
+    while (off < len){
+        i2ct_dec_t d;
+        esp_err_t r = i2ct_dec_init(&d, s_trace + off, len - off);
+        if (r != ESP_OK) return r;
+        i2ct_rec_t rec;
+        while ((r = i2ct_dec_next(&d, &rec)) == ESP_OK){
+            if (s_nrec == cap){
+                cap = cap ? 2 * cap : 1024;
+                s_rec = realloc(s_rec, cap * sizeof(*s_rec));
+            }
+            s_rec[s_nrec++] = rec;
+        }
+        if (r != ESP_ERR_NOT_FOUND) return r;
+        off += i2ct_dec_used(&d);
+    }
+    if (!s_nrec) return ESP_ERR_NOT_FOUND;
+    s_stats.records = s_nrec;
+
+    bool attached[128] = { false };
+    sim_i2c_detach_all();
+    for (uint32_t i = 0; i < s_nrec; i++){
+        const i2ct_rec_t *r = &s_rec[i];
+        if (r->addr >= 128) continue;
+        if (!attached[r->addr]){
+            sim_i2c_dev_t dev = { .ctx = (void *)(uintptr_t)r->addr, .read = dev_read, .write = dev_write };
+            sim_i2c_attach(r->addr, &dev);
+            attached[r->addr] = true;
+        }
+        if (r->read || r->len) push(&s_stream[r->addr], i);   // probes never reach a device
+    }
+    return ESP_OK;
+}
+
+uint64_t sim_replay_t0_us(void){ return s_nrec ? s_rec[0].t_us : 0; }
+uint64_t sim_replay_t1_us(void){ return s_nrec ? s_rec[s_nrec - 1].t_us : 0; }
+
+bool sim_replay_done(void){ return s_done; }
+
+void sim_replay_get_stats(sim_replay_stats_t *out){ *out = s_stats; }
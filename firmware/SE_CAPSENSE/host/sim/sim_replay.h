@@ -0,0 +1,40 @@
+#pragma once
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Captured I2C trace (include/i2ctrace.h) played back as the devices on
+// the simulated bus: every address in the trace answers the firmware's
+// transfers with the recorded data and results, in recorded order, so the
+// real fdc1004.c / bme280_drv.c / sampler.c see the field bus again.
+//
+// Each address is its own stream. A transfer takes the next record with
+// the same register, direction and length, within a few records (what the
+// firmware does not ask for, e.g. a CLI read, is skipped); if there is
+// none it is a miss, and a read NACKs. Time is the caller's: run the
+// firmware on the virtual clock, starting at sim_replay_t0_us, until
+// sim_replay_done.
+
+typedef struct {
+    uint32_t records;       // in the trace
+    uint32_t matched;
+    uint32_t skipped;       // records passed over to find a match
+    uint32_t missed;        // transfers with no matching record
+    uint32_t write_diffs;   // matched writes whose data differ from the trace
+    uint64_t skew_max_us;   // largest |virtual time - recorded time| at a match
+} sim_replay_stats_t;
+
+// Parse a whole trace (one or more blocks) and attach its addresses to the
+// simulated bus in place of whatever was there. The trace is copied.
+esp_err_t sim_replay_load(const void *trace, size_t len);
+void sim_replay_unload(void);
+
+// First and last recorded times.
+uint64_t sim_replay_t0_us(void);
+uint64_t sim_replay_t1_us(void);
+
+// True once an address has no records left.
+bool sim_replay_done(void);
+
+void sim_replay_get_stats(sim_replay_stats_t *out);
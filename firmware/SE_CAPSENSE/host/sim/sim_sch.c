@@ -0,0 +1,30 @@
+#include "sim_sch.h"
+#include "sim_clock.h"
+#include "sch_port.h"
+#include <string.h>
+
+static bool s_wake;
+static sim_sch_stats_t s_stats;
+
+void sim_sch_reset(void){
+    s_wake = false;
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+void sim_sch_get_stats(sim_sch_stats_t *out){ *out = s_stats; }
+
+esp_err_t sch_port_init(void){ return ESP_OK; }
+
+void sch_port_wait_us(uint32_t us){
+    s_stats.waits++;
+    if (s_wake){
+        s_wake = false;
+        s_stats.woken++;
+        return;
+    }
+    if (us == UINT32_MAX) return;
+    sim_clock_advance_us(us);
+    s_stats.slept_us += us;
+}
+
+void sch_port_wake(void){ s_wake = true; }
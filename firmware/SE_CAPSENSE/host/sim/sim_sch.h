@@ -0,0 +1,16 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+// Scheduler sleep/wake back-end (sch_port.h) on the virtual clock: a wait
+// advances the clock by its full length unless sch_trigger woke the loop
+// first. A wait with no deadline returns at once.
+
+typedef struct {
+    uint32_t waits;
+    uint32_t woken;        // waits cut short by a wake
+    uint64_t slept_us;
+} sim_sch_stats_t;
+
+void sim_sch_reset(void);
+void sim_sch_get_stats(sim_sch_stats_t *out);
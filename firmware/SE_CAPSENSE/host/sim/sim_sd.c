@@ -0,0 +1,182 @@
+#define _GNU_SOURCE
+#include "sim_sd.h"
+#include "sim_clock.h"
+#include "sd_port.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static char s_path[256] = "sim_sd.img";
+static int s_fd = -1;
+static uint32_t s_sectors;
+static uint32_t s_capacity;
+static uint32_t s_per_write_us, s_per_sector_us;
+static bool s_realtime, s_durable;
+static struct { esp_err_t err; uint32_t count; } s_inject;
+static uint32_t s_refuse;
+static bool s_cut_armed, s_dead;
+static uint32_t s_cut_sectors;
+static sim_sd_stats_t s_stats;
+
+#define PENDING_MAX 4
+static struct { void (*fn)(void *); void *arg; } s_pending[PENDING_MAX];
+static size_t s_npending;
+
+static uint64_t wall_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void sim_sd_reset(void){
+    sd_port_close();
+    s_capacity = 0;
+    s_per_write_us = s_per_sector_us = 0;
+    s_realtime = s_durable = false;
+    s_inject.count = 0;
+    s_refuse = 0;
+    s_cut_armed = s_dead = false;
+    s_npending = 0;
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+void sim_sd_set_path(const char *path){
+    strncpy(s_path, path, sizeof(s_path) - 1);
+    s_path[sizeof(s_path) - 1] = '\0';
+}
+
+void sim_sd_set_capacity(uint32_t sectors){ s_capacity = sectors; }
+
+void sim_sd_set_latency_us(uint32_t per_write_us, uint32_t per_sector_us){
+    s_per_write_us = per_write_us;
+    s_per_sector_us = per_sector_us;
+}
+
+void sim_sd_set_realtime(bool on, bool durable){
+    s_realtime = on;
+    s_durable = durable;
+}
+
+void sim_sd_inject_error(esp_err_t err, uint32_t count){
+    s_inject.err = err;
+    s_inject.count = count;
+}
+
+void sim_sd_refuse_defer(uint32_t count){ s_refuse = count; }
+
+void sim_sd_cut_power_after(uint32_t sectors){
+    s_cut_armed = true;
+    s_cut_sectors = sectors;
+}
+
+size_t sim_sd_run_pending(void){
+    size_t n = 0;
+    while (n < s_npending){
+        s_pending[n].fn(s_pending[n].arg);
+        n++;
+    }
+    s_npending = 0;
+    return n;
+}
+
+size_t sim_sd_pending(void){ return s_npending; }
+
+void sim_sd_get_stats(sim_sd_stats_t *out){ *out = s_stats; }
+void sim_sd_reset_stats(void){ memset(&s_stats, 0, sizeof(s_stats)); }
+
+// ---- sd_port.h ----
+
+static esp_err_t check(void){
+    if (s_fd < 0 || s_dead) return ESP_FAIL;
+    if (s_inject.count){
+        s_inject.count--;
+        return s_inject.err;
+    }
+    return ESP_OK;
+}
+
+static void account(uint64_t t0, uint32_t sectors, bool write){
+    if (s_realtime) sim_clock_advance_ns(wall_ns() - t0);
+    else sim_clock_advance_us((write ? s_per_write_us : 0) + (uint64_t)s_per_sector_us * sectors);
+}
+
+esp_err_t sd_port_open(uint32_t sectors){
+    sd_port_close();
+    s_dead = false;
+    s_cut_armed = false;
+    s_fd = open(s_path, O_RDWR | O_CREAT, 0644);
+    if (s_fd < 0) return ESP_FAIL;
+    if (s_capacity && sectors > s_capacity) sectors = s_capacity;
+    struct stat st;
+    if (fstat(s_fd, &st) != 0){ sd_port_close(); return ESP_FAIL; }
+    // preallocate: a sparse file reads back as zeros, like a fresh card
+    if ((uint64_t)st.st_size < (uint64_t)sectors * SD_SECTOR_SIZE &&
+        ftruncate(s_fd, (off_t)sectors * SD_SECTOR_SIZE) != 0){
+        sd_port_close();
+        return ESP_ERR_NO_MEM;
+    }
+    s_sectors = sectors;
+    return ESP_OK;
+}
+
+uint32_t sd_port_sectors(void){ return s_fd >= 0 ? s_sectors : 0; }
+
+void sd_port_close(void){
+    if (s_fd >= 0) close(s_fd);
+    s_fd = -1;
+    s_sectors = 0;
+}
+
+esp_err_t sd_port_write(uint32_t sector, const void *buf, uint32_t count){
+    esp_err_t r = check();
+    if (r != ESP_OK) return r;
+    if ((uint64_t)sector + count > s_sectors) return ESP_ERR_INVALID_ARG;
+    uint32_t n = count;
+    if (s_cut_armed && s_cut_sectors < n) n = s_cut_sectors;
+    uint64_t t0 = wall_ns();
+    ssize_t w = pwrite(s_fd, buf, (size_t)n * SD_SECTOR_SIZE, (off_t)sector * SD_SECTOR_SIZE);
+    account(t0, n, true);
+    s_stats.writes++;
+    s_stats.sectors_written += n;
+    if (s_cut_armed){
+        s_dead = true;
+        return ESP_FAIL;
+    }
+    return w == (ssize_t)count * SD_SECTOR_SIZE ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t sd_port_read(uint32_t sector, void *buf, uint32_t count){
+    esp_err_t r = check();
+    if (r != ESP_OK) return r;
+    if ((uint64_t)sector + count > s_sectors) return ESP_ERR_INVALID_ARG;
+    uint64_t t0 = wall_ns();
+    ssize_t got = pread(s_fd, buf, (size_t)count * SD_SECTOR_SIZE, (off_t)sector * SD_SECTOR_SIZE);
+    account(t0, count, false);
+    s_stats.reads++;
+    s_stats.sectors_read += count;
+    return got == (ssize_t)count * SD_SECTOR_SIZE ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t sd_port_sync(void){
+    esp_err_t r = check();
+    if (r != ESP_OK) return r;
+    uint64_t t0 = wall_ns();
+    int rc = s_durable ? fdatasync(s_fd) : 0;
+    account(t0, 0, false);
+    s_stats.syncs++;
+    return rc == 0 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t sd_port_defer(void (*fn)(void *), void *arg){
+    if (s_refuse){
+        s_refuse--;
+        return ESP_ERR_NO_MEM;
+    }
+    if (s_npending >= PENDING_MAX) return ESP_ERR_NO_MEM;
+    s_pending[s_npending].fn = fn;
+    s_pending[s_npending].arg = arg;
+    s_npending++;
+    return ESP_OK;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Simulated SD card: implements the storage back-end (sd_port.h) under the
+// real src/sd_logger.c with a plain file standing in for the log file on the
+// card. There is no writer task on the host: deferred writes run when the
+// test calls sim_sd_run_pending().
+
+typedef struct {
+    uint32_t writes;
+    uint32_t reads;
+    uint32_t syncs;
+    uint64_t sectors_written;
+    uint64_t sectors_read;
+} sim_sd_stats_t;
+
+// Close the image and restore the defaults below; the image file is kept.
+void sim_sd_reset(void);
+// Backing file, "sim_sd.img" in the working directory by default.
+void sim_sd_set_path(const char *path);
+// Card space available to the log in sectors; 0 (default) = as requested.
+void sim_sd_set_capacity(uint32_t sectors);
+
+// Timing. Modelled card time per write and per sector (read or written)
+// advances the virtual clock. In real-time mode each call advances it by the wall time the file
+// operation took instead, so the logger's latency stats measure the host
+// file system; `durable` makes sd_port_sync an fdatasync.
+void sim_sd_set_latency_us(uint32_t per_write_us, uint32_t per_sector_us);
+void sim_sd_set_realtime(bool on, bool durable);
+
+// Fail the next `count` reads/writes/syncs with err.
+void sim_sd_inject_error(esp_err_t err, uint32_t count);
+// Refuse the next `count` sd_port_defer calls, as a full writer queue does.
+void sim_sd_refuse_defer(uint32_t count);
+// Power cut: the next write stores only its first `sectors` sectors and
+// every access fails from then on, until the next sd_port_open.
+void sim_sd_cut_power_after(uint32_t sectors);
+
+size_t sim_sd_run_pending(void);
+size_t sim_sd_pending(void);
+
+void sim_sd_get_stats(sim_sd_stats_t *out);
+void sim_sd_reset_stats(void);
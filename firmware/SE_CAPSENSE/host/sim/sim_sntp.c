@@ -0,0 +1,45 @@
+#include "sim_sntp.h"
+#include "sim_clock.h"
+#include "tb_port.h"
+#include "timebase.h"
+
+static bool s_started;
+static uint32_t s_interval_ms;
+static uint64_t s_due_us;
+static int64_t s_offset_us;
+static int32_t s_drift_ppm;
+
+void tb_port_lock(void){}
+void tb_port_unlock(void){}
+
+esp_err_t tb_port_sntp_start(const char *server, uint32_t interval_ms){
+    if (s_started) return ESP_OK;
+    s_started = true;
+    s_interval_ms = interval_ms;
+    s_due_us = sim_clock_now_ns() / 1000u;
+    return ESP_OK;
+}
+
+void sim_sntp_reset(void){
+    s_started = false;
+    s_offset_us = 0;
+    s_drift_ppm = 0;
+}
+
+void sim_sntp_set_offset_us(int64_t offset_us){ s_offset_us = offset_us; }
+void sim_sntp_set_drift_ppm(int32_t ppm){ s_drift_ppm = ppm; }
+
+uint64_t sim_sntp_now_us(void){
+    uint64_t t = sim_clock_now_ns() / 1000u;
+    return t + (uint64_t)(s_offset_us + (int64_t)t * s_drift_ppm / 1000000);
+}
+
+size_t sim_sntp_run_pending(void){
+    uint64_t now = sim_clock_now_ns() / 1000u;
+    if (!s_started || now < s_due_us) return 0;
+    tb_sync(sim_sntp_now_us(), now);
+    while (s_due_us <= now) s_due_us += (uint64_t)s_interval_ms * 1000u;
+    return 1;
+}
+
+bool sim_sntp_started(void){ return s_started; }
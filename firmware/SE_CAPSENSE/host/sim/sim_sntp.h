@@ -0,0 +1,28 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Stand-in SNTP server: implements the time back-end (tb_port.h) under the
+// real src/timebase.c. Its clock is the virtual clock plus an offset and a
+// drift, so a test can put the board's wall clock anywhere; answers are
+// due every interval the firmware asked for, from the start, and reach
+// tb_sync when the test calls sim_sntp_run_pending(). The lock is a no-op
+// (the host build is single-threaded).
+
+// Not started, offset and drift 0.
+void sim_sntp_reset(void);
+
+// Server time minus virtual time at virtual time 0, and how fast the
+// server's clock runs against the virtual one.
+void sim_sntp_set_offset_us(int64_t offset_us);
+void sim_sntp_set_drift_ppm(int32_t ppm);
+
+// The server's clock now, Unix us.
+uint64_t sim_sntp_now_us(void);
+
+// Deliver the answer that is due, if any (several missed polls make one);
+// returns how many.
+size_t sim_sntp_run_pending(void);
+
+bool sim_sntp_started(void);
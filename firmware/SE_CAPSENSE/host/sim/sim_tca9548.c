@@ -0,0 +1,44 @@
+#include "sim_tca9548.h"
+#include <string.h>
+
+void sim_tca9548_init(sim_tca9548_t *m){ memset(m, 0, sizeof(*m)); }
+
+static esp_err_t ctrl_read(void *ctx, uint8_t reg, uint8_t *buf, size_t len){
+    sim_tca9548_t *m = ctx;
+    memset(buf, m->ctrl, len);
+    return ESP_OK;
+}
+
+// The part has no register pointer: reg is the first control byte.
+static esp_err_t ctrl_write(void *ctx, uint8_t reg, const uint8_t *buf, size_t len){
+    sim_tca9548_t *m = ctx;
+    m->ctrl = len ? buf[len - 1] : reg;
+    m->ctrl_writes++;
+    return ESP_OK;
+}
+
+static const sim_i2c_dev_t *routed(sim_tca9548_t *m){
+    uint8_t c = m->ctrl;
+    if (!c || (c & (c - 1)) || !m->down[__builtin_ctz(c)].read){
+        m->misrouted++;
+        return NULL;
+    }
+    return &m->down[__builtin_ctz(c)];
+}
+
+static esp_err_t down_read(void *ctx, uint8_t reg, uint8_t *buf, size_t len){
+    const sim_i2c_dev_t *d = routed(ctx);
+    return d ? d->read(d->ctx, reg, buf, len) : ESP_FAIL;
+}
+
+static esp_err_t down_write(void *ctx, uint8_t reg, const uint8_t *buf, size_t len){
+    const sim_i2c_dev_t *d = routed(ctx);
+    return d ? d->write(d->ctx, reg, buf, len) : ESP_FAIL;
+}
+
+esp_err_t sim_tca9548_attach(sim_tca9548_t *m, uint8_t addr, uint8_t down_addr){
+    sim_i2c_dev_t ctrl = { .ctx = m, .read = ctrl_read, .write = ctrl_write };
+    sim_i2c_dev_t down = { .ctx = m, .read = down_read, .write = down_write };
+    esp_err_t r = sim_i2c_attach(addr, &ctrl);
+    return r != ESP_OK ? r : sim_i2c_attach(down_addr, &down);
+}
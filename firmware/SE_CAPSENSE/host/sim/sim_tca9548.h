@@ -0,0 +1,28 @@
+#pragma once
+#include <esp_err.h>
+#include <stdint.h>
+#include "sim_i2c.h"
+
+// Model of the TI TCA9548A 1-to-8 I2C switch on the simulated bus.
+//
+// The control register (one byte, channel c enabled by bit c) answers at
+// the mux address: a write takes the last byte sent, a read returns it.
+// Downstream, each channel carries at most one device and all of them
+// share one address, as the FDC1004s do; an access there reaches the
+// device on the single enabled channel, and NACKs when no channel, more
+// than one (their replies would collide) or an empty one is enabled.
+
+#define SIM_TCA_CHANNELS 8
+
+typedef struct {
+    uint8_t ctrl;                          // channel enables, 0 at power-on
+    sim_i2c_dev_t down[SIM_TCA_CHANNELS];  // read NULL: nothing on that channel
+    uint32_t ctrl_writes;
+    uint32_t misrouted;                    // downstream accesses that NACKed
+} sim_tca9548_t;
+
+// Power-on state with every channel off and empty.
+void sim_tca9548_init(sim_tca9548_t *m);
+// Attach the control register at addr and the downstream devices at
+// down_addr.
+esp_err_t sim_tca9548_attach(sim_tca9548_t *m, uint8_t addr, uint8_t down_addr);
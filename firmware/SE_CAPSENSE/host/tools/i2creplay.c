@@ -0,0 +1,184 @@
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "sim_replay.h"
+#include "acq.h"
+#include "bme280_drv.h"
+#include "board.h"
+#include "config.h"
+#include "i2ctrace.h"
+#include "record.h"
+#include "sampler.h"
+#include "esp_log.h"
+#include <ctype.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Replay a captured I2C trace (include/i2ctrace.h) through the real
+// fdc1004.c, bme280_drv.c, sampler.c and acquisition task on the virtual
+// clock, as fast as the host allows, and report the throughput. -o writes
+// the records the firmware made from it as CSV (rc2csv's columns), to
+// compare filter settings or firmware versions on the same field data.
+//
+// The trace is the binary file, or a console log with the "I2CT <hex>"
+// lines of the CLI's 'i2c trace' command.
+//
+// -g captures a trace instead, from the simulated board drying a plank
+// for the given virtual seconds, to try the replay without a board.
+//
+// A trace captured from boot (I2C_CAPTURE_BYTES) has the chip IDs and the
+// BME280 calibration the drivers read at init; one started later replays
+// with those reads missing.
+//
+// usage: i2creplay [-o records.csv] trace
+//        i2creplay -g seconds trace
+
+#define TAU_S 7200.0
+
+static double wall_s(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static float drying_input(void *ctx, int cin, uint64_t t_ns){
+    (void)ctx;
+    double t = (double)t_ns / 1e9;
+    if (cin == WMC_MEAS) return (float)(4.0 + 6.0 * exp(-t / TAU_S));
+    return (float)(2.0 + cin);
+}
+
+// Hex from every "I2CT " line, in place; returns the bytes.
+static size_t from_console(uint8_t *buf, size_t len){
+    size_t n = 0;
+    for (size_t i = 0; i + 5 <= len; i++){
+        if (memcmp(buf + i, "I2CT ", 5) || (i && buf[i - 1] != '\n')) continue;
+        for (i += 5; i + 1 < len && isxdigit(buf[i]) && isxdigit(buf[i + 1]); i += 2){
+            char h[3] = { (char)buf[i], (char)buf[i + 1], 0 };
+            buf[n++] = (uint8_t)strtoul(h, NULL, 16);
+        }
+    }
+    return n;
+}
+
+static void csv_header(FILE *f){
+    fprintf(f, "t_ms");
+    for (int c = 0; c < SAMPLE_CAPS; c++) fprintf(f, ",cap%d", c);
+    for (int c = 0; c < SAMPLE_CAPS; c++) fprintf(f, ",dac%d", c);
+    fprintf(f, ",temp_cdeg,hum_q10,pres_q8,mc_cpct,flags\n");
+}
+
+static void csv_row(FILE *f, const sample_t *s){
+    fprintf(f, "%" PRIu64, s->t_ms);
+    for (int c = 0; c < SAMPLE_CAPS; c++) fprintf(f, ",%" PRId32, s->cap_raw[c]);
+    for (int c = 0; c < SAMPLE_CAPS; c++) fprintf(f, ",%u", s->capdac[c]);
+    fprintf(f, ",%" PRId32 ",%" PRIu32 ",%" PRIu32 ",%u,%u\n", s->temp_cdeg, s->hum_q10, s->pres_q8, s->mc_cpct, s->flags);
+}
+
+static FILE *s_out;
+
+static void sink(const void *block, size_t len){ fwrite(block, 1, len, s_out); }
+
+static int generate(unsigned long seconds, const char *path){
+    if (!(s_out = fopen(path, "wb"))) return 2;
+    sim_board_init();
+    sim_board_fdc.input = drying_input;
+    sim_board_fdc.noise_pf = 0.002f;
+    sim_i2c_set_bus_hz(I2C_FREQ_HZ);
+    static uint8_t block[4096];
+    i2ct_capture_start(block, sizeof(block), sink);
+    bme_init();
+    sampler_init();
+    acq_start();
+    sample_t s;
+    for (uint64_t ms = 0; ms < seconds * 1000ull; ms += SAMPLE_PERIOD_MS){
+        sim_board_bme.hum_pct = (float)(55.0 + 10.0 * exp(-(double)ms / 1000.0 / TAU_S));
+        sim_clock_advance_ms(SAMPLE_PERIOD_MS);
+        while (record_pop(&s)) {}
+    }
+    sim_clock_set_task(NULL, 0);
+    const void *last;
+    size_t len = i2ct_capture_stop(&last);
+    sink(last, len);
+    i2ct_stats_t st;
+    i2ct_get_stats(&st);
+    long bytes = ftell(s_out);
+    fclose(s_out);
+    printf("i2creplay: %lu s captured to %s: %u transfers, %ld bytes (%.1f bytes/s)\n", seconds, path,
+           (unsigned)st.records, bytes, (double)bytes / (double)seconds);
+    return st.dropped ? 1 : 0;
+}
+
+static int replay(const char *path, const char *csv){
+    FILE *f = fopen(path, "rb");
+    if (!f){
+        fprintf(stderr, "i2creplay: cannot read %s\n", path);
+        return 2;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *buf = malloc(len > 0 ? (size_t)len : 1);
+    if (fread(buf, 1, (size_t)len, f) != (size_t)len) len = 0;
+    fclose(f);
+    if (len < 2 || buf[0] != I2CT_MAGIC || buf[1] != I2CT_VERSION) len = (long)from_console(buf, (size_t)len);
+    FILE *out = csv ? fopen(csv, "w") : NULL;
+    if (csv && !out) return 2;
+    if (out) csv_header(out);
+
+    sim_board_init();
+    esp_err_t r = sim_replay_load(buf, (size_t)len);
+    free(buf);
+    if (r != ESP_OK){
+        fprintf(stderr, "i2creplay: not a trace: %s\n", esp_err_to_name(r));
+        return 1;
+    }
+    double w0 = wall_s();
+    sim_clock_set_ns(sim_replay_t0_us() * 1000u);
+    bme_init();
+    sampler_init();
+    acq_start();
+    uint64_t n = 0;
+    sample_t s;
+    while (!sim_replay_done() && sim_clock_now_ns() / 1000u <= sim_replay_t1_us() + 10000000u){
+        sim_clock_advance_ms(SAMPLE_PERIOD_MS);
+        while (record_pop(&s)){
+            n++;
+            if (out) csv_row(out, &s);
+        }
+    }
+    sim_clock_set_task(NULL, 0);
+    double wall = wall_s() - w0, span = (double)(sim_replay_t1_us() - sim_replay_t0_us()) / 1e6;
+    if (out) fclose(out);
+
+    sim_replay_stats_t st;
+    sim_replay_get_stats(&st);
+    printf("i2creplay: %" PRIu64 " samples from %.1f h of bus traffic in %.3f s: %.0f samples/s, %.0fx real time\n",
+           n, span / 3600.0, wall, (double)n / wall, span / wall);
+    printf("  %u transfers recorded, %u matched, %u skipped, %u missed, %u writes differ, max skew %" PRIu64 " us\n",
+           (unsigned)st.records, (unsigned)st.matched, (unsigned)st.skipped, (unsigned)st.missed,
+           (unsigned)st.write_diffs, st.skew_max_us);
+    sim_replay_unload();
+    return 0;
+}
+
+int main(int argc, char **argv){
+    const char *csv = NULL, *path = NULL;
+    unsigned long gen = 0;
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) csv = argv[++i];
+        else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) gen = strtoul(argv[++i], NULL, 0);
+        else if (!path && argv[i][0] != '-') path = argv[i];
+        else path = NULL, i = argc;
+    }
+    if (!path){
+        fprintf(stderr, "usage: i2creplay [-o records.csv] trace\n       i2creplay -g seconds trace\n");
+        return 2;
+    }
+    esp_log_level_set("*", ESP_LOG_NONE);
+    return gen ? generate(gen, path) : replay(path, csv);
+}
@@ -0,0 +1,145 @@
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_mqtt.h"
+#include "sim_sntp.h"
+#include "acq.h"
+#include "bme280_drv.h"
+#include "config.h"
+#include "mqtt_svc.h"
+#include "record.h"
+#include "sampler.h"
+#include "timebase.h"
+#include "esp_log.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Delivery latency of the JSON records on MQTT_BASE_TOPIC "/data": each
+// record's "e" (its conversion on the board's SNTP wall clock) against the
+// time the message arrived, for a subscriber whose clock follows the same
+// NTP server. Prints the count and the 50/90/99th percentiles and maximum
+// in ms.
+//
+// The input is one message a line, receive time (Unix seconds) first, as
+// mosquitto_sub writes it:
+//   mosquitto_sub -h broker -t 'capsense/+/data' -F '%U %p' > lat.txt
+//
+// -g writes such a file instead, from the simulated board and broker for
+// the given virtual seconds, the broker MQTT RTT_MS away and the NTP
+// server's clock SERVER_PPM off the board's, to try the report without a
+// board.
+//
+// usage: mqttlat file
+//        mqttlat -g seconds file
+
+#define RTT_MS 40
+#define SERVER_OFFSET_US 1700000000000000ll   // Nov 2023
+#define SERVER_PPM 30
+
+static int generate(unsigned long seconds, const char *path){
+    FILE *out = fopen(path, "w");
+    if (!out) return 2;
+    sim_board_init();
+    sim_mqtt_reset();
+    sim_mqtt_set_ack_delay_ms(RTT_MS);
+    sim_sntp_reset();
+    sim_sntp_set_offset_us(SERVER_OFFSET_US);
+    sim_sntp_set_drift_ppm(SERVER_PPM);
+    tb_reset();
+    bme_init();
+    sampler_init();
+    mqtt_svc_init();
+    tb_sntp_start();
+    acq_start();
+    size_t seen = 0;
+    sample_t s;
+    for (uint64_t ms = 0; ms < seconds * 1000ull; ms += MQTT_PUB_PERIOD_MS){
+        sim_clock_advance_ms(MQTT_PUB_PERIOD_MS);
+        sim_sntp_run_pending();
+        sim_mqtt_run_pending();
+        while (record_pop(&s) && mqtt_svc_enqueue(&s)) {}
+        mqtt_svc_job_drain();
+        // arrival: half the round trip after the publish, on the server's clock
+        for (; seen < sim_mqtt_messages(); seen++){
+            const sim_mqtt_msg_t *m = sim_mqtt_message(seen);
+            if (!strstr(m->topic, "/data")) continue;
+            uint64_t rx = sim_sntp_now_us() - (sim_clock_now_ns() - m->t_ns) / 1000u + RTT_MS * 500u;
+            fprintf(out, "%" PRIu64 ".%06u %s\n", rx / 1000000u, (unsigned)(rx % 1000000u), m->payload);
+        }
+    }
+    sim_clock_set_task(NULL, 0);
+    fclose(out);
+    tb_stats_t ts;
+    tb_get_stats(&ts);
+    printf("mqttlat: %lu s of records written to %s: %zu messages, %u SNTP answers\n",
+           seconds, path, seen, (unsigned)ts.syncs);
+    return seen ? 0 : 1;
+}
+
+static int cmp_i64(const void *a, const void *b){
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double pct_ms(const int64_t *v, size_t n, unsigned p){
+    size_t i = (n * p + 99) / 100;
+    return (double)v[i ? i - 1 : 0] / 1000.0;
+}
+
+static int report(const char *path){
+    FILE *f = fopen(path, "r");
+    if (!f){
+        fprintf(stderr, "mqttlat: cannot read %s\n", path);
+        return 2;
+    }
+    static char line[1 << 16];
+    int64_t *lat = NULL;
+    size_t n = 0, cap = 0, msgs = 0, unsynced = 0;
+    while (fgets(line, sizeof(line), f)){
+        char *p;
+        double rx_s = strtod(line, &p);
+        if (p == line || rx_s <= 0) continue;
+        int64_t rx = (int64_t)(rx_s * 1e6 + 0.5);
+        msgs++;
+        while ((p = strstr(p, "\"e\":")) != NULL){
+            p += 4;
+            int64_t e = strtoll(p, &p, 10);
+            if (!e) { unsynced++; continue; }
+            if (n == cap){
+                cap = cap ? 2 * cap : 1024;
+                lat = realloc(lat, cap * sizeof(*lat));
+            }
+            lat[n++] = rx - e;
+        }
+    }
+    fclose(f);
+    if (!n){
+        fprintf(stderr, "mqttlat: no timestamped records in %s (%zu messages)\n", path, msgs);
+        free(lat);
+        return 1;
+    }
+    qsort(lat, n, sizeof(*lat), cmp_i64);
+    printf("mqttlat: %zu records in %zu messages (%zu before SNTP skipped)\n", n, msgs, unsynced);
+    printf("  latency ms: p50 %.1f  p90 %.1f  p99 %.1f  max %.1f  min %.1f\n",
+           pct_ms(lat, n, 50), pct_ms(lat, n, 90), pct_ms(lat, n, 99), (double)lat[n - 1] / 1000.0,
+           (double)lat[0] / 1000.0);
+    free(lat);
+    return 0;
+}
+
+int main(int argc, char **argv){
+    const char *path = NULL;
+    unsigned long gen = 0;
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) gen = strtoul(argv[++i], NULL, 0);
+        else if (!path && argv[i][0] != '-') path = argv[i];
+        else path = NULL, i = argc;
+    }
+    if (!path){
+        fprintf(stderr, "usage: mqttlat file\n       mqttlat -g seconds file\n");
+        return 2;
+    }
+    esp_log_level_set("*", ESP_LOG_NONE);
+    return gen ? generate(gen, path) : report(path);
+}
@@ -0,0 +1,62 @@
+#include "reccodec.h"
+#include "tscodec.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Decode one reccodec or tscodec block to CSV, e.g. an MQTT_FMT_BIN or
+// MQTT_FMT_TSC payload saved by a subscriber (whose first 4 bytes are the
+// message seq: -s 4).
+//
+// usage: rc2csv [-s skip] < block > records.csv
+
+static void csv_header(FILE *f){
+    fprintf(f, "t_ms,t_us,epoch_us");
+    for (int c = 0; c < SAMPLE_CAPS; c++) fprintf(f, ",cap%d", c);
+    for (int c = 0; c < SAMPLE_CAPS; c++) fprintf(f, ",dac%d", c);
+    fprintf(f, ",temp_cdeg,hum_q10,pres_q8,mc_cpct,flags\n");
+}
+
+static void csv_row(FILE *f, const sample_t *s){
+    fprintf(f, "%" PRIu64 ",%" PRIu64 ",%" PRIu64, s->t_ms, s->t_us, s->epoch_us);
+    for (int c = 0; c < SAMPLE_CAPS; c++) fprintf(f, ",%" PRId32, s->cap_raw[c]);
+    for (int c = 0; c < SAMPLE_CAPS; c++) fprintf(f, ",%u", s->capdac[c]);
+    fprintf(f, ",%" PRId32 ",%" PRIu32 ",%" PRIu32 ",%u,%u\n", s->temp_cdeg, s->hum_q10, s->pres_q8, s->mc_cpct, s->flags);
+}
+
+int main(int argc, char **argv){
+    size_t skip = 0;
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) skip = strtoul(argv[++i], NULL, 0);
+        else {
+            fprintf(stderr, "usage: rc2csv [-s skip] < block\n");
+            return 2;
+        }
+    }
+    static uint8_t buf[1 << 20];
+    size_t len = fread(buf, 1, sizeof(buf), stdin);
+    if (len <= skip){
+        fprintf(stderr, "rc2csv: no block\n");
+        return 1;
+    }
+
+    bool tsc = buf[skip] == TSC_MAGIC;
+    rc_dec_t d;
+    tsc_dec_t td;
+    esp_err_t r = tsc ? tsc_dec_init(&td, buf + skip, len - skip) : rc_dec_init(&d, buf + skip, len - skip);
+    if (r != ESP_OK){
+        fprintf(stderr, "rc2csv: not a block: %s\n", esp_err_to_name(r));
+        return 1;
+    }
+    csv_header(stdout);
+    sample_t s;
+    while ((r = tsc ? tsc_dec_next(&td, &s) : rc_dec_next(&d, &s)) == ESP_OK) csv_row(stdout, &s);
+    if (r != ESP_ERR_NOT_FOUND){
+        uint16_t count = tsc ? td.count : d.count, left = tsc ? td.left : d.left;
+        fprintf(stderr, "rc2csv: block cut short after %u of %u records\n", (unsigned)(count - left),
+                (unsigned)count);
+        return 1;
+    }
+    return 0;
+}
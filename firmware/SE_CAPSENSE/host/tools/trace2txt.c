@@ -0,0 +1,23 @@
+#include "trace.h"
+#include <stdio.h>
+
+// Turn a trace_export blob (formats plus events, see trace.h) back into log
+// lines.
+//
+// usage: trace2txt < blob
+
+static void print_line(void *ctx, const char *text){
+    (void)ctx;
+    puts(text);
+}
+
+int main(void){
+    static uint8_t buf[1 << 20];
+    size_t len = fread(buf, 1, sizeof(buf), stdin);
+    esp_err_t r = trace_decode(buf, len, print_line, NULL);
+    if (r != ESP_OK){
+        fprintf(stderr, "trace2txt: %s\n", esp_err_to_name(r));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <esp_err.h>
+#include <stdint.h>
+
+// Acquisition task: the sampler's FDC polling and record assembly
+// (sampler_poll_job, sampler_job) run on their own high-priority task,
+// woken every SAMPLE_POLL_MS by a timer, instead of in the app_main job
+// loop. Records go to the lock-free record ring; filtering of the stored
+// stream, logging, SD and MQTT stay on the loop and the lower-priority
+// tasks behind it, so a slow write or publish no longer delays a
+// conversion read. The FDC1004 has no data-ready pin, so the timer runs at
+// the conversion rate and the DONE bits tell which results are new.
+//
+// The I2C bus belongs to this task once it runs.
+
+typedef struct {
+    uint32_t wakeups;
+    uint32_t late;              // wakeups a whole period or more behind (periods skipped)
+    uint32_t jitter_max_us;     // wakeup - timer deadline
+    uint64_t jitter_total_us;
+    uint32_t run_max_us;        // time spent per wakeup
+    uint64_t run_total_us;
+    uint32_t records;
+    uint32_t rec_jitter_max_us; // record time - record grid
+} acq_stats_t;
+
+// After sampler_init; the first record is due one sampler_period_ms()
+// from now. The period can change between records.
+esp_err_t acq_start(void);
+
+// One wakeup of the task: poll the FDC, and push a record when one is due.
+void acq_tick(void);
+
+void acq_get_stats(acq_stats_t *out);
+void acq_reset_stats(void);
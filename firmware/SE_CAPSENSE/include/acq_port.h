@@ -0,0 +1,11 @@
+#pragma once
+#include <esp_err.h>
+#include <stdint.h>
+
+// Task and timer behind acq.c: acq_port_esp.c (FreeRTOS task woken by a
+// periodic esp_timer) on the ESP32-C3, host/sim/sim_acq.c (a preempting
+// task on the virtual clock) on the host build. Not for use outside the
+// acquisition task.
+
+// Run tick every period_us on a task above the app_main loop.
+esp_err_t acq_port_start(uint32_t period_us, void (*tick)(void));
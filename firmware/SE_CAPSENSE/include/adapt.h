@@ -0,0 +1,64 @@
+#pragma once
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "record.h"
+
+// Adaptive record period: samples fast while the signal moves and backs
+// off while it is still (sampler_set_adapt).
+//
+// Every record updates, per channel (cap_raw[], temp_cdeg), an average
+// rate of change (units per second) and the variance of the change from
+// one record to the next around its average. A channel is busy when its
+// rate reaches rate[c] or the standard deviation reaches sd[c], and quiet
+// below half of both. One busy channel drops the period to min_ms at once;
+// hold records in a row with every channel quiet double it, up to max_ms.
+// In between, the period stays (hysteresis). Integer only.
+//
+// Between records the sampler watches the FDC conversions: a capacitance
+// that has moved jump codes from the last record makes the next record at
+// once, so an event is caught within a few conversions even at max_ms.
+
+#define ADAPT_CHANNELS 5                  // settings: measurements 1..4 of every FDC1004, temperature
+#define ADAPT_SIGNALS (SAMPLE_CAPS + 1)   // state: each capacitance channel, temperature
+#define ADAPT_IGNORE 0      // rate / sd threshold that leaves a channel out
+
+typedef struct {
+    uint32_t min_ms, max_ms;         // multiples of SAMPLE_POLL_MS
+    uint16_t hold;                   // quiet records before the period doubles
+    uint32_t rate[ADAPT_CHANNELS];   // busy rate of change, units/s
+    uint32_t sd[ADAPT_CHANNELS];     // busy record-to-record deviation, units
+    uint32_t jump;                   // capacitance step that records at once, codes; 0 = off
+} adapt_cfg_t;
+
+typedef struct {
+    uint32_t records;
+    uint32_t speedups;       // drops to min_ms
+    uint32_t slowdowns;      // doublings
+    uint32_t jumps;          // records made early for a capacitance step
+    uint32_t period_ms;      // now
+} adapt_stats_t;
+
+typedef struct {
+    adapt_cfg_t cfg;
+    uint32_t period_ms;
+    uint16_t quiet;
+    bool primed;                     // a record has been seen
+    bool warm;                       // and a change
+    uint64_t t_ms;
+    int32_t prev[ADAPT_SIGNALS];
+    int64_t slope[ADAPT_SIGNALS];    // units/s, 8 fraction bits
+    int64_t mean[ADAPT_SIGNALS];     // change per record, 8 fraction bits
+    int64_t var[ADAPT_SIGNALS];      // 16 fraction bits
+    adapt_stats_t stats;
+} adapt_t;
+
+// The ADAPT_* settings of config.h.
+void adapt_default_cfg(adapt_cfg_t *cfg);
+
+// ESP_ERR_INVALID_ARG for bounds that are not multiples of SAMPLE_POLL_MS
+// or out of order. Starts at period_ms, clamped to the bounds.
+esp_err_t adapt_init(adapt_t *a, const adapt_cfg_t *cfg, uint32_t period_ms);
+
+// Take the record just made; returns the period until the next one.
+uint32_t adapt_update(adapt_t *a, const sample_t *s);
@@ -1,7 +1,18 @@
 #pragma once
 #include <esp_err.h>
+#include <stdint.h>
+#include "i2c_bus.h"
 
 #define BME280_I2C_ADDR 0x76
+#define BME280_I2C_MAX_HZ 3400000  // High-speed mode
 
 esp_err_t bme_init(void);
-esp_err_t bme_read(float *temp_c, float *hum_pct, float *pres_hpa);
\ No newline at end of file
+// Compensated values in the Bosch integer formats: temperature in 0.01 degC,
+// humidity in %RH Q22.10, pressure in Pa Q24.8 (units.h converts them).
+esp_err_t bme_read(int32_t *temp_cdeg, uint32_t *hum_q10, uint32_t *pres_q8);
+
+// The prepared data-register read behind bme_read, for chaining into a
+// larger burst (i2c_txn_prepare_burst); I2C_TXN_NONE before bme_init.
+// After running it, bme_meas_decode compensates what it read.
+i2c_txn_id_t bme_meas_txn(void);
+void bme_meas_decode(int32_t *temp_cdeg, uint32_t *hum_q10, uint32_t *pres_q8);
@@ -4,7 +4,8 @@
 
 #define I2C_SCL_GPIO 3
 #define I2C_SDA_GPIO 4
-#define I2C_FREQ_HZ 400000
+#define I2C_FREQ_HZ 400000      // until devices are declared with i2c_bus_add_device
+#define I2C_FREQ_MAX_HZ 800000  // ESP32-C3 controller limit (Fast-mode Plus)
 
 #define LED_GPIO_1 0
 #define LED_GPIO_2 8
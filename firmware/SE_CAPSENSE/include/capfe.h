@@ -0,0 +1,82 @@
+#pragma once
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "i2c_bus.h"
+
+// Capacitance front-end: the converter chip behind a device's four record
+// channels (record.h), FDC1004 (fdc1004.h) or PCAP04 (pcap04.h). The
+// sampler only talks to one through capfe_t and picks it at boot from the
+// IDs that answer on the bus (capfe_probe).
+//
+// Results are in the FDC1004's scale whatever the chip: FDC_CODES_PER_PF
+// codes per pF above the channel's CAPDAC offset (units_cap_af), so the
+// filters, moisture estimate and record formats do not change with it.
+// With FDC_DEVICES > 1 every device on the mux has the same front-end.
+
+#define CAPFE_MEAS 4   // channels per device in a record
+
+typedef struct {
+    uint64_t t_us;        // time the completed result was read
+    int32_t raw;          // FDC_CODES_PER_PF per pF above the CAPDAC offset
+    uint8_t meas;         // 0..CAPFE_MEAS-1
+    bool saturated;       // at the end of the input range
+} capfe_result_t;
+
+typedef struct {
+    uint32_t polls;       // ready checks
+    uint32_t idle_polls;  // checks that found no completed result
+    uint32_t results;     // results read
+    uint32_t errors;      // failed bus transfers
+    uint32_t offset_changes;   // CAPDAC moved to follow an input
+} capfe_stats_t;
+
+typedef struct {
+    const char *name;
+    uint32_t rate_max_hz;   // result sets per second at most
+    uint16_t range_pf;      // widest input span, offset aside
+    uint32_t conv_us;       // one conversion of one input
+    bool offset;            // CAPDAC offsets (sample_t capdac)
+    bool averaging;         // averages the conversions between results on chip
+} capfe_caps_t;
+
+typedef struct {
+    const capfe_caps_t *caps;
+    // Device the calls below act on (fdc_select); the mux follows on the
+    // next access, or at once with route.
+    esp_err_t (*select)(uint8_t dev);
+    esp_err_t (*route)(void);
+    // Check the chip's ID and reset it: ESP_ERR_NOT_FOUND when something
+    // else (or nothing) answers.
+    esp_err_t (*init)(void);
+    // All CAPFE_MEAS inputs single-ended, about rate_hz result sets per
+    // second (averaged on chip when it could go faster) over range_pf,
+    // started; 0 takes the front-end's config.h default.
+    esp_err_t (*configure)(uint32_t rate_hz, uint16_t range_pf);
+    // Results per second each channel gets as configured.
+    uint32_t (*rate_hz)(void);
+    esp_err_t (*start)(void);
+    esp_err_t (*stop)(void);
+    // Channels (bit m) with a result completed since they were last read,
+    // then read those: the two halves of a poll.
+    esp_err_t (*ready)(uint8_t *mask);
+    esp_err_t (*read_batch)(uint8_t mask, capfe_result_t *out, size_t *n);
+    // The latest result of every channel, done or not, in one transaction;
+    // latest_txn is that transaction for a burst of the caller's, after
+    // which latest_decode returns what it read.
+    esp_err_t (*read_latest)(int32_t raw[CAPFE_MEAS], bool *saturated);
+    i2c_txn_id_t (*latest_txn)(void);
+    void (*latest_decode)(int32_t raw[CAPFE_MEAS], bool *saturated);
+    // CAPDAC offset of channel meas's results, in 3.125 pF steps (0
+    // without one). It may move between results (fdc1004.h auto-ranging).
+    uint8_t (*capdac)(uint8_t meas);
+    void (*get_stats)(capfe_stats_t *out);
+} capfe_t;
+
+extern const capfe_t capfe_fdc1004;
+extern const capfe_t capfe_pcap04;
+
+// Try each front-end on device dev, FDC1004 first: the one whose init
+// succeeds, selected, or NULL.
+const capfe_t *capfe_probe(uint8_t dev);
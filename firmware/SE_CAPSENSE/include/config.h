@@ -2,12 +2,45 @@
 #include <stdint.h>
 
 #define SAMPLE_PERIOD_MS 1000
-#define SAMPLE_AVG_COUNT 4
+#define SAMPLE_POLL_MS 10        // FDC result polling into the filter chain
+#define SAMPLE_DECIM 0           // filter decimation ratio; 0 = FDC conversions per measurement per SAMPLE_PERIOD_MS
+#define SAMPLE_CIC_ORDER 1       // 1 = boxcar average
+#define SAMPLE_MEDIAN_N 3        // spike rejection window (odd), 1 = off
+#define SAMPLE_IIR_SHIFT 0       // IIR on the decimated output, alpha = 2^-shift, 0 = off
+#define SAMPLE_ADAPT 0           // adapt.h: record period follows the signal between ADAPT_MIN_MS and ADAPT_MAX_MS; 0 = SAMPLE_PERIOD_MS
+#define ADAPT_MIN_MS 250         // while a channel moves
+#define ADAPT_MAX_MS 60000       // while all are still
+#define ADAPT_HOLD 10            // still records before the period doubles
+#define ADAPT_CAP_RATE 10486     // capacitance moving: codes/s (20 fF/s)...
+#define ADAPT_CAP_SD 2621        // ...or record-to-record deviation, codes (5 fF)
+#define ADAPT_CAP_JUMP 104858    // capacitance step that makes a record at once, codes (200 fF)
+#define ADAPT_TEMP_RATE 5        // temperature moving: 0.01 degC/s (3 degC/min)...
+#define ADAPT_TEMP_SD 50         // ...or record-to-record deviation, 0.01 degC
 #define SD_FLUSH_PERIOD_MS 5000
+#define SD_FRAME_SECTORS 8       // log frame: 4 KB, 63 records
+#define SD_LOG_SECTORS (64u * 2048u)   // preallocated log file, 64 MB
 #define RECORD_RING_CAP 64
+#define RECORD_DRAIN_PERIOD_MS 200   // record ring -> SD frame buffer / MQTT queue
 #define FDC_RATE_HZ 100
-#define FDC_CAP_RANGE_PF 15.0f
+#ifndef FDC_DEVICES              // the host build also compiles the firmware with 8 (host/CMakeLists.txt)
+#define FDC_DEVICES 1            // FDC1004s (all at 0x50); more than 1 sit one per FDC_MUX_ADDR channel, 0..FDC_DEVICES-1
+#endif
+#define FDC_MUX_ADDR 0x70        // TCA9548A I2C mux in front of them (i2cmux.h)
+#define FDC_CAP_RANGE_PF 15.0f   // FDC1004 input range around the CAPDAC offset; results at its ends count as saturated
+#define FDC_AUTORANGE 1          // CAPDAC follows each input (fdc1004.h); 0: it stays where fdc_configure put it
+#define FDC_AUTORANGE_PF 12      // re-centre an input this far from its offset (lands within 1.6 pF of it)
+#define PCAP_RATE_HZ 50          // PCAP04 (pcap04.h) result sets per second, each the on-chip average of the conversions in between; at most half the SAMPLE_POLL_MS rate, or sets are overwritten unread
+#define PCAP_RANGE_PF 15         // PCAP04 internal reference, pF (1..31); results past 16 pF saturate
 
+#define WMC_MEAS 0               // FDC measurement wired to the moisture electrodes
+#define WMC_SPECIES WMC_SPECIES_GENERIC
+#define WMC_SENSOR_C0_AF 1000000 // electrode stray capacitance; calibrate per board
+#define WMC_SENSOR_CE_AF 350000  // capacitance per unit relative permittivity of the wood
+
+#define TB_SNTP_SERVER "pool.ntp.org"   // wall clock for the records' epoch_us (timebase.h); the broker's host is a good choice
+#define TB_SNTP_INTERVAL_MS 900000   // SNTP poll (15 s at least)
+#define TB_STEP_US 128000        // wall-clock errors beyond this are stepped at once...
+#define TB_SLEW_PPM 500          // ...smaller ones slewed out at this rate (128 ms in ~4 min)
 #define WIFI_SSID "YOUR_SSID"
 #define WIFI_PSK "YOUR_PASS"
 #define MQTT_BROKER_URI "mqtt://raspberrypi.local"
@@ -16,4 +49,28 @@
 #define MQTT_BASE_TOPIC "capboard/esp32c3-01"
 #define MQTT_QOS 1
 #define MQTT_PUB_PERIOD_MS 200
-#define MQTT_QUEUE_DEPTH 128
\ No newline at end of file
+#define MQTT_QUEUE_DEPTH 128   // records waiting to be published or acknowledged (power of two)
+#define MQTT_BATCH_RECORDS 16    // records per message
+#define MQTT_BATCH_MAX_AGE_MS 5000   // publish a partial batch once its oldest record is this old
+#define MQTT_INFLIGHT_MAX 4      // QoS 1 messages awaiting PUBACK
+#define MQTT_ACK_TIMEOUT_MS 10000    // republish a message not acknowledged within this
+#define MQTT_PAYLOAD_FMT 0       // mqtt_fmt_t: 0 JSON on MQTT_BASE_TOPIC "/data", 1 reccodec.h blocks on "/rec", 2 tscodec.h blocks on "/tsc", 3 JSON in units on "/units"
+#define FWD_REPLAY_PER_S 100     // SD backlog records republished per second after an outage
+#define FWD_LIVE_RESERVE 32      // MQTT queue places kept for live records while replaying
+#define FWD_MAX_GAPS 8           // separate outages tracked in the backlog
+#define RBE_ENABLE 0             // rbe.h: publish only records that moved past the deadband below; 0: every record
+#define RBE_HEARTBEAT_MS 900000  // ...or once the last one published is this old
+#define RBE_CAP_ABS 5243         // capacitance deadband, codes (10 fF)
+#define RBE_TEMP_ABS 20          // 0.01 degC
+#define RBE_HUM_ABS 1024         // %RH Q10 (1 %RH)
+#define RBE_PRES_ABS 12800       // Pa Q8 (50 Pa)
+#define RBE_MC_ABS 10            // 0.01 % moisture content
+#define RBE_REL_PERMILLE 0       // ...or this fraction of the last published value, if larger
+#define SCH_REPORT_PERIOD_MS 60000   // scheduler stats to the log
+#define TRACE_RING_LEN 128       // deferred log events (power of two)
+#define TRACE_FMT_MAX 64         // distinct TRACE_x call sites
+#define TRACE_LEVEL 3            // esp_log_level_t: TRACE_x above this is not recorded (3 = INFO)
+#define TRACE_FLUSH_PERIOD_MS 100    // deferred log events to the UART
+#define PROF_ENABLE 1            // prof.h cycle probes on the hot paths; 0 compiles them out
+#define STATS_PUB_PERIOD_MS 60000    // stats.h snapshot to MQTT_BASE_TOPIC "/stats"
+#define I2C_CAPTURE_BYTES 0      // i2ctrace.h capture from boot into RAM (~2.3 KB/s), for the CLI 'i2c trace'; 0: none
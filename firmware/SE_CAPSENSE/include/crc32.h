@@ -0,0 +1,7 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-32 (IEEE 802.3, reflected, as zlib). Chain calls by passing the
+// previous result as crc; start from 0.
+uint32_t crc32_update(uint32_t crc, const void *data, size_t len);
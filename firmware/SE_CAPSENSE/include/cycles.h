@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+
+// Free-running CPU cycle counter for cost measurements. Wraps; subtract two
+// readings as uint32_t. On x86 hosts this is the TSC (reference cycles).
+#if defined(ESP_PLATFORM)
+#include "esp_cpu.h"
+static inline uint32_t cyc_now(void){ return (uint32_t)esp_cpu_get_cycle_count(); }
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint32_t cyc_now(void){ return (uint32_t)__rdtsc(); }
+#elif defined(__riscv)
+static inline uint32_t cyc_now(void){ uint32_t c; __asm__ volatile("rdcycle %0" : "=r"(c)); return c; }
+#else
+#include <time.h>
+static inline uint32_t cyc_now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);  // ns, not cycles
+}
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+#include <esp_err.h>
+#include <stddef.h>
+#include "record.h"
+
+// Record ring consumer shared by the SD log and the MQTT publisher.
+//
+// Every record is offered to each sink in turn and released from the ring
+// once all of them have taken it. A sink that takes fewer than it was
+// offered keeps the rest in the ring (backpressure up to the sampler)
+// while the others carry on; nobody is offered the same record twice.
+
+#define DRAIN_MAX_SINKS 4
+
+// Takes up to n records, copying them out; returns how many it took.
+typedef size_t (*drain_sink_t)(const sample_t *s, size_t n);
+
+// Adding a sink that is already registered does nothing.
+esp_err_t drain_add_sink(drain_sink_t sink);
+
+// Scheduler job: offer the pending records to every sink.
+void drain_job(void);
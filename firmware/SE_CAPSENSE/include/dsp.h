@@ -0,0 +1,40 @@
+#pragma once
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Per-channel fixed-point filter chain between acquisition and the record:
+//   median-of-N spike rejection -> CIC decimator (order 1 = boxcar) -> IIR
+// Input and output are raw integer codes; all state is integer.
+
+#define DSP_MEDIAN_MAX 7
+#define DSP_CIC_ORDER_MAX 3
+#define DSP_DECIM_MAX 1024   // R^order must fit 63 bits with 24-bit inputs
+
+typedef struct {
+    uint8_t median;      // window length, odd; 0 or 1 = off
+    uint16_t decim;      // CIC decimation ratio R; 1 = no decimation
+    uint8_t cic_order;   // 1 (boxcar) .. DSP_CIC_ORDER_MAX
+    uint8_t iir_shift;   // single-pole IIR on the decimated output, alpha = 2^-shift; 0 = off
+} dsp_cfg_t;
+
+typedef struct {
+    dsp_cfg_t cfg;
+    int32_t win[DSP_MEDIAN_MAX];
+    uint8_t win_n, win_pos;
+    uint64_t integ[DSP_CIC_ORDER_MAX];   // modular: wraps by design
+    uint64_t comb[DSP_CIC_ORDER_MAX];
+    int64_t gain;                        // R^order
+    uint16_t phase;
+    uint8_t fill;                        // CIC outputs still to discard while combs fill
+    int64_t iir;                         // Q(DSP_IIR_FRAC) state
+    bool iir_primed;
+} dsp_chan_t;
+
+// Validate cfg and reset the channel.
+esp_err_t dsp_init(dsp_chan_t *c, const dsp_cfg_t *cfg);
+void dsp_reset(dsp_chan_t *c);
+
+// Feed one input. Returns true with the filtered value in *out once every
+// `decim` inputs, once the CIC has filled (order - 1 outputs are discarded).
+bool dsp_push(dsp_chan_t *c, int32_t x, int32_t *out);
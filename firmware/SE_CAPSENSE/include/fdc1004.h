@@ -1,9 +1,109 @@
 #pragma once
 #include <esp_err.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "capfe.h"
+#include "i2c_bus.h"
 
 #define FDC1004_I2C_ADDR 0x50
+#define FDC1004_I2C_MAX_HZ 400000  // Fast-mode only
+#define FDC_NUM_MEAS 4
+#define FDC_CAPDAC_MAX 31
+#define FDC_CODES_PER_PF 524288     // 2^19 codes per pF (24-bit result); CAPDAC steps are 3.125 pF
+
+// Measurement inputs (CONF_MEASx CHA/CHB encoding)
+typedef enum {
+    FDC_CIN1 = 0,
+    FDC_CIN2 = 1,
+    FDC_CIN3 = 2,
+    FDC_CIN4 = 3,
+    FDC_IN_CAPDAC = 4,    // CHB only: single-ended against the CAPDAC offset
+    FDC_IN_DISABLED = 7,  // CHB only: single-ended, no offset
+} fdc_input_t;
+
+// FDC_CONF RATE field
+typedef enum {
+    FDC_RATE_100SPS = 1,
+    FDC_RATE_200SPS = 2,
+    FDC_RATE_400SPS = 3,
+} fdc_rate_t;
+
+typedef struct {
+    bool enabled;
+    fdc_input_t cha;      // CIN1..CIN4
+    fdc_input_t chb;      // CINx (differential), FDC_IN_CAPDAC or FDC_IN_DISABLED
+    uint8_t capdac;       // 0..FDC_CAPDAC_MAX, used when chb == FDC_IN_CAPDAC
+} fdc_meas_cfg_t;
+
+typedef struct {
+    fdc_meas_cfg_t meas[FDC_NUM_MEAS];
+    fdc_rate_t rate;
+    bool repeat;          // continuous conversions; false = one pass per fdc_start()
+    bool autorange;       // CAPDAC follows the measurements with CHB = FDC_IN_CAPDAC
+} fdc_config_t;
+
+// Auto-ranging: a result FDC_AUTORANGE_PF or more from its measurement's
+// offset moves the CAPDAC to the step nearest the input (CONF_MEASx write),
+// so it only moves again once the input has travelled most of that
+// distance. A saturated result moves it by the range, as far as it goes.
+// Results converted while the new offset may not yet have applied (two
+// sequence periods) are replaced by the last good one, so every result and
+// fdc_capdac agree and the results keep their rate.
+//
+// A result is saturated at FDC_CAP_RANGE_PF or more from the offset.
+
+// raw: the 24-bit two's complement result, sign-extended; meas 0..3 (MEAS1..4).
+// polls counts FDC_CONF reads, offset_changes auto-ranging CAPDAC moves.
+typedef capfe_result_t fdc_result_t;
+typedef capfe_stats_t fdc_stats_t;
+
+// With FDC_DEVICES > 1 there is one FDC1004 per i2cmux.h channel, device d
+// on channel d. The calls below act on the device fdc_select picked (0 at
+// boot), each with its own configuration, results and stats; selecting
+// costs nothing on the bus, and the mux is switched on the device's next
+// access. With one device there is no mux.
+esp_err_t fdc_select(uint8_t dev);
+uint8_t fdc_selected(void);
+// Switch the mux to the selected device (nothing with one device), for a
+// caller running fdc_results_txn in a burst of its own.
+esp_err_t fdc_route(void);
 
 esp_err_t fdc_init(void);
+// Four single-ended measurements, CINx against CAPDAC 0, at FDC_RATE_HZ in
+// repeat mode, auto-ranging with FDC_AUTORANGE, started.
 esp_err_t fdc_config_default(void);
-esp_err_t fdc_read_pf(float out_pf[4], bool *saturated);
\ No newline at end of file
+// Write CONF_MEAS1..4 and FDC_CONF. Starts conversions when any measurement
+// is enabled.
+esp_err_t fdc_configure(const fdc_config_t *cfg);
+const fdc_config_t *fdc_get_config(void);
+esp_err_t fdc_start(void);
+esp_err_t fdc_stop(void);
+
+// Check the DONE bits and read only the measurements that completed since
+// the last poll, each with its own timestamp. *n is the number written to out
+// (at most FDC_NUM_MEAS when max allows).
+esp_err_t fdc_poll(fdc_result_t *out, size_t max, size_t *n);
+// fdc_poll in two halves: the DONE bits (bit m = MEASm+1), then those
+// measurements' results.
+esp_err_t fdc_ready(uint8_t *mask);
+esp_err_t fdc_read_done(uint8_t mask, fdc_result_t *out, size_t *n);
+
+// CAPDAC offset of measurement `meas`'s latest result (0 unless CHB is
+// CAPDAC); it follows a change once the results do.
+uint8_t fdc_capdac(uint8_t meas);
+// Result code of measurement `meas` in attofarads, CAPDAC offset included.
+int32_t fdc_raw_to_af(int32_t raw, uint8_t meas);
+
+// Read all four result registers in one bus transaction and report the
+// latest result code of each measurement (the one before, for a measurement
+// whose offset is changing). *saturated: any of them is.
+esp_err_t fdc_read_raw(int32_t out_raw[4], bool *saturated);
+
+// The prepared result read behind fdc_read_raw, for chaining into a larger
+// burst (i2c_txn_prepare_burst); I2C_TXN_NONE before fdc_init. After running
+// it, fdc_results_raw returns what it read.
+i2c_txn_id_t fdc_results_txn(void);
+void fdc_results_raw(int32_t out_raw[4], bool *saturated);
+
+void fdc_get_stats(fdc_stats_t *out);
@@ -0,0 +1,52 @@
+#pragma once
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "rbe.h"
+#include "record.h"
+
+// Store-and-forward between the record ring and the MQTT publisher.
+//
+// fwd_append is the publisher's sink on the record ring (drain.h). Records
+// the publisher cannot queue (broker or Wi-Fi down, or the link slower than
+// the sampler) are not held in the ring: they are already in the SD log,
+// so only their record numbers (sdlog_next_record) are kept, as up to
+// FWD_MAX_GAPS ranges. Once the link is back, fwd_job_replay reads them
+// back from the log and queues them behind live records, at most
+// FWD_REPLAY_PER_S per second and never into the last FWD_LIVE_RESERVE
+// places of the publisher's queue. Replayed records arrive out of time
+// order; t_ms orders them.
+//
+// With report by exception (rbe.h: RBE_ENABLE, fwd_set_rbe) only the
+// records that pass the deadband are queued; the others are taken all the
+// same and stay in the SD log only. Live records and the replayed backlog
+// each keep their own reference.
+//
+// Without an SD log nothing can be spilled and the publisher holds records
+// back in the ring as before.
+
+typedef struct {
+    uint32_t live;          // records queued for publishing as they came
+    uint32_t spilled;       // records left in the SD log for later
+    uint32_t replayed;      // spilled records queued since
+    uint32_t lost;          // spilled records the log no longer holds (wrapped over, damaged frame)
+    uint32_t resent;        // records replayed twice because FWD_MAX_GAPS ranges were in use
+    uint32_t backlog;       // spilled records waiting now
+    uint32_t backlog_max;
+} fwd_stats_t;
+
+// Call with the record ring empty, after sdlog_init and mqtt_svc_init.
+esp_err_t fwd_init(void);
+
+size_t fwd_append(const sample_t *s, size_t n);
+
+// Scheduler job, ahead of mqtt_svc_job_drain.
+void fwd_job_replay(void);
+
+// Deadband for the records queued from now on; NULL publishes every one.
+void fwd_set_rbe(const rbe_cfg_t *cfg);
+// Deadband counts, live and replayed records together.
+void fwd_get_rbe_stats(rbe_stats_t *out);
+
+void fwd_get_stats(fwd_stats_t *out);
+void fwd_reset_stats(void);
@@ -1,8 +1,64 @@
 #pragma once
 #include <esp_err.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 esp_err_t i2c_bus_init(void);
 esp_err_t i2c_rd(uint8_t addr, uint8_t reg, uint8_t *buf, size_t len);
-esp_err_t i2c_wr(uint8_t addr, uint8_t reg, const uint8_t *buf, size_t len);
\ No newline at end of file
+esp_err_t i2c_wr(uint8_t addr, uint8_t reg, const uint8_t *buf, size_t len);
+// The register byte alone, no data: a command for devices driven by opcodes.
+esp_err_t i2c_cmd(uint8_t addr, uint8_t cmd);
+// Address-only write; true if a device ACKs.
+bool i2c_bus_probe(uint8_t addr);
+
+// Declare a device and its maximum SCL rate. The bus runs at the fastest
+// rate every declared device allows, capped by I2C_FREQ_MAX_HZ.
+esp_err_t i2c_bus_add_device(uint8_t addr, uint32_t max_hz);
+uint32_t i2c_bus_speed_hz(void);
+
+// Pre-built transactions: built once from a static pool (no heap, no
+// command-link construction per access) and run any number of times.
+// Buffers are referenced, not copied, and must outlive the transaction.
+typedef int8_t i2c_txn_id_t;
+#define I2C_TXN_NONE ((i2c_txn_id_t)-1)
+#define I2C_TXN_POOL_SIZE 32
+#define I2C_BURST_MAX 10
+
+i2c_txn_id_t i2c_txn_prepare_read(uint8_t addr, uint8_t reg, uint8_t *buf, size_t len);
+i2c_txn_id_t i2c_txn_prepare_write(uint8_t addr, uint8_t reg, const uint8_t *buf, size_t len);
+// Chain prepared transactions into one bus transaction: repeated STARTs
+// between the parts, a single STOP at the end. Members stay usable alone.
+i2c_txn_id_t i2c_txn_prepare_burst(const i2c_txn_id_t *ids, size_t n);
+esp_err_t i2c_txn_run(i2c_txn_id_t id);
+
+// Queue a prepared transaction on the bus task; cb runs there with the
+// result once the transfer is done. One outstanding submit per transaction.
+typedef void (*i2c_done_cb)(i2c_txn_id_t id, esp_err_t result, void *arg);
+esp_err_t i2c_txn_submit(i2c_txn_id_t id, i2c_done_cb cb, void *arg);
+
+// Called for every segment once its transaction is done, with the
+// transaction's start time and result and the bus lock held (i2ctrace.h
+// capture). buf holds the data written or read. NULL: none.
+typedef void (*i2c_tap_fn)(uint64_t t_us, uint8_t addr, uint8_t reg, bool read, const uint8_t *buf, size_t len,
+                           esp_err_t result);
+void i2c_bus_set_tap(i2c_tap_fn fn);
+
+// Per-device transfer statistics. Bursts are accounted under address 0x00.
+#define I2C_STATS_MAX_DEVS 8
+#define I2C_HIST_BUCKETS 16   // bucket b: latency in [2^(b-1), 2^b) us, bucket 0: < 1 us
+
+typedef struct {
+    uint8_t addr;
+    uint32_t xfers;
+    uint32_t nacks;           // ESP_FAIL: no ACK from the device
+    uint32_t timeouts;        // ESP_ERR_TIMEOUT: bus stuck or held low
+    uint32_t other_errors;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t hist[I2C_HIST_BUCKETS];
+} i2c_dev_stats_t;
+
+// Copies up to max per-device entries; returns how many devices have stats.
+size_t i2c_bus_get_stats(i2c_dev_stats_t *out, size_t max);
+void i2c_bus_reset_stats(void);
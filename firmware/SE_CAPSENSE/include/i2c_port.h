@@ -0,0 +1,38 @@
+#pragma once
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "i2c_bus.h"
+
+// Controller back-end behind i2c_bus.c: i2c_port_esp.c on the ESP32-C3,
+// host/sim/sim_i2c.c on the host build. Not for use outside the bus layer.
+
+typedef struct {
+    uint8_t addr;
+    uint8_t reg;
+    bool read;
+    uint16_t len;
+    uint8_t *buf;
+} i2c_seg_t;
+
+typedef struct {
+    i2c_seg_t seg[I2C_BURST_MAX];
+    uint8_t nseg;
+    uint8_t stats_slot;
+    i2c_done_cb cb;
+    void *cb_arg;
+} i2c_txn_t;
+
+esp_err_t i2c_port_init(uint32_t hz);
+esp_err_t i2c_port_set_speed(uint32_t hz);
+// Build transaction `id` once for repeated execution.
+esp_err_t i2c_port_build(i2c_txn_id_t id, const i2c_txn_t *t);
+esp_err_t i2c_port_exec(i2c_txn_id_t id, const i2c_txn_t *t, uint32_t timeout_ms);
+// One-off transfer of a single segment. A len 0 write is an address probe
+// with buf NULL, the register byte alone (i2c_cmd) otherwise.
+esp_err_t i2c_port_xfer(const i2c_seg_t *seg, uint32_t timeout_ms);
+
+// Serialise bus users (tasks), and run fn(arg) on the bus task.
+void i2c_port_lock(void);
+void i2c_port_unlock(void);
+esp_err_t i2c_port_defer(void (*fn)(void *), void *arg);
@@ -0,0 +1,34 @@
+#pragma once
+#include <esp_err.h>
+#include <stdint.h>
+#include "i2c_bus.h"
+
+// TCA9548A-style I2C mux at FDC_MUX_ADDR: eight downstream buses, any set of
+// them switched onto the main one by writing its control register. Devices
+// on the main bus (the BME280) stay reachable whatever is selected.
+//
+// i2cmux_select switches to one channel and remembers it, so a run of
+// accesses to the same downstream device costs one control write; after a
+// failed write the next select writes again. Selects go through prepared
+// transactions (i2c_bus.h), one per channel.
+
+#define I2CMUX_CHANNELS 8
+#define I2CMUX_NONE 0xFF          // all channels off
+#define I2CMUX_I2C_MAX_HZ 400000
+
+// Probe the mux and switch every channel off. ESP_ERR_NOT_FOUND if nothing
+// answers at FDC_MUX_ADDR.
+esp_err_t i2cmux_init(void);
+
+// Connect channel ch (0..I2CMUX_CHANNELS-1) alone, or none.
+esp_err_t i2cmux_select(uint8_t ch);
+// The channel last selected, I2CMUX_NONE when unknown or none.
+uint8_t i2cmux_channel(void);
+
+typedef struct {
+    uint32_t selects;    // calls
+    uint32_t writes;     // control writes they needed
+    uint32_t errors;
+} i2cmux_stats_t;
+
+void i2cmux_get_stats(i2cmux_stats_t *out);
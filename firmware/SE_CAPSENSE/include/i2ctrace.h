@@ -0,0 +1,102 @@
+#pragma once
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Capture of every I2C transfer (addr, reg, bytes, time) into a compact
+// trace, and its codec, shared by the firmware and the host replay
+// (host/sim/sim_replay.h, host/tools/i2creplay). No allocation, plain C99.
+//
+// A trace is one or more blocks:
+//   header  'I', I2CT_VERSION, record count (u16 LE), t0_us (u64 LE)
+//   record  varint  dt_us since the previous record (the first: since t0_us)
+//           u8      addr << 1 | read
+//           u8      reg
+//           u8      status (i2ct_status_t)
+//           varint  len
+//           len bytes: the data written, or read when the status is OK
+//
+// A transaction of several segments (a burst) is one record per segment,
+// each with the transaction's start time and result. Address probes are
+// writes of length 0. An FDC1004 poll with its results takes ~70 bytes.
+
+#define I2CT_MAGIC 'I'
+#define I2CT_VERSION 1
+#define I2CT_HEADER_BYTES 12
+#define I2CT_RECORD_MAX(len) (10u + 3u + 3u + (len))
+
+typedef enum {
+    I2CT_OK,
+    I2CT_NACK,       // ESP_FAIL
+    I2CT_TIMEOUT,    // ESP_ERR_TIMEOUT
+    I2CT_ERROR,      // anything else
+} i2ct_status_t;
+
+typedef struct {
+    uint64_t t_us;
+    uint8_t addr;
+    uint8_t reg;
+    bool read;
+    uint8_t status;          // i2ct_status_t
+    uint16_t len;
+    const uint8_t *data;     // len bytes; NULL for a read that failed
+} i2ct_rec_t;
+
+typedef struct {
+    uint8_t *buf;
+    size_t cap, len;
+    uint16_t count;
+    uint64_t prev_us;
+} i2ct_enc_t;
+
+typedef struct {
+    const uint8_t *start, *p, *end;
+    uint16_t count, left;
+    uint64_t t_us;
+} i2ct_dec_t;
+
+static inline uint8_t i2ct_status_of(esp_err_t r){
+    return r == ESP_OK ? I2CT_OK : r == ESP_FAIL ? I2CT_NACK : r == ESP_ERR_TIMEOUT ? I2CT_TIMEOUT : I2CT_ERROR;
+}
+
+static inline esp_err_t i2ct_err_of(uint8_t status){
+    static const esp_err_t e[] = { ESP_OK, ESP_FAIL, ESP_ERR_TIMEOUT, ESP_ERR_INVALID_RESPONSE };
+    return status < 4 ? e[status] : ESP_ERR_INVALID_RESPONSE;
+}
+
+// Start a block in buf (at least I2CT_HEADER_BYTES) at t0_us.
+esp_err_t i2ct_enc_init(i2ct_enc_t *e, void *buf, size_t cap, uint64_t t0_us);
+// Append r; false, with the block unchanged, when it does not fit, the
+// block holds UINT16_MAX records or r is older than the last record.
+bool i2ct_enc_add(i2ct_enc_t *e, const i2ct_rec_t *r);
+
+// ESP_ERR_INVALID_VERSION for another version, ESP_ERR_INVALID_ARG if it
+// is not a block, ESP_ERR_INVALID_SIZE if the header is cut short.
+esp_err_t i2ct_dec_init(i2ct_dec_t *d, const void *buf, size_t len);
+// out->data points into the block. ESP_ERR_NOT_FOUND after the last
+// record, ESP_ERR_INVALID_SIZE if the block is cut short.
+esp_err_t i2ct_dec_next(i2ct_dec_t *d, i2ct_rec_t *out);
+// Bytes of the block read so far; after the last record, where the next
+// block of the trace starts.
+static inline size_t i2ct_dec_used(const i2ct_dec_t *d){ return (size_t)(d->p - d->start); }
+
+// Called with each full block during a capture; the block is reused when
+// it returns.
+typedef void (*i2ct_sink_fn)(const void *block, size_t len);
+
+typedef struct {
+    uint32_t records;    // segments captured
+    uint32_t blocks;     // blocks handed to the sink
+    uint32_t dropped;    // segments lost to a full block with no sink
+} i2ct_stats_t;
+
+// Record every transfer on the bus into buf (any size from a few hundred
+// bytes). With a sink, full blocks go to it and the capture goes on;
+// without one it keeps the first cap bytes and counts the rest as dropped.
+esp_err_t i2ct_capture_start(void *buf, size_t cap, i2ct_sink_fn sink);
+// Stop; *block (if not NULL) is set to the open block, whose length is
+// returned.
+size_t i2ct_capture_stop(const void **block);
+bool i2ct_capturing(void);
+void i2ct_get_stats(i2ct_stats_t *out);
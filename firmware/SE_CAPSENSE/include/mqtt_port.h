@@ -0,0 +1,23 @@
+#pragma once
+#include <esp_err.h>
+#include <stddef.h>
+
+// Broker connection behind mqtt_svc.c: mqtt_port_esp.c (esp-mqtt) on the
+// ESP32-C3, host/sim/sim_mqtt.c (in-process fake broker) on the host build.
+// Not for use outside the MQTT service.
+
+typedef enum {
+    MQTT_PORT_CONNECTED,
+    MQTT_PORT_DISCONNECTED,
+    MQTT_PORT_PUBACK,         // QoS 1 message msg_id acknowledged
+} mqtt_port_event_t;
+
+// Runs on the client's task on the target; must not block.
+typedef void (*mqtt_port_cb_t)(mqtt_port_event_t ev, int msg_id);
+
+// Connect in the background and keep reconnecting; events go to cb.
+esp_err_t mqtt_port_start(const char *uri, const char *client_id, mqtt_port_cb_t cb);
+
+// Queue a message for sending without waiting for the network. Returns the
+// message id (> 0 for QoS 1, 0 for QoS 0) or -1.
+int mqtt_port_publish(const char *topic, const void *data, size_t len, int qos);
@@ -1,9 +1,91 @@
 #pragma once
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <esp_err.h>
 #include "record.h"
 
+// Batched record publisher (back-end: mqtt_port.h).
+//
+// Records are queued (MQTT_QUEUE_DEPTH) and published on
+// MQTT_BASE_TOPIC "/data", MQTT_BATCH_RECORDS to a message, or fewer once
+// the oldest has waited MQTT_BATCH_MAX_AGE_MS. At most MQTT_INFLIGHT_MAX
+// messages await their PUBACK; one not acknowledged within
+// MQTT_ACK_TIMEOUT_MS, or still open when the connection comes back, is
+// published again with the same seq. Records leave the queue only when
+// acknowledged, and a full queue refuses new ones, so they stay in the
+// record ring instead of being lost.
+//
+// Payload (integer fields, units as in sample_t):
+//   {"dev":"<MQTT_CLIENT_ID>","seq":<n>,"recs":[{"t":<t_ms>,"u":<t_us>,"e":<epoch_us>,"cap":[SAMPLE_CAPS codes],
+//    "dac":[SAMPLE_CAPS CAPDAC steps],"tc":<0.01 degC>,"rh":<%RH Q10>,"pa":<Pa Q8>,
+//    "mc":<0.01 %>,"f":<flags>},...]}
+// seq counts messages since boot; a subscriber drops repeats of a seq.
+// A subscriber with a synchronised clock gets each record's delivery
+// latency as its receive time minus "e" (host/tools/mqttlat).
+//
+// With MQTT_FMT_BIN the topic is MQTT_BASE_TOPIC "/rec" and the payload is
+// seq (u32 LE) followed by one reccodec.h block of the message's records,
+// ~15 bytes a record against ~130 for JSON. MQTT_FMT_TSC is the same on
+// "/tsc" with a tscodec.h block, ~9 bytes a record.
+//
+// MQTT_FMT_UNITS is the JSON envelope on "/units" with the records in
+// pF, degC, %RH, hPa and % (rectext.h RT_JSON), for dashboards that plot
+// the payload as it comes. Both JSON formats are written by rectext.c,
+// without printf.
+
+typedef enum {
+    MQTT_FMT_JSON,
+    MQTT_FMT_BIN,
+    MQTT_FMT_TSC,
+    MQTT_FMT_UNITS,
+} mqtt_fmt_t;
+
+typedef struct {
+    uint32_t accepted;       // records taken into the queue
+    uint32_t stalls;         // appends cut short by a full queue
+    uint32_t msgs;           // messages published (first transmissions)
+    uint32_t records_sent;   // records in those messages
+    uint32_t retransmits;
+    uint32_t acks;
+    uint32_t publish_errors; // messages the client refused to queue
+    uint64_t bytes;          // payload bytes, retransmits included
+    uint16_t batch_max;      // largest message, records
+    uint8_t inflight;        // messages awaiting PUBACK now
+    uint8_t inflight_max;
+    uint32_t lat_min_us;     // first publish to PUBACK
+    uint32_t lat_max_us;
+    uint64_t lat_total_us;   // over `acks`
+    uint32_t age_records;    // acknowledged records with a t_us
+    uint32_t age_max_us;     // their conversion (t_us) to PUBACK
+    uint64_t age_total_us;
+} mqtt_stats_t;
+
 esp_err_t mqtt_svc_init(void);
 bool mqtt_svc_is_connected(void);
+
+// Queue records for publishing. Returns how many were taken; fewer than n
+// means the queue is full of unacknowledged records.
+size_t mqtt_svc_append(const sample_t *s, size_t n);
 bool mqtt_svc_enqueue(const sample_t *s);
-void mqtt_svc_job_drain(void);
\ No newline at end of file
+// Records mqtt_svc_append would take now (0 before mqtt_svc_init).
+size_t mqtt_svc_room(void);
+
+// Scheduler job: collect acknowledgements, republish overdue messages and
+// publish new batches while the window has room.
+void mqtt_svc_job_drain(void);
+
+// Records per message, 1..MQTT_BATCH_RECORDS.
+void mqtt_svc_set_batch(uint16_t records);
+
+// Payload format (default MQTT_PAYLOAD_FMT); applies from the next
+// transmission, retransmits included.
+void mqtt_svc_set_format(mqtt_fmt_t fmt);
+
+// Publish one message on MQTT_BASE_TOPIC "/<subtopic>" at QoS 0, outside
+// the record queue (telemetry). ESP_ERR_INVALID_STATE while disconnected,
+// ESP_FAIL if the client refuses it.
+esp_err_t mqtt_svc_publish(const char *subtopic, const void *payload, size_t len);
+
+void mqtt_svc_get_stats(mqtt_stats_t *out);
+void mqtt_svc_reset_stats(void);
@@ -0,0 +1,51 @@
+#pragma once
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "capfe.h"
+#include "i2c_bus.h"
+
+// ScioSense PCAP04 capacitance-to-digital converter, the second capfe.h
+// front-end: ports PC0..PC3, grounded, measured against the internal
+// reference and read as record channels 0..3. Every sequence converts all
+// four ports C_AVRG times and averages on chip; the sequence timer sets the
+// result rate, and the averaging count is as many conversions as fit in it.
+//
+// Results are C/Cref ratios (Q5.27), scaled here to FDC_CODES_PER_PF codes
+// per pF; there is no CAPDAC (capdac 0). With FDC_DEVICES > 1 there is one
+// per i2cmux.h channel, as for the FDC1004.
+
+#define PCAP04_I2C_ADDR 0x28
+#define PCAP04_I2C_MAX_HZ 1000000   // Fast-mode Plus
+#define PCAP_NUM_MEAS 4
+#define PCAP_OLF_US 20              // sequence timer tick (50 kHz low-frequency oscillator)
+#define PCAP_CONV_US 5              // one port's charge/discharge cycle, discharge time included
+#define PCAP_AVRG_MAX 8191
+#define PCAP_CREF_MAX_PF 31
+
+esp_err_t pcap_select(uint8_t dev);
+esp_err_t pcap_route(void);
+
+// Check the test byte, power-on reset. ESP_ERR_NOT_FOUND if something else answers.
+esp_err_t pcap_init(void);
+// rate_hz result sets per second (0: PCAP_RATE_HZ) with the reference at
+// range_pf (0: PCAP_RANGE_PF), written and started.
+esp_err_t pcap_configure(uint32_t rate_hz, uint16_t range_pf);
+uint32_t pcap_rate_hz(void);
+// Conversions averaged into each result.
+uint16_t pcap_averaging(void);
+esp_err_t pcap_start(void);
+esp_err_t pcap_stop(void);
+
+// All four ports when a sequence has ended since the last check (STATUS_0),
+// then their results.
+esp_err_t pcap_ready(uint8_t *mask);
+esp_err_t pcap_read_done(uint8_t mask, capfe_result_t *out, size_t *n);
+
+// RES0..RES3 in one read: the latest result of every port, ended or not.
+esp_err_t pcap_read_raw(int32_t out_raw[4], bool *saturated);
+i2c_txn_id_t pcap_results_txn(void);
+void pcap_results_raw(int32_t out_raw[4], bool *saturated);
+
+void pcap_get_stats(capfe_stats_t *out);
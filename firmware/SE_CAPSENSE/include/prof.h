@@ -0,0 +1,53 @@
+#pragma once
+#include <stdint.h>
+#include "config.h"
+#include "cycles.h"
+
+// Cycle-count probes on the hot paths.
+//
+// PROF_START/PROF_STOP bracket a section and add its cost in CPU cycles
+// (cycles.h) to the probe's count, total, max and a log2 histogram:
+//
+//     PROF_START(PROF_BME_READ);
+//     ...
+//     PROF_STOP(PROF_BME_READ);
+//
+// With PROF_ENABLE 0 both expand to nothing. Each probe is written by one
+// task at a time (the I2C probe under the bus lock); a reader on another
+// task may see a probe mid-update, which the stats can live with.
+
+#define PROF_BUCKETS 24   // bucket b: [2^(b-1), 2^b) cycles, bucket 0: 0, the last one open-ended
+
+typedef enum {
+    PROF_SAMPLER_JOB,     // sampler_job: one record
+    PROF_SAMPLER_POLL,    // sampler_poll_job: FDC results into the filters
+    PROF_I2C_XFER,        // one I2C transfer or prepared transaction, bus time included
+    PROF_BME_READ,        // bme_read
+    PROF_SCH_LOOP,        // sch_run_due less the jobs it ran
+    PROF_COUNT
+} prof_id_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t max;
+    uint64_t total;
+    uint32_t hist[PROF_BUCKETS];
+} prof_probe_t;
+
+#if PROF_ENABLE
+#define PROF_START(id) uint32_t prof_t0_##id = cyc_now()
+#define PROF_STOP(id) prof_record((id), cyc_now() - prof_t0_##id)
+#else
+#define PROF_START(id) do {} while (0)
+#define PROF_STOP(id) do {} while (0)
+#endif
+
+void prof_record(prof_id_t id, uint32_t cycles);
+
+const char *prof_name(prof_id_t id);
+void prof_get(prof_id_t id, prof_probe_t *out);
+void prof_reset(void);
+
+// Upper bound of the bucket holding the pct-th percentile (0..100), capped
+// at max; 0 for an empty probe.
+uint32_t prof_percentile(const prof_probe_t *p, unsigned pct);
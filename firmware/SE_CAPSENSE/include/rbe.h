@@ -0,0 +1,61 @@
+#pragma once
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "record.h"
+
+// Report by exception: a deadband on the records going to MQTT.
+//
+// A record is published when a channel has moved past its deadband since
+// the last record published, when its flags or CAPDAC offsets differ from
+// that record's, or when that record is RBE_HEARTBEAT_MS old; the others
+// are suppressed (they are still in the SD log). A channel's deadband is
+// abs (channel units) or rel_permille of the last published value,
+// whichever is larger; RBE_IGNORE leaves the channel out.
+//
+// Channels, in map order as in reccodec.h: cap_raw[0..3], temp_cdeg,
+// hum_q10, pres_q8, mc_cpct. With more FDC1004s, cap_raw[4..] take the
+// settings and reason bit of the same measurement on the first.
+
+#define RBE_CHANNELS 8
+#define RBE_IGNORE INT32_MAX
+
+// Why a record was published: bit c for channel c, then these.
+enum {
+    RBE_FIRST = RBE_CHANNELS,
+    RBE_HEARTBEAT,
+    RBE_FLAGS,          // flags or CAPDAC changed
+    RBE_WHY_BITS,
+};
+
+typedef struct {
+    int32_t abs[RBE_CHANNELS];
+    uint16_t rel_permille[RBE_CHANNELS];
+    uint32_t heartbeat_ms;           // 0: no heartbeat
+} rbe_cfg_t;
+
+typedef struct {
+    uint32_t offered;
+    uint32_t published;
+    uint32_t why[RBE_WHY_BITS];      // published records per reason (a record can have several)
+} rbe_stats_t;
+
+typedef struct {
+    rbe_cfg_t cfg;
+    bool primed;
+    sample_t last;                   // last published
+    rbe_stats_t stats;
+} rbe_t;
+
+// The RBE_* settings of config.h.
+void rbe_default_cfg(rbe_cfg_t *cfg);
+
+void rbe_init(rbe_t *r, const rbe_cfg_t *cfg);
+
+// Why s has to be published (1 << channel, RBE_FIRST, ...), 0 if it can be
+// suppressed. Changes nothing.
+uint16_t rbe_test(const rbe_t *r, const sample_t *s);
+
+// Count s, with the rbe_test result: published when why is not 0, and then
+// the reference for the next records.
+void rbe_note(rbe_t *r, const sample_t *s, uint16_t why);
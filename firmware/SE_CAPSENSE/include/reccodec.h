@@ -0,0 +1,88 @@
+#pragma once
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "record.h"
+
+// Packed, versioned encoding of sample_t for transport and storage, shared
+// by the firmware and host tools (no allocation, no float, plain C99).
+//
+// A block is self-contained: a 4-byte header, then records delta-coded
+// against the one before them in the block.
+//
+//   header   'R', RC_VERSION, record count (u16 LE), varint period_ms
+//   record   varint  channel map, XOR the previous record's map
+//            varint  first record: t_ms; then zigzag(dt - period_ms)
+//            varint  zigzag change in t_ms * 1000 - t_us   if RC_MAP_T_US
+//            varint  zigzag change in epoch_us - t_us      if RC_MAP_EPOCH
+//            4 bytes capdac[0..3], then one   if RC_MAP_CAPDAC
+//                    per cap_raw[4..] present
+//            zigzag varint delta per channel   present in the map, in
+//                    cap_raw[0..3], temp_cdeg, hum_q10, pres_q8, mc_cpct,
+//                    cap_raw[4..] order
+//            varint  flags                     if RC_MAP_FLAGS
+//
+// Values keep the sensors' native scales (record.h), so the coding is
+// lossless. A channel is absent when it is 0 (mc_cpct: WMC_INVALID;
+// cap_raw[4..]: it and its capdac); it then takes no bytes and decodes as
+// such. The two time changes are against the last record that had them.
+// On the firmware's steady 1 Hz records most fields are one byte and a
+// record takes ~18 bytes against 64 for sample_t.
+//
+// Version 2 added cap_raw[4..] (FDC_DEVICES > 1) at map bits 10 and up,
+// version 3 t_us and epoch_us at bits 38 and 39; an older block is a newer
+// one without them. A block with more capacitance channels than SAMPLE_CAPS
+// does not decode (ESP_ERR_NOT_SUPPORTED).
+
+#define RC_MAGIC 'R'
+#define RC_VERSION 3
+#define RC_HEADER_MAX 8       // 4 + varint period_ms
+// one record at its widest: 84, and per cap_raw[4..] 6 more plus 4 for the map
+#define RC_RECORD_MAX (84 + (SAMPLE_CAPS > 4 ? 4 + 6 * (SAMPLE_CAPS - 4) : 0))
+
+#define RC_MAP_CAP(i) ((i) < 4 ? 1ull << (i) : 1ull << ((i) + 6))   // cap_raw[i]
+#define RC_MAP_TEMP   (1u << 4)
+#define RC_MAP_HUM    (1u << 5)
+#define RC_MAP_PRES   (1u << 6)
+#define RC_MAP_MC     (1u << 7)
+#define RC_MAP_CAPDAC (1u << 8)     // capdac differs from the previous record
+#define RC_MAP_FLAGS  (1u << 9)     // flags nonzero
+#define RC_MAP_T_US   (1ull << 38)  // t_us nonzero
+#define RC_MAP_EPOCH  (1ull << 39)  // epoch_us nonzero
+
+typedef struct {
+    uint8_t *buf;
+    size_t cap, len;
+    uint16_t count;
+    uint32_t period_ms;
+    uint64_t prev_map;
+    uint64_t prev_lag, prev_off;
+    sample_t prev;
+} rc_enc_t;
+
+typedef struct {
+    const uint8_t *p, *end;
+    uint16_t count, left;
+    uint32_t period_ms;
+    uint8_t version;
+    uint64_t prev_map;
+    uint64_t prev_lag, prev_off;
+    sample_t prev;
+} rc_dec_t;
+
+// Start a block in buf (at least RC_HEADER_MAX bytes). period_ms is the
+// nominal record interval; any interval encodes, this one in one byte.
+esp_err_t rc_enc_init(rc_enc_t *e, void *buf, size_t cap, uint32_t period_ms);
+// Append s; false, with nothing written, when it does not fit or the
+// block holds UINT16_MAX records.
+bool rc_enc_add(rc_enc_t *e, const sample_t *s);
+// Bytes used so far; the block is complete after every add.
+static inline size_t rc_enc_len(const rc_enc_t *e){ return e->len; }
+
+// ESP_ERR_INVALID_VERSION for another version, ESP_ERR_INVALID_ARG if it
+// is not a block, ESP_ERR_INVALID_SIZE if the header is cut short.
+esp_err_t rc_dec_init(rc_dec_t *d, const void *buf, size_t len);
+// ESP_ERR_NOT_FOUND after the last record, ESP_ERR_INVALID_SIZE if the
+// block is cut short, ESP_ERR_NOT_SUPPORTED for a channel this build lacks.
+esp_err_t rc_dec_next(rc_dec_t *d, sample_t *out);
@@ -4,13 +4,64 @@
 #include <stdint.h>
 #include "config.h"
 
+// Capacitance channels per record: FDC1004 d's measurement m is channel
+// 4 * d + m. A device that is missing leaves its channels at 0.
+#define SAMPLE_CAPS (4 * FDC_DEVICES)
+
+// Integer sample: raw codes plus the scale to read them (units.h converts).
 typedef struct {
 uint64_t t_ms;
-float cap_pf[4];
-float temp_c, hum_pct, pres_hpa;
-uint16_t flags;
+uint64_t t_us;          // latest conversion in cap_raw, monotonic us since boot
+uint64_t epoch_us;      // t_us on the SNTP wall clock (timebase.h), Unix us; 0 before the first sync
+int32_t cap_raw[SAMPLE_CAPS];   // FDC1004 result codes, FDC_CODES_PER_PF per pF
+uint8_t capdac[SAMPLE_CAPS];    // CAPDAC offset added to each, in 3.125 pF steps
+int32_t temp_cdeg;      // 0.01 degC
+uint32_t hum_q10;       // %RH, Q22.10
+uint32_t pres_q8;       // Pa, Q24.8
+uint16_t mc_cpct;       // wood moisture content, 0.01 %; WMC_INVALID when not estimated
+uint16_t flags;         // SAMPLE_FLAG_*
 } sample_t;
 
+#define SAMPLE_FLAG_SATURATED  (1u << 0)   // a capacitance result is at the ADC range limit
+#define SAMPLE_FLAG_UNFILTERED (1u << 1)   // cap_raw is a single conversion, not the filter output
+#define SAMPLE_FLAG_MC_CLAMPED (1u << 2)   // capacitance outside the moisture table, mc_cpct clamped
+#define SAMPLE_FLAG_NO_ENV     (1u << 3)   // BME280 read failed: temp/hum/pres are zero
+#define SAMPLE_FLAG_CAPDAC     (1u << 4)   // a CAPDAC offset moved since the last record (fdc1004.h auto-ranging)
+
+// Record ring: single producer (sampler) / single consumer (drain), lock-free.
+// RECORD_RING_CAP must be a power of two.
+
+typedef enum {
+    RECORD_OVERFLOW_REJECT,       // full ring refuses the new record (default)
+    RECORD_OVERFLOW_DROP_OLDEST,  // full ring discards the oldest unclaimed record
+} record_overflow_t;
+
+typedef struct {
+    uint32_t pushed;      // records accepted
+    uint32_t rejected;    // records refused because the ring was full
+    uint32_t dropped;     // oldest records discarded under DROP_OLDEST
+    uint32_t high_water;  // highest fill level seen
+} record_stats_t;
+
+// Select before the producer and consumer start running.
+void record_set_overflow(record_overflow_t policy);
+
+// Producer side
 bool record_push(const sample_t *s);
+// Zero-copy push: fill the returned slot, then publish it. Returns NULL when
+// the ring is full and the policy rejects.
+sample_t *record_reserve(void);
+void record_publish(void);
+
+// Consumer side
 bool record_pop(sample_t *s);
-size_t record_count(void);
\ No newline at end of file
+size_t record_pop_batch(sample_t *out, size_t max);
+// Zero-copy pop: returns up to max records that are contiguous in ring
+// memory (a wrapped backlog takes two peeks). They stay valid until
+// record_commit(n) releases the first n of them; every peek must be
+// followed by a commit, record_commit(0) included.
+size_t record_peek(const sample_t **first, size_t max);
+void record_commit(size_t n);
+
+size_t record_count(void);
+void record_get_stats(record_stats_t *out);
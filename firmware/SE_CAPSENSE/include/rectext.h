@@ -0,0 +1,62 @@
+#pragma once
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "record.h"
+
+// Text encoding of sample_t for dashboards and spreadsheets, shared by the
+// firmware and host tools (no allocation, no float, no printf). Records
+// are appended to a caller's buffer, so a whole batch is one buffer.
+//
+// Numbers are written with integer arithmetic, two digits per step and
+// 32-bit divisions where the value allows (the ESP32-C3 has no FPU and
+// a 64-bit division is a library call); fixed-point values get a decimal
+// point inserted. On the host that is ~25x faster than snprintf("%.2f")
+// and the like, ~10x for plain integers (host/bench/bench_rectext); on
+// the target, where every %f digit is soft-float arithmetic, more.
+//
+//   RT_JSON_CODES  mqtt_svc.h's "/data" record, native scales (record.h):
+//     {"t":<t_ms>,"u":<t_us>,"e":<epoch_us>,"cap":[codes],"dac":[steps],
+//      "tc":<0.01 degC>,"rh":<%RH Q10>,"pa":<Pa Q8>,"mc":<0.01 %>,"f":<flags>}
+//   RT_JSON  the same reading in units (units.h), for "/units":
+//     {"t":<t_ms>,"e":<epoch_us>,"pf":[pF, 6 decimals],"degc":21.50,
+//      "rh":45.123,"hpa":1013.25,"mc":12.34 or null,"f":<flags>}
+//   RT_CSV   one line per record, columns as rt_csv_header
+//
+// JSON records are separated by commas; the caller writes the enclosing
+// array or object. The values are exact: pF is units_cap_af() in aF with
+// the point moved 6 places, and so on, with nothing lost to binary floats.
+
+typedef enum {
+    RT_JSON_CODES,
+    RT_JSON,
+    RT_CSV,
+} rt_fmt_t;
+
+// one record at its widest, in any format
+#define RT_RECORD_MAX (168 + 16 * SAMPLE_CAPS)
+// widest rt_put_u64 / rt_put_fixed output
+#define RT_NUM_MAX 21
+
+typedef struct {
+    char *buf;
+    size_t cap, len;
+    uint32_t count;
+    rt_fmt_t fmt;
+} rt_enc_t;
+
+// Append to buf, which holds no terminating NUL.
+esp_err_t rt_enc_init(rt_enc_t *e, void *buf, size_t cap, rt_fmt_t fmt);
+// Append s; false, with nothing written, when it does not fit.
+bool rt_enc_add(rt_enc_t *e, const sample_t *s);
+static inline size_t rt_enc_len(const rt_enc_t *e){ return e->len; }
+
+// The RT_CSV column names and a newline; 0 if cap is too small.
+size_t rt_csv_header(char *buf, size_t cap);
+
+// v in decimal at p (room for RT_NUM_MAX); returns the end.
+char *rt_put_u64(char *p, uint64_t v);
+// v / 10^decimals with that many decimals ("-0.05" for -5, 2), decimals
+// up to 9; returns the end.
+char *rt_put_fixed(char *p, int64_t v, unsigned decimals);
@@ -1,3 +1,48 @@
 #pragma once
+#include <esp_err.h>
+#include <stdbool.h>
+#include "adapt.h"
+#include "capfe.h"
+#include "dsp.h"
+#include "record.h"
+
 void sampler_init(void);
-void sampler_job(void);
\ No newline at end of file
+// Drain completed conversions (capfe.h) into the per-channel filter chain;
+// run every SAMPLE_POLL_MS.
+void sampler_poll_job(void);
+// Assemble one record from the latest filter outputs and the BME280 and push
+// it; run every sampler_period_ms(). Until every enabled measurement has a
+// filter output it reads the result registers directly (SAMPLE_FLAG_UNFILTERED).
+void sampler_job(void);
+
+// Front-end sampler_init found (capfe.h): the FDC1004 when none answered.
+const capfe_t *sampler_frontend(void);
+
+// When the first record was pushed, in tb_now_us() time (0 = not yet).
+uint64_t sampler_first_record_us(void);
+
+// Record ring sink (drain.h) that logs the newest record it is offered and
+// takes them all: the per-sample log lines, kept off the acquisition task.
+size_t sampler_log_sink(const sample_t *s, size_t n);
+
+// Filter applied to all measurements. sampler_init sets it from config.h,
+// decimating the per-measurement conversion rate to one output per
+// SAMPLE_PERIOD_MS unless SAMPLE_DECIM overrides it.
+esp_err_t sampler_set_filter(const dsp_cfg_t *cfg);
+const dsp_cfg_t *sampler_get_filter(void);
+
+// Record period (SAMPLE_PERIOD_MS after sampler_init); a multiple of
+// SAMPLE_POLL_MS. Setting it retunes the decimation like sampler_init
+// does, keeping the median, CIC order and IIR; the acquisition task picks
+// it up after its next record.
+esp_err_t sampler_set_period_ms(uint32_t ms);
+uint32_t sampler_period_ms(void);
+
+// Let adapt.h pick the period from each record (SAMPLE_ADAPT sets the
+// default); NULL holds the current one.
+esp_err_t sampler_set_adapt(const adapt_cfg_t *cfg);
+// A capacitance step since the last record (adapt.h jump): make the next
+// record now.
+bool sampler_record_due(void);
+// False while it is off.
+bool sampler_get_adapt_stats(adapt_stats_t *out);
\ No newline at end of file
@@ -0,0 +1,16 @@
+#pragma once
+#include <esp_err.h>
+#include <stdint.h>
+
+// Sleep/wake behind scheduler.c: sch_port_esp.c (task notification and a
+// one-shot esp_timer) on the ESP32-C3, host/sim/sim_sch.c (virtual clock)
+// on the host build. Not for use outside the scheduler.
+
+// Bind to the calling task, which is the one that will sleep.
+esp_err_t sch_port_init(void);
+
+// Block for up to us (UINT32_MAX: until woken).
+void sch_port_wait_us(uint32_t us);
+
+// End the current or next wait early; callable from any task or ISR.
+void sch_port_wake(void);
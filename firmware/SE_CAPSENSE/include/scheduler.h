@@ -1,6 +1,79 @@
 #pragma once
+#include <esp_err.h>
+#include <stdbool.h>
 #include <stdint.h>
 
+// Cooperative job scheduler for the app_main loop.
+//
+// Jobs sit in a min-heap on their next deadline (µs, tb_now_us). The loop
+// runs what is due and then sleeps until the next deadline, or until
+// sch_trigger wakes it early:
+//
+//     for (;;) sch_wait_us(sch_run_due());
+//
+// Jobs due at the same time run in the order they were added. Every run is
+// timed: dispatch jitter (start - deadline), run time, and runs that started
+// a whole period or more late.
+
+#define SCH_MAX_JOBS 16
+#define SCH_MS(ms) ((uint32_t)(ms) * 1000u)
+
 typedef void (*job_fn)(void);
-void sch_add(job_fn fn, uint32_t period_ms);
-void sch_run_due(void);
\ No newline at end of file
+
+// What a job that falls a period or more behind does.
+typedef enum {
+    SCH_SKIP,       // drop the missed runs and keep the phase (the default)
+    SCH_CATCH_UP,   // run once for every missed period, back to back
+} sch_overrun_t;
+
+typedef struct {
+    const char *name;
+    uint32_t period_us;
+    uint32_t runs;
+    uint32_t triggered;      // runs requested by sch_trigger
+    uint32_t missed;         // runs started a whole period or more after their deadline
+    uint32_t skipped;        // deadlines dropped under SCH_SKIP
+    uint32_t jitter_max_us;
+    uint64_t jitter_total_us;
+    uint32_t run_max_us;
+    uint64_t run_total_us;
+} sch_job_stats_t;
+
+typedef struct {
+    uint32_t wakeups;        // sch_run_due calls
+    uint32_t idle_wakeups;   // ... that ran nothing
+    uint32_t dispatches;
+} sch_stats_t;
+
+// Forget all jobs and stats. Call before adding jobs, from the task that
+// will run the loop.
+esp_err_t sch_init(void);
+
+// Run fn every period_us, first one period from now. period_us 0 makes an
+// event job that runs only when triggered. Returns the job id, or -1 when
+// all SCH_MAX_JOBS are in use.
+int sch_add(const char *name, job_fn fn, uint32_t period_us, sch_overrun_t overrun);
+
+// Change a periodic job's period: its next run is one new period after its
+// last deadline. From the loop's task, jobs included (a job can set its own).
+// ESP_ERR_INVALID_ARG for an event job or period_us 0.
+esp_err_t sch_set_period(int id, uint32_t period_us);
+
+// Run job id at the next sch_run_due, waking the loop if it sleeps. Safe
+// from other tasks and from ISRs.
+void sch_trigger(int id);
+
+// Run every job that is due, then return µs until the next deadline
+// (UINT32_MAX if there is none).
+uint32_t sch_run_due(void);
+
+// Sleep for up to us, returning early on sch_trigger.
+void sch_wait_us(uint32_t us);
+
+int sch_job_count(void);
+bool sch_get_job_stats(int id, sch_job_stats_t *out);
+void sch_get_stats(sch_stats_t *out);
+void sch_reset_stats(void);
+
+// Log one line per job; usable as a job itself.
+void sch_log_stats(void);
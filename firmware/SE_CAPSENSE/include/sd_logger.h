@@ -1,5 +1,94 @@
 #pragma once
 #include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+#include "record.h"
+#include "sd_port.h"
 
+// Streaming record log on the SD card (back-end: sd_port.h).
+//
+// The preallocated log file is a ring of fixed-size frames of
+// SD_FRAME_SECTORS sectors. Frame k of the log (seq k) always sits in slot
+// seq % slots, so a reader resynchronises after a damaged frame by skipping
+// to the next slot. Records handed to sdlog_append (the record ring's sink,
+// see drain.h) are copied into one of two frame buffers; a full buffer, or the partly filled one every
+// SD_FLUSH_PERIOD_MS, goes to the writer task while the other keeps
+// filling. A partial flush rewrites the open frame in place with the same
+// seq, so a power cut loses at most the frame being written. A full frame
+// whose write fails stays in its buffer and is written again (same slot
+// and seq) before the buffer takes new records; appends stall meanwhile.
+
+#define SDLOG_MAGIC 0x4C504143u   // "CAPL"
+#define SDLOG_VERSION 1
+#define SDLOG_FRAME_BYTES (SD_FRAME_SECTORS * SD_SECTOR_SIZE)
+
+typedef struct {
+    uint32_t magic;      // SDLOG_MAGIC
+    uint32_t seq;        // frame number since the log was created
+    uint16_t version;    // SDLOG_VERSION
+    uint16_t rec_size;   // sizeof(sample_t)
+    uint16_t count;      // records that follow the header
+    uint16_t flags;      // 0
+    uint32_t slots;      // frames in the log file
+    uint32_t crc;        // CRC-32 of the header (with crc = 0) and the records
+} sdlog_hdr_t;
+
+#define SDLOG_FRAME_RECORDS ((SDLOG_FRAME_BYTES - sizeof(sdlog_hdr_t)) / sizeof(sample_t))
+
+typedef struct {
+    uint32_t records;        // records accepted into frame buffers
+    uint32_t frames;         // frames completed
+    uint32_t writes;         // frame writes issued (full and partial)
+    uint64_t bytes;          // bytes written to the card
+    uint32_t write_errors;   // failed writes, and writes the writer task did not take
+    uint32_t rewrites;       // full frames written again after an error
+    uint32_t stalls;         // appends refused because both buffers were in flight
+    uint32_t wraps;          // times the log wrapped to slot 0
+    uint32_t flush_max_us;   // worst write + sync time
+    uint64_t flush_total_us;
+} sdlog_stats_t;
+
+// Mount and open the log, preallocated to SD_LOG_SECTORS, and resume after
+// the last intact frame.
 esp_err_t sdlog_init(void);
-void sdlog_job_flush(void);
\ No newline at end of file
+bool sdlog_ready(void);
+
+// Copy records into the open frame. Returns how many were taken; fewer than
+// n means both buffers are in flight and the caller should keep the rest.
+size_t sdlog_append(const sample_t *s, size_t n);
+
+// Scheduler job: flush the open frame once SD_FLUSH_PERIOD_MS has passed
+// since the last write.
+void sdlog_job_flush(void);
+// Queue the open frame for writing now.
+esp_err_t sdlog_flush(void);
+
+// Like the calls above, from the task that appends: the stats are kept
+// there, finished writes included.
+void sdlog_get_stats(sdlog_stats_t *out);
+void sdlog_reset_stats(void);
+
+// Next slot to be written and the number of slots in the log.
+uint32_t sdlog_slot(void);
+uint32_t sdlog_slots(void);
+
+// Read back slot `slot`. Fills out (up to max records) and *seq; returns
+// ESP_ERR_INVALID_CRC for a damaged or never-written frame.
+esp_err_t sdlog_read_slot(uint32_t slot, sample_t *out, size_t max, size_t *n, uint32_t *seq);
+
+// Records by number: record k of frame seq is seq * SDLOG_FRAME_RECORDS + k,
+// so the numbers run on across frames, reboots and wraps. Next to be
+// appended, and oldest still held by the log.
+uint64_t sdlog_next_record(void);
+uint64_t sdlog_oldest_record(void);
+// Read up to max records starting at record `first`, stopping at the end of
+// its frame (*n = 0 once first reaches sdlog_next_record). Returns
+// ESP_ERR_NOT_FOUND when the log has wrapped over it and ESP_ERR_INVALID_CRC
+// when its frame is damaged on the card.
+esp_err_t sdlog_read_records(uint64_t first, sample_t *out, size_t max, size_t *n);
+
+// Validate a frame image (at least SDLOG_FRAME_BYTES, or the sectors
+// holding the header and its records). Returns the header or NULL.
+const sdlog_hdr_t *sdlog_frame_check(const void *frame, size_t len);
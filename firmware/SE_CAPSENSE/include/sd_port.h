@@ -0,0 +1,24 @@
+#pragma once
+#include <esp_err.h>
+#include <stdint.h>
+
+// Storage back-end behind sd_logger.c: sd_port_esp.c (SD card on SPI, FAT
+// file) on the ESP32-C3, host/sim/sim_sd.c (a plain file) on the host build.
+// The log lives in one preallocated file addressed in 512-byte sectors from
+// its start. Not for use outside the logger.
+
+#define SD_SECTOR_SIZE 512
+
+// Mount the card and open the log file, growing it to `sectors` if it is
+// shorter. The port may grant less than asked when the card is full.
+esp_err_t sd_port_open(uint32_t sectors);
+uint32_t sd_port_sectors(void);
+void sd_port_close(void);
+
+esp_err_t sd_port_write(uint32_t sector, const void *buf, uint32_t count);
+esp_err_t sd_port_read(uint32_t sector, void *buf, uint32_t count);
+// Make everything written so far durable.
+esp_err_t sd_port_sync(void);
+
+// Run fn(arg) on the writer task, in submission order.
+esp_err_t sd_port_defer(void (*fn)(void *), void *arg);
@@ -0,0 +1,34 @@
+#pragma once
+#include <stddef.h>
+
+// Health snapshot for the fleet: the cli `stats` command logs it, and
+// stats_job_publish sends it to MQTT_BASE_TOPIC "/stats" as one line of
+// JSON (integers only):
+//
+//   {"dev":"<MQTT_CLIENT_ID>","t":<t_ms>,
+//    "ring":{"hw":<high water>,"rej":<rejected>,"drop":<dropped>},
+//    "i2c":{"xfers":<n>,"err":<nacks + timeouts + other>},
+//    "mqtt":{"stalls":<n>,"retx":<n>,"rbe":[offered,published],"age":[avg ms,max ms]},
+//    "sntp":[syncs,steps,last error us],"trace_drop":<n>,
+//    "period_ms":<record period>,
+//    "jobs":{"<name>":[runs,missed,run avg us,run max us],...,"acq":[...]},
+//    "prof":{"<probe>":[count,p50,p99,max cycles],...}}
+//
+// "rbe" counts the records the deadband (rbe.h) passed; [0,0] when it is
+// off. "age" is conversion to PUBACK over the records acknowledged since
+// boot; "sntp" is the wall clock (timebase.h). "period_ms" is the record
+// period now (adapt.h moves it). "acq" is the acquisition task:
+// [wakeups,late,run avg us,run max us]. "prof" holds the prof.h probes
+// that have run, and is empty with PROF_ENABLE 0.
+
+#define STATS_JSON_MAX 1024
+
+// Write the JSON snapshot into buf. Returns the length it needed, like
+// snprintf.
+size_t stats_format(char *buf, size_t cap);
+
+// Write the snapshot to the log, one line per item.
+void stats_log(void);
+
+// Scheduler job: publish the snapshot while MQTT is connected.
+void stats_job_publish(void);
@@ -0,0 +1,14 @@
+#pragma once
+#include <esp_err.h>
+#include <stdint.h>
+
+// SNTP client and lock behind timebase.c: tb_port_esp.c (esp_sntp, a
+// critical section) on the ESP32-C3, host/sim/sim_sntp.c (a stand-in server
+// on the virtual clock) on the host build. Not for use outside timebase.c.
+
+void tb_port_lock(void);
+void tb_port_unlock(void);
+
+// Ask server for the time every interval_ms, handing each answer to
+// tb_sync. Starting again does nothing.
+esp_err_t tb_port_sntp_start(const char *server, uint32_t interval_ms);
@@ -1,3 +1,37 @@
 #pragma once
+#include <esp_err.h>
+#include <stdbool.h>
 #include <stdint.h>
-uint64_t tb_now_ms(void);
\ No newline at end of file
+
+// Monotonic time since boot (esp_timer), and a wall clock on top of it for
+// lining records up across boards and with the broker.
+//
+// The wall clock is the monotonic clock plus an offset that SNTP keeps
+// (tb_port.h, one tb_sync per answer). The first answer, or one more than
+// TB_STEP_US off, sets the offset outright; a smaller error is slewed out
+// at TB_SLEW_PPM, so between steps the wall clock never jumps or runs
+// backwards and intervals stay within TB_SLEW_PPM of the monotonic ones.
+
+uint64_t tb_now_ms(void);
+uint64_t tb_now_us(void);
+
+// Poll TB_SNTP_SERVER every TB_SNTP_INTERVAL_MS, once the network is up.
+esp_err_t tb_sntp_start(void);
+
+// A time answer: the wall clock read epoch_us (Unix us) at monotonic mono_us.
+void tb_sync(uint64_t epoch_us, uint64_t mono_us);
+bool tb_synced(void);
+// Wall-clock time of monotonic time mono_us (a recent one), Unix us; 0
+// before the first answer.
+uint64_t tb_epoch_us(uint64_t mono_us);
+
+typedef struct {
+    uint32_t syncs;        // answers taken
+    uint32_t steps;        // of which set the offset outright
+    int32_t last_err_us;   // wall clock minus the last answer, before it was applied
+    int32_t slew_us;       // correction still to slew out
+} tb_stats_t;
+
+void tb_get_stats(tb_stats_t *out);
+// Back to no wall clock (host tests).
+void tb_reset(void);
@@ -0,0 +1,103 @@
+#pragma once
+#include <esp_err.h>
+#include <esp_log.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "config.h"
+
+// Deferred binary logging for the sampling path (lock: trace_port.h).
+//
+// TRACE_E/W/I/D take the place of ESP_LOGx at call sites that must not
+// format or wait for the UART: the call stores a format id, its timestamp
+// and up to TRACE_ARGS_MAX integer arguments in a RAM ring, and
+// trace_job_flush formats them later on the app_main loop, through
+// ESP_LOG at the event's level and tag. A full ring drops new events and
+// counts them.
+//
+//     ESP_LOGW(TAG, "read failed: %d", r);  ->  TRACE_W(TAG, "read failed: %d", r);
+//
+// Arguments are 32-bit integers (d i u x X c, any flags, width, precision
+// and length modifier); there is no %s or %f. The format is checked at
+// compile time like printf's.
+//
+// trace_export packs the formats and pending events into a blob for the
+// host (host/tools/trace2txt), which formats them with the same code:
+//   'T', TRACE_VERSION, formats (u16 LE), events (u16 LE)
+//   per format (id 1, 2, ...)  level u8, tag NUL-terminated, format NUL-terminated
+//   per event                  id u16 LE, t_ms u32 LE, nargs u8, args u32 LE
+
+#define TRACE_VERSION 1
+#define TRACE_ARGS_MAX 4
+
+typedef struct {
+    const char *fmt;
+    uint8_t level;      // esp_log_level_t
+    uint16_t id;        // 0 until the first event
+    const char *tag;    // set with the id
+} trace_fmt_t;
+
+typedef struct {
+    uint16_t id;
+    uint8_t nargs;
+    uint32_t t_ms;
+    uint32_t arg[TRACE_ARGS_MAX];
+} trace_ev_t;
+
+typedef struct {
+    uint32_t events;      // events stored
+    uint32_t dropped;     // events lost to a full ring
+    uint32_t no_id;       // events lost because TRACE_FMT_MAX formats are in use
+    uint32_t formatted;   // events written out by trace_job_flush
+    uint32_t high_water;  // most events waiting at once
+} trace_stats_t;
+
+// Events above this level are not stored (default TRACE_LEVEL).
+extern uint8_t trace_level;
+
+void trace_emit(trace_fmt_t *f, const char *tag, uint8_t nargs, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+#define TRACE_NARGS_(...) TRACE_NARGS_N_(0, ##__VA_ARGS__, TRACE_TOO_MANY_ARGUMENTS, 4, 3, 2, 1, 0)
+#define TRACE_NARGS_N_(z, a, b, c, d, e, n, ...) n
+#define TRACE_ARGS_(z, a, b, c, d, ...) (uint32_t)(a), (uint32_t)(b), (uint32_t)(c), (uint32_t)(d)
+
+#define TRACE_LOG(level, tag, format, ...) do {                                              \
+        static trace_fmt_t trace_fmt_ = { (format), (level), 0, NULL };                      \
+        if (0) printf(format, ##__VA_ARGS__);                                                \
+        if (trace_level >= (level))                                                          \
+            trace_emit(&trace_fmt_, (tag), TRACE_NARGS_(__VA_ARGS__),                        \
+                       TRACE_ARGS_(0, ##__VA_ARGS__, 0, 0, 0, 0));                           \
+    } while (0)
+
+#define TRACE_E(tag, format, ...) TRACE_LOG(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define TRACE_W(tag, format, ...) TRACE_LOG(ESP_LOG_WARN,  tag, format, ##__VA_ARGS__)
+#define TRACE_I(tag, format, ...) TRACE_LOG(ESP_LOG_INFO,  tag, format, ##__VA_ARGS__)
+#define TRACE_D(tag, format, ...) TRACE_LOG(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+
+// Forget pending events, formats and stats.
+void trace_init(void);
+
+// Take up to max pending events, oldest first.
+size_t trace_pop(trace_ev_t *out, size_t max);
+// Format of id, or NULL.
+const trace_fmt_t *trace_fmt(uint16_t id);
+
+// Scheduler job: write pending events to the log.
+void trace_job_flush(void);
+
+// Format one event's text (no level, time or tag) into out. Returns the
+// length it needed, like snprintf.
+int trace_format(char *out, size_t cap, const char *fmt, const uint32_t *arg, uint8_t nargs);
+
+// Pack every format and as many pending events as fit (taking them from the
+// ring) into buf. Returns the bytes used, 0 if the formats alone do not fit.
+size_t trace_export(void *buf, size_t cap);
+
+// Turn an exported blob back into log lines ("W (t_ms) tag: text").
+// ESP_ERR_INVALID_ARG if it is not one, ESP_ERR_INVALID_SIZE if it is cut
+// short (lines before the cut have been passed to line).
+esp_err_t trace_decode(const void *blob, size_t len, void (*line)(void *ctx, const char *text), void *ctx);
+
+void trace_get_stats(trace_stats_t *out);
+void trace_reset_stats(void);
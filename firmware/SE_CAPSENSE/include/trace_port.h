@@ -0,0 +1,8 @@
+#pragma once
+
+// Lock behind trace.c: trace_port_esp.c (a critical section, so any task or
+// ISR may emit) on the ESP32-C3, host/sim/sim_trace.c (nothing to lock on
+// the single-threaded host) on the host build. Held for a few stores only.
+
+void trace_port_lock(void);
+void trace_port_unlock(void);
@@ -0,0 +1,88 @@
+#pragma once
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "record.h"
+
+// Streaming bit-packed compression of sample_t batches (Gorilla-style),
+// shared by the firmware and host tools (no allocation, no float, plain C99).
+//
+// A block is an 8-byte header, 'Z', TSC_VERSION, record count (u16 LE),
+// period_ms (u32 LE), then a bit stream, MSB first:
+//
+//   map      '0' same channels as before | '1' 8-bit channel map, then
+//            '0' no cap_raw[4..] | '1' 5-bit n - 1, n bits: cap_raw[4..3+n],
+//            then a bit each for t_us and epoch_us
+//   time     first record: 64-bit t_ms; then the delta of delta, starting
+//            from dt = period_ms, zigzagged into
+//            '0' 0 | '10' 7 bits | '110' 12 bits | '1110' 20 bits | '1111' 64 bits
+//   t_us     if in the map: t_ms * 1000 - t_us, and then
+//   epoch    if in the map: epoch_us - t_us, each as the zigzagged change
+//            since the last record that had it, coded like a value
+//   capdac   '0' unchanged | '1' 4 x 8 bits, then 8 bits per cap_raw[4..]
+//            present
+//   value    per channel present, cap_raw[0..3], temp_cdeg, hum_q10,
+//            pres_q8, mc_cpct, cap_raw[4..]: the zigzagged delta v as
+//            '0' v = 0 | '10' v in the channel's current width |
+//            '11' 6-bit width - 1, then v in that width (the new width)
+//   flags    '0' unchanged | '1' 16 bits
+//
+// The width follows each channel's noise: it is set when a delta does not
+// fit and again when a narrower one would save more than the 6-bit field.
+// Channel presence is as in reccodec.h (absent = 0, mc_cpct WMC_INVALID);
+// the coding is lossless. Every record costs at most TSC_RECORD_MAX_BITS
+// and a fixed amount of work, whatever the data.
+//
+// Version 2 added the cap_raw[4..] bit after the map (FDC_DEVICES > 1),
+// version 3 t_us and epoch_us; older blocks still decode, without them.
+
+#define TSC_MAGIC 'Z'
+#define TSC_VERSION 3
+#define TSC_HEADER_BYTES 8
+#define TSC_CHANS (4 + SAMPLE_CAPS)   // value channels, cap_raw[4..] last
+#define TSC_WIDTHS (TSC_CHANS + 2)    // and the t_us and epoch_us changes
+#define TSC_RECORD_MAX_BITS (12 + 68 + 2 * 72 + 33 + 8 * 72 + 17 + (SAMPLE_CAPS > 4 ? 5 + 81 * (SAMPLE_CAPS - 4) : 0))
+#define TSC_RECORD_MAX ((TSC_RECORD_MAX_BITS + 7) / 8)
+
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t bits;          // stream position, from the start of buf
+    uint16_t count;
+    uint32_t period_ms;
+    uint64_t prev_dt;
+    uint64_t prev_map;
+    uint64_t prev_lag, prev_off;
+    uint8_t width[TSC_WIDTHS];
+    bool over;            // the record being added ran out of room
+    sample_t prev;
+} tsc_enc_t;
+
+typedef struct {
+    const uint8_t *buf;
+    size_t bits, end_bits;
+    uint16_t count, left;
+    uint32_t period_ms;
+    uint64_t prev_dt;
+    uint64_t prev_map;
+    uint64_t prev_lag, prev_off;
+    uint8_t width[TSC_WIDTHS];
+    uint8_t version;
+    sample_t prev;
+} tsc_dec_t;
+
+// Start a block in buf (at least TSC_HEADER_BYTES).
+esp_err_t tsc_enc_init(tsc_enc_t *e, void *buf, size_t cap, uint32_t period_ms);
+// Append s; false, with the block unchanged, when it does not fit or the
+// block holds UINT16_MAX records.
+bool tsc_enc_add(tsc_enc_t *e, const sample_t *s);
+// Bytes used so far; the block is complete after every add.
+static inline size_t tsc_enc_len(const tsc_enc_t *e){ return (e->bits + 7) / 8; }
+
+// ESP_ERR_INVALID_VERSION for another version, ESP_ERR_INVALID_ARG if it
+// is not a block, ESP_ERR_INVALID_SIZE if the header is cut short.
+esp_err_t tsc_dec_init(tsc_dec_t *d, const void *buf, size_t len);
+// ESP_ERR_NOT_FOUND after the last record, ESP_ERR_INVALID_SIZE if the
+// block is cut short, ESP_ERR_NOT_SUPPORTED for a channel this build lacks.
+esp_err_t tsc_dec_next(tsc_dec_t *d, sample_t *out);
@@ -0,0 +1,32 @@
+#pragma once
+#include <stdint.h>
+
+// Integer units from the drivers to the encoders. Samples keep the sensors'
+// native scales (record.h); these convert to decimal fixed-point for display
+// and transport. Floats only appear at the edge (host tools, text output).
+
+#define UNITS_AF_PER_PF 1000000          // attofarads per pF
+#define UNITS_CAPDAC_STEP_AF 3125000     // FDC1004 CAPDAC step, 3.125 pF
+#define UNITS_CAPDAC_STEP_CODES 1638400  // the same in result codes
+
+// FDC1004 result code (2^19 per pF) plus CAPDAC offset to attofarads.
+// 1e6 / 2^19 = 15625 / 8192 exactly, rounded to nearest.
+static inline int32_t units_cap_af(int32_t raw, uint8_t capdac){
+    return (int32_t)(((int64_t)raw * 15625 + 4096) >> 13) + (int32_t)capdac * UNITS_CAPDAC_STEP_AF;
+}
+
+// The same in result codes: continuous across CAPDAC changes, for comparing
+// readings with each other.
+static inline int32_t units_cap_codes(int32_t raw, uint8_t capdac){
+    return raw + (int32_t)capdac * UNITS_CAPDAC_STEP_CODES;
+}
+
+// BME280 humidity, %RH in Q22.10, to 0.001 %RH.
+static inline int32_t units_hum_mpct(uint32_t hum_q10){
+    return (int32_t)(((uint64_t)hum_q10 * 1000u + 512u) >> 10);
+}
+
+// BME280 pressure, Pa in Q24.8, to Pa (= 0.01 hPa).
+static inline int32_t units_pres_pa(uint32_t pres_q8){
+    return (int32_t)((pres_q8 + 128u) >> 8);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Wood moisture content from the sensor capacitance and the wood temperature.
+// The capacitance model C(MC, T) of each species is tabulated at compile time
+// on a moisture x temperature grid (src/wmc.c); an estimate interpolates the
+// table in temperature and inverts it in moisture, all in integer math.
+
+typedef enum {
+    WMC_SPECIES_GENERIC,   // softwood/hardwood average, specific gravity 0.50
+    WMC_SPECIES_PINE,
+    WMC_SPECIES_SPRUCE,
+    WMC_SPECIES_DOUGLAS_FIR,
+    WMC_SPECIES_OAK,
+    WMC_SPECIES_BEECH,
+    WMC_SPECIES_COUNT,
+} wmc_species_t;
+
+#define WMC_MC_MAX_CPCT 3000       // table range 0..30 % (fibre saturation)
+#define WMC_T_MIN_CDEG (-2000)     // temperature range of the tables, 0.01 degC
+#define WMC_T_MAX_CDEG 6000
+#define WMC_INVALID 0xFFFF         // sample_t.mc_cpct when there is no estimate
+
+esp_err_t wmc_set_species(wmc_species_t sp);
+wmc_species_t wmc_get_species(void);
+const char *wmc_species_name(wmc_species_t sp);
+// WMC_SPECIES_COUNT when the name is unknown.
+wmc_species_t wmc_species_from_name(const char *name);
+
+// Moisture content in 0.01 % for sensor capacitance cap_af (attofarads) at
+// temp_cdeg (0.01 degC; clamped to the table range). Results outside
+// 0..WMC_MC_MAX_CPCT are clamped and *clamped is set.
+uint16_t wmc_estimate(int32_t cap_af, int32_t temp_cdeg, bool *clamped);
+
+// Model capacitance for a given moisture content and temperature, from the
+// same table (used by calibration checks and the simulator).
+int32_t wmc_model_af(uint16_t mc_cpct, int32_t temp_cdeg);
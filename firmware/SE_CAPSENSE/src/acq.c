@@ -0,0 +1,66 @@
+#include "acq.h"
+#include "acq_port.h"
+#include "sampler.h"
+#include "config.h"
+#include "timebase.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "acq";
+
+#define POLL_US ((uint64_t)SAMPLE_POLL_MS * 1000u)
+
+_Static_assert(SAMPLE_PERIOD_MS % SAMPLE_POLL_MS == 0, "SAMPLE_PERIOD_MS must be a multiple of SAMPLE_POLL_MS");
+
+static uint64_t s_due_us;       // next timer deadline
+static uint64_t s_rec_due_us;   // next record
+static acq_stats_t s_stats;
+
+esp_err_t acq_start(void){
+    uint64_t now = tb_now_us();
+    s_due_us = now + POLL_US;
+    s_rec_due_us = now + (uint64_t)sampler_period_ms() * 1000u;
+    memset(&s_stats, 0, sizeof(s_stats));
+    esp_err_t r = acq_port_start((uint32_t)POLL_US, acq_tick);
+    if (r != ESP_OK) ESP_LOGE(TAG, "acquisition task start failed: %d", r);
+    else ESP_LOGI(TAG, "acquisition task: FDC poll every %u ms, record every %u ms",
+                  (unsigned)SAMPLE_POLL_MS, (unsigned)sampler_period_ms());
+    return r;
+}
+
+void acq_tick(void){
+    uint64_t t0 = tb_now_us();
+    // a wakeup just ahead of the deadline (timer phase) counts as on time
+    uint64_t late = t0 > s_due_us ? t0 - s_due_us : 0;
+    s_stats.wakeups++;
+    s_stats.jitter_total_us += late;
+    if (late > s_stats.jitter_max_us) s_stats.jitter_max_us = (uint32_t)late;
+    if (late >= POLL_US){
+        s_stats.late++;
+        s_due_us += late / POLL_US * POLL_US;
+    }
+    s_due_us += POLL_US;
+
+    // the record first, so its timestamp is the wakeup; it carries the
+    // filter outputs up to the previous poll
+    bool due_now = t0 + POLL_US / 2 >= s_rec_due_us;
+    if (due_now || sampler_record_due()){
+        if (!due_now) s_rec_due_us = t0;   // early, for a step (adapt.h)
+        uint64_t due = s_rec_due_us, rl = t0 > due ? t0 - due : 0;
+        if (rl > s_stats.rec_jitter_max_us) s_stats.rec_jitter_max_us = (uint32_t)rl;
+        sampler_job();
+        s_stats.records++;
+        // a new period (sampler_set_period_ms, adapt.h) runs from this record
+        uint64_t rec_us = (uint64_t)sampler_period_ms() * 1000u;
+        s_rec_due_us = due + (rl / rec_us + 1) * rec_us;
+    }
+    sampler_poll_job();
+
+    uint32_t us = (uint32_t)(tb_now_us() - t0);
+    s_stats.run_total_us += us;
+    if (us > s_stats.run_max_us) s_stats.run_max_us = us;
+}
+
+void acq_get_stats(acq_stats_t *out){ *out = s_stats; }
+
+void acq_reset_stats(void){ memset(&s_stats, 0, sizeof(s_stats)); }
@@ -0,0 +1,30 @@
+#include "acq_port.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+#define ACQ_TASK_PRIO 5   // above app_main and the SD writer, below the I2C bus task
+
+static TaskHandle_t s_task;
+static esp_timer_handle_t s_timer;
+static void (*s_tick)(void);
+
+static void on_timer(void *arg){ xTaskNotifyGive(s_task); }
+
+static void acq_task(void *arg){
+    for (;;){
+        // missed notifications collapse into one wakeup; acq_tick skips
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        s_tick();
+    }
+}
+
+esp_err_t acq_port_start(uint32_t period_us, void (*tick)(void)){
+    if (s_task) return ESP_ERR_INVALID_STATE;
+    s_tick = tick;
+    if (xTaskCreate(acq_task, "acq", 4096, NULL, ACQ_TASK_PRIO, &s_task) != pdPASS) return ESP_ERR_NO_MEM;
+    const esp_timer_create_args_t args = { .callback = on_timer, .name = "acq" };
+    esp_err_t r = esp_timer_create(&args, &s_timer);
+    if (r == ESP_OK) r = esp_timer_start_periodic(s_timer, period_us);
+    return r;
+}
@@ -0,0 +1,93 @@
+#include "adapt.h"
+#include "config.h"
+#include "units.h"
+#include <string.h>
+
+#define EWMA_DIV 4   // weight 1/4 on the newest record
+#define Q 8          // fraction bits of slope and mean, so a slow channel does not round to 0
+#define E_MAX ((int64_t)1 << 30)   // |change - mean| in the variance (2^22 codes, 8 pF): keeps var * 4 in range
+
+// Signal c: capacitance channel c (CAPDAC included), then temperature; and its settings.
+static int32_t chan(const sample_t *s, int c){ return c < SAMPLE_CAPS ? units_cap_codes(s->cap_raw[c], s->capdac[c]) : s->temp_cdeg; }
+static int cfg_of(int c){ return c < SAMPLE_CAPS ? c % 4 : 4; }
+
+static int64_t abs64(int64_t v){ return v < 0 ? -v : v; }
+
+void adapt_default_cfg(adapt_cfg_t *cfg){
+    *cfg = (adapt_cfg_t){
+        .min_ms = ADAPT_MIN_MS, .max_ms = ADAPT_MAX_MS, .hold = ADAPT_HOLD,
+        .rate = { ADAPT_CAP_RATE, ADAPT_CAP_RATE, ADAPT_CAP_RATE, ADAPT_CAP_RATE, ADAPT_TEMP_RATE },
+        .sd = { ADAPT_CAP_SD, ADAPT_CAP_SD, ADAPT_CAP_SD, ADAPT_CAP_SD, ADAPT_TEMP_SD },
+        .jump = ADAPT_CAP_JUMP,
+    };
+}
+
+esp_err_t adapt_init(adapt_t *a, const adapt_cfg_t *cfg, uint32_t period_ms){
+    if (!cfg->min_ms || cfg->min_ms % SAMPLE_POLL_MS || cfg->max_ms % SAMPLE_POLL_MS || cfg->max_ms < cfg->min_ms)
+        return ESP_ERR_INVALID_ARG;
+    memset(a, 0, sizeof(*a));
+    a->cfg = *cfg;
+    if (period_ms < cfg->min_ms) period_ms = cfg->min_ms;
+    if (period_ms > cfg->max_ms) period_ms = cfg->max_ms;
+    a->period_ms = a->stats.period_ms = period_ms;
+    return ESP_OK;
+}
+
+uint32_t adapt_update(adapt_t *a, const sample_t *s){
+    a->stats.records++;
+    if (!a->primed || s->t_ms <= a->t_ms){
+        for (int c = 0; c < ADAPT_SIGNALS; c++) a->prev[c] = chan(s, c);
+        a->t_ms = s->t_ms;
+        a->primed = true;
+        return a->period_ms;
+    }
+    int64_t dt = (int64_t)(s->t_ms - a->t_ms);
+    bool busy = false, quiet = true;
+    for (int c = 0; c < ADAPT_SIGNALS; c++){
+        int64_t d = (int64_t)chan(s, c) - a->prev[c];
+        a->prev[c] = chan(s, c);
+        int64_t r = d * (1 << Q) * 1000 / dt;
+        if (!a->warm){
+            // the averages start from the first change, not from 0
+            a->slope[c] = r;
+            a->mean[c] = d * (1 << Q);
+        }
+        a->slope[c] += (r - a->slope[c]) / EWMA_DIV;
+        int64_t e = d * (1 << Q) - a->mean[c];
+        a->mean[c] += e / EWMA_DIV;
+        // a board going in moves ~2^26 codes at once: busy whatever sd is
+        if (e > E_MAX) e = E_MAX;
+        if (e < -E_MAX) e = -E_MAX;
+        a->var[c] += (e * e - a->var[c]) / EWMA_DIV;
+
+        int64_t rate = (int64_t)a->cfg.rate[cfg_of(c)] << Q, sd = (int64_t)a->cfg.sd[cfg_of(c)] << Q;
+        if (rate && abs64(a->slope[c]) >= rate) busy = true;
+        if (sd && a->var[c] >= sd * sd) busy = true;
+        if ((rate && abs64(a->slope[c]) * 2 >= rate) || (sd && a->var[c] * 4 >= sd * sd)) quiet = false;
+    }
+    a->t_ms = s->t_ms;
+    a->warm = true;
+
+    uint32_t p = a->period_ms;
+    if (busy){
+        a->quiet = 0;
+        if (p > a->cfg.min_ms){
+            p = a->cfg.min_ms;
+            a->stats.speedups++;
+        }
+    } else if (!quiet){
+        a->quiet = 0;
+    } else if (++a->quiet >= a->cfg.hold){
+        a->quiet = 0;
+        if (p < a->cfg.max_ms){
+            p = p * 2 > a->cfg.max_ms ? a->cfg.max_ms : p * 2;
+            a->stats.slowdowns++;
+        }
+    }
+    if (p != a->period_ms){
+        // the change per record scales with the period; the rate does not
+        for (int c = 0; c < ADAPT_SIGNALS; c++) a->mean[c] = a->slope[c] * p / 1000;
+        a->period_ms = a->stats.period_ms = p;
+    }
+    return p;
+}
@@ -1,6 +1,8 @@
 #include "bme280_drv.h"
 #include "i2c_bus.h"
 #include "esp_log.h"
+#include "trace.h"
+#include "prof.h"
 #include <stdint.h>
 #include <string.h>
 
@@ -38,8 +40,11 @@ static struct {
 
 static int32_t t_fine;
 
+// Prepared burst read of the data registers, press/temp/hum in one go.
+static uint8_t s_meas_buf[8];
+static i2c_txn_id_t s_txn_meas = I2C_TXN_NONE;
+
 static uint16_t read_u16_le(const uint8_t *b){ return (uint16_t)b[0] | ((uint16_t)b[1] << 8); }
-static int16_t read_s16_le(const uint8_t *b){ return (int16_t)read_u16_le(b); }
 
 esp_err_t bme_init(void){
     uint8_t id;
@@ -91,6 +96,10 @@ esp_err_t bme_init(void){
     r = i2c_wr(BME280_I2C_ADDR, BME_REG_CONFIG, &config, 1);
     if (r != ESP_OK){ ESP_LOGE(TAG, "i2c write config failed: %d", r); return r; }
 
+    i2c_bus_add_device(BME280_I2C_ADDR, BME280_I2C_MAX_HZ);
+    if (s_txn_meas == I2C_TXN_NONE)
+        s_txn_meas = i2c_txn_prepare_read(BME280_I2C_ADDR, BME_REG_MEAS, s_meas_buf, sizeof(s_meas_buf));
+
     ESP_LOGI(TAG, "BME280 initialized (id=0x%02x)", id);
     return ESP_OK;
 }
@@ -134,22 +143,27 @@ static int32_t comp_hum(int32_t adc_H){
     return (v_x1_u32r >> 12); // humidity in % * 1024
 }
 
-esp_err_t bme_read(float *t, float *h, float *p){
-    uint8_t buf[8];
-    esp_err_t r = i2c_rd(BME280_I2C_ADDR, BME_REG_MEAS, buf, sizeof(buf));
-    if (r != ESP_OK){ ESP_LOGE(TAG, "i2c read meas failed: %d", r); return r; }
+i2c_txn_id_t bme_meas_txn(void){ return s_txn_meas; }
 
+void bme_meas_decode(int32_t *t, uint32_t *h, uint32_t *p){
+    const uint8_t *buf = s_meas_buf;
     int32_t adc_P = ( (int32_t)buf[0] << 12 ) | ( (int32_t)buf[1] << 4 ) | (buf[2] >> 4 );
     int32_t adc_T = ( (int32_t)buf[3] << 12 ) | ( (int32_t)buf[4] << 4 ) | (buf[5] >> 4 );
     int32_t adc_H = ( (int32_t)buf[6] << 8 ) | buf[7];
 
+    // temperature first: it sets t_fine for the other two
     int32_t Traw = comp_temp(adc_T); // in 0.01 C
-    uint32_t Praw = comp_pres(adc_P); // Pa << 8
-    int32_t Hraw = comp_hum(adc_H); // % * 1024
-
-    if (t) *t = ((float)Traw) / 100.0f;
-    if (p) *p = ((float)Praw) / 256.0f / 100.0f; // convert Pa<<8 to hPa
-    if (h) *h = ((float)Hraw) / 1024.0f;
+    if (t) *t = Traw;
+    if (p) *p = comp_pres(adc_P); // Pa << 8
+    if (h) *h = (uint32_t)comp_hum(adc_H); // % * 1024
+}
 
-    return ESP_OK;
-}
\ No newline at end of file
+esp_err_t bme_read(int32_t *t, uint32_t *h, uint32_t *p){
+    PROF_START(PROF_BME_READ);
+    esp_err_t r = s_txn_meas != I2C_TXN_NONE ? i2c_txn_run(s_txn_meas)
+                                              : i2c_rd(BME280_I2C_ADDR, BME_REG_MEAS, s_meas_buf, sizeof(s_meas_buf));
+    if (r != ESP_OK) TRACE_E(TAG, "i2c read meas failed: %d", r);
+    else bme_meas_decode(t, h, p);
+    PROF_STOP(PROF_BME_READ);
+    return r;
+}
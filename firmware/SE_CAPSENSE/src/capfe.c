@@ -0,0 +1,9 @@
+#include "capfe.h"
+
+static const capfe_t *const FRONTENDS[] = { &capfe_fdc1004, &capfe_pcap04 };
+
+const capfe_t *capfe_probe(uint8_t dev){
+    for (size_t i = 0; i < sizeof(FRONTENDS) / sizeof(FRONTENDS[0]); i++)
+        if (FRONTENDS[i]->select(dev) == ESP_OK && FRONTENDS[i]->init() == ESP_OK) return FRONTENDS[i];
+    return NULL;
+}
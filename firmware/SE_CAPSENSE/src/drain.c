@@ -0,0 +1,32 @@
+#include "drain.h"
+
+static drain_sink_t s_sink[DRAIN_MAX_SINKS];
+static size_t s_ahead[DRAIN_MAX_SINKS];   // records at the ring head already taken by sink i
+static size_t s_nsinks;
+
+esp_err_t drain_add_sink(drain_sink_t sink){
+    for (size_t i = 0; i < s_nsinks; i++)
+        if (s_sink[i] == sink) return ESP_OK;
+    if (s_nsinks == DRAIN_MAX_SINKS) return ESP_ERR_NO_MEM;
+    s_sink[s_nsinks] = sink;
+    s_ahead[s_nsinks] = 0;
+    s_nsinks++;
+    return ESP_OK;
+}
+
+void drain_job(void){
+    if (!s_nsinks) return;
+    // a wrapped backlog takes two peeks; stop at the first sink that is full
+    for (;;){
+        const sample_t *p;
+        size_t n = record_peek(&p, RECORD_RING_CAP);
+        size_t done = n;
+        for (size_t i = 0; i < s_nsinks; i++){
+            if (s_ahead[i] < n) s_ahead[i] += s_sink[i](p + s_ahead[i], n - s_ahead[i]);
+            if (s_ahead[i] < done) done = s_ahead[i];
+        }
+        record_commit(done);
+        for (size_t i = 0; i < s_nsinks; i++) s_ahead[i] -= done;
+        if (n == 0 || done < n) break;
+    }
+}
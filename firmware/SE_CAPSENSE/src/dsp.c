@@ -0,0 +1,87 @@
+#include "dsp.h"
+#include <string.h>
+
+#define DSP_IIR_FRAC 8   // fractional bits kept in the IIR state
+
+esp_err_t dsp_init(dsp_chan_t *c, const dsp_cfg_t *cfg){
+    if (cfg->median > DSP_MEDIAN_MAX || (cfg->median > 1 && !(cfg->median & 1)) ||
+        cfg->decim < 1 || cfg->decim > DSP_DECIM_MAX ||
+        cfg->cic_order < 1 || cfg->cic_order > DSP_CIC_ORDER_MAX ||
+        cfg->iir_shift > 16)
+        return ESP_ERR_INVALID_ARG;
+    c->cfg = *cfg;
+    c->gain = 1;
+    for (int k = 0; k < cfg->cic_order; k++) c->gain *= cfg->decim;
+    dsp_reset(c);
+    return ESP_OK;
+}
+
+void dsp_reset(dsp_chan_t *c){
+    c->win_n = c->win_pos = 0;
+    memset(c->integ, 0, sizeof(c->integ));
+    memset(c->comb, 0, sizeof(c->comb));
+    c->phase = 0;
+    c->fill = (uint8_t)(c->cfg.cic_order - 1);   // a boxcar needs no fill
+    c->iir = 0;
+    c->iir_primed = false;
+}
+
+// Median of the last `median` inputs (fewer while the window fills).
+static int32_t median(dsp_chan_t *c, int32_t x){
+    uint8_t n = c->cfg.median;
+    c->win[c->win_pos] = x;
+    c->win_pos = (uint8_t)((c->win_pos + 1) % n);
+    if (c->win_n < n) c->win_n++;
+
+    if (c->win_n == 3){   // the common case: min/max network, no sort
+        int32_t a = c->win[0], b = c->win[1], d = c->win[2];
+        int32_t lo = a < b ? a : b, hi = a < b ? b : a;
+        int32_t m = hi < d ? hi : d;
+        return lo > m ? lo : m;
+    }
+    int32_t s[DSP_MEDIAN_MAX];
+    for (uint8_t i = 0; i < c->win_n; i++){
+        int32_t v = c->win[i];
+        int j = i;
+        for (; j > 0 && s[j - 1] > v; j--) s[j] = s[j - 1];
+        s[j] = v;
+    }
+    return s[c->win_n / 2];
+}
+
+static int64_t div_round(int64_t v, int64_t d){
+    return v >= 0 ? (v + d / 2) / d : -((-v + d / 2) / d);
+}
+
+bool dsp_push(dsp_chan_t *c, int32_t x, int32_t *out){
+    if (c->cfg.median > 1) x = median(c, x);
+
+    // Integrators run at the input rate, combs at the output rate. Unsigned
+    // arithmetic wraps cleanly; the comb differences recover the true sum.
+    uint8_t order = c->cfg.cic_order;
+    uint64_t v = (uint64_t)(int64_t)x;
+    for (uint8_t k = 0; k < order; k++) v = c->integ[k] += v;
+    if (++c->phase < c->cfg.decim) return false;
+    c->phase = 0;
+    for (uint8_t k = 0; k < order; k++){
+        uint64_t prev = c->comb[k];
+        c->comb[k] = v;
+        v -= prev;
+    }
+    if (c->fill){
+        // the first order-1 outputs are missing their history
+        c->fill--;
+        return false;
+    }
+    int32_t y = (int32_t)div_round((int64_t)v, c->gain);
+
+    if (c->cfg.iir_shift){
+        // arithmetic shifts (GCC semantics for negative values), no divide
+        int64_t xq = (int64_t)y * (1 << DSP_IIR_FRAC);
+        if (!c->iir_primed){ c->iir = xq; c->iir_primed = true; }
+        else c->iir += (xq - c->iir) >> c->cfg.iir_shift;
+        y = (int32_t)((c->iir + (1 << (DSP_IIR_FRAC - 1))) >> DSP_IIR_FRAC);
+    }
+    *out = y;
+    return true;
+}
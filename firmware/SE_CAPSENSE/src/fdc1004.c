@@ -1,63 +1,393 @@
 #include "fdc1004.h"
 #include "i2c_bus.h"
+#include "i2cmux.h"
 #include "esp_log.h"
+#include "trace.h"
 #include "config.h"
+#include "timebase.h"
+#include "units.h"
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdbool.h>
 
+#define FDC_REG_MEAS1_MSB 0x00 // MEASx_MSB = 0x00 + 2x, MEASx_LSB = 0x01 + 2x
+#define FDC_REG_CONF_MEAS1 0x08
+#define FDC_REG_FDC_CONF 0x0C
 #define FDC_REG_MANUF_ID 0xFE
 #define FDC_REG_DEVICE_ID 0xFF
-#define FDC_REG_RESULT_BASE 0x00 // results: 4 * 2 bytes
+
+#define FDC_MANUF_ID_TI 0x5449
+#define FDC_DEVICE_ID 0x1004
+
+// FDC_CONF fields
+#define FDC_CONF_RST (1u << 15)
+#define FDC_CONF_RATE_SHIFT 10
+#define FDC_CONF_REPEAT (1u << 8)
+#define FDC_CONF_MEAS(m) (0x80u >> (m))   // MEAS_1 is bit 7
+#define FDC_CONF_DONE(m) (0x08u >> (m))   // DONE_1 is bit 3
+
+#define SAT_CODES ((int32_t)(FDC_CAP_RANGE_PF * FDC_CODES_PER_PF))
+#define AUTORANGE_CODES ((int32_t)FDC_AUTORANGE_PF * FDC_CODES_PER_PF)
 
 static const char *TAG = "fdc";
 
+// Per device; the devices share the address, the prepared transactions and
+// their buffers, and fdc_select picks the one the calls below act on.
+typedef struct {
+    fdc_config_t cfg;
+    int32_t latest[FDC_NUM_MEAS];
+    uint8_t latest_dac[FDC_NUM_MEAS];      // CAPDAC latest[m] was converted with
+    uint64_t settle_us[FDC_NUM_MEAS];      // results before this may have the old CAPDAC
+    fdc_stats_t stats;
+} fdc_dev_t;
+
+static fdc_dev_t s_devs[FDC_DEVICES];
+static fdc_dev_t *s_dev = &s_devs[0];
+static uint8_t s_sel;
+
+esp_err_t fdc_select(uint8_t dev){
+    if (dev >= FDC_DEVICES) return ESP_ERR_INVALID_ARG;
+    s_sel = dev;
+    s_dev = &s_devs[dev];
+    return ESP_OK;
+}
+
+uint8_t fdc_selected(void){ return s_sel; }
+
+esp_err_t fdc_route(void){
+#if FDC_DEVICES > 1
+    return i2cmux_select(s_sel);
+#else
+    return ESP_OK;
+#endif
+}
+
+// Registers are 16-bit big-endian and the pointer does not auto-increment,
+// so every register is its own segment.
+static esp_err_t rd16(uint8_t reg, uint16_t *v){
+    uint8_t b[2];
+    esp_err_t r = fdc_route();
+    if (r == ESP_OK) r = i2c_rd(FDC1004_I2C_ADDR, reg, b, 2);
+    if (r != ESP_OK){ s_dev->stats.errors++; return r; }
+    *v = (uint16_t)((b[0] << 8) | b[1]);
+    return ESP_OK;
+}
+
+static esp_err_t wr16(uint8_t reg, uint16_t v){
+    uint8_t b[2] = { (uint8_t)(v >> 8), (uint8_t)v };
+    esp_err_t r = fdc_route();
+    if (r == ESP_OK) r = i2c_wr(FDC1004_I2C_ADDR, reg, b, 2);
+    if (r != ESP_OK) s_dev->stats.errors++;
+    return r;
+}
+
+// Prepared reads for the hot paths: FDC_CONF, one MSB+LSB burst per
+// measurement, and all four results in one burst.
+static uint8_t s_conf_buf[2];
+static uint8_t s_res_buf[FDC_NUM_MEAS][4];   // MSB[15:8], MSB[7:0], LSB[15:8], LSB[7:0]
+static i2c_txn_id_t s_txn_conf = I2C_TXN_NONE;
+static i2c_txn_id_t s_txn_meas[FDC_NUM_MEAS] = { I2C_TXN_NONE, I2C_TXN_NONE, I2C_TXN_NONE, I2C_TXN_NONE };
+static i2c_txn_id_t s_txn_results = I2C_TXN_NONE;
+
+static void prepare_txns(void){
+    if (s_txn_results != I2C_TXN_NONE) return;
+    i2c_txn_id_t parts[2 * FDC_NUM_MEAS];
+    s_txn_conf = i2c_txn_prepare_read(FDC1004_I2C_ADDR, FDC_REG_FDC_CONF, s_conf_buf, 2);
+    for (int m = 0; m < FDC_NUM_MEAS; m++){
+        parts[2 * m] = i2c_txn_prepare_read(FDC1004_I2C_ADDR, (uint8_t)(FDC_REG_MEAS1_MSB + 2 * m), &s_res_buf[m][0], 2);
+        parts[2 * m + 1] = i2c_txn_prepare_read(FDC1004_I2C_ADDR, (uint8_t)(FDC_REG_MEAS1_MSB + 2 * m + 1), &s_res_buf[m][2], 2);
+        s_txn_meas[m] = i2c_txn_prepare_burst(&parts[2 * m], 2);
+    }
+    s_txn_results = i2c_txn_prepare_burst(parts, 2 * FDC_NUM_MEAS);
+    if (s_txn_conf == I2C_TXN_NONE || s_txn_results == I2C_TXN_NONE)
+        ESP_LOGW(TAG, "no prepared transactions, using one-off transfers");
+}
+
+static int32_t res_raw(int m){
+    // 24-bit result: MSB[15:0] = D[23:8], LSB[15:8] = D[7:0]
+    const uint8_t *b = s_res_buf[m];
+    return (int32_t)(((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8)) >> 8;
+}
+
+static esp_err_t read_conf(uint16_t *v){
+    if (s_txn_conf == I2C_TXN_NONE) return rd16(FDC_REG_FDC_CONF, v);
+    esp_err_t r = fdc_route();
+    if (r == ESP_OK) r = i2c_txn_run(s_txn_conf);
+    if (r != ESP_OK){ s_dev->stats.errors++; return r; }
+    *v = (uint16_t)((s_conf_buf[0] << 8) | s_conf_buf[1]);
+    return ESP_OK;
+}
+
+// MSB first: reading it acknowledges DONE_x.
+static esp_err_t read_result(int m, int32_t *raw){
+    esp_err_t r;
+    if (s_txn_meas[m] != I2C_TXN_NONE){
+        if ((r = fdc_route()) == ESP_OK) r = i2c_txn_run(s_txn_meas[m]);
+        if (r != ESP_OK){ s_dev->stats.errors++; return r; }
+    } else {
+        uint16_t msb, lsb;
+        if ((r = rd16((uint8_t)(FDC_REG_MEAS1_MSB + 2 * m), &msb)) != ESP_OK) return r;
+        if ((r = rd16((uint8_t)(FDC_REG_MEAS1_MSB + 2 * m + 1), &lsb)) != ESP_OK) return r;
+        s_res_buf[m][0] = (uint8_t)(msb >> 8); s_res_buf[m][1] = (uint8_t)msb;
+        s_res_buf[m][2] = (uint8_t)(lsb >> 8); s_res_buf[m][3] = (uint8_t)lsb;
+    }
+    *raw = res_raw(m);
+    return ESP_OK;
+}
+
 esp_err_t fdc_init(void){
-    uint8_t buf[2];
-    if (i2c_rd(FDC1004_I2C_ADDR, FDC_REG_MANUF_ID, buf, 2)!=ESP_OK) {
+    uint16_t manuf, dev;
+    if (rd16(FDC_REG_MANUF_ID, &manuf)!=ESP_OK) {
         ESP_LOGE(TAG, "Failed to read manufacturer ID");
         return ESP_FAIL;
     }
-    ESP_LOGI(TAG, "manuf_id=0x%02X%02X", buf[0], buf[1]);
-
-    if (i2c_rd(FDC1004_I2C_ADDR, FDC_REG_DEVICE_ID, buf, 2)!=ESP_OK) {
+    if (rd16(FDC_REG_DEVICE_ID, &dev)!=ESP_OK) {
         ESP_LOGE(TAG, "Failed to read device ID");
         return ESP_FAIL;
     }
-    ESP_LOGI(TAG, "device_id=0x%02X%02X", buf[0], buf[1]);
+    ESP_LOGI(TAG, "manuf_id=0x%04X device_id=0x%04X", manuf, dev);
+    if (manuf != FDC_MANUF_ID_TI || dev != FDC_DEVICE_ID){
+        ESP_LOGE(TAG, "unexpected IDs, not an FDC1004");
+        return ESP_ERR_NOT_FOUND;
+    }
 
-    return ESP_OK;
+    i2c_bus_add_device(FDC1004_I2C_ADDR, FDC1004_I2C_MAX_HZ);
+    prepare_txns();
+
+    // Start from power-on defaults regardless of what ran before a soft reboot.
+    return wr16(FDC_REG_FDC_CONF, FDC_CONF_RST);
+}
+
+static uint16_t conf_meas_word(const fdc_meas_cfg_t *m){
+    uint16_t capdac = (m->chb == FDC_IN_CAPDAC) ? (m->capdac & FDC_CAPDAC_MAX) : 0;
+    return (uint16_t)(((m->cha & 7u) << 13) | ((m->chb & 7u) << 10) | (capdac << 5));
+}
+
+static uint8_t fdc_capdac_cfg(int m){
+    const fdc_meas_cfg_t *mc = &s_dev->cfg.meas[m];
+    return mc->chb == FDC_IN_CAPDAC ? mc->capdac : 0;
+}
+
+static uint16_t fdc_conf_word(const fdc_config_t *c){
+    uint16_t w = (uint16_t)((c->rate & 3u) << FDC_CONF_RATE_SHIFT);
+    if (c->repeat) w |= FDC_CONF_REPEAT;
+    for (int m = 0; m < FDC_NUM_MEAS; m++)
+        if (c->meas[m].enabled) w |= FDC_CONF_MEAS(m);
+    return w;
+}
+
+esp_err_t fdc_configure(const fdc_config_t *cfg){
+    for (int m = 0; m < FDC_NUM_MEAS; m++){
+        const fdc_meas_cfg_t *mc = &cfg->meas[m];
+        if (!mc->enabled) continue;
+        if (mc->cha > FDC_CIN4 || mc->cha == mc->chb ||
+            (mc->chb > FDC_CIN4 && mc->chb != FDC_IN_CAPDAC && mc->chb != FDC_IN_DISABLED) ||
+            mc->capdac > FDC_CAPDAC_MAX){
+            ESP_LOGE(TAG, "invalid MEAS%d config", m + 1);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    if (cfg->rate < FDC_RATE_100SPS || cfg->rate > FDC_RATE_400SPS) return ESP_ERR_INVALID_ARG;
+
+    // Stop first so no conversion runs with a half-written configuration.
+    esp_err_t r = wr16(FDC_REG_FDC_CONF, 0);
+    for (int m = 0; m < FDC_NUM_MEAS && r == ESP_OK; m++)
+        r = wr16((uint8_t)(FDC_REG_CONF_MEAS1 + m), conf_meas_word(&cfg->meas[m]));
+    if (r != ESP_OK){ ESP_LOGE(TAG, "CONF_MEAS write failed: %d", r); return r; }
+
+    s_dev->cfg = *cfg;
+    for (int m = 0; m < FDC_NUM_MEAS; m++){
+        s_dev->latest[m] = 0;
+        s_dev->latest_dac[m] = fdc_capdac_cfg(m);
+        s_dev->settle_us[m] = 0;
+    }
+    return fdc_start();
 }
 
-esp_err_t fdc_config_default(void){
-    // NOTE: real configuration (MEASx mapping, conversion rate, range) is TODO.
-    // For now, we assume the sensor is in a mode that produces results at 0x00..0x07
-    // and will be measured externally or by default settings. If you want, I can
-    // implement full register config once we confirm register map/sheet.
-    ESP_LOGI(TAG, "fdc_config_default: no-op (TODO: implement full config)");
+static esp_err_t config_rate(uint32_t rate_hz){
+    fdc_config_t c = {
+        .rate = rate_hz >= 400 ? FDC_RATE_400SPS : rate_hz >= 200 ? FDC_RATE_200SPS : FDC_RATE_100SPS,
+        .repeat = true,
+        .autorange = FDC_AUTORANGE,
+    };
+    for (int m = 0; m < FDC_NUM_MEAS; m++)
+        c.meas[m] = (fdc_meas_cfg_t){ .enabled = true, .cha = (fdc_input_t)m, .chb = FDC_IN_CAPDAC, .capdac = 0 };
+    esp_err_t r = fdc_configure(&c);
+    if (r == ESP_OK) ESP_LOGI(TAG, "4x single-ended, %d S/s, repeat", 100 << (c.rate - 1));
+    return r;
+}
+
+esp_err_t fdc_config_default(void){ return config_rate(FDC_RATE_HZ); }
+
+const fdc_config_t *fdc_get_config(void){ return &s_dev->cfg; }
+
+// Writing FDC_CONF (re)starts the sequence: continuous in repeat mode,
+// otherwise one conversion of each enabled measurement.
+esp_err_t fdc_start(void){ return wr16(FDC_REG_FDC_CONF, fdc_conf_word(&s_dev->cfg)); }
+
+esp_err_t fdc_stop(void){
+    fdc_config_t c = s_dev->cfg;
+    for (int m = 0; m < FDC_NUM_MEAS; m++) c.meas[m].enabled = false;
+    return wr16(FDC_REG_FDC_CONF, fdc_conf_word(&c));
+}
+
+static bool saturated(int32_t raw){ return raw >= SAT_CODES || raw <= -SAT_CODES; }
+
+// One measurement's conversions repeat every enabled-measurements x 1/RATE.
+static uint32_t seq_us(void){
+    const fdc_config_t *c = &s_dev->cfg;
+    uint32_t n = 0;
+    for (int m = 0; m < FDC_NUM_MEAS; m++) if (c->meas[m].enabled) n++;
+    return n * (10000u >> (c->rate - 1));
+}
+
+// Move measurement m's CAPDAC to the step nearest the input when raw is
+// FDC_AUTORANGE_PF or more off the current one.
+static void autorange(int m, int32_t raw, uint64_t t_us){
+    fdc_meas_cfg_t *mc = &s_dev->cfg.meas[m];
+    if (!s_dev->cfg.autorange || !mc->enabled || mc->chb != FDC_IN_CAPDAC) return;
+    if (raw < AUTORANGE_CODES && raw > -AUTORANGE_CODES) return;
+    int32_t half = raw < 0 ? -UNITS_CAPDAC_STEP_CODES / 2 : UNITS_CAPDAC_STEP_CODES / 2;
+    int32_t dac = mc->capdac + (raw + half) / UNITS_CAPDAC_STEP_CODES;
+    if (dac < 0) dac = 0;
+    if (dac > FDC_CAPDAC_MAX) dac = FDC_CAPDAC_MAX;
+    if (dac == mc->capdac) return;   // out of CAPDAC range: stays saturated
+    fdc_meas_cfg_t next = *mc;
+    next.capdac = (uint8_t)dac;
+    if (wr16((uint8_t)(FDC_REG_CONF_MEAS1 + m), conf_meas_word(&next)) != ESP_OK) return;
+    mc->capdac = (uint8_t)dac;
+    // the conversion running now may have started with the old offset
+    s_dev->settle_us[m] = t_us + 2u * seq_us();
+    s_dev->stats.offset_changes++;
+    TRACE_D(TAG, "MEAS%d CAPDAC %d", m + 1, (int)dac);
+}
+
+// Take raw, read at t_us, as measurement m's latest result unless it may
+// have been converted before the last offset change.
+static bool accept(int m, int32_t raw, uint64_t t_us){
+    if (t_us < s_dev->settle_us[m]) return false;
+    s_dev->latest[m] = raw;
+    s_dev->latest_dac[m] = fdc_capdac_cfg(m);
+    autorange(m, raw, t_us);
+    return true;
+}
+
+esp_err_t fdc_ready(uint8_t *mask){
+    *mask = 0;
+    uint16_t conf;
+    esp_err_t r = read_conf(&conf);
+    if (r != ESP_OK) return r;
+    s_dev->stats.polls++;
+    for (int m = 0; m < FDC_NUM_MEAS; m++)
+        if (conf & FDC_CONF_DONE(m)) *mask |= (uint8_t)(1u << m);
+    if (!*mask) s_dev->stats.idle_polls++;
     return ESP_OK;
 }
 
-esp_err_t fdc_read_pf(float out_pf[4], bool *saturated){
-    uint8_t buf[8];
-    if (i2c_rd(FDC1004_I2C_ADDR, FDC_REG_RESULT_BASE, buf, sizeof(buf)) != ESP_OK){
-        ESP_LOGW(TAG, "fdc_read: failed to read result registers");
-        for (int i=0;i<4;i++) out_pf[i]=0.0f;
+esp_err_t fdc_read_done(uint8_t mask, fdc_result_t *out, size_t *n){
+    esp_err_t r = ESP_OK;
+    *n = 0;
+    for (int m = 0; m < FDC_NUM_MEAS && r == ESP_OK; m++){
+        if (!(mask & (1u << m))) continue;
+        int32_t raw;
+        if ((r = read_result(m, &raw)) != ESP_OK) break;
+        uint64_t t = tb_now_us();
+        if (!accept(m, raw, t)) raw = s_dev->latest[m];   // repeat the last good one, the rate stays put
+        out[*n] = (fdc_result_t){ .t_us = t, .raw = raw, .meas = (uint8_t)m, .saturated = saturated(raw) };
+        (*n)++;
+    }
+    s_dev->stats.results += (uint32_t)*n;
+    return r;
+}
+
+esp_err_t fdc_poll(fdc_result_t *out, size_t max, size_t *n){
+    uint8_t mask;
+    *n = 0;
+    esp_err_t r = fdc_ready(&mask);
+    if (r != ESP_OK) return r;
+    for (int m = 0; m < FDC_NUM_MEAS; m++){
+        if (!(mask & (1u << m))) continue;
+        if (max) max--; else mask &= (uint8_t)~(1u << m);   // left for the next poll
+    }
+    return fdc_read_done(mask, out, n);
+}
+
+uint8_t fdc_capdac(uint8_t meas){ return s_dev->latest_dac[meas & 3]; }
+
+int32_t fdc_raw_to_af(int32_t raw, uint8_t meas){ return units_cap_af(raw, fdc_capdac(meas)); }
+
+i2c_txn_id_t fdc_results_txn(void){ return s_txn_results; }
+
+void fdc_results_raw(int32_t out_raw[4], bool *sat){
+    uint64_t t = tb_now_us();
+    bool any = false;
+    for (int m = 0; m < FDC_NUM_MEAS; m++){
+        accept(m, res_raw(m), t);
+        out_raw[m] = s_dev->latest[m];
+        if (s_dev->cfg.meas[m].enabled && saturated(out_raw[m])) any = true;
+    }
+    if (sat) *sat = any;
+}
+
+esp_err_t fdc_read_raw(int32_t out_raw[4], bool *saturated){
+    // The result registers always hold the latest conversion, so one burst
+    // over all of them is enough; DONE only matters to fdc_poll's stream.
+    esp_err_t r = s_txn_results != I2C_TXN_NONE ? fdc_route() : ESP_ERR_INVALID_STATE;
+    if (r == ESP_OK) r = i2c_txn_run(s_txn_results);
+    if (r != ESP_OK){
+        s_dev->stats.errors++;
+        TRACE_W(TAG, "fdc_read: failed to read result registers");
+        for (int i=0;i<4;i++) out_raw[i]=0;
         if (saturated) *saturated = false;
         return ESP_FAIL;
     }
 
-    // Interpret consecutive pairs as signed 16-bit values (big-endian)
-    for (int i=0;i<4;i++){
-        int16_t raw = (int16_t)((buf[2*i] << 8) | buf[2*i+1]);
-        // Convert raw to pF using simple scaling: assume full-scale corresponds to FDC_CAP_RANGE_PF
-        // This is an approximation; we'll refine after observing raw values.
-        float pf = ((float)raw) / 32768.0f * FDC_CAP_RANGE_PF;
-        out_pf[i] = pf;
-    }
-    if (saturated) *saturated = false; // detection not implemented yet
+    fdc_results_raw(out_raw, saturated);
 
-    ESP_LOGD(TAG, "fdc_raw=%02x%02x %02x%02x %02x%02x %02x%02x", buf[0],buf[1],buf[2],buf[3],buf[4],buf[5],buf[6],buf[7]);
-    ESP_LOGI(TAG, "FDC: %0.3f pF, %0.3f pF, %0.3f pF, %0.3f pF", out_pf[0], out_pf[1], out_pf[2], out_pf[3]);
+    TRACE_D(TAG, "FDC: %" PRId32 " fF, %" PRId32 " fF, %" PRId32 " fF, %" PRId32 " fF",
+             fdc_raw_to_af(out_raw[0], 0) / 1000, fdc_raw_to_af(out_raw[1], 1) / 1000,
+             fdc_raw_to_af(out_raw[2], 2) / 1000, fdc_raw_to_af(out_raw[3], 3) / 1000);
 
     return ESP_OK;
-}
\ No newline at end of file
+}
+
+void fdc_get_stats(fdc_stats_t *out){ *out = s_dev->stats; }
+
+// capfe.h front-end. The range is fixed (+-15 pF around the CAPDAC offset)
+// and the rate is 100, 200 or 400 S/s shared round-robin by the measurements.
+
+static const capfe_caps_t FE_CAPS = {
+    .name = "FDC1004", .rate_max_hz = 400 / FDC_NUM_MEAS, .range_pf = 15,
+    .conv_us = 2500, .offset = true, .averaging = false,
+};
+
+static esp_err_t fe_configure(uint32_t rate_hz, uint16_t range_pf){
+    if (range_pf > FE_CAPS.range_pf) return ESP_ERR_INVALID_ARG;
+    return rate_hz ? config_rate(rate_hz * FDC_NUM_MEAS) : fdc_config_default();
+}
+
+static uint32_t fe_rate_hz(void){
+    const fdc_config_t *c = &s_dev->cfg;
+    uint32_t n = 0;
+    for (int m = 0; m < FDC_NUM_MEAS; m++) if (c->meas[m].enabled) n++;
+    if (c->rate < FDC_RATE_100SPS || c->rate > FDC_RATE_400SPS || !n) return 0;
+    return (100u << (c->rate - 1)) / n;
+}
+
+const capfe_t capfe_fdc1004 = {
+    .caps = &FE_CAPS,
+    .select = fdc_select,
+    .route = fdc_route,
+    .init = fdc_init,
+    .configure = fe_configure,
+    .rate_hz = fe_rate_hz,
+    .start = fdc_start,
+    .stop = fdc_stop,
+    .ready = fdc_ready,
+    .read_batch = fdc_read_done,
+    .read_latest = fdc_read_raw,
+    .latest_txn = fdc_results_txn,
+    .latest_decode = fdc_results_raw,
+    .capdac = fdc_capdac,
+    .get_stats = fdc_get_stats,
+};
@@ -0,0 +1,170 @@
+#include "forward.h"
+#include "config.h"
+#include "mqtt_svc.h"
+#include "sd_logger.h"
+#include "timebase.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "fwd";
+
+#define CHUNK 16   // records per read from the log
+
+typedef struct { uint64_t first, end; } gap_t;   // record numbers [first, end)
+
+static bool s_ready;
+static bool s_spill;            // the SD log is there to spill to
+static uint64_t s_next;         // record number of the next record offered
+static gap_t s_gap[FWD_MAX_GAPS];
+static size_t s_ngaps;
+static uint32_t s_credit;       // replay budget, records * 1000
+static uint64_t s_credit_ms;
+static fwd_stats_t s_stats;
+static bool s_rbe_on;
+static rbe_t s_rbe_live, s_rbe_replay;
+
+static uint32_t backlog(void){
+    uint64_t n = 0;
+    for (size_t i = 0; i < s_ngaps; i++) n += s_gap[i].end - s_gap[i].first;
+    return (uint32_t)n;
+}
+
+static void stat_backlog(void){
+    s_stats.backlog = backlog();
+    if (s_stats.backlog > s_stats.backlog_max) s_stats.backlog_max = s_stats.backlog;
+}
+
+// Queue what passes the deadband; returns the records taken (queued or
+// suppressed), stopping at the first the queue refuses.
+static size_t publish(rbe_t *rb, const sample_t *s, size_t n, uint32_t *queued){
+    if (!s_rbe_on){
+        size_t k = mqtt_svc_append(s, n);
+        *queued += (uint32_t)k;
+        return k;
+    }
+    size_t i = 0;
+    for (; i < n; i++){
+        uint16_t why = rbe_test(rb, &s[i]);
+        if (why){
+            if (!mqtt_svc_append(&s[i], 1)) break;
+            (*queued)++;
+        }
+        rbe_note(rb, &s[i], why);
+    }
+    return i;
+}
+
+void fwd_set_rbe(const rbe_cfg_t *cfg){
+    s_rbe_on = cfg != NULL;
+    if (!cfg) return;
+    rbe_init(&s_rbe_live, cfg);
+    rbe_init(&s_rbe_replay, cfg);
+}
+
+void fwd_get_rbe_stats(rbe_stats_t *out){
+    *out = s_rbe_live.stats;
+    out->offered += s_rbe_replay.stats.offered;
+    out->published += s_rbe_replay.stats.published;
+    for (int b = 0; b < RBE_WHY_BITS; b++) out->why[b] += s_rbe_replay.stats.why[b];
+}
+
+esp_err_t fwd_init(void){
+    s_spill = sdlog_ready();
+    s_next = s_spill ? sdlog_next_record() : 0;
+    s_ngaps = 0;
+    s_credit = 0;
+    s_credit_ms = tb_now_ms();
+#if RBE_ENABLE
+    rbe_cfg_t cfg;
+    rbe_default_cfg(&cfg);
+    fwd_set_rbe(&cfg);
+#else
+    fwd_set_rbe(NULL);
+#endif
+    s_ready = true;
+    if (!s_spill) ESP_LOGW(TAG, "no SD log: records wait in the ring while MQTT is down");
+    return ESP_OK;
+}
+
+size_t fwd_append(const sample_t *s, size_t n){
+    if (!s_ready) return 0;
+    size_t k = publish(&s_rbe_live, s, n, &s_stats.live);
+    if (k == n || !s_spill){
+        s_next += k;
+        return k;
+    }
+
+    // the rest stays in the SD log; note where
+    uint64_t first = s_next + k, end = s_next + n;
+    if (s_ngaps && s_gap[s_ngaps - 1].end == first){
+        s_gap[s_ngaps - 1].end = end;
+    } else if (s_ngaps < FWD_MAX_GAPS){
+        s_gap[s_ngaps++] = (gap_t){ first, end };
+    } else {
+        // out of ranges: merge with the last one and replay what went out live in between
+        s_stats.resent += (uint32_t)(first - s_gap[s_ngaps - 1].end);
+        s_gap[s_ngaps - 1].end = end;
+    }
+    s_stats.spilled += (uint32_t)(n - k);
+    s_next = end;
+    stat_backlog();
+    return n;
+}
+
+void fwd_job_replay(void){
+    if (!s_ready) return;
+    uint64_t now = tb_now_ms();
+    uint64_t credit = s_credit + (now - s_credit_ms) * FWD_REPLAY_PER_S;
+    uint32_t cap = (FWD_REPLAY_PER_S * MQTT_PUB_PERIOD_MS / 1000u + CHUNK) * 1000u;
+    s_credit = credit > cap ? cap : (uint32_t)credit;
+    s_credit_ms = now;
+    if (!s_ngaps || !mqtt_svc_is_connected()) return;
+
+    size_t room = mqtt_svc_room();
+    room = room > FWD_LIVE_RESERVE ? room - FWD_LIVE_RESERVE : 0;
+    size_t budget = s_credit / 1000u;
+    if (budget > room) budget = room;
+
+    static sample_t buf[CHUNK];
+    while (budget && s_ngaps){
+        gap_t *g = &s_gap[0];
+        size_t want = budget < CHUNK ? budget : CHUNK;
+        if (g->end - g->first < want) want = (size_t)(g->end - g->first);
+        size_t got = 0;
+        esp_err_t r = sdlog_read_records(g->first, buf, want, &got);
+        if (r == ESP_ERR_NOT_FOUND || r == ESP_ERR_INVALID_CRC){
+            // wrapped over, or the frame never made it to the card: skip it
+            uint64_t to = r == ESP_ERR_NOT_FOUND ? sdlog_oldest_record()
+                        : (g->first / SDLOG_FRAME_RECORDS + 1) * SDLOG_FRAME_RECORDS;
+            if (to > g->end) to = g->end;
+            ESP_LOGW(TAG, "backlog records %llu..%llu unreadable: %d", (unsigned long long)g->first,
+                     (unsigned long long)to, r);
+            s_stats.lost += (uint32_t)(to - g->first);
+            g->first = to;
+        } else if (r != ESP_OK || !got){
+            break;   // card busy, or the records have not reached the log yet
+        } else {
+            uint32_t queued = 0;
+            size_t k = publish(&s_rbe_replay, buf, got, &queued);
+            g->first += k;
+            s_stats.replayed += queued;
+            budget -= k;
+            s_credit -= queued * 1000u;
+            if (k < got) break;
+        }
+        if (g->first == g->end){
+            memmove(&s_gap[0], &s_gap[1], (s_ngaps - 1) * sizeof(gap_t));
+            s_ngaps--;
+        }
+    }
+    stat_backlog();
+}
+
+void fwd_get_stats(fwd_stats_t *out){ *out = s_stats; }
+
+void fwd_reset_stats(void){
+    memset(&s_stats, 0, sizeof(s_stats));
+    memset(&s_rbe_live.stats, 0, sizeof(s_rbe_live.stats));
+    memset(&s_rbe_replay.stats, 0, sizeof(s_rbe_replay.stats));
+    stat_backlog();
+}
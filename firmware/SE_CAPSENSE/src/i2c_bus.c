@@ -1,42 +1,228 @@
+#include "i2c_bus.h"
+#include "i2c_port.h"
 #include "board.h"
-#include "driver/i2c.h"
+#include "timebase.h"
+#include "prof.h"
 #include "esp_log.h"
+#include <string.h>
 
 #define TAG "i2c"
 
+#define BURST_SLOT 0   // stats slot for bursts, reported as address 0x00
+
+static i2c_txn_t s_pool[I2C_TXN_POOL_SIZE];
+static int s_pool_used;
+
+static struct { uint8_t addr; uint32_t max_hz; } s_devs[I2C_STATS_MAX_DEVS];
+static int s_ndevs;
+static uint32_t s_speed_hz;
+
+static i2c_dev_stats_t s_stats[I2C_STATS_MAX_DEVS];
+static int s_nstats = 1;  // slot 0 is reserved for bursts
+static i2c_tap_fn s_tap;  // set and called under the bus lock
+
 esp_err_t i2c_bus_init(void){
-i2c_config_t conf = {
-.mode = I2C_MODE_MASTER,
-.sda_io_num = I2C_SDA_GPIO,
-.scl_io_num = I2C_SCL_GPIO,
-.sda_pullup_en = GPIO_PULLUP_ENABLE,
-.scl_pullup_en = GPIO_PULLUP_ENABLE,
-.master.clk_speed = I2C_FREQ_HZ,
-};
-ESP_ERROR_CHECK(i2c_param_config(I2C_NUM_0, &conf));
-    esp_err_t r = i2c_driver_install(I2C_NUM_0, conf.mode, 0, 0, 0);
-    ESP_LOGI(TAG, "i2c_bus_init: %d", r);
+    s_speed_hz = I2C_FREQ_HZ;
+    esp_err_t r = i2c_port_init(s_speed_hz);
+    ESP_LOGI(TAG, "i2c_bus_init: %d (%u Hz)", r, (unsigned)s_speed_hz);
+    return r;
+}
+
+esp_err_t i2c_bus_add_device(uint8_t addr, uint32_t max_hz){
+    int i;
+    for (i = 0; i < s_ndevs && s_devs[i].addr != addr; i++) {}
+    if (i == s_ndevs){
+        if (s_ndevs >= I2C_STATS_MAX_DEVS) return ESP_ERR_NO_MEM;
+        s_ndevs++;
+    }
+    s_devs[i].addr = addr;
+    s_devs[i].max_hz = max_hz;
+
+    uint32_t hz = I2C_FREQ_MAX_HZ;
+    for (i = 0; i < s_ndevs; i++) if (s_devs[i].max_hz < hz) hz = s_devs[i].max_hz;
+    if (hz == s_speed_hz) return ESP_OK;
+
+    i2c_port_lock();
+    esp_err_t r = i2c_port_set_speed(hz);
+    i2c_port_unlock();
+    if (r == ESP_OK){
+        ESP_LOGI(TAG, "bus clock %u -> %u Hz (0x%02x allows %u Hz)", (unsigned)s_speed_hz, (unsigned)hz, addr, (unsigned)max_hz);
+        s_speed_hz = hz;
+    }
     return r;
 }
 
+uint32_t i2c_bus_speed_hz(void){ return s_speed_hz; }
 
-static esp_err_t i2c_xfer(uint8_t addr, uint8_t reg, uint8_t *buf, size_t len, bool read){
-i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-i2c_master_start(cmd);
-i2c_master_write_byte(cmd, (addr<<1) | 0, true);
-i2c_master_write_byte(cmd, reg, true);
-if (read){
-i2c_master_start(cmd);
-i2c_master_write_byte(cmd, (addr<<1) | 1, true);
-i2c_master_read(cmd, buf, len, I2C_MASTER_LAST_NACK);
-} else {
-i2c_master_write(cmd, buf, len, true);
+// Timeout scales with the transfer: wire time at the current clock plus 2 ms
+// of slack for clock stretching and driver latency.
+static uint32_t timeout_ms(const i2c_txn_t *t){
+    uint32_t bytes = 0;
+    for (int i = 0; i < t->nseg; i++) bytes += 3u + t->seg[i].len;
+    uint32_t hz = s_speed_hz ? s_speed_hz : 100000;
+    return 2u + (bytes * 9u * 1000u + hz - 1u) / hz;
 }
-i2c_master_stop(cmd);
-esp_err_t r = i2c_master_cmd_begin(I2C_NUM_0, cmd, pdMS_TO_TICKS(20));
-i2c_cmd_link_delete(cmd);
-return r;
+
+static uint8_t stats_slot(uint8_t addr){
+    for (int i = 1; i < s_nstats; i++) if (s_stats[i].addr == addr) return (uint8_t)i;
+    if (s_nstats >= I2C_STATS_MAX_DEVS) return BURST_SLOT;  // table full: lump into slot 0
+    s_stats[s_nstats].addr = addr;
+    return (uint8_t)s_nstats++;
+}
+
+static void account(uint8_t slot, esp_err_t r, uint64_t us){
+    i2c_dev_stats_t *st = &s_stats[slot];
+    st->xfers++;
+    if (r == ESP_FAIL) st->nacks++;
+    else if (r == ESP_ERR_TIMEOUT) st->timeouts++;
+    else if (r != ESP_OK) st->other_errors++;
+    st->total_us += us;
+    if (us > st->max_us) st->max_us = (uint32_t)us;
+    int b = 0;
+    while (us && b < I2C_HIST_BUCKETS - 1){ us >>= 1; b++; }
+    st->hist[b]++;
 }
 
-esp_err_t i2c_rd(uint8_t a, uint8_t r, uint8_t *b, size_t l){ return i2c_xfer(a,r,b,l,true); }
-esp_err_t i2c_wr(uint8_t a, uint8_t r, const uint8_t *b, size_t l){ return i2c_xfer(a,r,(uint8_t*)b,l,false); }
\ No newline at end of file
+static void tap(uint64_t t0, const i2c_seg_t *seg, int n, esp_err_t r){
+    for (int i = 0; i < n; i++) s_tap(t0, seg[i].addr, seg[i].reg, seg[i].read, seg[i].buf, seg[i].len, r);
+}
+
+void i2c_bus_set_tap(i2c_tap_fn fn){
+    i2c_port_lock();
+    s_tap = fn;
+    i2c_port_unlock();
+}
+
+static esp_err_t xfer(uint8_t addr, uint8_t reg, uint8_t *buf, size_t len, bool read){
+    i2c_txn_t t = { .nseg = 1 };
+    t.seg[0] = (i2c_seg_t){ .addr = addr, .reg = reg, .read = read, .len = (uint16_t)len, .buf = buf };
+    i2c_port_lock();
+    PROF_START(PROF_I2C_XFER);
+    uint64_t t0 = tb_now_us();
+    esp_err_t r = i2c_port_xfer(&t.seg[0], timeout_ms(&t));
+    account(stats_slot(addr), r, tb_now_us() - t0);
+    if (s_tap) tap(t0, &t.seg[0], 1, r);
+    PROF_STOP(PROF_I2C_XFER);
+    i2c_port_unlock();
+    return r;
+}
+
+esp_err_t i2c_rd(uint8_t a, uint8_t r, uint8_t *b, size_t l){ return xfer(a,r,b,l,true); }
+esp_err_t i2c_wr(uint8_t a, uint8_t r, const uint8_t *b, size_t l){ return xfer(a,r,(uint8_t*)b,l,false); }
+
+esp_err_t i2c_cmd(uint8_t a, uint8_t c){
+    static uint8_t none;   // a buffer tells the port it is not a probe
+    return xfer(a, c, &none, 0, false);
+}
+
+bool i2c_bus_probe(uint8_t addr){
+    i2c_seg_t seg = { .addr = addr, .read = false, .len = 0, .buf = NULL };
+    i2c_port_lock();
+    uint64_t t0 = tb_now_us();
+    esp_err_t r = i2c_port_xfer(&seg, 25);
+    if (s_tap) tap(t0, &seg, 1, r);
+    i2c_port_unlock();
+    return r == ESP_OK;
+}
+
+static i2c_txn_id_t pool_add(const i2c_txn_t *t){
+    if (s_pool_used >= I2C_TXN_POOL_SIZE){
+        ESP_LOGE(TAG, "transaction pool exhausted (%d)", I2C_TXN_POOL_SIZE);
+        return I2C_TXN_NONE;
+    }
+    i2c_txn_id_t id = (i2c_txn_id_t)s_pool_used;
+    s_pool[id] = *t;
+    esp_err_t r = i2c_port_build(id, &s_pool[id]);
+    if (r != ESP_OK){
+        ESP_LOGE(TAG, "building transaction %d failed: %d", id, r);
+        return I2C_TXN_NONE;
+    }
+    s_pool_used++;
+    return id;
+}
+
+static i2c_txn_id_t prepare(uint8_t addr, uint8_t reg, uint8_t *buf, size_t len, bool read){
+    if (!buf || !len || len > UINT16_MAX) return I2C_TXN_NONE;
+    i2c_txn_t t = { .nseg = 1 };
+    t.seg[0] = (i2c_seg_t){ .addr = addr, .reg = reg, .read = read, .len = (uint16_t)len, .buf = buf };
+    i2c_port_lock();
+    t.stats_slot = stats_slot(addr);
+    i2c_txn_id_t id = pool_add(&t);
+    i2c_port_unlock();
+    return id;
+}
+
+i2c_txn_id_t i2c_txn_prepare_read(uint8_t addr, uint8_t reg, uint8_t *buf, size_t len){
+    return prepare(addr, reg, buf, len, true);
+}
+
+i2c_txn_id_t i2c_txn_prepare_write(uint8_t addr, uint8_t reg, const uint8_t *buf, size_t len){
+    return prepare(addr, reg, (uint8_t *)buf, len, false);
+}
+
+i2c_txn_id_t i2c_txn_prepare_burst(const i2c_txn_id_t *ids, size_t n){
+    i2c_txn_t t = { .nseg = 0, .stats_slot = BURST_SLOT };
+    i2c_port_lock();
+    for (size_t i = 0; i < n; i++){
+        if (ids[i] < 0 || ids[i] >= s_pool_used){ i2c_port_unlock(); return I2C_TXN_NONE; }
+        const i2c_txn_t *m = &s_pool[ids[i]];
+        if (t.nseg + m->nseg > I2C_BURST_MAX){ i2c_port_unlock(); return I2C_TXN_NONE; }
+        memcpy(&t.seg[t.nseg], m->seg, m->nseg * sizeof(i2c_seg_t));
+        t.nseg += m->nseg;
+    }
+    i2c_txn_id_t id = t.nseg ? pool_add(&t) : I2C_TXN_NONE;
+    i2c_port_unlock();
+    return id;
+}
+
+esp_err_t i2c_txn_run(i2c_txn_id_t id){
+    if (id < 0 || id >= s_pool_used) return ESP_ERR_INVALID_ARG;
+    i2c_txn_t *t = &s_pool[id];
+    i2c_port_lock();
+    PROF_START(PROF_I2C_XFER);
+    uint64_t t0 = tb_now_us();
+    esp_err_t r = i2c_port_exec(id, t, timeout_ms(t));
+    account(t->stats_slot, r, tb_now_us() - t0);
+    if (s_tap) tap(t0, t->seg, t->nseg, r);
+    PROF_STOP(PROF_I2C_XFER);
+    i2c_port_unlock();
+    return r;
+}
+
+static void run_deferred(void *arg){
+    i2c_txn_id_t id = (i2c_txn_id_t)(intptr_t)arg;
+    i2c_txn_t *t = &s_pool[id];
+    i2c_done_cb cb = t->cb;
+    void *cb_arg = t->cb_arg;
+    t->cb = NULL;
+    esp_err_t r = i2c_txn_run(id);
+    if (cb) cb(id, r, cb_arg);
+}
+
+esp_err_t i2c_txn_submit(i2c_txn_id_t id, i2c_done_cb cb, void *arg){
+    if (id < 0 || id >= s_pool_used) return ESP_ERR_INVALID_ARG;
+    i2c_txn_t *t = &s_pool[id];
+    if (t->cb) return ESP_ERR_INVALID_STATE;
+    t->cb = cb;
+    t->cb_arg = arg;
+    esp_err_t r = i2c_port_defer(run_deferred, (void *)(intptr_t)id);
+    if (r != ESP_OK) t->cb = NULL;
+    return r;
+}
+
+size_t i2c_bus_get_stats(i2c_dev_stats_t *out, size_t max){
+    size_t n = 0;
+    for (int i = 0; i < s_nstats && n < max; i++){
+        if (i == BURST_SLOT && !s_stats[i].xfers) continue;
+        out[n++] = s_stats[i];
+    }
+    return n;
+}
+
+void i2c_bus_reset_stats(void){
+    for (int i = 0; i < s_nstats; i++){
+        uint8_t addr = s_stats[i].addr;
+        memset(&s_stats[i], 0, sizeof(s_stats[i]));
+        s_stats[i].addr = addr;
+    }
+}
@@ -0,0 +1,119 @@
+#include "i2c_port.h"
+#include "board.h"
+#include "driver/i2c.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#define TAG "i2c"
+
+#define PORT I2C_NUM_0
+
+// Command links live in one static arena: each prepared transaction is built
+// once here and re-executed; one-off transfers reuse the scratch link.
+// A read segment takes 7 link entries (start, addr, reg, start, addr, read,
+// last read), a link 2 more for its header plus 1 for the stop.
+#define LINK_BYTES(nseg) (I2C_INTERNAL_STRUCT_SIZE * (3 + 7 * (nseg)))
+#define ARENA_SEGS 64
+#define ARENA_BYTES (I2C_TXN_POOL_SIZE * LINK_BYTES(0) + I2C_INTERNAL_STRUCT_SIZE * 7 * ARENA_SEGS)
+
+static uint8_t s_arena[ARENA_BYTES];
+static size_t s_arena_used;
+static i2c_cmd_handle_t s_links[I2C_TXN_POOL_SIZE];
+static uint8_t s_scratch[LINK_BYTES(1)];
+
+static SemaphoreHandle_t s_mutex;
+static QueueHandle_t s_queue;
+
+typedef struct { void (*fn)(void *); void *arg; } deferred_t;
+
+#define BUS_TASK_PRIO 6
+#define BUS_QUEUE_DEPTH I2C_TXN_POOL_SIZE
+
+static esp_err_t config(uint32_t hz){
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = I2C_SDA_GPIO,
+        .scl_io_num = I2C_SCL_GPIO,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = hz,
+    };
+    return i2c_param_config(PORT, &conf);
+}
+
+static void bus_task(void *arg){
+    deferred_t d;
+    for (;;){
+        if (xQueueReceive(s_queue, &d, portMAX_DELAY) == pdTRUE) d.fn(d.arg);
+    }
+}
+
+esp_err_t i2c_port_init(uint32_t hz){
+    esp_err_t r = config(hz);
+    if (r != ESP_OK) return r;
+    r = i2c_driver_install(PORT, I2C_MODE_MASTER, 0, 0, 0);
+    if (r != ESP_OK) return r;
+    s_mutex = xSemaphoreCreateMutex();
+    s_queue = xQueueCreate(BUS_QUEUE_DEPTH, sizeof(deferred_t));
+    if (!s_mutex || !s_queue) return ESP_ERR_NO_MEM;
+    if (xTaskCreate(bus_task, "i2c_bus", 3072, NULL, BUS_TASK_PRIO, NULL) != pdPASS) return ESP_ERR_NO_MEM;
+    return ESP_OK;
+}
+
+esp_err_t i2c_port_set_speed(uint32_t hz){ return config(hz); }
+
+static esp_err_t add_seg(i2c_cmd_handle_t cmd, const i2c_seg_t *s){
+    esp_err_t r = i2c_master_start(cmd);
+    if (r == ESP_OK) r = i2c_master_write_byte(cmd, (s->addr << 1) | I2C_MASTER_WRITE, true);
+    if (s->len == 0 && !s->read && !s->buf) return r;  // address-only probe
+    if (r == ESP_OK) r = i2c_master_write_byte(cmd, s->reg, true);
+    if (r != ESP_OK) return r;
+    if (!s->read) return s->len ? i2c_master_write(cmd, s->buf, s->len, true) : ESP_OK;
+    r = i2c_master_start(cmd);
+    if (r == ESP_OK) r = i2c_master_write_byte(cmd, (s->addr << 1) | I2C_MASTER_READ, true);
+    if (r == ESP_OK) r = i2c_master_read(cmd, s->buf, s->len, I2C_MASTER_LAST_NACK);
+    return r;
+}
+
+static esp_err_t build(i2c_cmd_handle_t cmd, const i2c_seg_t *seg, size_t n){
+    esp_err_t r = ESP_OK;
+    for (size_t i = 0; i < n && r == ESP_OK; i++) r = add_seg(cmd, &seg[i]);
+    return r == ESP_OK ? i2c_master_stop(cmd) : r;
+}
+
+esp_err_t i2c_port_build(i2c_txn_id_t id, const i2c_txn_t *t){
+    size_t need = LINK_BYTES(t->nseg);
+    if (s_arena_used + need > sizeof(s_arena)) return ESP_ERR_NO_MEM;
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(&s_arena[s_arena_used], need);
+    if (!cmd) return ESP_ERR_NO_MEM;
+    esp_err_t r = build(cmd, t->seg, t->nseg);
+    if (r != ESP_OK) return r;
+    s_arena_used += need;
+    s_links[id] = cmd;
+    return ESP_OK;
+}
+
+esp_err_t i2c_port_exec(i2c_txn_id_t id, const i2c_txn_t *t, uint32_t timeout_ms){
+    return i2c_master_cmd_begin(PORT, s_links[id], pdMS_TO_TICKS(timeout_ms) + 1);
+}
+
+esp_err_t i2c_port_xfer(const i2c_seg_t *seg, uint32_t timeout_ms){
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(s_scratch, sizeof(s_scratch));
+    if (!cmd) return ESP_ERR_NO_MEM;
+    esp_err_t r = build(cmd, seg, 1);
+    if (r == ESP_OK) r = i2c_master_cmd_begin(PORT, cmd, pdMS_TO_TICKS(timeout_ms) + 1);
+    i2c_cmd_link_delete_static(cmd);
+    return r;
+}
+
+void i2c_port_lock(void){ if (s_mutex) xSemaphoreTake(s_mutex, portMAX_DELAY); }
+void i2c_port_unlock(void){ if (s_mutex) xSemaphoreGive(s_mutex); }
+
+esp_err_t i2c_port_defer(void (*fn)(void *), void *arg){
+    deferred_t d = { fn, arg };
+    if (!s_queue) return ESP_ERR_INVALID_STATE;
+    return xQueueSend(s_queue, &d, 0) == pdTRUE ? ESP_OK : ESP_ERR_NO_MEM;
+}
@@ -0,0 +1,58 @@
+#include "i2cmux.h"
+#include "config.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "i2cmux";
+
+// The control register is the byte after the address; the part latches the
+// last byte written, so the prepared write sends it twice (register byte
+// and one data byte) and stays a normal i2c_bus write.
+static const uint8_t CTRL[I2CMUX_CHANNELS] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
+static i2c_txn_id_t s_txn_sel[I2CMUX_CHANNELS] = {
+    I2C_TXN_NONE, I2C_TXN_NONE, I2C_TXN_NONE, I2C_TXN_NONE,
+    I2C_TXN_NONE, I2C_TXN_NONE, I2C_TXN_NONE, I2C_TXN_NONE,
+};
+#define UNKNOWN 0xFE
+static uint8_t s_ch = UNKNOWN;
+static i2cmux_stats_t s_stats;
+
+esp_err_t i2cmux_init(void){
+    s_ch = UNKNOWN;
+    if (!i2c_bus_probe(FDC_MUX_ADDR)){
+        ESP_LOGE(TAG, "no mux at 0x%02x", FDC_MUX_ADDR);
+        return ESP_ERR_NOT_FOUND;
+    }
+    i2c_bus_add_device(FDC_MUX_ADDR, I2CMUX_I2C_MAX_HZ);
+    for (int c = 0; c < I2CMUX_CHANNELS; c++)
+        if (s_txn_sel[c] == I2C_TXN_NONE) s_txn_sel[c] = i2c_txn_prepare_write(FDC_MUX_ADDR, CTRL[c], &CTRL[c], 1);
+    return i2cmux_select(I2CMUX_NONE);
+}
+
+esp_err_t i2cmux_select(uint8_t ch){
+    s_stats.selects++;
+    if (ch == s_ch) return ESP_OK;
+    if (ch >= I2CMUX_CHANNELS && ch != I2CMUX_NONE) return ESP_ERR_INVALID_ARG;
+    s_stats.writes++;
+    esp_err_t r;
+    if (ch == I2CMUX_NONE){
+        uint8_t off = 0;
+        r = i2c_wr(FDC_MUX_ADDR, 0, &off, 1);
+    } else if (s_txn_sel[ch] != I2C_TXN_NONE){
+        r = i2c_txn_run(s_txn_sel[ch]);
+    } else {
+        r = i2c_wr(FDC_MUX_ADDR, CTRL[ch], &CTRL[ch], 1);
+    }
+    if (r != ESP_OK){
+        // the control register may or may not have taken it
+        s_stats.errors++;
+        s_ch = UNKNOWN;
+        return r;
+    }
+    s_ch = ch;
+    return ESP_OK;
+}
+
+uint8_t i2cmux_channel(void){ return s_ch == UNKNOWN ? I2CMUX_NONE : s_ch; }
+
+void i2cmux_get_stats(i2cmux_stats_t *out){ *out = s_stats; }
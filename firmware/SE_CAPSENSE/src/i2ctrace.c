@@ -0,0 +1,148 @@
+#include "i2ctrace.h"
+#include "i2c_bus.h"
+#include "timebase.h"
+#include <string.h>
+
+static size_t put_varint(uint8_t *p, uint64_t v){
+    size_t n = 0;
+    while (v >= 0x80){
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static bool get_varint(const uint8_t **p, const uint8_t *end, uint64_t *v){
+    uint64_t r = 0;
+    for (unsigned shift = 0; *p < end && shift < 64; shift += 7){
+        uint8_t b = *(*p)++;
+        r |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)){
+            *v = r;
+            return true;
+        }
+    }
+    return false;
+}
+
+esp_err_t i2ct_enc_init(i2ct_enc_t *e, void *buf, size_t cap, uint64_t t0_us){
+    if (cap < I2CT_HEADER_BYTES) return ESP_ERR_INVALID_SIZE;
+    e->buf = buf;
+    e->cap = cap;
+    e->count = 0;
+    e->prev_us = t0_us;
+    e->buf[0] = I2CT_MAGIC;
+    e->buf[1] = I2CT_VERSION;
+    e->buf[2] = e->buf[3] = 0;
+    for (int i = 0; i < 8; i++) e->buf[4 + i] = (uint8_t)(t0_us >> (8 * i));
+    e->len = I2CT_HEADER_BYTES;
+    return ESP_OK;
+}
+
+bool i2ct_enc_add(i2ct_enc_t *e, const i2ct_rec_t *r){
+    if (e->count == UINT16_MAX || r->t_us < e->prev_us) return false;
+    uint16_t n = r->read && r->status != I2CT_OK ? 0 : r->len;
+    if (e->cap - e->len < I2CT_RECORD_MAX(n)){
+        // the bound is loose; encode into a scratch copy of the fixed part
+        uint8_t tmp[16];
+        size_t k = put_varint(tmp, r->t_us - e->prev_us);
+        k += 3 + put_varint(tmp + k, n);
+        if (e->cap - e->len < k + n) return false;
+    }
+    uint8_t *p = e->buf + e->len;
+    p += put_varint(p, r->t_us - e->prev_us);
+    *p++ = (uint8_t)(r->addr << 1 | (r->read ? 1 : 0));
+    *p++ = r->reg;
+    *p++ = r->status;
+    p += put_varint(p, n);
+    if (n) memcpy(p, r->data, n);
+    e->len = (size_t)(p + n - e->buf);
+    e->prev_us = r->t_us;
+    e->count++;
+    e->buf[2] = (uint8_t)e->count;
+    e->buf[3] = (uint8_t)(e->count >> 8);
+    return true;
+}
+
+esp_err_t i2ct_dec_init(i2ct_dec_t *d, const void *buf, size_t len){
+    const uint8_t *b = buf;
+    memset(d, 0, sizeof(*d));
+    if (len < I2CT_HEADER_BYTES) return ESP_ERR_INVALID_SIZE;
+    if (b[0] != I2CT_MAGIC) return ESP_ERR_INVALID_ARG;
+    if (b[1] != I2CT_VERSION) return ESP_ERR_INVALID_VERSION;
+    d->start = b;
+    d->p = b + I2CT_HEADER_BYTES;
+    d->end = b + len;
+    d->count = d->left = (uint16_t)(b[2] | b[3] << 8);
+    for (int i = 7; i >= 0; i--) d->t_us = d->t_us << 8 | b[4 + i];
+    return ESP_OK;
+}
+
+esp_err_t i2ct_dec_next(i2ct_dec_t *d, i2ct_rec_t *out){
+    if (!d->left) return ESP_ERR_NOT_FOUND;
+    const uint8_t *p = d->p;
+    uint64_t dt, len;
+    if (!get_varint(&p, d->end, &dt) || d->end - p < 3) return ESP_ERR_INVALID_SIZE;
+    uint8_t a = p[0], reg = p[1], st = p[2];
+    p += 3;
+    if (!get_varint(&p, d->end, &len) || len > UINT16_MAX || (uint64_t)(d->end - p) < len) return ESP_ERR_INVALID_SIZE;
+    d->t_us += dt;
+    *out = (i2ct_rec_t){
+        .t_us = d->t_us, .addr = a >> 1, .reg = reg, .read = a & 1, .status = st,
+        .len = (uint16_t)len, .data = len ? p : NULL,
+    };
+    d->p = p + len;
+    d->left--;
+    return ESP_OK;
+}
+
+// Capture: the bus tap runs with the bus lock held, so one transfer at a
+// time.
+static i2ct_enc_t s_enc;
+static i2ct_sink_fn s_sink;
+static bool s_on;
+static i2ct_stats_t s_stats;
+
+static void tap(uint64_t t_us, uint8_t addr, uint8_t reg, bool read, const uint8_t *buf, size_t len, esp_err_t r){
+    i2ct_rec_t rec = {
+        .t_us = t_us, .addr = addr, .reg = reg, .read = read, .status = i2ct_status_of(r),
+        .len = (uint16_t)len, .data = buf,
+    };
+    if (i2ct_enc_add(&s_enc, &rec)){
+        s_stats.records++;
+        return;
+    }
+    if (s_sink && s_enc.count){
+        s_sink(s_enc.buf, s_enc.len);
+        s_stats.blocks++;
+        i2ct_enc_init(&s_enc, s_enc.buf, s_enc.cap, t_us);
+        if (i2ct_enc_add(&s_enc, &rec)){
+            s_stats.records++;
+            return;
+        }
+    }
+    s_stats.dropped++;
+}
+
+esp_err_t i2ct_capture_start(void *buf, size_t cap, i2ct_sink_fn sink){
+    if (!buf) return ESP_ERR_INVALID_ARG;
+    esp_err_t r = i2ct_enc_init(&s_enc, buf, cap, tb_now_us());
+    if (r != ESP_OK) return r;
+    s_sink = sink;
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_on = true;
+    i2c_bus_set_tap(tap);
+    return ESP_OK;
+}
+
+size_t i2ct_capture_stop(const void **block){
+    i2c_bus_set_tap(NULL);
+    s_on = false;
+    if (block) *block = s_enc.buf;
+    return s_enc.buf ? s_enc.len : 0;
+}
+
+bool i2ct_capturing(void){ return s_on; }
+
+void i2ct_get_stats(i2ct_stats_t *out){ *out = s_stats; }
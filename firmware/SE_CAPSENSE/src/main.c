@@ -2,7 +2,6 @@
 #include <stdbool.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "driver/i2c.h"
 #include "esp_err.h"
 #include "esp_log.h"
 #include "board.h"
@@ -10,52 +9,40 @@
 #include "timebase.h"
 #include "scheduler.h"
 #include "sampler.h"
-/* SD logging disabled for now while working on WiFi/MQTT
-#include "sd_logger.h" */
+#include "acq.h"
+#include "sd_logger.h"
+#include "drain.h"
+#include "forward.h"
 #include "uart_cli.h"
 #include "wifi_svc.h"
 #include "mqtt_svc.h"
 #include "i2c_bus.h"
 #include "bme280_drv.h"
+#include "trace.h"
+#include "stats.h"
+#include "i2ctrace.h"
 
 
-// ===== SET THESE TO YOUR PCB =====
-#define I2C_PORT        I2C_NUM_0
-#define I2C_SDA_GPIO    4       // <-- change
-#define I2C_SCL_GPIO    3       // <-- change
-#define I2C_FREQ_HZ     100000  // start slow; later 400000
-// =================================
-
-static void i2c_master_init(void)
-{
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = I2C_SDA_GPIO,
-        .scl_io_num = I2C_SCL_GPIO,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,  // OK even if you have external pullups
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = I2C_FREQ_HZ,
-        .clk_flags = 0,
-    };
-
-    ESP_ERROR_CHECK(i2c_param_config(I2C_PORT, &conf));
-    ESP_ERROR_CHECK(i2c_driver_install(I2C_PORT, conf.mode, 0, 0, 0));
-}
+static const char *TAG = "app";
 
-static bool i2c_probe(uint8_t addr)
-{
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (addr << 1) | 0, true); // write
-    i2c_master_stop(cmd);
+#ifndef PIO_UNIT_TESTING
+static int s_sampler_job = -1;
 
-    esp_err_t err = i2c_master_cmd_begin(I2C_PORT, cmd, pdMS_TO_TICKS(25));
-    i2c_cmd_link_delete(cmd);
+// sampler_job on the job loop, following its record period (adapt.h)
+static void sampler_loop_job(void){
+    sampler_job();
+    sch_set_period(s_sampler_job, SCH_MS(sampler_period_ms()));
+}
 
-    return (err == ESP_OK);
+// and a capacitance step records at once, as on the acquisition task
+static void sampler_loop_poll_job(void){
+    sampler_poll_job();
+    if (sampler_record_due()) sch_trigger(s_sampler_job);
 }
 
-static const char *TAG = "app";
+#if I2C_CAPTURE_BYTES
+static uint8_t s_i2c_capture[I2C_CAPTURE_BYTES];
+#endif
 
 void app_main(void)
 {
@@ -69,16 +56,17 @@ void app_main(void)
         while (1) vTaskDelay(pdMS_TO_TICKS(1000));
     }
 
+#if I2C_CAPTURE_BYTES
+    // bus traffic from here on, for host/tools/i2creplay ('i2c trace')
+    i2ct_capture_start(s_i2c_capture, sizeof(s_i2c_capture), NULL);
+#endif
+
     // Init BME sensor (log and continue if absent)
     r = bme_init();
     if (r != ESP_OK) {
         ESP_LOGW(TAG, "BME init failed: %d; continuing without BME", r);
     }
 
-    // SD logging temporarily disabled while debugging WiFi/MQTT
-    ESP_LOGI(TAG, "SD logging is disabled for this session");
-    (void)r; // keep variable referenced
-
     // Configure LED GPIOs (ensure pins configured even if SD init failed)
     gpio_reset_pin(LED_SENSE_GPIO);
     gpio_reset_pin(LED_SD_GPIO);
@@ -87,47 +75,69 @@ void app_main(void)
     gpio_set_level(LED_SENSE_GPIO, 0);
     gpio_set_level(LED_SD_GPIO, 0);
 
-    // Init other modules
+    // Jobs run on this task; it sleeps until the next one is due
+    sch_init();
+
+    // log lines deferred from the sampling path (trace.h)
+    sch_add("trace", trace_job_flush, SCH_MS(TRACE_FLUSH_PERIOD_MS), SCH_SKIP);
+
+    // Sampling starts now, whatever the state of Wi-Fi, on its own task so
+    // that nothing below can delay it; the ring is drained to the SD log
+    // and MQTT as they come up
     sampler_init();
+    if (acq_start() != ESP_OK) {
+        ESP_LOGW(TAG, "no acquisition task; sampling from the job loop");
+        sch_add("sampler_poll", sampler_loop_poll_job, SCH_MS(SAMPLE_POLL_MS), SCH_SKIP);
+        s_sampler_job = sch_add("sampler", sampler_loop_job, SCH_MS(sampler_period_ms()), SCH_SKIP);
+    }
+    drain_add_sink(sampler_log_sink);
+
+    // SD log (log and continue without it if there is no card)
+    r = sdlog_init();
+    if (r != ESP_OK) {
+        ESP_LOGW(TAG, "SD logging disabled: %d", r);
+    } else {
+        // frames are written when they fill or every SD_FLUSH_PERIOD_MS
+        drain_add_sink(sdlog_append);
+        sch_add("sdlog_flush", sdlog_job_flush, SCH_MS(RECORD_DRAIN_PERIOD_MS), SCH_SKIP);
+    }
+    // record ring -> SD log and MQTT queue, whichever of them are up
+    sch_add("drain", drain_job, SCH_MS(RECORD_DRAIN_PERIOD_MS), SCH_SKIP);
 
     // Start simple UART CLI so user can enter Wi‑Fi credentials if needed
     cli_init();
 
-    // Init Wi-Fi (but DO NOT start sensor sampling until we have connectivity)
+    // Wi-Fi connects (and reconnects) in the background; enter credentials
+    // via UART if none are stored
     r = wifi_svc_init();
     if (r != ESP_OK){
         ESP_LOGW(TAG, "wifi_svc_init failed: %d; continuing without Wi-Fi", r);
     } else {
         // schedule periodic Wi-Fi status reports every 10s
-        sch_add(wifi_svc_job_report, 10000);
-
-        // Wait for Wi‑Fi to connect (no timeout) — user must provide credentials via UART if none stored
-        ESP_LOGI(TAG, "Waiting for Wi‑Fi connection... (enter credentials via UART if needed)");
-        while (wifi_svc_wait_connected(15000) != ESP_OK){
-            ESP_LOGW(TAG, "Still waiting for Wi‑Fi connection...");
-            // continue looping until connected; user can use UART CLI to set credentials
-        }
+        sch_add("wifi_report", wifi_svc_job_report, SCH_MS(10000), SCH_SKIP);
+        // wall clock for the records' epoch_us; SNTP retries until the network is up
+        if (tb_sntp_start() != ESP_OK) ESP_LOGW(TAG, "SNTP did not start; records carry no epoch_us");
 
-        ESP_LOGI(TAG, "Wi‑Fi connected; initializing MQTT and starting sampling");
+        // the client keeps retrying until the network is up; meanwhile
+        // records that do not fit its queue stay in the SD log for replay
         if (mqtt_svc_init() != ESP_OK){
             ESP_LOGW(TAG, "mqtt_svc_init failed; MQTT disabled");
         } else {
-            // Schedule MQTT drain job if implementation available
-            sch_add(mqtt_svc_job_drain, MQTT_PUB_PERIOD_MS);
+            fwd_init();
+            drain_add_sink(fwd_append);
+            sch_add("fwd_replay", fwd_job_replay, SCH_MS(MQTT_PUB_PERIOD_MS), SCH_SKIP);
+            sch_add("mqtt", mqtt_svc_job_drain, SCH_MS(MQTT_PUB_PERIOD_MS), SCH_SKIP);
+            // ring, I2C, job and probe stats for the fleet dashboards
+            sch_add("stats", stats_job_publish, SCH_MS(STATS_PUB_PERIOD_MS), SCH_SKIP);
         }
-
-        // only start sampling after Wi‑Fi connected
-        sampler_init();
-        sch_add(sampler_job, 1000);
     }
 
-    // flush records to SD every 5s
-    // sd logging disabled; sch_add(sdlog_job_flush, 5000);
+    // per-job run counts, jitter and missed deadlines
+    sch_add("sched_report", sch_log_stats, SCH_MS(SCH_REPORT_PERIOD_MS), SCH_SKIP);
 
-    // main loop: run scheduler
+    // main loop: run what is due, sleep until the next deadline
     while (1) {
-        sch_run_due();
-        vTaskDelay(pdMS_TO_TICKS(10));
+        sch_wait_us(sch_run_due());
     }
 }
-
+#endif
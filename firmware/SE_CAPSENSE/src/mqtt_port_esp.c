@@ -0,0 +1,58 @@
+#include "mqtt_port.h"
+#include "config.h"
+#include "mqtt_client.h"
+#include "esp_log.h"
+
+#define TAG "mqtt"
+
+static esp_mqtt_client_handle_t s_client;
+static mqtt_port_cb_t s_cb;
+
+static void on_event(void *arg, esp_event_base_t base, int32_t id, void *data){
+    esp_mqtt_event_handle_t e = (esp_mqtt_event_handle_t)data;
+    switch ((esp_mqtt_event_id_t)id){
+    case MQTT_EVENT_CONNECTED:
+        s_cb(MQTT_PORT_CONNECTED, 0);
+        break;
+    case MQTT_EVENT_DISCONNECTED:
+        s_cb(MQTT_PORT_DISCONNECTED, 0);
+        break;
+    case MQTT_EVENT_PUBLISHED:
+        s_cb(MQTT_PORT_PUBACK, e->msg_id);
+        break;
+    case MQTT_EVENT_ERROR:
+        ESP_LOGW(TAG, "client error, type %d", e->error_handle ? (int)e->error_handle->error_type : -1);
+        break;
+    default:
+        break;
+    }
+}
+
+esp_err_t mqtt_port_start(const char *uri, const char *client_id, mqtt_port_cb_t cb){
+    s_cb = cb;
+    if (s_client) return ESP_OK;
+    esp_mqtt_client_config_t cfg = {
+        .broker.address.uri = uri,
+        .broker.address.port = MQTT_PORT,
+        .credentials.client_id = client_id,
+        // mqtt_svc republishes on its own ack timeout and after a reconnect;
+        // keep the client's outbox retry out of its way
+        .session.message_retransmit_timeout = MQTT_ACK_TIMEOUT_MS * 4,
+    };
+    s_client = esp_mqtt_client_init(&cfg);
+    if (!s_client) return ESP_ERR_NO_MEM;
+    esp_mqtt_client_register_event(s_client, ESP_EVENT_ANY_ID, on_event, NULL);
+    esp_err_t r = esp_mqtt_client_start(s_client);
+    if (r != ESP_OK){
+        esp_mqtt_client_destroy(s_client);
+        s_client = NULL;
+    }
+    return r;
+}
+
+int mqtt_port_publish(const char *topic, const void *data, size_t len, int qos){
+    if (!s_client) return -1;
+    // copied into the client's outbox and sent from its task
+    int id = esp_mqtt_client_enqueue(s_client, topic, (const char *)data, (int)len, qos, 0, true);
+    return id < 0 ? -1 : id;
+}
@@ -1,21 +1,288 @@
 #include "mqtt_svc.h"
+#include "mqtt_port.h"
 #include "config.h"
+#include "reccodec.h"
+#include "rectext.h"
+#include "tscodec.h"
+#include "timebase.h"
 #include "esp_log.h"
-
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
 
 static const char *TAG = "mqtt";
 
+_Static_assert((MQTT_QUEUE_DEPTH & (MQTT_QUEUE_DEPTH - 1)) == 0, "MQTT_QUEUE_DEPTH must be a power of two");
+_Static_assert(MQTT_QUEUE_DEPTH >= MQTT_INFLIGHT_MAX * MQTT_BATCH_RECORDS, "MQTT_QUEUE_DEPTH cannot hold the in-flight window");
+_Static_assert(sizeof(MQTT_CLIENT_ID) <= 40, "MQTT_CLIENT_ID too long for the payload header");
+
+#define QMASK (MQTT_QUEUE_DEPTH - 1)
+#define HDR_JSON_MAX 96     // {"dev":"...","seq":4294967295,"recs":[ ... ]}
+#define PAYLOAD_MAX (HDR_JSON_MAX + MQTT_BATCH_RECORDS * RT_RECORD_MAX)
+
+_Static_assert(PAYLOAD_MAX >= 4 + RC_HEADER_MAX + MQTT_BATCH_RECORDS * RC_RECORD_MAX, "binary batch exceeds the payload buffer");
+_Static_assert(PAYLOAD_MAX >= 4 + TSC_HEADER_BYTES + MQTT_BATCH_RECORDS * TSC_RECORD_MAX, "compressed batch exceeds the payload buffer");
+#define ACKQ 16             // PUBACKs between drain runs (power of two)
+
+_Static_assert(ACKQ > MQTT_INFLIGHT_MAX, "ACKQ must cover the in-flight window");
+
+typedef struct {
+    uint32_t first;      // queue index of the first record
+    uint16_t count;
+    bool acked;
+    uint32_t seq;
+    int msg_id;          // id of the latest transmission
+    int prev_id;         // and of the one before, whose PUBACK may still come
+    uint64_t first_us;   // first transmission
+    uint64_t sent_us;    // latest transmission
+} msg_t;
+
+// Queue of records: [tail, sent) are in messages awaiting PUBACK,
+// [sent, head) wait for a message. Indices run freely.
+static sample_t s_q[MQTT_QUEUE_DEPTH];
+static uint32_t s_q_tail, s_q_sent, s_q_head;
+static uint32_t s_q_ms[MQTT_QUEUE_DEPTH];   // tb_now_ms() when each record was queued
+
+// In-flight window, in publish order.
+static msg_t s_win[MQTT_INFLIGHT_MAX];
+static uint32_t s_w_tail, s_w_head;
+
+static char s_topic[64];
+static mqtt_fmt_t s_fmt = MQTT_PAYLOAD_FMT;
+static char s_payload[PAYLOAD_MAX];
+static uint32_t s_seq;
+static uint16_t s_batch = MQTT_BATCH_RECORDS;
+static bool s_started;
+static uint32_t s_seen_gen;
+static mqtt_stats_t s_stats;
+
+// Written by the port callback (client task), read by the drain job.
+static _Atomic bool s_connected;
+static _Atomic uint32_t s_conn_gen;   // bumped on every (re)connect
+static int s_ackq[ACKQ];
+static _Atomic uint32_t s_ack_head, s_ack_tail;
+
+static void on_event(mqtt_port_event_t ev, int msg_id){
+    switch (ev){
+    case MQTT_PORT_CONNECTED:
+        atomic_store_explicit(&s_conn_gen, atomic_load_explicit(&s_conn_gen, memory_order_relaxed) + 1,
+                              memory_order_relaxed);
+        atomic_store_explicit(&s_connected, true, memory_order_release);
+        break;
+    case MQTT_PORT_DISCONNECTED:
+        atomic_store_explicit(&s_connected, false, memory_order_release);
+        break;
+    case MQTT_PORT_PUBACK: {
+        // a full queue loses the ack; the message is then republished on timeout
+        uint32_t h = atomic_load_explicit(&s_ack_head, memory_order_relaxed);
+        if (h - atomic_load_explicit(&s_ack_tail, memory_order_acquire) == ACKQ) break;
+        s_ackq[h & (ACKQ - 1)] = msg_id;
+        atomic_store_explicit(&s_ack_head, h + 1, memory_order_release);
+        break;
+    }
+    }
+}
+
+static void stat_inflight(void){
+    uint8_t n = 0;
+    for (uint32_t w = s_w_tail; w != s_w_head; w++) n += !s_win[w % MQTT_INFLIGHT_MAX].acked;
+    s_stats.inflight = n;
+    if (s_stats.inflight > s_stats.inflight_max) s_stats.inflight_max = s_stats.inflight;
+}
 
 esp_err_t mqtt_svc_init(void){
-ESP_LOGI(TAG, "MQTT init (stub) broker=%s", MQTT_BROKER_URI);
-return ESP_OK;
+    mqtt_svc_set_format(s_fmt);
+    s_q_tail = s_q_sent = s_q_head = 0;
+    s_w_tail = s_w_head = 0;
+    s_seq = 0;
+    s_seen_gen = 0;
+    atomic_store(&s_connected, false);
+    atomic_store(&s_conn_gen, 0);
+    atomic_store(&s_ack_head, 0);
+    atomic_store(&s_ack_tail, 0);
+    s_started = false;
+    esp_err_t r = mqtt_port_start(MQTT_BROKER_URI, MQTT_CLIENT_ID, on_event);
+    if (r != ESP_OK){
+        ESP_LOGE(TAG, "MQTT client start failed: %d", r);
+        return r;
+    }
+    s_started = true;
+    ESP_LOGI(TAG, "publishing to %s on %s: %u records per message, %u in flight, QoS %d",
+             s_topic, MQTT_BROKER_URI, (unsigned)s_batch, (unsigned)MQTT_INFLIGHT_MAX, MQTT_QOS);
+    return ESP_OK;
+}
+
+bool mqtt_svc_is_connected(void){ return atomic_load_explicit(&s_connected, memory_order_acquire); }
+
+size_t mqtt_svc_append(const sample_t *s, size_t n){
+    if (!s_started) return 0;
+    uint32_t room = MQTT_QUEUE_DEPTH - (s_q_head - s_q_tail);
+    size_t k = n < room ? n : room;
+    if (k < n) s_stats.stalls++;
+    uint32_t now_ms = (uint32_t)tb_now_ms();
+    for (size_t i = 0; i < k; i++){
+        s_q[(s_q_head + i) & QMASK] = s[i];
+        s_q_ms[(s_q_head + i) & QMASK] = now_ms;
+    }
+    s_q_head += (uint32_t)k;
+    s_stats.accepted += (uint32_t)k;
+    return k;
+}
+
+bool mqtt_svc_enqueue(const sample_t *s){ return mqtt_svc_append(s, 1) == 1; }
+
+size_t mqtt_svc_room(void){ return s_started ? MQTT_QUEUE_DEPTH - (s_q_head - s_q_tail) : 0; }
+
+void mqtt_svc_set_batch(uint16_t records){
+    if (records < 1) records = 1;
+    if (records > MQTT_BATCH_RECORDS) records = MQTT_BATCH_RECORDS;
+    s_batch = records;
+}
+
+void mqtt_svc_set_format(mqtt_fmt_t fmt){
+    s_fmt = fmt;
+    static const char *const sub[] = { "data", "rec", "tsc", "units" };
+    snprintf(s_topic, sizeof(s_topic), "%s/%s", MQTT_BASE_TOPIC, sub[fmt]);
+}
+
+static size_t encode_bin(const msg_t *m){
+    for (int i = 0; i < 4; i++) s_payload[i] = (char)(m->seq >> (8 * i));
+    if (s_fmt == MQTT_FMT_TSC){
+        tsc_enc_t e;
+        tsc_enc_init(&e, s_payload + 4, PAYLOAD_MAX - 4, SAMPLE_PERIOD_MS);
+        for (uint16_t i = 0; i < m->count; i++) tsc_enc_add(&e, &s_q[(m->first + i) & QMASK]);
+        return 4 + tsc_enc_len(&e);
+    }
+    rc_enc_t e;
+    rc_enc_init(&e, s_payload + 4, PAYLOAD_MAX - 4, SAMPLE_PERIOD_MS);
+    for (uint16_t i = 0; i < m->count; i++) rc_enc_add(&e, &s_q[(m->first + i) & QMASK]);
+    return 4 + rc_enc_len(&e);
+}
+
+static size_t encode(const msg_t *m){
+    if (s_fmt == MQTT_FMT_BIN || s_fmt == MQTT_FMT_TSC) return encode_bin(m);
+    static const char head[] = "{\"dev\":\"" MQTT_CLIENT_ID "\",\"seq\":";
+    memcpy(s_payload, head, sizeof(head) - 1);
+    char *p = rt_put_u64(s_payload + sizeof(head) - 1, m->seq);
+    memcpy(p, ",\"recs\":[", 9);
+    p += 9;
+    rt_enc_t e;
+    rt_enc_init(&e, p, (size_t)(s_payload + PAYLOAD_MAX - 2 - p), s_fmt == MQTT_FMT_UNITS ? RT_JSON : RT_JSON_CODES);
+    for (uint16_t i = 0; i < m->count; i++) rt_enc_add(&e, &s_q[(m->first + i) & QMASK]);
+    p += rt_enc_len(&e);
+    memcpy(p, "]}", 2);
+    return (size_t)(p + 2 - s_payload);
+}
+
+static bool transmit(msg_t *m, uint64_t now_us){
+    size_t len = encode(m);
+    int id = mqtt_port_publish(s_topic, s_payload, len, MQTT_QOS);
+    if (id < 0){
+        s_stats.publish_errors++;
+        return false;
+    }
+    m->prev_id = m->msg_id;
+    m->msg_id = id;
+    m->sent_us = now_us;
+    s_stats.bytes += len;
+    return true;
 }
 
+static void acked(msg_t *m, uint64_t now_us){
+    m->acked = true;
+    uint32_t us = (uint32_t)(now_us - m->first_us);
+    if (!s_stats.acks || us < s_stats.lat_min_us) s_stats.lat_min_us = us;
+    if (us > s_stats.lat_max_us) s_stats.lat_max_us = us;
+    s_stats.lat_total_us += us;
+    s_stats.acks++;
+    for (uint16_t i = 0; i < m->count; i++){
+        const sample_t *s = &s_q[(m->first + i) & QMASK];
+        if (!s->t_us) continue;
+        uint64_t age = now_us > s->t_us ? now_us - s->t_us : 0;
+        if (age > s_stats.age_max_us) s_stats.age_max_us = age > UINT32_MAX ? UINT32_MAX : (uint32_t)age;
+        s_stats.age_total_us += age;
+        s_stats.age_records++;
+    }
+}
 
-bool mqtt_svc_is_connected(void){ return false; }
+static void take_acks(uint64_t now_us){
+    uint32_t t = atomic_load_explicit(&s_ack_tail, memory_order_relaxed);
+    uint32_t h = atomic_load_explicit(&s_ack_head, memory_order_acquire);
+    for (; t != h; t++){
+        int id = s_ackq[t & (ACKQ - 1)];
+        for (uint32_t w = s_w_tail; w != s_w_head; w++){
+            msg_t *m = &s_win[w % MQTT_INFLIGHT_MAX];
+            if (!m->acked && (m->msg_id == id || m->prev_id == id)){
+                acked(m, now_us);
+                break;
+            }
+        }
+    }
+    atomic_store_explicit(&s_ack_tail, t, memory_order_release);
 
+    // release acknowledged messages from the front of the window
+    while (s_w_tail != s_w_head && s_win[s_w_tail % MQTT_INFLIGHT_MAX].acked){
+        const msg_t *m = &s_win[s_w_tail % MQTT_INFLIGHT_MAX];
+        s_q_tail = m->first + m->count;
+        s_w_tail++;
+    }
+}
 
-bool mqtt_svc_enqueue(const sample_t *s){ (void)s; return true; }
+void mqtt_svc_job_drain(void){
+    if (!s_started) return;
+    uint64_t now_us = tb_now_us();
+    take_acks(now_us);
+    if (!mqtt_svc_is_connected()){
+        stat_inflight();
+        return;
+    }
 
+    // republish what the broker has not acknowledged: everything after a
+    // reconnect, otherwise what has timed out
+    uint32_t gen = atomic_load_explicit(&s_conn_gen, memory_order_relaxed);
+    bool reconnected = gen != s_seen_gen;
+    s_seen_gen = gen;
+    for (uint32_t w = s_w_tail; w != s_w_head; w++){
+        msg_t *m = &s_win[w % MQTT_INFLIGHT_MAX];
+        if (m->acked) continue;
+        if (!reconnected && now_us - m->sent_us < (uint64_t)MQTT_ACK_TIMEOUT_MS * 1000u) continue;
+        if (!transmit(m, now_us)) break;
+        s_stats.retransmits++;
+    }
+
+    // new batches while the window has room
+    while (s_w_head - s_w_tail < MQTT_INFLIGHT_MAX){
+        uint32_t unsent = s_q_head - s_q_sent;
+        if (!unsent) break;
+        if (unsent < s_batch && (uint32_t)tb_now_ms() - s_q_ms[s_q_sent & QMASK] < MQTT_BATCH_MAX_AGE_MS) break;
+        msg_t *m = &s_win[s_w_head % MQTT_INFLIGHT_MAX];
+        *m = (msg_t){
+            .first = s_q_sent, .count = (uint16_t)(unsent < s_batch ? unsent : s_batch),
+            .seq = s_seq, .msg_id = -1, .prev_id = -1, .first_us = now_us,
+        };
+        if (!transmit(m, now_us)) break;
+        s_seq++;
+        s_w_head++;
+        s_q_sent += m->count;
+        s_stats.msgs++;
+        s_stats.records_sent += m->count;
+        if (m->count > s_stats.batch_max) s_stats.batch_max = m->count;
+        if (MQTT_QOS == 0) acked(m, now_us);
+    }
+    if (MQTT_QOS == 0) take_acks(now_us);
+    stat_inflight();
+}
 
-void mqtt_svc_job_drain(void){ /* TODO */ }
\ No newline at end of file
+esp_err_t mqtt_svc_publish(const char *subtopic, const void *payload, size_t len){
+    if (!s_started || !mqtt_svc_is_connected()) return ESP_ERR_INVALID_STATE;
+    char topic[sizeof(s_topic)];
+    snprintf(topic, sizeof(topic), "%s/%s", MQTT_BASE_TOPIC, subtopic);
+    return mqtt_port_publish(topic, payload, len, 0) < 0 ? ESP_FAIL : ESP_OK;
+}
+
+void mqtt_svc_get_stats(mqtt_stats_t *out){ *out = s_stats; }
+
+void mqtt_svc_reset_stats(void){
+    memset(&s_stats, 0, sizeof(s_stats));
+    stat_inflight();
+}
@@ -0,0 +1,255 @@
+#include "pcap04.h"
+#include "i2c_bus.h"
+#include "i2cmux.h"
+#include "esp_log.h"
+#include "trace.h"
+#include "config.h"
+#include "timebase.h"
+#include <string.h>
+
+// Opcodes: the I2C register byte carries the command.
+#define OP_WR_CONFIG 0xA3   // then 0xC0 | address and the data, auto-incrementing
+#define OP_RD_RESULT 0x40   // | address, auto-incrementing
+#define OP_TEST_READ 0x7E
+#define OP_POR 0x88
+#define OP_INIT 0x8A
+#define OP_CDC_START 0x8C
+
+#define TEST_BYTE 0x11
+
+// Configuration registers written (CFG0..CFG47, the rest left as shipped)
+#define CFG_CREF 5          // C_REF_SEL: internal reference, pF
+#define CFG_PORT_EN 6       // C_PORT_EN: PC0..PC5
+#define CFG_AVRG 7          // C_AVRG, 13 bits LE over 7..8
+#define CFG_CONV_TIME 9     // CONV_TIME, 23 bits LE over 9..11, in PCAP_OLF_US
+#define CFG_TRIG 13         // C_TRIG_SEL
+#define CFG_RUN 47          // RUNBIT
+#define CFG_BYTES 48
+#define TRIG_TIMER 2
+
+// Result RAM
+#define RES0 0              // RES0..RES7, u32 LE, C/Cref in Q5.27
+#define RES_STATUS0 32
+#define STAT0_EOC 0x08      // a sequence ended; cleared by reading STATUS_0
+
+#define PORTS_MASK ((1u << PCAP_NUM_MEAS) - 1u)
+#define RAW_MAX 8388607     // the FDC1004's 24-bit scale (16 pF)
+
+static const char *TAG = "pcap";
+
+typedef struct {
+    uint8_t cfg[CFG_BYTES];
+    uint32_t rate_hz;
+    uint16_t avrg;
+    int32_t latest[PCAP_NUM_MEAS];
+    capfe_stats_t stats;
+} pcap_dev_t;
+
+static pcap_dev_t s_devs[FDC_DEVICES];
+static pcap_dev_t *s_dev = &s_devs[0];
+static uint8_t s_sel;
+
+static uint8_t s_stat_buf[1];
+static uint8_t s_res_buf[4 * PCAP_NUM_MEAS];
+static i2c_txn_id_t s_txn_status = I2C_TXN_NONE;
+static i2c_txn_id_t s_txn_results = I2C_TXN_NONE;
+
+esp_err_t pcap_select(uint8_t dev){
+    if (dev >= FDC_DEVICES) return ESP_ERR_INVALID_ARG;
+    s_sel = dev;
+    s_dev = &s_devs[dev];
+    return ESP_OK;
+}
+
+esp_err_t pcap_route(void){
+#if FDC_DEVICES > 1
+    return i2cmux_select(s_sel);
+#else
+    return ESP_OK;
+#endif
+}
+
+static esp_err_t count(esp_err_t r){
+    if (r != ESP_OK) s_dev->stats.errors++;
+    return r;
+}
+
+static esp_err_t cmd(uint8_t op){
+    esp_err_t r = pcap_route();
+    if (r == ESP_OK) r = i2c_cmd(PCAP04_I2C_ADDR, op);
+    return count(r);
+}
+
+static esp_err_t rd(uint8_t op, uint8_t *buf, size_t len){
+    esp_err_t r = pcap_route();
+    if (r == ESP_OK) r = i2c_rd(PCAP04_I2C_ADDR, op, buf, len);
+    return count(r);
+}
+
+static esp_err_t run(i2c_txn_id_t id, uint8_t op, uint8_t *buf, size_t len){
+    if (id == I2C_TXN_NONE) return rd(op, buf, len);
+    esp_err_t r = pcap_route();
+    if (r == ESP_OK) r = i2c_txn_run(id);
+    return count(r);
+}
+
+static esp_err_t write_cfg(uint8_t first, uint8_t n){
+    uint8_t b[1 + CFG_BYTES];
+    b[0] = (uint8_t)(0xC0 | first);
+    memcpy(&b[1], &s_dev->cfg[first], n);
+    esp_err_t r = pcap_route();
+    if (r == ESP_OK) r = i2c_wr(PCAP04_I2C_ADDR, OP_WR_CONFIG, b, 1u + n);
+    return count(r);
+}
+
+esp_err_t pcap_init(void){
+    uint8_t id;
+    if (rd(OP_TEST_READ, &id, 1) != ESP_OK) return ESP_FAIL;
+    if (id != TEST_BYTE){
+        ESP_LOGE(TAG, "test byte 0x%02X, not a PCAP04", id);
+        return ESP_ERR_NOT_FOUND;
+    }
+    i2c_bus_add_device(PCAP04_I2C_ADDR, PCAP04_I2C_MAX_HZ);
+    if (s_txn_results == I2C_TXN_NONE){
+        s_txn_status = i2c_txn_prepare_read(PCAP04_I2C_ADDR, OP_RD_RESULT | RES_STATUS0, s_stat_buf, 1);
+        s_txn_results = i2c_txn_prepare_read(PCAP04_I2C_ADDR, OP_RD_RESULT | RES0, s_res_buf, sizeof(s_res_buf));
+    }
+    memset(s_dev->cfg, 0, sizeof(s_dev->cfg));
+    return cmd(OP_POR);
+}
+
+esp_err_t pcap_configure(uint32_t rate_hz, uint16_t range_pf){
+    if (!rate_hz) rate_hz = PCAP_RATE_HZ;
+    if (!range_pf) range_pf = PCAP_RANGE_PF;
+    if (rate_hz > 1000000u / PCAP_OLF_US || range_pf > PCAP_CREF_MAX_PF) return ESP_ERR_INVALID_ARG;
+
+    // the sequence timer sets the rate; average as many conversions of the
+    // four ports as fit in one period
+    uint32_t ticks = 1000000u / PCAP_OLF_US / rate_hz;
+    if (ticks > 0x7FFFFF) ticks = 0x7FFFFF;
+    uint32_t avrg = ticks * PCAP_OLF_US / (PCAP_CONV_US * PCAP_NUM_MEAS);
+    if (avrg < 1) avrg = 1;
+    if (avrg > PCAP_AVRG_MAX) avrg = PCAP_AVRG_MAX;
+
+    // stop first so no sequence runs with a half-written configuration
+    esp_err_t r = pcap_stop();
+    if (r != ESP_OK) return r;
+    uint8_t *c = s_dev->cfg;
+    c[CFG_CREF] = (uint8_t)range_pf;
+    c[CFG_PORT_EN] = PORTS_MASK;
+    c[CFG_AVRG] = (uint8_t)avrg;
+    c[CFG_AVRG + 1] = (uint8_t)(avrg >> 8);
+    c[CFG_CONV_TIME] = (uint8_t)ticks;
+    c[CFG_CONV_TIME + 1] = (uint8_t)(ticks >> 8);
+    c[CFG_CONV_TIME + 2] = (uint8_t)(ticks >> 16);
+    c[CFG_TRIG] = TRIG_TIMER;
+    if ((r = write_cfg(0, CFG_RUN)) != ESP_OK){ ESP_LOGE(TAG, "config write failed: %d", r); return r; }
+
+    s_dev->rate_hz = 1000000u / (ticks * PCAP_OLF_US);
+    s_dev->avrg = (uint16_t)avrg;
+    memset(s_dev->latest, 0, sizeof(s_dev->latest));
+    ESP_LOGI(TAG, "4x grounded, %u sets/s of %u conversions, Cref %u pF",
+             (unsigned)s_dev->rate_hz, (unsigned)avrg, (unsigned)range_pf);
+    return pcap_start();
+}
+
+uint32_t pcap_rate_hz(void){ return s_dev->rate_hz; }
+uint16_t pcap_averaging(void){ return s_dev->avrg; }
+
+esp_err_t pcap_start(void){
+    s_dev->cfg[CFG_RUN] = 1;
+    esp_err_t r = write_cfg(CFG_RUN, 1);
+    if (r == ESP_OK) r = cmd(OP_INIT);
+    if (r == ESP_OK) r = cmd(OP_CDC_START);
+    return r;
+}
+
+esp_err_t pcap_stop(void){
+    s_dev->cfg[CFG_RUN] = 0;
+    return write_cfg(CFG_RUN, 1);
+}
+
+esp_err_t pcap_ready(uint8_t *mask){
+    *mask = 0;
+    esp_err_t r = run(s_txn_status, OP_RD_RESULT | RES_STATUS0, s_stat_buf, 1);
+    if (r != ESP_OK) return r;
+    s_dev->stats.polls++;
+    if (s_stat_buf[0] & STAT0_EOC) *mask = PORTS_MASK;
+    else s_dev->stats.idle_polls++;
+    return ESP_OK;
+}
+
+// Q5.27 ratio times Cref in pF, to 2^19 codes per pF.
+static int32_t res_raw(int m, bool *sat){
+    const uint8_t *b = &s_res_buf[4 * m];
+    uint32_t v = (uint32_t)b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+    uint64_t codes = ((uint64_t)v * s_dev->cfg[CFG_CREF]) >> 8;
+    if (codes > RAW_MAX){
+        *sat = true;
+        return RAW_MAX;
+    }
+    return (int32_t)codes;
+}
+
+void pcap_results_raw(int32_t out_raw[4], bool *saturated){
+    bool sat = false;
+    for (int m = 0; m < PCAP_NUM_MEAS; m++) out_raw[m] = s_dev->latest[m] = res_raw(m, &sat);
+    if (saturated) *saturated = sat;
+}
+
+esp_err_t pcap_read_done(uint8_t mask, capfe_result_t *out, size_t *n){
+    *n = 0;
+    if (!(mask & PORTS_MASK)) return ESP_OK;
+    esp_err_t r = run(s_txn_results, OP_RD_RESULT | RES0, s_res_buf, sizeof(s_res_buf));
+    if (r != ESP_OK) return r;
+    uint64_t t = tb_now_us();
+    for (int m = 0; m < PCAP_NUM_MEAS; m++){
+        bool sat = false;
+        s_dev->latest[m] = res_raw(m, &sat);
+        if (mask & (1u << m))
+            out[(*n)++] = (capfe_result_t){ .t_us = t, .raw = s_dev->latest[m], .meas = (uint8_t)m, .saturated = sat };
+    }
+    s_dev->stats.results += (uint32_t)*n;
+    return ESP_OK;
+}
+
+esp_err_t pcap_read_raw(int32_t out_raw[4], bool *saturated){
+    esp_err_t r = run(s_txn_results, OP_RD_RESULT | RES0, s_res_buf, sizeof(s_res_buf));
+    if (r != ESP_OK){
+        TRACE_W(TAG, "pcap_read: failed to read results");
+        for (int i = 0; i < 4; i++) out_raw[i] = 0;
+        if (saturated) *saturated = false;
+        return ESP_FAIL;
+    }
+    pcap_results_raw(out_raw, saturated);
+    return ESP_OK;
+}
+
+i2c_txn_id_t pcap_results_txn(void){ return s_txn_results; }
+
+void pcap_get_stats(capfe_stats_t *out){ *out = s_dev->stats; }
+
+static const capfe_caps_t FE_CAPS = {
+    .name = "PCAP04", .rate_max_hz = 1000000u / PCAP_OLF_US, .range_pf = 16,
+    .conv_us = PCAP_CONV_US, .offset = false, .averaging = true,
+};
+
+static uint8_t fe_capdac(uint8_t meas){ return 0; }
+
+const capfe_t capfe_pcap04 = {
+    .caps = &FE_CAPS,
+    .select = pcap_select,
+    .route = pcap_route,
+    .init = pcap_init,
+    .configure = pcap_configure,
+    .rate_hz = pcap_rate_hz,
+    .start = pcap_start,
+    .stop = pcap_stop,
+    .ready = pcap_ready,
+    .read_batch = pcap_read_done,
+    .read_latest = pcap_read_raw,
+    .latest_txn = pcap_results_txn,
+    .latest_decode = pcap_results_raw,
+    .capdac = fe_capdac,
+    .get_stats = pcap_get_stats,
+};
@@ -0,0 +1,47 @@
+#include "prof.h"
+#include <string.h>
+
+static prof_probe_t s_probe[PROF_COUNT];
+
+static const char *const s_name[PROF_COUNT] = {
+    [PROF_SAMPLER_JOB] = "sampler_job",
+    [PROF_SAMPLER_POLL] = "sampler_poll",
+    [PROF_I2C_XFER] = "i2c_xfer",
+    [PROF_BME_READ] = "bme_read",
+    [PROF_SCH_LOOP] = "sch_loop",
+};
+
+void prof_record(prof_id_t id, uint32_t cycles){
+    if ((unsigned)id >= PROF_COUNT) return;
+    prof_probe_t *p = &s_probe[id];
+    p->count++;
+    p->total += cycles;
+    if (cycles > p->max) p->max = cycles;
+    unsigned b = cycles ? 32u - (unsigned)__builtin_clz(cycles) : 0;
+    p->hist[b < PROF_BUCKETS ? b : PROF_BUCKETS - 1]++;
+}
+
+const char *prof_name(prof_id_t id){ return (unsigned)id < PROF_COUNT ? s_name[id] : "?"; }
+
+void prof_get(prof_id_t id, prof_probe_t *out){
+    if ((unsigned)id < PROF_COUNT) *out = s_probe[id];
+    else memset(out, 0, sizeof(*out));
+}
+
+void prof_reset(void){ memset(s_probe, 0, sizeof(s_probe)); }
+
+uint32_t prof_percentile(const prof_probe_t *p, unsigned pct){
+    if (!p->count) return 0;
+    if (pct > 100) pct = 100;
+    // rank of the percentile, 1-based, rounded up
+    uint64_t rank = ((uint64_t)p->count * pct + 99) / 100, seen = 0;
+    if (!rank) rank = 1;
+    for (unsigned b = 0; b < PROF_BUCKETS; b++){
+        seen += p->hist[b];
+        if (seen < rank) continue;
+        if (b == PROF_BUCKETS - 1) return p->max;
+        uint32_t hi = b ? (1u << b) - 1 : 0;
+        return hi < p->max ? hi : p->max;
+    }
+    return p->max;
+}
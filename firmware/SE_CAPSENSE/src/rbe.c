@@ -0,0 +1,68 @@
+#include "rbe.h"
+#include "config.h"
+#include "wmc.h"
+#include <string.h>
+
+static int64_t chan(const sample_t *s, int c){
+    switch (c){
+    case 0: case 1: case 2: case 3: return s->cap_raw[c];
+    case 4: return s->temp_cdeg;
+    case 5: return s->hum_q10;
+    case 6: return s->pres_q8;
+    default: return s->mc_cpct;
+    }
+}
+
+void rbe_default_cfg(rbe_cfg_t *cfg){
+    static const int32_t ABS[RBE_CHANNELS] = { RBE_CAP_ABS, RBE_CAP_ABS, RBE_CAP_ABS, RBE_CAP_ABS,
+                                               RBE_TEMP_ABS, RBE_HUM_ABS, RBE_PRES_ABS, RBE_MC_ABS };
+    memcpy(cfg->abs, ABS, sizeof(ABS));
+    for (int c = 0; c < RBE_CHANNELS; c++) cfg->rel_permille[c] = RBE_REL_PERMILLE;
+    cfg->heartbeat_ms = RBE_HEARTBEAT_MS;
+}
+
+void rbe_init(rbe_t *r, const rbe_cfg_t *cfg){
+    memset(r, 0, sizeof(*r));
+    r->cfg = *cfg;
+}
+
+// v moved past setting c's deadband from ref.
+static bool moved(const rbe_cfg_t *cfg, int c, int64_t ref, int64_t v){
+    int64_t d = v - ref;
+    if (d < 0) d = -d;
+    if (ref < 0) ref = -ref;
+    int64_t band = ref * cfg->rel_permille[c] / 1000;
+    if (band < cfg->abs[c]) band = cfg->abs[c];
+    return d > band;
+}
+
+uint16_t rbe_test(const rbe_t *r, const sample_t *s){
+    if (!r->primed) return 1u << RBE_FIRST;
+    const sample_t *p = &r->last;
+    uint16_t why = 0;
+    if (r->cfg.heartbeat_ms && s->t_ms - p->t_ms >= r->cfg.heartbeat_ms) why |= 1u << RBE_HEARTBEAT;
+    if (s->flags != p->flags || memcmp(s->capdac, p->capdac, sizeof(s->capdac))) why |= 1u << RBE_FLAGS;
+    for (int c = 0; c < RBE_CHANNELS; c++){
+        if (r->cfg.abs[c] == RBE_IGNORE) continue;
+        if (c == 7 && (s->mc_cpct == WMC_INVALID) != (p->mc_cpct == WMC_INVALID)){
+            why |= 1u << c;   // an estimate appeared or went away
+            continue;
+        }
+        if (moved(&r->cfg, c, chan(p, c), chan(s, c))) why |= 1u << c;
+    }
+    // the other FDC1004s' channels, under the same measurement on the first
+    for (int c = 4; c < SAMPLE_CAPS; c++)
+        if (r->cfg.abs[c % 4] != RBE_IGNORE && moved(&r->cfg, c % 4, p->cap_raw[c], s->cap_raw[c]))
+            why |= 1u << (c % 4);
+    return why;
+}
+
+void rbe_note(rbe_t *r, const sample_t *s, uint16_t why){
+    r->stats.offered++;
+    if (!why) return;
+    r->stats.published++;
+    for (int b = 0; b < RBE_WHY_BITS; b++)
+        if (why & (1u << b)) r->stats.why[b]++;
+    r->last = *s;
+    r->primed = true;
+}
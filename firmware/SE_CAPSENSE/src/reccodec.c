@@ -0,0 +1,210 @@
+#include "reccodec.h"
+#include "wmc.h"
+#include <string.h>
+
+#define CHANS (4 + SAMPLE_CAPS)   // value channels: the 8 of version 1, then cap_raw[4..]
+#define MAP_EXT (((1ull << (SAMPLE_CAPS - 4)) - 1) << 10)
+#define MAP_VALUES (RC_MAP_CAP(0) | RC_MAP_CAP(1) | RC_MAP_CAP(2) | RC_MAP_CAP(3) | \
+                    RC_MAP_TEMP | RC_MAP_HUM | RC_MAP_PRES | RC_MAP_MC | MAP_EXT)
+#define MAP_ALL (MAP_VALUES | RC_MAP_CAPDAC | RC_MAP_FLAGS | RC_MAP_T_US | RC_MAP_EPOCH)
+
+static size_t put_var(uint8_t *p, uint64_t v){
+    size_t n = 0;
+    while (v >= 0x80){
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static bool get_var(rc_dec_t *d, uint64_t *v){
+    uint64_t r = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7){
+        if (d->p == d->end) return false;
+        uint8_t b = *d->p++;
+        r |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)){
+            *v = r;
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint64_t zz(int64_t v){ return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static int64_t unzz(uint64_t v){ return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+// Value channels in map bit order, skipping RC_MAP_CAPDAC and RC_MAP_FLAGS.
+static uint64_t bit(int c){ return c < 8 ? 1ull << c : 1ull << (c + 2); }
+
+static int64_t chan(const sample_t *s, int c){
+    if (c >= 8) return s->cap_raw[c - 4];
+    switch (c){
+    case 0: case 1: case 2: case 3: return s->cap_raw[c];
+    case 4: return s->temp_cdeg;
+    case 5: return s->hum_q10;
+    case 6: return s->pres_q8;
+    default: return s->mc_cpct;
+    }
+}
+
+static void set_chan(sample_t *s, int c, int64_t v){
+    if (c >= 8){
+        s->cap_raw[c - 4] = (int32_t)v;
+        return;
+    }
+    switch (c){
+    case 0: case 1: case 2: case 3: s->cap_raw[c] = (int32_t)v; break;
+    case 4: s->temp_cdeg = (int32_t)v; break;
+    case 5: s->hum_q10 = (uint32_t)v; break;
+    case 6: s->pres_q8 = (uint32_t)v; break;
+    default: s->mc_cpct = (uint16_t)v; break;
+    }
+}
+
+static uint64_t map_of(const sample_t *s, const sample_t *prev){
+    uint64_t m = 0;
+    for (int c = 0; c < 7; c++) if (chan(s, c)) m |= 1u << c;
+    if (s->mc_cpct != WMC_INVALID) m |= RC_MAP_MC;
+    for (int i = 4; i < SAMPLE_CAPS; i++) if (s->cap_raw[i] || s->capdac[i]) m |= RC_MAP_CAP(i);
+    if (memcmp(s->capdac, prev->capdac, 4)) m |= RC_MAP_CAPDAC;
+    for (int i = 4; i < SAMPLE_CAPS; i++)
+        if ((m & RC_MAP_CAP(i)) && s->capdac[i] != prev->capdac[i]) m |= RC_MAP_CAPDAC;
+    if (s->flags) m |= RC_MAP_FLAGS;
+    if (s->t_us) m |= RC_MAP_T_US;
+    if (s->epoch_us) m |= RC_MAP_EPOCH;
+    return m;
+}
+
+// Absent channels keep the last value (and cap_raw[4..] its capdac) as the
+// base for the next delta.
+static void keep_absent(sample_t *s, const sample_t *prev, uint64_t map){
+    for (int c = 0; c < CHANS; c++)
+        if (!(map & bit(c))) set_chan(s, c, chan(prev, c));
+    for (int i = 4; i < SAMPLE_CAPS; i++)
+        if (!(map & RC_MAP_CAP(i))) s->capdac[i] = prev->capdac[i];
+}
+
+esp_err_t rc_enc_init(rc_enc_t *e, void *buf, size_t cap, uint32_t period_ms){
+    if (cap < RC_HEADER_MAX) return ESP_ERR_INVALID_SIZE;
+    memset(e, 0, sizeof(*e));
+    e->buf = buf;
+    e->cap = cap;
+    e->period_ms = period_ms;
+    e->buf[0] = RC_MAGIC;
+    e->buf[1] = RC_VERSION;
+    e->buf[2] = e->buf[3] = 0;
+    e->len = 4 + put_var(e->buf + 4, period_ms);
+    return ESP_OK;
+}
+
+bool rc_enc_add(rc_enc_t *e, const sample_t *s){
+    if (e->count == UINT16_MAX) return false;
+    uint8_t tmp[RC_RECORD_MAX];
+    uint64_t map = map_of(s, &e->prev);
+    size_t n = put_var(tmp, map ^ e->prev_map);
+    if (!e->count) n += put_var(tmp + n, s->t_ms);
+    else n += put_var(tmp + n, zz((int64_t)(s->t_ms - e->prev.t_ms - e->period_ms)));
+    // both nearly constant from one record to the next
+    // modulo 2^64 like the fields themselves; signed only to zigzag
+    uint64_t lag = s->t_ms * 1000u - s->t_us, off = s->epoch_us - s->t_us;
+    if (map & RC_MAP_T_US) n += put_var(tmp + n, zz((int64_t)(lag - e->prev_lag)));
+    if (map & RC_MAP_EPOCH) n += put_var(tmp + n, zz((int64_t)(off - e->prev_off)));
+    if (map & RC_MAP_CAPDAC){
+        memcpy(tmp + n, s->capdac, 4);
+        n += 4;
+        for (int i = 4; i < SAMPLE_CAPS; i++) if (map & RC_MAP_CAP(i)) tmp[n++] = s->capdac[i];
+    }
+    for (int c = 0; c < CHANS; c++)
+        if (map & bit(c)) n += put_var(tmp + n, zz(chan(s, c) - chan(&e->prev, c)));
+    if (map & RC_MAP_FLAGS) n += put_var(tmp + n, s->flags);
+    if (e->len + n > e->cap) return false;
+
+    memcpy(e->buf + e->len, tmp, n);
+    e->len += n;
+    e->count++;
+    e->buf[2] = (uint8_t)e->count;
+    e->buf[3] = (uint8_t)(e->count >> 8);
+
+    sample_t base = *s;
+    keep_absent(&base, &e->prev, map);
+    e->prev = base;
+    e->prev_map = map;
+    if (map & RC_MAP_T_US) e->prev_lag = lag;
+    if (map & RC_MAP_EPOCH) e->prev_off = off;
+    return true;
+}
+
+esp_err_t rc_dec_init(rc_dec_t *d, const void *buf, size_t len){
+    const uint8_t *b = buf;
+    memset(d, 0, sizeof(*d));
+    if (len < 5) return ESP_ERR_INVALID_SIZE;
+    if (b[0] != RC_MAGIC) return ESP_ERR_INVALID_ARG;
+    if (!b[1] || b[1] > RC_VERSION) return ESP_ERR_INVALID_VERSION;
+    d->version = b[1];
+    d->count = d->left = (uint16_t)(b[2] | b[3] << 8);
+    d->p = b + 4;
+    d->end = b + len;
+    uint64_t v;
+    if (!get_var(d, &v) || v > UINT32_MAX) return ESP_ERR_INVALID_SIZE;
+    d->period_ms = (uint32_t)v;
+    return ESP_OK;
+}
+
+esp_err_t rc_dec_next(rc_dec_t *d, sample_t *out){
+    if (!d->left) return ESP_ERR_NOT_FOUND;
+    uint64_t v;
+    if (!get_var(d, &v)) return ESP_ERR_INVALID_SIZE;
+    uint64_t map = v ^ d->prev_map;
+    if (map >> (d->version < 3 ? 38 : 40)) return ESP_ERR_INVALID_SIZE;
+    // bits 10..37 are cap_raw[4..31]: from a build with more FDC1004s
+    if (map & ~MAP_ALL) return ESP_ERR_NOT_SUPPORTED;
+    sample_t s = d->prev;
+    if (!get_var(d, &v)) return ESP_ERR_INVALID_SIZE;
+    s.t_ms = d->left == d->count ? v : d->prev.t_ms + d->period_ms + (uint64_t)unzz(v);
+    uint64_t lag = d->prev_lag, off = d->prev_off;
+    s.t_us = s.epoch_us = 0;
+    if (map & RC_MAP_T_US){
+        if (!get_var(d, &v)) return ESP_ERR_INVALID_SIZE;
+        lag += (uint64_t)unzz(v);
+        s.t_us = s.t_ms * 1000u - lag;
+    }
+    if (map & RC_MAP_EPOCH){
+        if (!get_var(d, &v)) return ESP_ERR_INVALID_SIZE;
+        off += (uint64_t)unzz(v);
+        s.epoch_us = s.t_us + off;
+    }
+    if (map & RC_MAP_CAPDAC){
+        if (d->end - d->p < 4) return ESP_ERR_INVALID_SIZE;
+        memcpy(s.capdac, d->p, 4);
+        d->p += 4;
+        for (int i = 4; i < SAMPLE_CAPS; i++){
+            if (!(map & RC_MAP_CAP(i))) continue;
+            if (d->p == d->end) return ESP_ERR_INVALID_SIZE;
+            s.capdac[i] = *d->p++;
+        }
+    }
+    for (int c = 0; c < CHANS; c++){
+        if (!(map & bit(c))) continue;
+        if (!get_var(d, &v)) return ESP_ERR_INVALID_SIZE;
+        set_chan(&s, c, chan(&d->prev, c) + unzz(v));
+    }
+    s.flags = 0;
+    if (map & RC_MAP_FLAGS){
+        if (!get_var(d, &v)) return ESP_ERR_INVALID_SIZE;
+        s.flags = (uint16_t)v;
+    }
+    d->prev = s;
+    d->prev_map = map;
+    d->prev_lag = lag;
+    d->prev_off = off;
+    d->left--;
+
+    *out = s;
+    for (int c = 0; c < 7; c++) if (!(map & (1u << c))) set_chan(out, c, 0);
+    if (!(map & RC_MAP_MC)) out->mc_cpct = WMC_INVALID;
+    for (int i = 4; i < SAMPLE_CAPS; i++)
+        if (!(map & RC_MAP_CAP(i))) out->cap_raw[i] = out->capdac[i] = 0;
+    return ESP_OK;
+}
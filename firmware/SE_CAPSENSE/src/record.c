@@ -1,17 +1,110 @@
 #include "record.h"
 #include "config.h"
+#include <stdatomic.h>
+#include <string.h>
+
+_Static_assert((RECORD_RING_CAP & (RECORD_RING_CAP - 1)) == 0, "RECORD_RING_CAP must be a power of two");
+
+#define RING_MASK   (RECORD_RING_CAP - 1u)
+
+// head/tail are free-running 31-bit indices; bit 31 of tail marks a consumer
+// claim (peek in progress). Under DROP_OLDEST the producer may only advance
+// an unclaimed tail, with a CAS, so it never overwrites a slot the consumer is
+// reading. RV32IMC has no A extension: plain loads/stores stay inline and
+// the CAS (libatomic) is only used under DROP_OLDEST.
+#define IDX_MASK    0x7FFFFFFFu
+#define CLAIMED     0x80000000u
 
 static sample_t q[RECORD_RING_CAP];
-static volatile size_t head=0, tail=0, count=0;
+static _Atomic uint32_t head, tail;
+static record_overflow_t policy = RECORD_OVERFLOW_REJECT;
+static uint32_t claim_n;
+static record_stats_t stats;
+
+void record_set_overflow(record_overflow_t p){ policy = p; }
+
+sample_t *record_reserve(void){
+    uint32_t h = atomic_load_explicit(&head, memory_order_relaxed);
+    uint32_t t = atomic_load_explicit(&tail, memory_order_acquire);
+    if (((h - t) & IDX_MASK) >= RECORD_RING_CAP){
+        uint32_t expect = t;
+        if (policy != RECORD_OVERFLOW_DROP_OLDEST || (t & CLAIMED) ||
+            !atomic_compare_exchange_strong(&tail, &expect, (t + 1u) & IDX_MASK)){
+            stats.rejected++;
+            return NULL;
+        }
+        stats.dropped++;
+    }
+    return &q[h & RING_MASK];
+}
+
+void record_publish(void){
+    uint32_t h = (atomic_load_explicit(&head, memory_order_relaxed) + 1u) & IDX_MASK;
+    atomic_store_explicit(&head, h, memory_order_release);
+    uint32_t t = atomic_load_explicit(&tail, memory_order_relaxed);
+    uint32_t n = (h - t) & IDX_MASK;
+    stats.pushed++;
+    if (n > stats.high_water) stats.high_water = n;
+}
 
 bool record_push(const sample_t *s){
-if (count>=RECORD_RING_CAP) return false;
-q[head] = *s; head=(head+1)%RECORD_RING_CAP; count++; return true;
+    sample_t *slot = record_reserve();
+    if (!slot) return false;
+    *slot = *s;
+    record_publish();
+    return true;
+}
+
+size_t record_peek(const sample_t **first, size_t max){
+    uint32_t t = atomic_load_explicit(&tail, memory_order_acquire) & IDX_MASK;
+    // Only DROP_OLDEST lets the producer move tail, so only then does the
+    // consumer need to claim it. The CAS fails only if the producer dropped
+    // the oldest record between the load and here.
+    if (policy == RECORD_OVERFLOW_DROP_OLDEST)
+        while (!atomic_compare_exchange_weak(&tail, &t, t | CLAIMED)) t &= IDX_MASK;
+
+    uint32_t h = atomic_load_explicit(&head, memory_order_acquire);
+    size_t avail = (h - t) & IDX_MASK;
+    size_t run = RECORD_RING_CAP - (t & RING_MASK);
+    if (avail > run) avail = run;
+    if (avail > max) avail = max;
+    claim_n = (uint32_t)avail;
+    *first = &q[t & RING_MASK];
+    return avail;
+}
+
+void record_commit(size_t n){
+    if (n > claim_n) n = claim_n;
+    uint32_t t = atomic_load_explicit(&tail, memory_order_relaxed) & IDX_MASK;
+    claim_n = 0;
+    atomic_store_explicit(&tail, (t + (uint32_t)n) & IDX_MASK, memory_order_release);
 }
 
 bool record_pop(sample_t *s){
-if (!count) return false;
-*s = q[tail]; tail=(tail+1)%RECORD_RING_CAP; count--; return true;
+    const sample_t *p;
+    if (!record_peek(&p, 1)){ record_commit(0); return false; }
+    *s = *p;
+    record_commit(1);
+    return true;
+}
+
+size_t record_pop_batch(sample_t *out, size_t max){
+    size_t total = 0;
+    while (total < max){
+        const sample_t *p;
+        size_t n = record_peek(&p, max - total);
+        memcpy(&out[total], p, n * sizeof(*p));
+        record_commit(n);
+        if (!n) break;
+        total += n;
+    }
+    return total;
+}
+
+size_t record_count(void){
+    uint32_t h = atomic_load_explicit(&head, memory_order_acquire);
+    uint32_t t = atomic_load_explicit(&tail, memory_order_acquire);
+    return (h - t) & IDX_MASK;
 }
 
-size_t record_count(void){ return count; }
\ No newline at end of file
+void record_get_stats(record_stats_t *out){ *out = stats; }
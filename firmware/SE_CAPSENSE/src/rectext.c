@@ -0,0 +1,185 @@
+#include "rectext.h"
+#include "units.h"
+#include "wmc.h"
+#include <string.h>
+
+static const char PAIRS[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const uint32_t POW10[10] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+// Exactly n digits of v (< 10^n, leading zeros), ending at end.
+static void put_n(char *end, uint32_t v, unsigned n){
+    for (; n >= 2; n -= 2, v /= 100){
+        end -= 2;
+        memcpy(end, &PAIRS[2 * (v % 100)], 2);
+    }
+    if (n) *--end = (char)('0' + v);
+}
+
+static char *put_u32(char *p, uint32_t v){
+    unsigned n = 1;
+    while (n < 10 && v >= POW10[n]) n++;
+    put_n(p + n, v, n);
+    return p + n;
+}
+
+char *rt_put_u64(char *p, uint64_t v){
+    if (v <= UINT32_MAX) return put_u32(p, (uint32_t)v);
+    // 8 digits at a time: one 64-bit division here, 32-bit ones after
+    uint64_t hi = v / 100000000u;
+    uint32_t lo = (uint32_t)(v - hi * 100000000u);
+    if (hi <= UINT32_MAX) p = put_u32(p, (uint32_t)hi);
+    else {
+        uint64_t top = hi / 100000000u;
+        p = put_u32(p, (uint32_t)top);
+        put_n(p + 8, (uint32_t)(hi - top * 100000000u), 8);
+        p += 8;
+    }
+    put_n(p + 8, lo, 8);
+    return p + 8;
+}
+
+char *rt_put_fixed(char *p, int64_t v, unsigned decimals){
+    uint64_t u = (uint64_t)v;
+    if (v < 0){
+        *p++ = '-';
+        u = 0 - u;
+    }
+    if (!decimals) return rt_put_u64(p, u);
+    uint64_t ip;
+    uint32_t fp;
+    if (u <= UINT32_MAX){
+        ip = (uint32_t)u / POW10[decimals];
+        fp = (uint32_t)u - (uint32_t)ip * POW10[decimals];
+    } else {
+        ip = u / POW10[decimals];
+        fp = (uint32_t)(u - ip * POW10[decimals]);
+    }
+    p = rt_put_u64(p, ip);
+    *p++ = '.';
+    put_n(p + decimals, fp, decimals);
+    return p + decimals;
+}
+
+#define PUT(p, lit) (memcpy((p), (lit), sizeof(lit) - 1), (p) + sizeof(lit) - 1)
+
+static char *put_codes(char *p, const sample_t *s){
+    p = PUT(p, "{\"t\":");
+    p = rt_put_u64(p, s->t_ms);
+    p = PUT(p, ",\"u\":");
+    p = rt_put_u64(p, s->t_us);
+    p = PUT(p, ",\"e\":");
+    p = rt_put_u64(p, s->epoch_us);
+    p = PUT(p, ",\"cap\":[");
+    for (int c = 0; c < SAMPLE_CAPS; c++){
+        if (c) *p++ = ',';
+        p = rt_put_fixed(p, s->cap_raw[c], 0);
+    }
+    p = PUT(p, "],\"dac\":[");
+    for (int c = 0; c < SAMPLE_CAPS; c++){
+        if (c) *p++ = ',';
+        p = put_u32(p, s->capdac[c]);
+    }
+    p = PUT(p, "],\"tc\":");
+    p = rt_put_fixed(p, s->temp_cdeg, 0);
+    p = PUT(p, ",\"rh\":");
+    p = put_u32(p, s->hum_q10);
+    p = PUT(p, ",\"pa\":");
+    p = put_u32(p, s->pres_q8);
+    p = PUT(p, ",\"mc\":");
+    p = put_u32(p, s->mc_cpct);
+    p = PUT(p, ",\"f\":");
+    p = put_u32(p, s->flags);
+    *p++ = '}';
+    return p;
+}
+
+static char *put_units(char *p, const sample_t *s){
+    p = PUT(p, "{\"t\":");
+    p = rt_put_u64(p, s->t_ms);
+    p = PUT(p, ",\"e\":");
+    p = rt_put_u64(p, s->epoch_us);
+    p = PUT(p, ",\"pf\":[");
+    for (int c = 0; c < SAMPLE_CAPS; c++){
+        if (c) *p++ = ',';
+        p = rt_put_fixed(p, units_cap_af(s->cap_raw[c], s->capdac[c]), 6);
+    }
+    p = PUT(p, "],\"degc\":");
+    p = rt_put_fixed(p, s->temp_cdeg, 2);
+    p = PUT(p, ",\"rh\":");
+    p = rt_put_fixed(p, units_hum_mpct(s->hum_q10), 3);
+    p = PUT(p, ",\"hpa\":");
+    p = rt_put_fixed(p, units_pres_pa(s->pres_q8), 2);
+    p = PUT(p, ",\"mc\":");
+    p = s->mc_cpct == WMC_INVALID ? PUT(p, "null") : rt_put_fixed(p, s->mc_cpct, 2);
+    p = PUT(p, ",\"f\":");
+    p = put_u32(p, s->flags);
+    *p++ = '}';
+    return p;
+}
+
+static char *put_csv(char *p, const sample_t *s){
+    p = rt_put_u64(p, s->t_ms);
+    *p++ = ',';
+    p = rt_put_u64(p, s->epoch_us);
+    for (int c = 0; c < SAMPLE_CAPS; c++){
+        *p++ = ',';
+        p = rt_put_fixed(p, units_cap_af(s->cap_raw[c], s->capdac[c]), 6);
+    }
+    *p++ = ',';
+    p = rt_put_fixed(p, s->temp_cdeg, 2);
+    *p++ = ',';
+    p = rt_put_fixed(p, units_hum_mpct(s->hum_q10), 3);
+    *p++ = ',';
+    p = rt_put_fixed(p, units_pres_pa(s->pres_q8), 2);
+    *p++ = ',';
+    if (s->mc_cpct != WMC_INVALID) p = rt_put_fixed(p, s->mc_cpct, 2);
+    *p++ = ',';
+    p = put_u32(p, s->flags);
+    *p++ = '\n';
+    return p;
+}
+
+esp_err_t rt_enc_init(rt_enc_t *e, void *buf, size_t cap, rt_fmt_t fmt){
+    if (fmt > RT_CSV) return ESP_ERR_INVALID_ARG;
+    memset(e, 0, sizeof(*e));
+    e->buf = buf;
+    e->cap = cap;
+    e->fmt = fmt;
+    return ESP_OK;
+}
+
+bool rt_enc_add(rt_enc_t *e, const sample_t *s){
+    // straight into buf when the widest record fits, else via the stack
+    char tmp[RT_RECORD_MAX];
+    bool direct = e->cap - e->len >= RT_RECORD_MAX;
+    char *p0 = direct ? e->buf + e->len : tmp, *p = p0;
+    if (e->count && e->fmt != RT_CSV) *p++ = ',';
+    p = e->fmt == RT_CSV ? put_csv(p, s) : e->fmt == RT_JSON ? put_units(p, s) : put_codes(p, s);
+    size_t n = (size_t)(p - p0);
+    if (!direct){
+        if (n > e->cap - e->len) return false;
+        memcpy(e->buf + e->len, tmp, n);
+    }
+    e->len += n;
+    e->count++;
+    return true;
+}
+
+size_t rt_csv_header(char *buf, size_t cap){
+    char tmp[48 + 12 * SAMPLE_CAPS + 64], *p = tmp;
+    p = PUT(p, "t_ms,epoch_us");
+    for (int c = 0; c < SAMPLE_CAPS; c++){
+        p = PUT(p, ",cap");
+        p = put_u32(p, (uint32_t)c);
+        p = PUT(p, "_pf");
+    }
+    p = PUT(p, ",temp_c,rh_pct,pres_hpa,mc_pct,flags\n");
+    size_t n = (size_t)(p - tmp);
+    if (n > cap) return 0;
+    memcpy(buf, tmp, n);
+    return n;
+}
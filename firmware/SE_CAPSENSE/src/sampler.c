@@ -1,44 +1,319 @@
 #include "sampler.h"
 #include "record.h"
-#include "fdc1004.h"
+#include "capfe.h"
 #include "bme280_drv.h"
+#include "dsp.h"
+#include "i2c_bus.h"
+#include "i2cmux.h"
 #include "config.h"
 #include "timebase.h"
+#include "units.h"
+#include "wmc.h"
 #include "esp_log.h"
+#include "trace.h"
+#include "prof.h"
 #include "driver/gpio.h"
 #include "board.h"
+#include <inttypes.h>
+#include <string.h>
+
+_Static_assert(FDC_DEVICES >= 1 && FDC_DEVICES <= I2CMUX_CHANNELS, "FDC_DEVICES out of range");
+
+#define DEV_MASK(d) (((1u << CAPFE_MEAS) - 1u) << (CAPFE_MEAS * (d)))
 
 static const char *TAG = "sampler";
 
-void sampler_init(void){ fdc_init(); fdc_config_default(); }
+// Front-end found at boot (capfe.h); every device has the same one.
+static const capfe_t *s_fe = &capfe_fdc1004;
+
+// Capacitance results and BME data in a single bus transaction per sample,
+// built from the front-end's part.
+static i2c_txn_id_t s_txn_sample = I2C_TXN_NONE;
+static i2c_txn_id_t s_txn_sample_fe = I2C_TXN_NONE;
+
+// Per-channel filter chain (record.h channel numbers) fed by
+// sampler_poll_job at the front-end's rate.
+static dsp_cfg_t s_filter;
+static dsp_chan_t s_dsp[SAMPLE_CAPS];
+static int32_t s_filt[SAMPLE_CAPS];
+static uint32_t s_have;      // channels with at least one filter output
+static uint64_t s_out_us;    // read time of the last conversion that made a filter output
+static uint32_t s_enabled;   // channels the front-ends convert
+static uint32_t s_sat;       // channels with a saturated result since the last record
+static uint8_t s_dac[SAMPLE_CAPS];       // CAPDAC of each channel's latest result
+static uint8_t s_rec_dac[SAMPLE_CAPS];   // in the last record
+static uint8_t s_present;    // devices that came up
+static uint64_t s_first_us;
+static uint32_t s_period_ms = SAMPLE_PERIOD_MS;
+static bool s_adapt_on;
+static adapt_t s_adapt;
+static int32_t s_fast[SAMPLE_CAPS];   // quick average of the conversions, for adapt jumps
+static int32_t s_rec_cap[SAMPLE_CAPS];   // in the last record
+static bool s_jump;
+
+static void default_filter(dsp_cfg_t *f, uint32_t period_ms){
+    uint32_t rate_hz = s_fe->rate_hz();
+    if (!rate_hz) rate_hz = FDC_RATE_HZ / CAPFE_MEAS;
+    uint32_t r = SAMPLE_DECIM ? SAMPLE_DECIM : rate_hz * period_ms / 1000;
+    if (r < 1) r = 1;
+    if (r > DSP_DECIM_MAX) r = DSP_DECIM_MAX;
+    *f = (dsp_cfg_t){ .median = SAMPLE_MEDIAN_N, .decim = (uint16_t)r,
+                      .cic_order = SAMPLE_CIC_ORDER, .iir_shift = SAMPLE_IIR_SHIFT };
+}
+
+esp_err_t sampler_set_filter(const dsp_cfg_t *cfg){
+    dsp_chan_t tmp;
+    esp_err_t r = dsp_init(&tmp, cfg);
+    if (r != ESP_OK) return r;
+    for (int c = 0; c < SAMPLE_CAPS; c++) dsp_init(&s_dsp[c], cfg);
+    s_filter = *cfg;
+    s_have = 0;
+    return ESP_OK;
+}
+
+const dsp_cfg_t *sampler_get_filter(void){ return &s_filter; }
+
+void sampler_init(void){
+#if FDC_DEVICES > 1
+    if (i2cmux_init() != ESP_OK) ESP_LOGW(TAG, "no I2C mux: the capacitance front-ends cannot answer");
+#endif
+    s_enabled = 0;
+    s_present = 0;
+    memset(s_dac, 0, sizeof(s_dac));
+    const capfe_t *fe = NULL;
+    for (uint8_t d = 0; d < FDC_DEVICES; d++){
+        // the first device to answer picks the front-end for all of them
+        if (!fe) fe = capfe_probe(d);
+        else if (fe->select(d) != ESP_OK || fe->init() != ESP_OK){
+            ESP_LOGW(TAG, "no %s on mux channel %u", fe->caps->name, d);
+            continue;
+        }
+        if (!fe || fe->configure(0, 0) != ESP_OK){
+            if (FDC_DEVICES > 1) ESP_LOGW(TAG, "no capacitance front-end on mux channel %u", d);
+            continue;
+        }
+        s_present |= (uint8_t)(1u << d);
+        s_enabled |= DEV_MASK(d);
+        for (int m = 0; m < CAPFE_MEAS; m++) s_dac[CAPFE_MEAS * d + m] = fe->capdac((uint8_t)m);
+    }
+    memcpy(s_rec_dac, s_dac, sizeof(s_rec_dac));
+    s_sat = 0;
+    s_fe = fe ? fe : &capfe_fdc1004;
+    s_fe->select(0);
+    if (fe) ESP_LOGI(TAG, "front-end %s, %u results/s per channel", fe->caps->name, (unsigned)fe->rate_hz());
+    i2c_txn_id_t parts[2] = { s_fe->latest_txn(), bme_meas_txn() };
+    if (parts[0] != s_txn_sample_fe && parts[0] != I2C_TXN_NONE && parts[1] != I2C_TXN_NONE){
+        s_txn_sample = i2c_txn_prepare_burst(parts, 2);
+        s_txn_sample_fe = parts[0];
+    }
+
+    s_period_ms = SAMPLE_PERIOD_MS;
+    dsp_cfg_t f;
+    default_filter(&f, s_period_ms);
+    sampler_set_filter(&f);
+#if SAMPLE_ADAPT
+    adapt_cfg_t ac;
+    adapt_default_cfg(&ac);
+    sampler_set_adapt(&ac);
+#else
+    sampler_set_adapt(NULL);
+#endif
+    ESP_LOGI(TAG, "filter: median %u, CIC order %u decim %u, IIR shift %u",
+             f.median, f.cic_order, f.decim, f.iir_shift);
+}
+
+// The devices convert continuously and side by side; each poll reads out
+// whatever they finished since the last, one device after the other.
+void sampler_poll_job(void){
+    capfe_result_t res[CAPFE_MEAS];
+    size_t n;
+    uint8_t done;
+    PROF_START(PROF_SAMPLER_POLL);
+    for (uint8_t dev = 0; dev < FDC_DEVICES; dev++){
+        if (!(s_present & (1u << dev))) continue;
+        s_fe->select(dev);
+        if (s_fe->ready(&done) != ESP_OK || s_fe->read_batch(done, res, &n) != ESP_OK){
+            s_have &= ~DEV_MASK(dev);   // don't publish stale filter outputs
+            n = 0;
+        }
+        for (size_t i = 0; i < n; i++){
+            int c = CAPFE_MEAS * dev + res[i].meas;
+            if (res[i].saturated) s_sat |= 1u << c;
+            // the chain runs on absolute codes, so a CAPDAC move
+            // (fdc1004.h auto-ranging) is no step in its input
+            s_dac[c] = s_fe->capdac(res[i].meas);
+            int32_t v = units_cap_codes(res[i].raw, s_dac[c]);
+            if (dsp_push(&s_dsp[c], v, &s_filt[c])){
+                s_have |= 1u << c;
+                s_out_us = res[i].t_us;
+            }
+            if (s_adapt_on && s_adapt.cfg.jump){
+                s_fast[c] += (v - s_fast[c]) / 4;
+                int32_t d = s_fast[c] - s_rec_cap[c];
+                if ((uint32_t)(d < 0 ? -d : d) >= s_adapt.cfg.jump && s_adapt.primed) s_jump = true;
+            }
+        }
+    }
+    s_fe->select(0);
+    PROF_STOP(PROF_SAMPLER_POLL);
+}
 
 void sampler_job(void){
+    PROF_START(PROF_SAMPLER_JOB);
     sample_t s = {0};
     s.t_ms = tb_now_ms();
-    bool sat=false; float cap[4];
+    bool sat=false, wsat=false, cap_ok=true;   // wsat: the moisture electrodes
 
     // Indicate sensor read started
     gpio_set_level(LED_SENSE_GPIO, 1);
 
-    if (fdc_read_pf(cap, &sat)==ESP_OK){
-        for (int i=0;i<4;i++) s.cap_pf[i]=cap[i];
-        if (sat) s.flags |= (1u<<0);
+    esp_err_t r = ESP_FAIL;
+    bool env = false;
+    if (s_jump){
+        // the filter outputs are from before the step: read the results
+        // directly and start the filters again on the new level
+        for (int c = 0; c < SAMPLE_CAPS; c++) dsp_reset(&s_dsp[c]);
+        s_have = 0;
+    }
+    for (uint8_t dev = 0; dev < FDC_DEVICES; dev++){
+        uint32_t en = s_enabled & DEV_MASK(dev);
+        int32_t *raw = &s.cap_raw[CAPFE_MEAS * dev];
+        bool dsat = false;
+        s_fe->select(dev);
+        if (en && (s_have & en) == en){
+            // filtered capacitance from the poll job, back relative to
+            // the current CAPDAC
+            for (int m = 0; m < CAPFE_MEAS; m++){
+                int c = CAPFE_MEAS * dev + m;
+                s.capdac[c] = s_dac[c];
+                raw[m] = s_filt[c] - units_cap_codes(0, s_dac[c]);
+            }
+            if (s_out_us > s.t_us) s.t_us = s_out_us;
+        } else if (dev == 0 || (s_present & (1u << dev))){
+            s.flags |= SAMPLE_FLAG_UNFILTERED;
+            if (dev == 0 && s_txn_sample != I2C_TXN_NONE && s_fe->route() == ESP_OK && i2c_txn_run(s_txn_sample) == ESP_OK){
+                s_fe->latest_decode(raw, &dsat);
+                bme_meas_decode(&s.temp_cdeg, &s.hum_q10, &s.pres_q8);
+                env = true;
+                r = ESP_OK;
+            } else if (s_fe->read_latest(raw, &dsat) != ESP_OK){
+                // one device missing or failing: read them separately so the others still report
+                dsat = false;
+                if (dev == 0) cap_ok = false;
+            }
+            s.t_us = tb_now_us();   // the results just read
+        }
+        if (dsat){
+            sat = true;
+            if (dev == WMC_MEAS / CAPFE_MEAS) wsat = true;
+        }
+        if (!en || (s_have & en) != en)
+            for (int m = 0; m < CAPFE_MEAS; m++) s.capdac[CAPFE_MEAS * dev + m] = s_fe->capdac((uint8_t)m);
+    }
+    s_fe->select(0);
+    if (!s.t_us) s.t_us = tb_now_us();
+    s.epoch_us = tb_epoch_us(s.t_us);
+    if (s_sat & s_enabled) sat = true;
+    if (s_sat & (1u << WMC_MEAS)) wsat = true;
+    if (memcmp(s.capdac, s_rec_dac, sizeof(s_rec_dac))) s.flags |= SAMPLE_FLAG_CAPDAC;
+    memcpy(s_rec_dac, s.capdac, sizeof(s_rec_dac));
+    s_sat = 0;
+    if (!env) r = bme_read(&s.temp_cdeg, &s.hum_q10, &s.pres_q8);
+    if (sat) s.flags |= SAMPLE_FLAG_SATURATED;
+
+    // moisture needs the wood temperature and an in-range capacitance on its
+    // own electrodes; other channels saturating only flag the record
+    s.mc_cpct = WMC_INVALID;
+    if (r == ESP_OK && cap_ok && !wsat && (s_enabled & (1u << WMC_MEAS))){
+        bool clip;
+        s.mc_cpct = wmc_estimate(units_cap_af(s.cap_raw[WMC_MEAS], s.capdac[WMC_MEAS]), s.temp_cdeg, &clip);
+        if (clip) s.flags |= SAMPLE_FLAG_MC_CLAMPED;
     }
-    esp_err_t r = bme_read(&s.temp_c, &s.hum_pct, &s.pres_hpa);
     if (r != ESP_OK){
-        ESP_LOGW(TAG, "BME read failed: %d", r);
+        TRACE_W(TAG, "BME read failed: %d", r);
         // leave defaults/zeroed values
-    } else {
-        ESP_LOGI(TAG, "BME: T=%.2fC H=%.2f%% P=%.2f hPa", s.temp_c, s.hum_pct, s.pres_hpa);
+        s.flags |= SAMPLE_FLAG_NO_ENV;
     }
 
     // Sensor read finished
     gpio_set_level(LED_SENSE_GPIO, 0);
 
+    if (s_adapt_on){
+        if (s_jump) s_adapt.stats.jumps++;
+        s_jump = false;
+        for (int c = 0; c < SAMPLE_CAPS; c++) s_rec_cap[c] = s_fast[c] = units_cap_codes(s.cap_raw[c], s.capdac[c]);
+        uint32_t p = adapt_update(&s_adapt, &s);
+        if (p != s_period_ms && sampler_set_period_ms(p) == ESP_OK)
+            TRACE_D(TAG, "record period %u ms", (unsigned)p);
+    }
+
     bool pushed = record_push(&s);
     if (!pushed) {
-        ESP_LOGW(TAG, "record_push failed: ring full");
+        TRACE_W(TAG, "record_push failed: ring full");
     } else {
-        ESP_LOGD(TAG, "record pushed, pending=%u", (unsigned)record_count());
+        TRACE_D(TAG, "record pushed, pending=%u", (unsigned)record_count());
+        if (!s_first_us){
+            s_first_us = tb_now_us();
+            TRACE_I(TAG, "first record %u ms after boot", (unsigned)(s_first_us / 1000u));
+        }
+    }
+    PROF_STOP(PROF_SAMPLER_JOB);
+}
+
+uint64_t sampler_first_record_us(void){ return s_first_us; }
+
+const capfe_t *sampler_frontend(void){ return s_fe; }
+
+esp_err_t sampler_set_period_ms(uint32_t ms){
+    if (!ms || ms % SAMPLE_POLL_MS) return ESP_ERR_INVALID_ARG;
+    if (ms == s_period_ms) return ESP_OK;
+    // retune the decimation to the new period; the last outputs stay valid
+    // until the first at the new rate, so no record goes out unfiltered
+    dsp_cfg_t f;
+    default_filter(&f, ms);
+    f.median = s_filter.median;
+    f.cic_order = s_filter.cic_order;
+    f.iir_shift = s_filter.iir_shift;
+    uint32_t have = s_have;
+    esp_err_t r = sampler_set_filter(&f);
+    if (r != ESP_OK) return r;
+    s_have = have;
+    s_period_ms = ms;
+    return ESP_OK;
+}
+
+uint32_t sampler_period_ms(void){ return s_period_ms; }
+
+bool sampler_record_due(void){ return s_jump; }
+
+esp_err_t sampler_set_adapt(const adapt_cfg_t *cfg){
+    if (!cfg){
+        s_adapt_on = false;
+        return ESP_OK;
     }
+    s_adapt_on = false;
+    esp_err_t r = adapt_init(&s_adapt, cfg, s_period_ms);
+    s_jump = false;
+    s_adapt_on = r == ESP_OK;
+    return r;
+}
+
+bool sampler_get_adapt_stats(adapt_stats_t *out){
+    if (!s_adapt_on) return false;
+    *out = s_adapt.stats;
+    return true;
+}
+
+size_t sampler_log_sink(const sample_t *recs, size_t n){
+    if (!n) return 0;
+    const sample_t *s = &recs[n - 1];
+    if (s->flags & SAMPLE_FLAG_NO_ENV) return n;
+    int32_t t = s->temp_cdeg, h = units_hum_mpct(s->hum_q10), p = units_pres_pa(s->pres_q8);
+    ESP_LOGI(TAG, "BME: T=%s%" PRId32 ".%02" PRId32 "C H=%" PRId32 ".%02" PRId32 "%% P=%" PRId32 ".%02" PRId32 " hPa",
+             t < 0 ? "-" : "", (t < 0 ? -t : t) / 100, (t < 0 ? -t : t) % 100,
+             h / 1000, (h % 1000) / 10, p / 100, p % 100);
+    if (s->mc_cpct != WMC_INVALID)
+        ESP_LOGI(TAG, "WMC: %u.%02u%% (%s)%s", s->mc_cpct / 100u, s->mc_cpct % 100u,
+                 wmc_species_name(wmc_get_species()), (s->flags & SAMPLE_FLAG_MC_CLAMPED) ? " clamped" : "");
+    return n;
 } 
\ No newline at end of file
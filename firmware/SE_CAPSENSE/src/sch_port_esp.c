@@ -0,0 +1,39 @@
+#include "sch_port.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+// The loop sleeps on a task notification. The deadline comes from a one-shot
+// esp_timer rather than the tick timeout, which is 10 ms at
+// CONFIG_FREERTOS_HZ=100.
+
+static TaskHandle_t s_task;
+static esp_timer_handle_t s_timer;
+
+static void on_timer(void *arg){ xTaskNotifyGive(s_task); }
+
+esp_err_t sch_port_init(void){
+    s_task = xTaskGetCurrentTaskHandle();
+    if (s_timer) return ESP_OK;
+    const esp_timer_create_args_t args = { .callback = on_timer, .name = "sched" };
+    return esp_timer_create(&args, &s_timer);
+}
+
+void sch_port_wait_us(uint32_t us){
+    if (us != UINT32_MAX) esp_timer_start_once(s_timer, us);
+    // a stale notification (timer and trigger both fired) only ends the
+    // next wait early; sch_run_due then returns the time left
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    esp_timer_stop(s_timer);
+}
+
+void sch_port_wake(void){
+    if (!s_task) return;
+    if (xPortInIsrContext()){
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(s_task, &woken);
+        portYIELD_FROM_ISR(woken);
+    } else {
+        xTaskNotifyGive(s_task);
+    }
+}
@@ -1,20 +1,220 @@
 #include "scheduler.h"
+#include "sch_port.h"
 #include "timebase.h"
+#include "prof.h"
+#include "esp_log.h"
+#include <stdatomic.h>
+#include <string.h>
 
-typedef struct { job_fn fn; uint32_t period; uint64_t next_due; } job_t;
-static job_t jobs[12];
-static int njobs = 0;
+static const char *TAG = "sched";
 
-void sch_add(job_fn fn, uint32_t period){
-jobs[njobs++] = (job_t){ .fn=fn, .period=period, .next_due=tb_now_ms()+period };
+typedef struct {
+    job_fn fn;
+    uint32_t period_us;
+    sch_overrun_t overrun;
+    uint64_t due_us;
+    sch_job_stats_t st;
+} job_t;
+
+static job_t s_jobs[SCH_MAX_JOBS];
+static int s_njobs;
+// Periodic jobs by (deadline, id); s_heap[0] is the next one due.
+static uint8_t s_heap[SCH_MAX_JOBS];
+static int s_nheap;
+static sch_stats_t s_stats;
+static int s_running = -1;   // periodic job in dispatch, its deadline still to be set
+#if PROF_ENABLE
+static uint32_t s_job_cyc;   // cycles inside jobs during this sch_run_due
+#endif
+
+// Set by sch_trigger from any context; plain stores only (no RMW atomics
+// on the C3).
+static _Atomic bool s_trig[SCH_MAX_JOBS];
+static _Atomic bool s_any_trig;
+
+static bool before(int a, int b){
+    const job_t *ja = &s_jobs[s_heap[a]], *jb = &s_jobs[s_heap[b]];
+    return ja->due_us != jb->due_us ? ja->due_us < jb->due_us : s_heap[a] < s_heap[b];
+}
+
+static void swap(int a, int b){
+    uint8_t t = s_heap[a];
+    s_heap[a] = s_heap[b];
+    s_heap[b] = t;
+}
+
+static void sift_up(int i){
+    while (i && before(i, (i - 1) / 2)){
+        swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void sift_down(int i){
+    for (;;){
+        int l = 2 * i + 1, m = i;
+        if (l < s_nheap && before(l, m)) m = l;
+        if (l + 1 < s_nheap && before(l + 1, m)) m = l + 1;
+        if (m == i) return;
+        swap(i, m);
+        i = m;
+    }
+}
+
+esp_err_t sch_init(void){
+    memset(s_jobs, 0, sizeof(s_jobs));
+    s_njobs = s_nheap = 0;
+    memset(&s_stats, 0, sizeof(s_stats));
+    for (int i = 0; i < SCH_MAX_JOBS; i++) atomic_store(&s_trig[i], false);
+    atomic_store(&s_any_trig, false);
+    return sch_port_init();
+}
+
+int sch_add(const char *name, job_fn fn, uint32_t period_us, sch_overrun_t overrun){
+    if (!fn || s_njobs == SCH_MAX_JOBS){
+        ESP_LOGE(TAG, "cannot add job %s: %d of %d in use", name ? name : "?", s_njobs, SCH_MAX_JOBS);
+        return -1;
+    }
+    int id = s_njobs++;
+    s_jobs[id] = (job_t){
+        .fn = fn, .period_us = period_us, .overrun = overrun,
+        .st = { .name = name ? name : "?", .period_us = period_us },
+    };
+    if (period_us){
+        s_jobs[id].due_us = tb_now_us() + period_us;
+        s_heap[s_nheap] = (uint8_t)id;
+        sift_up(s_nheap++);
+    }
+    return id;
+}
+
+esp_err_t sch_set_period(int id, uint32_t period_us){
+    if (id < 0 || id >= s_njobs || !period_us || !s_jobs[id].period_us) return ESP_ERR_INVALID_ARG;
+    job_t *j = &s_jobs[id];
+    uint32_t old = j->period_us;
+    j->period_us = j->st.period_us = period_us;
+    if (id == s_running) return ESP_OK;   // the loop sets the next deadline as it returns
+    int i = 0;
+    while (s_heap[i] != id) i++;
+    j->due_us = j->due_us - old + period_us;
+    sift_up(i);
+    sift_down(i);
+    return ESP_OK;
 }
 
-void sch_run_due(void){
-uint64_t now = tb_now_ms();
-for (int i=0;i<njobs;i++){
-if ((int64_t)(now - jobs[i].next_due) >= 0){
-jobs[i].fn();
-jobs[i].next_due += jobs[i].period;
+void sch_trigger(int id){
+    if (id < 0 || id >= s_njobs) return;
+    atomic_store_explicit(&s_trig[id], true, memory_order_release);
+    atomic_store_explicit(&s_any_trig, true, memory_order_release);
+    sch_port_wake();
 }
+
+// Run one job; returns when it started.
+static uint64_t dispatch(job_t *j){
+    uint64_t t0 = tb_now_us();
+#if PROF_ENABLE
+    uint32_t c0 = cyc_now();
+    j->fn();
+    s_job_cyc += cyc_now() - c0;
+#else
+    j->fn();
+#endif
+    uint32_t us = (uint32_t)(tb_now_us() - t0);
+    j->st.runs++;
+    j->st.run_total_us += us;
+    if (us > j->st.run_max_us) j->st.run_max_us = us;
+    s_stats.dispatches++;
+    return t0;
+}
+
+uint32_t sch_run_due(void){
+#if PROF_ENABLE
+    uint32_t c0 = cyc_now();
+    s_job_cyc = 0;
+#endif
+    uint64_t now = tb_now_us();
+    uint32_t ran = 0;
+    s_stats.wakeups++;
+
+    if (atomic_load_explicit(&s_any_trig, memory_order_acquire)){
+        atomic_store_explicit(&s_any_trig, false, memory_order_relaxed);
+        for (int i = 0; i < s_njobs; i++){
+            if (!atomic_load_explicit(&s_trig[i], memory_order_acquire)) continue;
+            // cleared first: a trigger from here on runs the job again
+            atomic_store_explicit(&s_trig[i], false, memory_order_relaxed);
+            s_jobs[i].st.triggered++;
+            dispatch(&s_jobs[i]);
+            ran++;
+        }
+    }
+
+    // deadlines up to `now` only, so a job that overruns cannot keep the
+    // loop here
+    while (s_nheap && s_jobs[s_heap[0]].due_us <= now){
+        job_t *j = &s_jobs[s_heap[0]];
+        uint64_t due = j->due_us;
+        s_running = s_heap[0];
+        uint64_t late = dispatch(j) - due;
+        s_running = -1;
+        if (late > j->st.jitter_max_us) j->st.jitter_max_us = (uint32_t)late;
+        j->st.jitter_total_us += late;
+        if (late >= j->period_us){
+            j->st.missed++;
+            if (j->overrun == SCH_SKIP){
+                uint64_t k = late / j->period_us;
+                j->st.skipped += (uint32_t)k;
+                due += k * j->period_us;
+            }
+        }
+        j->due_us = due + j->period_us;
+        sift_down(0);
+        ran++;
+    }
+    if (!ran) s_stats.idle_wakeups++;
+
+    uint32_t wait = UINT32_MAX;
+    if (s_nheap){
+        uint64_t t = tb_now_us(), next = s_jobs[s_heap[0]].due_us;
+        wait = next <= t ? 0 : next - t >= UINT32_MAX ? UINT32_MAX - 1 : (uint32_t)(next - t);
+    }
+#if PROF_ENABLE
+    // the loop's own cost; jobs have their run times
+    prof_record(PROF_SCH_LOOP, cyc_now() - c0 - s_job_cyc);
+#endif
+    return wait;
+}
+
+void sch_wait_us(uint32_t us){
+    if (us) sch_port_wait_us(us);
+}
+
+int sch_job_count(void){ return s_njobs; }
+
+bool sch_get_job_stats(int id, sch_job_stats_t *out){
+    if (id < 0 || id >= s_njobs) return false;
+    *out = s_jobs[id].st;
+    return true;
+}
+
+void sch_get_stats(sch_stats_t *out){ *out = s_stats; }
+
+void sch_reset_stats(void){
+    memset(&s_stats, 0, sizeof(s_stats));
+    for (int i = 0; i < s_njobs; i++){
+        sch_job_stats_t *st = &s_jobs[i].st;
+        *st = (sch_job_stats_t){ .name = st->name, .period_us = st->period_us };
+    }
+}
+
+void sch_log_stats(void){
+    ESP_LOGI(TAG, "%u wakeups (%u idle), %u dispatches", (unsigned)s_stats.wakeups,
+             (unsigned)s_stats.idle_wakeups, (unsigned)s_stats.dispatches);
+    for (int i = 0; i < s_njobs; i++){
+        const sch_job_stats_t *st = &s_jobs[i].st;
+        uint32_t n = st->runs ? st->runs : 1, timed = st->runs > st->triggered ? st->runs - st->triggered : 1;
+        ESP_LOGI(TAG, "%-16s %8u runs %4u missed %4u skipped  jitter avg %6u max %6u us  run avg %6u max %6u us",
+                 st->name, (unsigned)st->runs, (unsigned)st->missed, (unsigned)st->skipped,
+                 (unsigned)(st->jitter_total_us / timed), (unsigned)st->jitter_max_us,
+                 (unsigned)(st->run_total_us / n), (unsigned)st->run_max_us);
+    }
 }
-}
\ No newline at end of file
@@ -1,19 +1,349 @@
 #include "sd_logger.h"
+#include "sd_port.h"
+#include "crc32.h"
+#include "board.h"
+#include "timebase.h"
 #include "esp_log.h"
-#include "esp_err.h"
+#include <stdatomic.h>
+#include <string.h>
 
 static const char *TAG = "sdlog";
 
-/*
- * SD logging stubbed out so firmware can be developed without SD hardware.
- * This keeps the symbols available but makes the module a harmless no-op.
- */
+#define HDR_BYTES sizeof(sdlog_hdr_t)
+#define REC_BYTES sizeof(sample_t)
+
+_Static_assert(HDR_BYTES % 8 == 0, "records after the header must stay 8-byte aligned");
+_Static_assert(SDLOG_FRAME_RECORDS > 0 && SDLOG_FRAME_RECORDS <= UINT16_MAX, "SD_FRAME_SECTORS out of range");
+
+// One write in flight per buffer. The writer task only touches the buffer
+// it was handed and the result fields of its job, and clears its busy flag
+// when done. Everything else, s_stats included, belongs to the task that
+// appends (the scheduler), which folds finished writes in with reap().
+typedef struct {
+    uint32_t slot;
+    uint32_t seq;
+    uint32_t sectors;
+    uint8_t idx;
+    bool closed;         // a full frame, not a copy of the open one
+    bool owed;           // queued, result not yet in s_stats
+    esp_err_t err;       // set by the writer
+    uint32_t us;         // write + sync time, set by the writer
+} wr_job_t;
+
+static uint8_t s_buf[2][SDLOG_FRAME_BYTES] __attribute__((aligned(8)));
+static uint8_t s_rd[SDLOG_FRAME_BYTES] __attribute__((aligned(8)));   // read-back / resume scratch
+static uint32_t s_rd_seq = UINT32_MAX;   // intact frame held in s_rd, for sdlog_read_records
+static wr_job_t s_wr[2];
+static _Atomic bool s_busy[2];
+static bool s_retry;           // a partial flush failed: rewrite the open frame
+static bool s_unwritten[2];    // holds a closed frame that did not reach the card
+
+static bool s_ready;
+static uint8_t s_active;       // buffer being filled; never busy
+static uint16_t s_count;       // records in the active buffer
+static uint16_t s_flushed;     // of those, already on the card from a partial flush
+static uint32_t s_seq;         // seq of the open frame
+static uint32_t s_slots;
+static uint64_t s_last_write_ms;
+static sdlog_stats_t s_stats;
+
+static inline uint32_t slot_of(uint32_t seq){ return seq % s_slots; }
+
+static void finalize(uint8_t *frame, uint16_t count, uint32_t seq){
+    sdlog_hdr_t h = {
+        .magic = SDLOG_MAGIC, .seq = seq, .version = SDLOG_VERSION, .rec_size = REC_BYTES,
+        .count = count, .flags = 0, .slots = s_slots, .crc = 0,
+    };
+    memcpy(frame, &h, HDR_BYTES);
+    h.crc = crc32_update(0, frame, HDR_BYTES + (size_t)count * REC_BYTES);
+    memcpy(frame, &h, HDR_BYTES);
+}
+
+const sdlog_hdr_t *sdlog_frame_check(const void *frame, size_t len){
+    const sdlog_hdr_t *h = (const sdlog_hdr_t *)frame;
+    if (len < HDR_BYTES || h->magic != SDLOG_MAGIC || h->version != SDLOG_VERSION ||
+        h->rec_size != REC_BYTES || h->count > SDLOG_FRAME_RECORDS)
+        return NULL;
+    size_t body = (size_t)h->count * REC_BYTES;
+    if (len < HDR_BYTES + body) return NULL;
+    sdlog_hdr_t z = *h;
+    z.crc = 0;
+    uint32_t crc = crc32_update(0, &z, HDR_BYTES);
+    crc = crc32_update(crc, (const uint8_t *)frame + HDR_BYTES, body);
+    return crc == h->crc ? h : NULL;
+}
+
+static void write_frame(void *arg){
+    wr_job_t *j = (wr_job_t *)arg;
+    gpio_set_level(LED_SD_GPIO, 1);
+    uint64_t t0 = tb_now_us();
+    esp_err_t r = sd_port_write(j->slot * SD_FRAME_SECTORS, s_buf[j->idx], j->sectors);
+    if (r == ESP_OK) r = sd_port_sync();
+    uint32_t us = (uint32_t)(tb_now_us() - t0);
+    gpio_set_level(LED_SD_GPIO, 0);
+
+    if (r != ESP_OK) ESP_LOGW(TAG, "write of slot %u failed: %d", (unsigned)j->slot, r);
+    j->err = r;
+    j->us = us;
+    atomic_store_explicit(&s_busy[j->idx], false, memory_order_release);
+}
+
+static inline bool busy(uint8_t b){ return atomic_load_explicit(&s_busy[b], memory_order_acquire); }
+
+// Account for a finished write of buffer b: stats, and what to write again.
+static void reap(uint8_t b){
+    wr_job_t *j = &s_wr[b];
+    if (!j->owed || busy(b)) return;
+    j->owed = false;
+    if (j->err != ESP_OK){
+        s_stats.write_errors++;
+        if (j->closed) s_unwritten[b] = true;
+        else s_retry = true;
+    } else {
+        s_stats.bytes += (uint64_t)j->sectors * SD_SECTOR_SIZE;
+    }
+    s_stats.flush_total_us += j->us;
+    if (j->us > s_stats.flush_max_us) s_stats.flush_max_us = j->us;
+}
+
+// Queue the write prepared in s_wr[b].
+static esp_err_t hand_over(uint8_t b){
+    s_wr[b].owed = true;
+    atomic_store_explicit(&s_busy[b], true, memory_order_relaxed);
+    esp_err_t r = sd_port_defer(write_frame, &s_wr[b]);
+    if (r != ESP_OK){
+        s_wr[b].owed = false;
+        atomic_store_explicit(&s_busy[b], false, memory_order_relaxed);
+    }
+    s_stats.writes++;
+    s_last_write_ms = tb_now_ms();
+    return r;
+}
+
+// Hand buffer b, holding `count` records of frame `seq`, to the writer. Only
+// the sectors that hold data are written.
+static esp_err_t submit(uint8_t b, uint16_t count, uint32_t seq, bool closed){
+    finalize(s_buf[b], count, seq);
+    size_t bytes = HDR_BYTES + (size_t)count * REC_BYTES;
+    s_wr[b] = (wr_job_t){ .slot = slot_of(seq), .seq = seq, .sectors = (uint32_t)((bytes + SD_SECTOR_SIZE - 1) / SD_SECTOR_SIZE),
+                          .idx = b, .closed = closed };
+    return hand_over(b);
+}
+
+// True when buffer b can be reused. A closed frame in it that failed to
+// write is handed to the writer again first (same slot and seq), until it
+// gets through.
+static bool settled(uint8_t b){
+    reap(b);
+    if (busy(b)) return false;
+    if (!s_unwritten[b]) return true;
+    s_stats.rewrites++;
+    if (hand_over(b) == ESP_OK) s_unwritten[b] = false;
+    else s_stats.write_errors++;
+    return false;
+}
+
+// Write out the full active frame and open the next one in the other buffer.
+static bool close_frame(void){
+    uint8_t other = s_active ^ 1;
+    if (!settled(other)) return false;
+    esp_err_t r = submit(s_active, s_count, s_seq, true);
+    if (r != ESP_OK){
+        // kept in its buffer: settled() writes it before the buffer is reused
+        s_stats.write_errors++;
+        s_unwritten[s_active] = true;
+        ESP_LOGW(TAG, "write of slot %u not queued: %d", (unsigned)slot_of(s_seq), r);
+    }
+    s_active = other;
+    s_count = s_flushed = 0;
+    s_seq++;
+    s_stats.frames++;
+    if (slot_of(s_seq) == 0) s_stats.wraps++;
+    return true;
+}
+
+size_t sdlog_append(const sample_t *s, size_t n){
+    if (!s_ready) return 0;
+    size_t done = 0;
+    while (done < n){
+        if (s_count == SDLOG_FRAME_RECORDS && !close_frame()){
+            s_stats.stalls++;
+            break;
+        }
+        size_t k = SDLOG_FRAME_RECORDS - s_count;
+        if (k > n - done) k = n - done;
+        memcpy(s_buf[s_active] + HDR_BYTES + (size_t)s_count * REC_BYTES, &s[done], k * REC_BYTES);
+        s_count = (uint16_t)(s_count + k);
+        done += k;
+    }
+    s_stats.records += (uint32_t)done;
+    return done;
+}
+
+esp_err_t sdlog_flush(void){
+    if (!s_ready) return ESP_ERR_INVALID_STATE;
+    // the active buffer keeps filling: write a copy of it from the other one,
+    // once a failed closed frame there is on the card
+    uint8_t other = s_active ^ 1;
+    bool free = settled(other);
+    if (s_count == s_flushed && !s_retry) return ESP_OK;
+    if (!free) return ESP_ERR_INVALID_STATE;
+    memcpy(s_buf[other] + HDR_BYTES, s_buf[s_active] + HDR_BYTES, (size_t)s_count * REC_BYTES);
+    esp_err_t r = submit(other, s_count, s_seq, false);
+    if (r == ESP_OK){
+        s_flushed = s_count;
+        s_retry = false;
+    }
+    return r;
+}
+
+void sdlog_job_flush(void){
+    if (!s_ready) return;
+    if (tb_now_ms() - s_last_write_ms >= SD_FLUSH_PERIOD_MS) sdlog_flush();
+}
+
+// Header of slot `slot` belongs to this log and sits where its seq says.
+static bool slot_header(uint32_t slot, uint32_t *seq){
+    s_rd_seq = UINT32_MAX;
+    if (sd_port_read(slot * SD_FRAME_SECTORS, s_rd, 1) != ESP_OK) return false;
+    const sdlog_hdr_t *h = (const sdlog_hdr_t *)s_rd;
+    if (h->magic != SDLOG_MAGIC || h->version != SDLOG_VERSION || h->rec_size != REC_BYTES ||
+        h->slots != s_slots || h->seq % s_slots != slot)
+        return false;
+    *seq = h->seq;
+    return true;
+}
+
+// Find the newest frame. Slots written in the current lap form a prefix of
+// the file (seq = lap * slots + slot); bisect for its end, then check the
+// last frame in full. An intact, partly filled frame is reopened; a torn
+// one is rewritten with the same seq.
+static void resume(void){
+    uint32_t seq0, seq;
+    s_seq = 0;
+    s_count = s_flushed = 0;
+    if (!slot_header(0, &seq0)){
+        // empty log, or slot 0 torn at the start of a new lap
+        if (slot_header(s_slots - 1, &seq)) s_seq = seq + 1;
+        return;
+    }
+    uint32_t lap = seq0 / s_slots;
+    uint32_t lo = 0, hi = s_slots;   // slot lo is in this lap, slot hi is not
+    while (hi - lo > 1){
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (slot_header(mid, &seq) && seq / s_slots == lap) lo = mid; else hi = mid;
+    }
+    s_seq = lap * s_slots + lo;
+
+    uint8_t *f = s_buf[s_active];
+    const sdlog_hdr_t *h = NULL;
+    if (sd_port_read(lo * SD_FRAME_SECTORS, f, SD_FRAME_SECTORS) == ESP_OK)
+        h = sdlog_frame_check(f, SDLOG_FRAME_BYTES);
+    if (!h){
+        ESP_LOGW(TAG, "frame %u (slot %u) is damaged; rewriting it", (unsigned)s_seq, (unsigned)lo);
+        return;
+    }
+    if (h->count == SDLOG_FRAME_RECORDS){
+        s_seq++;
+        return;
+    }
+    s_count = s_flushed = h->count;
+}
 
 esp_err_t sdlog_init(void){
-    ESP_LOGI(TAG, "SD logging is stubbed out for this build");
+    s_ready = false;
+    esp_err_t r = sd_port_open(SD_LOG_SECTORS);
+    if (r != ESP_OK){
+        ESP_LOGE(TAG, "SD card not available: %d", r);
+        return r;
+    }
+    s_slots = sd_port_sectors() / SD_FRAME_SECTORS;
+    if (s_slots < 2){
+        sd_port_close();
+        return ESP_ERR_INVALID_SIZE;
+    }
+    s_active = 0;
+    s_rd_seq = UINT32_MAX;
+    atomic_store(&s_busy[0], false);
+    atomic_store(&s_busy[1], false);
+    memset(s_wr, 0, sizeof(s_wr));
+    s_retry = false;
+    s_unwritten[0] = s_unwritten[1] = false;
+    resume();
+    s_last_write_ms = tb_now_ms();
+    s_ready = true;
+    ESP_LOGI(TAG, "log: %u frames of %u records, resuming at frame %u (slot %u, %u records)",
+             (unsigned)s_slots, (unsigned)SDLOG_FRAME_RECORDS, (unsigned)s_seq,
+             (unsigned)slot_of(s_seq), (unsigned)s_count);
     return ESP_OK;
 }
 
-void sdlog_job_flush(void){
-    ESP_LOGD(TAG, "sdlog_job_flush: stub no-op");
+bool sdlog_ready(void){ return s_ready; }
+
+uint32_t sdlog_slot(void){ return s_ready ? slot_of(s_seq) : 0; }
+uint32_t sdlog_slots(void){ return s_slots; }
+
+esp_err_t sdlog_read_slot(uint32_t slot, sample_t *out, size_t max, size_t *n, uint32_t *seq){
+    if (!s_ready) return ESP_ERR_INVALID_STATE;
+    if (slot >= s_slots) return ESP_ERR_INVALID_ARG;
+    s_rd_seq = UINT32_MAX;
+    esp_err_t r = sd_port_read(slot * SD_FRAME_SECTORS, s_rd, SD_FRAME_SECTORS);
+    if (r != ESP_OK) return r;
+    const sdlog_hdr_t *h = sdlog_frame_check(s_rd, SDLOG_FRAME_BYTES);
+    if (!h || h->seq % s_slots != slot) return ESP_ERR_INVALID_CRC;
+    size_t k = h->count < max ? h->count : max;
+    memcpy(out, s_rd + HDR_BYTES, k * REC_BYTES);
+    if (n) *n = k;
+    if (seq) *seq = h->seq;
+    return ESP_OK;
+}
+
+uint64_t sdlog_next_record(void){ return (uint64_t)s_seq * SDLOG_FRAME_RECORDS + s_count; }
+
+uint64_t sdlog_oldest_record(void){
+    return s_seq + 1 >= s_slots ? (uint64_t)(s_seq + 1 - s_slots) * SDLOG_FRAME_RECORDS : 0;
+}
+
+esp_err_t sdlog_read_records(uint64_t first, sample_t *out, size_t max, size_t *n){
+    *n = 0;
+    if (!s_ready) return ESP_ERR_INVALID_STATE;
+    if (first < sdlog_oldest_record()) return ESP_ERR_NOT_FOUND;
+    if (first >= sdlog_next_record()) return ESP_OK;
+    uint32_t seq = (uint32_t)(first / SDLOG_FRAME_RECORDS);
+    uint16_t idx = (uint16_t)(first % SDLOG_FRAME_RECORDS);
+
+    // the open frame and one in flight or waiting to be written again are
+    // read from RAM, the rest from the card
+    const uint8_t *f;
+    uint16_t count;
+    uint8_t other = s_active ^ 1;
+    reap(other);
+    if (seq == s_seq){
+        f = s_buf[s_active];
+        count = s_count;
+    } else if ((busy(other) || s_unwritten[other]) && s_wr[other].seq == seq){
+        f = s_buf[other];
+        count = SDLOG_FRAME_RECORDS;
+    } else {
+        if (s_rd_seq != seq){
+            esp_err_t r = sd_port_read(slot_of(seq) * SD_FRAME_SECTORS, s_rd, SD_FRAME_SECTORS);
+            if (r != ESP_OK) return r;
+            const sdlog_hdr_t *h = sdlog_frame_check(s_rd, SDLOG_FRAME_BYTES);
+            if (!h || h->seq != seq || h->count != SDLOG_FRAME_RECORDS) return ESP_ERR_INVALID_CRC;
+            s_rd_seq = seq;
+        }
+        f = s_rd;
+        count = SDLOG_FRAME_RECORDS;
+    }
+    size_t k = (size_t)(count - idx) < max ? (size_t)(count - idx) : max;
+    memcpy(out, f + HDR_BYTES + (size_t)idx * REC_BYTES, k * REC_BYTES);
+    *n = k;
+    return ESP_OK;
+}
+
+void sdlog_get_stats(sdlog_stats_t *out){
+    reap(0);
+    reap(1);
+    *out = s_stats;
 }
+void sdlog_reset_stats(void){ memset(&s_stats, 0, sizeof(s_stats)); }
@@ -0,0 +1,167 @@
+#include "sd_port.h"
+#include "board.h"
+#include "esp_vfs_fat.h"
+#include "sdmmc_cmd.h"
+#include "driver/sdspi_host.h"
+#include "driver/spi_common.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TAG "sd"
+
+#define MOUNT_POINT "/sdcard"
+#define LOG_PATH MOUNT_POINT "/CAPLOG.BIN"
+#define SPI_HZ 20000000
+
+#define WRITER_TASK_PRIO 3     // below the I2C bus task and the scheduler loop
+#define WRITER_QUEUE_DEPTH 2   // one per logger buffer
+
+typedef struct { void (*fn)(void *); void *arg; } deferred_t;
+
+static sdmmc_card_t *s_card;
+static bool s_bus_ready;
+static int s_fd = -1;
+static uint32_t s_sectors;
+static SemaphoreHandle_t s_mutex;
+static QueueHandle_t s_queue;
+
+static void writer_task(void *arg){
+    deferred_t d;
+    for (;;){
+        if (xQueueReceive(s_queue, &d, portMAX_DELAY) == pdTRUE) d.fn(d.arg);
+    }
+}
+
+static esp_err_t mount(void){
+    if (!s_bus_ready){
+        spi_bus_config_t bus = {
+            .mosi_io_num = SD_MOSI_GPIO,
+            .miso_io_num = SD_MISO_GPIO,
+            .sclk_io_num = SD_SCK_GPIO,
+            .quadwp_io_num = -1,
+            .quadhd_io_num = -1,
+            .max_transfer_sz = 4096,
+        };
+        esp_err_t r = spi_bus_initialize(SD_SPI_HOST, &bus, SDSPI_DEFAULT_DMA);
+        if (r != ESP_OK) return r;
+        s_bus_ready = true;
+    }
+    sdmmc_host_t host = SDSPI_HOST_DEFAULT();
+    host.slot = SD_SPI_HOST;
+    host.max_freq_khz = SPI_HZ / 1000;
+    sdspi_device_config_t slot = SDSPI_DEVICE_CONFIG_DEFAULT();
+    slot.gpio_cs = SD_CS_GPIO;
+    slot.host_id = SD_SPI_HOST;
+    esp_vfs_fat_mount_config_t mcfg = {
+        .format_if_mount_failed = false,
+        .max_files = 2,
+        .allocation_unit_size = 16 * 1024,
+    };
+    return esp_vfs_fat_sdspi_mount(MOUNT_POINT, &host, &slot, &mcfg, &s_card);
+}
+
+esp_err_t sd_port_open(uint32_t sectors){
+    sd_port_close();
+    if (!s_mutex) s_mutex = xSemaphoreCreateMutex();
+    if (!s_queue) s_queue = xQueueCreate(WRITER_QUEUE_DEPTH, sizeof(deferred_t));
+    if (!s_mutex || !s_queue) return ESP_ERR_NO_MEM;
+    static bool task_started;
+    if (!task_started){
+        if (xTaskCreate(writer_task, "sd_writer", 3072, NULL, WRITER_TASK_PRIO, NULL) != pdPASS) return ESP_ERR_NO_MEM;
+        task_started = true;
+    }
+
+    esp_err_t r = mount();
+    if (r != ESP_OK){
+        ESP_LOGE(TAG, "mount failed: %s", esp_err_to_name(r));
+        return r;
+    }
+    s_fd = open(LOG_PATH, O_RDWR | O_CREAT, 0644);
+    if (s_fd < 0){
+        ESP_LOGE(TAG, "open %s failed", LOG_PATH);
+        return ESP_FAIL;
+    }
+
+    // Preallocate: seeking past the end and writing the last sector makes
+    // FatFs allocate the whole cluster chain now, so later writes never
+    // touch the FAT. Shrink the request to the free space on the card.
+    struct stat st;
+    if (fstat(s_fd, &st) != 0){
+        ESP_LOGE(TAG, "stat %s failed", LOG_PATH);
+        sd_port_close();
+        return ESP_FAIL;
+    }
+    uint64_t want = (uint64_t)sectors * SD_SECTOR_SIZE;
+    if ((uint64_t)st.st_size < want){
+        uint64_t total = 0, free_bytes = 0;
+        if (esp_vfs_fat_info(MOUNT_POINT, &total, &free_bytes) == ESP_OK &&
+            (uint64_t)st.st_size + free_bytes < want)
+            want = ((uint64_t)st.st_size + free_bytes) / SD_SECTOR_SIZE * SD_SECTOR_SIZE;
+        static const uint8_t zero[SD_SECTOR_SIZE];
+        if (want < SD_SECTOR_SIZE || lseek(s_fd, (off_t)(want - SD_SECTOR_SIZE), SEEK_SET) < 0 ||
+            write(s_fd, zero, SD_SECTOR_SIZE) != SD_SECTOR_SIZE || fsync(s_fd) != 0){
+            ESP_LOGE(TAG, "preallocating %u sectors failed", (unsigned)(want / SD_SECTOR_SIZE));
+            sd_port_close();
+            return ESP_ERR_NO_MEM;
+        }
+        ESP_LOGI(TAG, "preallocated %s: %u KB", LOG_PATH, (unsigned)(want / 1024));
+    } else if ((uint64_t)st.st_size > want){
+        want = (uint64_t)st.st_size / SD_SECTOR_SIZE * SD_SECTOR_SIZE;
+    }
+    s_sectors = (uint32_t)(want / SD_SECTOR_SIZE);
+    return ESP_OK;
+}
+
+uint32_t sd_port_sectors(void){ return s_fd >= 0 ? s_sectors : 0; }
+
+void sd_port_close(void){
+    if (s_fd >= 0) close(s_fd);
+    s_fd = -1;
+    s_sectors = 0;
+    if (s_card){
+        esp_vfs_fat_sdcard_unmount(MOUNT_POINT, s_card);
+        s_card = NULL;
+    }
+}
+
+static esp_err_t xfer(bool wr, uint32_t sector, void *buf, uint32_t count){
+    if (s_fd < 0) return ESP_ERR_INVALID_STATE;
+    if ((uint64_t)sector + count > s_sectors) return ESP_ERR_INVALID_ARG;
+    size_t len = (size_t)count * SD_SECTOR_SIZE;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    // sector-aligned offset and length: FatFs moves whole sectors straight
+    // between buf and the card, without its window buffer
+    ssize_t n = -1;
+    if (lseek(s_fd, (off_t)sector * SD_SECTOR_SIZE, SEEK_SET) >= 0)
+        n = wr ? write(s_fd, buf, len) : read(s_fd, buf, len);
+    xSemaphoreGive(s_mutex);
+    return n == (ssize_t)len ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t sd_port_write(uint32_t sector, const void *buf, uint32_t count){
+    return xfer(true, sector, (void *)buf, count);
+}
+
+esp_err_t sd_port_read(uint32_t sector, void *buf, uint32_t count){
+    return xfer(false, sector, buf, count);
+}
+
+esp_err_t sd_port_sync(void){
+    if (s_fd < 0) return ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    int rc = fsync(s_fd);
+    xSemaphoreGive(s_mutex);
+    return rc == 0 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t sd_port_defer(void (*fn)(void *), void *arg){
+    deferred_t d = { fn, arg };
+    if (!s_queue) return ESP_ERR_INVALID_STATE;
+    return xQueueSend(s_queue, &d, 0) == pdTRUE ? ESP_OK : ESP_ERR_NO_MEM;
+}
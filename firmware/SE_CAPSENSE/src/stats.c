@@ -0,0 +1,147 @@
+#include "stats.h"
+#include "acq.h"
+#include "config.h"
+#include "forward.h"
+#include "i2c_bus.h"
+#include "mqtt_svc.h"
+#include "prof.h"
+#include "record.h"
+#include "sampler.h"
+#include "scheduler.h"
+#include "timebase.h"
+#include "trace.h"
+#include "esp_log.h"
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+static const char *TAG = "stats";
+
+// snprintf that keeps counting past the end of buf
+static void put(char *buf, size_t cap, size_t *len, const char *fmt, ...){
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(*len < cap ? buf + *len : NULL, *len < cap ? cap - *len : 0, fmt, ap);
+    va_end(ap);
+    if (n > 0) *len += (size_t)n;
+}
+
+static void i2c_totals(uint32_t *xfers, uint32_t *errors){
+    i2c_dev_stats_t d[I2C_STATS_MAX_DEVS];
+    size_t n = i2c_bus_get_stats(d, I2C_STATS_MAX_DEVS);
+    *xfers = *errors = 0;
+    for (size_t i = 0; i < n; i++){
+        *xfers += d[i].xfers;
+        *errors += d[i].nacks + d[i].timeouts + d[i].other_errors;
+    }
+}
+
+size_t stats_format(char *buf, size_t cap){
+    size_t len = 0;
+    record_stats_t rs;
+    mqtt_stats_t ms;
+    trace_stats_t ts;
+    acq_stats_t as;
+    rbe_stats_t bs;
+    tb_stats_t tbs;
+    uint32_t xfers, errors;
+    record_get_stats(&rs);
+    fwd_get_rbe_stats(&bs);
+    mqtt_svc_get_stats(&ms);
+    trace_get_stats(&ts);
+    acq_get_stats(&as);
+    tb_get_stats(&tbs);
+    i2c_totals(&xfers, &errors);
+
+    put(buf, cap, &len, "{\"dev\":\"%s\",\"t\":%llu,\"ring\":{\"hw\":%u,\"rej\":%u,\"drop\":%u}", MQTT_CLIENT_ID,
+        (unsigned long long)tb_now_ms(), (unsigned)rs.high_water, (unsigned)rs.rejected, (unsigned)rs.dropped);
+    put(buf, cap, &len, ",\"i2c\":{\"xfers\":%u,\"err\":%u},\"mqtt\":{\"stalls\":%u,\"retx\":%u,\"rbe\":[%u,%u],",
+        (unsigned)xfers, (unsigned)errors, (unsigned)ms.stalls, (unsigned)ms.retransmits, (unsigned)bs.offered,
+        (unsigned)bs.published);
+    put(buf, cap, &len, "\"age\":[%u,%u]},\"sntp\":[%u,%u,%d]",
+        (unsigned)(ms.age_records ? ms.age_total_us / ms.age_records / 1000u : 0), (unsigned)(ms.age_max_us / 1000u),
+        (unsigned)tbs.syncs, (unsigned)tbs.steps, (int)tbs.last_err_us);
+    put(buf, cap, &len, ",\"trace_drop\":%u,\"period_ms\":%u", (unsigned)ts.dropped, (unsigned)sampler_period_ms());
+
+    put(buf, cap, &len, ",\"jobs\":{");
+    for (int i = 0; i < sch_job_count(); i++){
+        sch_job_stats_t j;
+        if (!sch_get_job_stats(i, &j)) continue;
+        put(buf, cap, &len, "%s\"%s\":[%u,%u,%u,%u]", i ? "," : "", j.name, (unsigned)j.runs, (unsigned)j.missed,
+            (unsigned)(j.runs ? j.run_total_us / j.runs : 0), (unsigned)j.run_max_us);
+    }
+    put(buf, cap, &len, "%s\"acq\":[%u,%u,%u,%u]}", sch_job_count() ? "," : "", (unsigned)as.wakeups,
+        (unsigned)as.late, (unsigned)(as.wakeups ? as.run_total_us / as.wakeups : 0), (unsigned)as.run_max_us);
+
+    put(buf, cap, &len, ",\"prof\":{");
+    bool first = true;
+    for (int i = 0; i < PROF_COUNT; i++){
+        prof_probe_t p;
+        prof_get((prof_id_t)i, &p);
+        if (!p.count) continue;
+        put(buf, cap, &len, "%s\"%s\":[%u,%u,%u,%u]", first ? "" : ",", prof_name((prof_id_t)i), (unsigned)p.count,
+            (unsigned)prof_percentile(&p, 50), (unsigned)prof_percentile(&p, 99), (unsigned)p.max);
+        first = false;
+    }
+    put(buf, cap, &len, "}}");
+    return len;
+}
+
+void stats_log(void){
+    record_stats_t rs;
+    trace_stats_t ts;
+    record_get_stats(&rs);
+    trace_get_stats(&ts);
+    ESP_LOGI(TAG, "ring: high water %u of %u, %u rejected, %u dropped; trace: %u dropped", (unsigned)rs.high_water,
+             (unsigned)RECORD_RING_CAP, (unsigned)rs.rejected, (unsigned)rs.dropped, (unsigned)ts.dropped);
+
+    i2c_dev_stats_t d[I2C_STATS_MAX_DEVS];
+    size_t n = i2c_bus_get_stats(d, I2C_STATS_MAX_DEVS);
+    for (size_t i = 0; i < n; i++)
+        ESP_LOGI(TAG, "i2c 0x%02x: %u xfers, %u nacks, %u timeouts, %u other errors, max %u us", d[i].addr,
+                 (unsigned)d[i].xfers, (unsigned)d[i].nacks, (unsigned)d[i].timeouts, (unsigned)d[i].other_errors,
+                 (unsigned)d[i].max_us);
+
+    rbe_stats_t bs;
+    fwd_get_rbe_stats(&bs);
+    if (bs.offered)
+        ESP_LOGI(TAG, "rbe: %u of %u records published (%u%% suppressed), %u heartbeats", (unsigned)bs.published,
+                 (unsigned)bs.offered, (unsigned)(100u - 100ull * bs.published / bs.offered),
+                 (unsigned)bs.why[RBE_HEARTBEAT]);
+
+    tb_stats_t tbs;
+    tb_get_stats(&tbs);
+    if (tbs.syncs)
+        ESP_LOGI(TAG, "sntp: %u answers, %u steps, last error %d us, %d us to slew", (unsigned)tbs.syncs,
+                 (unsigned)tbs.steps, (int)tbs.last_err_us, (int)tbs.slew_us);
+    else
+        ESP_LOGI(TAG, "sntp: no answer yet, records carry no epoch_us");
+
+    adapt_stats_t ad;
+    if (sampler_get_adapt_stats(&ad))
+        ESP_LOGI(TAG, "adapt: period %u ms; %u speedups, %u slowdowns, %u early records over %u", (unsigned)ad.period_ms,
+                 (unsigned)ad.speedups, (unsigned)ad.slowdowns, (unsigned)ad.jumps, (unsigned)ad.records);
+
+    sch_log_stats();
+
+    for (int i = 0; i < PROF_COUNT; i++){
+        prof_probe_t p;
+        prof_get((prof_id_t)i, &p);
+        if (!p.count) continue;
+        ESP_LOGI(TAG, "%-14s %8u calls  avg %8u  p50 %8u  p99 %8u  max %8u cycles", prof_name((prof_id_t)i),
+                 (unsigned)p.count, (unsigned)(p.total / p.count), (unsigned)prof_percentile(&p, 50),
+                 (unsigned)prof_percentile(&p, 99), (unsigned)p.max);
+    }
+}
+
+void stats_job_publish(void){
+    static char s_buf[STATS_JSON_MAX];
+    if (!mqtt_svc_is_connected()) return;
+    size_t len = stats_format(s_buf, sizeof(s_buf));
+    if (len >= sizeof(s_buf)){
+        ESP_LOGW(TAG, "snapshot needs %u bytes, has %u", (unsigned)len, (unsigned)sizeof(s_buf));
+        return;
+    }
+    esp_err_t r = mqtt_svc_publish("stats", s_buf, len);
+    if (r != ESP_OK) ESP_LOGW(TAG, "publish failed: %d", r);
+}
@@ -0,0 +1,24 @@
+#include "tb_port.h"
+#include "timebase.h"
+#include "esp_sntp.h"
+#include "freertos/FreeRTOS.h"
+
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void tb_port_lock(void){ portENTER_CRITICAL_SAFE(&s_mux); }
+void tb_port_unlock(void){ portEXIT_CRITICAL_SAFE(&s_mux); }
+
+// On the lwIP task, with tv the time just received.
+static void on_sync(struct timeval *tv){
+    tb_sync((uint64_t)tv->tv_sec * 1000000u + (uint64_t)tv->tv_usec, tb_now_us());
+}
+
+esp_err_t tb_port_sntp_start(const char *server, uint32_t interval_ms){
+    if (esp_sntp_enabled()) return ESP_OK;
+    esp_sntp_setoperatingmode(ESP_SNTP_OPMODE_POLL);
+    esp_sntp_setservername(0, server);
+    sntp_set_sync_interval(interval_ms);
+    sntp_set_time_sync_notification_cb(on_sync);
+    esp_sntp_init();
+    return ESP_OK;
+}
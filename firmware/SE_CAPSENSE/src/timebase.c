@@ -1,3 +1,74 @@
 #include "timebase.h"
+#include "tb_port.h"
+#include "config.h"
 #include "esp_timer.h"
-uint64_t tb_now_ms(void){ return (uint64_t)(esp_timer_get_time()/1000ULL); }
\ No newline at end of file
+#include <string.h>
+
+uint64_t tb_now_ms(void){ return (uint64_t)(esp_timer_get_time()/1000ULL); }
+uint64_t tb_now_us(void){ return (uint64_t)esp_timer_get_time(); }
+
+// Wall clock = monotonic + s_off + the part of s_slew done by then, which
+// runs from s_slew_from at TB_SLEW_PPM.
+static bool s_synced;
+static int64_t s_off;
+static int64_t s_slew;
+static uint64_t s_slew_from;
+static tb_stats_t s_stats;
+
+static int64_t slewed(uint64_t mono_us){
+    if (!s_slew || mono_us <= s_slew_from) return 0;
+    uint64_t done = (mono_us - s_slew_from) * TB_SLEW_PPM / 1000000u;
+    uint64_t left = (uint64_t)(s_slew < 0 ? -s_slew : s_slew);
+    if (done > left) done = left;
+    return s_slew < 0 ? -(int64_t)done : (int64_t)done;
+}
+
+static int32_t clamp32(int64_t v){ return v > INT32_MAX ? INT32_MAX : v < INT32_MIN ? INT32_MIN : (int32_t)v; }
+
+esp_err_t tb_sntp_start(void){ return tb_port_sntp_start(TB_SNTP_SERVER, TB_SNTP_INTERVAL_MS); }
+
+void tb_sync(uint64_t epoch_us, uint64_t mono_us){
+    tb_port_lock();
+    int64_t off = s_off + slewed(mono_us);
+    int64_t err = (int64_t)(epoch_us - mono_us) - off;
+    s_stats.syncs++;
+    s_stats.last_err_us = clamp32(-err);
+    if (!s_synced || err > TB_STEP_US || err < -TB_STEP_US){
+        s_off = (int64_t)(epoch_us - mono_us);
+        s_slew = 0;
+        s_stats.steps++;
+    } else {
+        // what is left of the last slew is part of err
+        s_off = off;
+        s_slew = err;
+        s_slew_from = mono_us;
+    }
+    s_synced = true;
+    tb_port_unlock();
+}
+
+bool tb_synced(void){ return s_synced; }
+
+uint64_t tb_epoch_us(uint64_t mono_us){
+    tb_port_lock();
+    uint64_t t = s_synced ? mono_us + (uint64_t)(s_off + slewed(mono_us)) : 0;
+    tb_port_unlock();
+    return t;
+}
+
+void tb_get_stats(tb_stats_t *out){
+    uint64_t now = tb_now_us();
+    tb_port_lock();
+    *out = s_stats;
+    out->slew_us = clamp32(s_slew - slewed(now));
+    tb_port_unlock();
+}
+
+void tb_reset(void){
+    tb_port_lock();
+    s_synced = false;
+    s_off = s_slew = 0;
+    s_slew_from = 0;
+    memset(&s_stats, 0, sizeof(s_stats));
+    tb_port_unlock();
+}
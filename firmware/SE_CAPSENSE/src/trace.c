@@ -0,0 +1,226 @@
+#include "trace.h"
+#include "trace_port.h"
+#include "timebase.h"
+#include <inttypes.h>
+#include <string.h>
+
+_Static_assert((TRACE_RING_LEN & (TRACE_RING_LEN - 1)) == 0, "TRACE_RING_LEN must be a power of two");
+_Static_assert(TRACE_FMT_MAX < UINT16_MAX, "TRACE_FMT_MAX out of range");
+
+#define MASK (TRACE_RING_LEN - 1u)
+#define HDR_BYTES 6
+#define TEXT_MAX 160
+
+uint8_t trace_level = TRACE_LEVEL;
+
+// Both ends take the port lock: emitters are any task (or ISR), the
+// consumer is the loop.
+static trace_ev_t s_ring[TRACE_RING_LEN];
+static uint32_t s_head, s_tail;
+static trace_fmt_t *s_fmts[TRACE_FMT_MAX];
+static uint16_t s_nfmt;
+static trace_stats_t s_stats;
+
+void trace_init(void){
+    trace_port_lock();
+    for (uint16_t i = 0; i < s_nfmt; i++) s_fmts[i]->id = 0;
+    s_nfmt = 0;
+    s_head = s_tail = 0;
+    memset(&s_stats, 0, sizeof(s_stats));
+    trace_port_unlock();
+}
+
+void trace_emit(trace_fmt_t *f, const char *tag, uint8_t nargs, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3){
+    uint32_t t_ms = (uint32_t)tb_now_ms();
+    trace_port_lock();
+    if (!f->id){
+        if (s_nfmt == TRACE_FMT_MAX){
+            s_stats.no_id++;
+            trace_port_unlock();
+            return;
+        }
+        f->tag = tag;
+        s_fmts[s_nfmt++] = f;
+        f->id = s_nfmt;
+    }
+    uint32_t n = s_head - s_tail;
+    if (n == TRACE_RING_LEN) s_stats.dropped++;
+    else {
+        s_ring[s_head & MASK] = (trace_ev_t){ .id = f->id, .nargs = nargs, .t_ms = t_ms, .arg = { a0, a1, a2, a3 } };
+        s_head++;
+        s_stats.events++;
+        if (n + 1 > s_stats.high_water) s_stats.high_water = n + 1;
+    }
+    trace_port_unlock();
+}
+
+size_t trace_pop(trace_ev_t *out, size_t max){
+    trace_port_lock();
+    size_t k = 0;
+    for (; k < max && s_tail != s_head; k++) out[k] = s_ring[s_tail++ & MASK];
+    trace_port_unlock();
+    return k;
+}
+
+const trace_fmt_t *trace_fmt(uint16_t id){ return id && id <= s_nfmt ? s_fmts[id - 1] : NULL; }
+
+static void put_str(char *out, size_t cap, size_t *len, const char *s){
+    for (; *s; s++, (*len)++)
+        if (*len + 1 < cap) out[*len] = *s;
+}
+
+int trace_format(char *out, size_t cap, const char *fmt, const uint32_t *arg, uint8_t nargs){
+    size_t len = 0;
+    uint8_t k = 0;
+    const char *p = fmt;
+    while (*p){
+        if (*p != '%'){
+            if (len + 1 < cap) out[len] = *p;
+            len++;
+            p++;
+            continue;
+        }
+        // rebuild the conversion without its length modifier: every
+        // argument is 32 bits, whatever the target's PRId32 says
+        char spec[16] = "%", tmp[40];
+        size_t n = 1;
+        const char *q = p + 1;
+        while (*q && strchr("-+ #0123456789.", *q)){
+            if (n < sizeof(spec) - 2) spec[n++] = *q;
+            q++;
+        }
+        while (*q && strchr("hljzt", *q)) q++;
+        char conv = *q;
+        if (!conv) break;
+        spec[n++] = conv;
+        spec[n] = '\0';
+        p = q + 1;
+        if (conv == '%') strcpy(tmp, "%");
+        else if (k >= nargs) strcpy(tmp, "?");
+        else if (conv == 'd' || conv == 'i') snprintf(tmp, sizeof(tmp), spec, (int)(int32_t)arg[k++]);
+        else if (strchr("uxXoc", conv)) snprintf(tmp, sizeof(tmp), spec, (unsigned)arg[k++]);
+        else {
+            strcpy(tmp, "?");
+            k++;
+        }
+        put_str(out, cap, &len, tmp);
+    }
+    if (cap) out[len < cap ? len : cap - 1] = '\0';
+    return (int)len;
+}
+
+void trace_job_flush(void){
+    trace_ev_t ev[8];
+    size_t n;
+    char text[TEXT_MAX];
+    while ((n = trace_pop(ev, 8)) > 0){
+        for (size_t i = 0; i < n; i++){
+            const trace_fmt_t *f = trace_fmt(ev[i].id);
+            if (!f) continue;
+            trace_format(text, sizeof(text), f->fmt, ev[i].arg, ev[i].nargs);
+            ESP_LOG_LEVEL((esp_log_level_t)f->level, f->tag, "(%" PRIu32 ") %s", ev[i].t_ms, text);
+        }
+        s_stats.formatted += (uint32_t)n;
+    }
+}
+
+static void put_le(uint8_t *p, uint32_t v, int bytes){
+    for (int i = 0; i < bytes; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t get_le(const uint8_t *p, int bytes){
+    uint32_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--) v = v << 8 | p[i];
+    return v;
+}
+
+size_t trace_export(void *buf, size_t cap){
+    uint8_t *b = buf;
+    trace_port_lock();
+    uint16_t nfmt = s_nfmt;
+    trace_port_unlock();
+
+    size_t len = HDR_BYTES;
+    if (cap < len) return 0;
+    for (uint16_t i = 0; i < nfmt; i++){
+        const trace_fmt_t *f = s_fmts[i];
+        size_t lt = strlen(f->tag) + 1, lf = strlen(f->fmt) + 1;
+        if (len + 1 + lt + lf > cap) return 0;
+        b[len++] = f->level;
+        memcpy(b + len, f->tag, lt);
+        memcpy(b + len + lt, f->fmt, lf);
+        len += lt + lf;
+    }
+    uint16_t nev = 0;
+    trace_port_lock();
+    while (s_tail != s_head && nev < UINT16_MAX){
+        const trace_ev_t *e = &s_ring[s_tail & MASK];
+        size_t need = 7 + 4u * e->nargs;
+        if (e->id > nfmt) break;   // its format came after the dictionary
+        if (len + need > cap) break;
+        put_le(b + len, e->id, 2);
+        put_le(b + len + 2, e->t_ms, 4);
+        b[len + 6] = e->nargs;
+        for (uint8_t a = 0; a < e->nargs; a++) put_le(b + len + 7 + 4 * a, e->arg[a], 4);
+        len += need;
+        s_tail++;
+        nev++;
+    }
+    trace_port_unlock();
+    b[0] = 'T';
+    b[1] = TRACE_VERSION;
+    put_le(b + 2, nfmt, 2);
+    put_le(b + 4, nev, 2);
+    return len;
+}
+
+esp_err_t trace_decode(const void *blob, size_t len, void (*line)(void *ctx, const char *text), void *ctx){
+    const uint8_t *b = blob, *p = b + HDR_BYTES, *end = b + len;
+    if (len < HDR_BYTES || b[0] != 'T') return ESP_ERR_INVALID_ARG;
+    if (b[1] != TRACE_VERSION) return ESP_ERR_INVALID_VERSION;
+    uint16_t nfmt = (uint16_t)get_le(b + 2, 2), nev = (uint16_t)get_le(b + 4, 2);
+    if (nfmt > TRACE_FMT_MAX) return ESP_ERR_INVALID_ARG;
+
+    const char *tags[TRACE_FMT_MAX], *fmts[TRACE_FMT_MAX];
+    uint8_t levels[TRACE_FMT_MAX];
+    for (uint16_t i = 0; i < nfmt; i++){
+        if (p == end) return ESP_ERR_INVALID_SIZE;
+        levels[i] = *p++;
+        for (int s = 0; s < 2; s++){
+            const uint8_t *z = memchr(p, '\0', (size_t)(end - p));
+            if (!z) return ESP_ERR_INVALID_SIZE;
+            if (s) fmts[i] = (const char *)p; else tags[i] = (const char *)p;
+            p = z + 1;
+        }
+    }
+
+    char text[TEXT_MAX], out[TEXT_MAX + 48];
+    for (uint16_t i = 0; i < nev; i++){
+        if (end - p < 7) return ESP_ERR_INVALID_SIZE;
+        uint16_t id = (uint16_t)get_le(p, 2);
+        uint32_t t_ms = get_le(p + 2, 4), arg[TRACE_ARGS_MAX];
+        uint8_t nargs = p[6];
+        if (!id || id > nfmt || nargs > TRACE_ARGS_MAX) return ESP_ERR_INVALID_ARG;
+        if ((size_t)(end - p) < 7 + 4u * nargs) return ESP_ERR_INVALID_SIZE;
+        for (uint8_t a = 0; a < nargs; a++) arg[a] = get_le(p + 7 + 4 * a, 4);
+        p += 7 + 4 * nargs;
+        trace_format(text, sizeof(text), fmts[id - 1], arg, nargs);
+        uint8_t lv = levels[id - 1];
+        snprintf(out, sizeof(out), "%c (%" PRIu32 ") %s: %s", lv <= ESP_LOG_VERBOSE ? "NEWIDV"[lv] : '?', t_ms,
+                 tags[id - 1], text);
+        line(ctx, out);
+    }
+    return ESP_OK;
+}
+
+void trace_get_stats(trace_stats_t *out){
+    trace_port_lock();
+    *out = s_stats;
+    trace_port_unlock();
+}
+
+void trace_reset_stats(void){
+    trace_port_lock();
+    memset(&s_stats, 0, sizeof(s_stats));
+    trace_port_unlock();
+}
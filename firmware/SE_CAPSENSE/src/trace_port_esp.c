@@ -0,0 +1,7 @@
+#include "trace_port.h"
+#include "freertos/FreeRTOS.h"
+
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void trace_port_lock(void){ portENTER_CRITICAL_SAFE(&s_mux); }
+void trace_port_unlock(void){ portEXIT_CRITICAL_SAFE(&s_mux); }
@@ -0,0 +1,364 @@
+#include "tscodec.h"
+#include "wmc.h"
+#include <string.h>
+
+static uint64_t zz(int64_t v){ return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static int64_t unzz(uint64_t v){ return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+static unsigned width_of(uint64_t v){
+    unsigned w = 0;
+    uint32_t hi = (uint32_t)(v >> 32);
+    if (hi){ w = 32; v = hi; }
+    uint32_t x = (uint32_t)v;
+    return x ? w + 32 - (unsigned)__builtin_clz(x) : w;
+}
+
+// Value channels in map bit order, as in reccodec.c but with cap_raw[4..]
+// straight after mc_cpct.
+static int64_t chan(const sample_t *s, int c){
+    if (c >= 8) return s->cap_raw[c - 4];
+    switch (c){
+    case 0: case 1: case 2: case 3: return s->cap_raw[c];
+    case 4: return s->temp_cdeg;
+    case 5: return s->hum_q10;
+    case 6: return s->pres_q8;
+    default: return s->mc_cpct;
+    }
+}
+
+static void set_chan(sample_t *s, int c, int64_t v){
+    if (c >= 8){
+        s->cap_raw[c - 4] = (int32_t)v;
+        return;
+    }
+    switch (c){
+    case 0: case 1: case 2: case 3: s->cap_raw[c] = (int32_t)v; break;
+    case 4: s->temp_cdeg = (int32_t)v; break;
+    case 5: s->hum_q10 = (uint32_t)v; break;
+    case 6: s->pres_q8 = (uint32_t)v; break;
+    default: s->mc_cpct = (uint16_t)v; break;
+    }
+}
+
+// t_us and epoch_us present, at the top of the map
+#define MAP_T_US (1ull << 62)
+#define MAP_EPOCH (1ull << 63)
+#define W_LAG TSC_CHANS
+#define W_OFF (TSC_CHANS + 1)
+
+static uint64_t map_of(const sample_t *s){
+    uint64_t m = 0;
+    if (s->t_us) m |= MAP_T_US;
+    if (s->epoch_us) m |= MAP_EPOCH;
+    for (int c = 0; c < 7; c++) if (chan(s, c)) m |= 1u << c;
+    if (s->mc_cpct != WMC_INVALID) m |= 1u << 7;
+    for (int c = 8; c < TSC_CHANS; c++) if (s->cap_raw[c - 4] || s->capdac[c - 4]) m |= 1ull << c;
+    return m;
+}
+
+static bool dac_changed(const sample_t *s, const sample_t *prev, uint64_t map){
+    if (memcmp(s->capdac, prev->capdac, 4)) return true;
+    for (int c = 8; c < TSC_CHANS; c++)
+        if ((map >> c & 1) && s->capdac[c - 4] != prev->capdac[c - 4]) return true;
+    return false;
+}
+
+// Low n bits of v (n <= 32), MSB first. A byte is cleared when the stream
+// first enters it.
+static void put(tsc_enc_t *e, uint32_t v, unsigned n){
+    while (n){
+        size_t byte = e->bits >> 3;
+        if (byte >= e->cap){
+            e->over = true;
+            return;
+        }
+        unsigned off = e->bits & 7, k = 8 - off < n ? 8 - off : n;
+        if (!off) e->buf[byte] = 0;
+        e->buf[byte] |= (uint8_t)(((v >> (n - k)) & ((1u << k) - 1)) << (8 - off - k));
+        e->bits += k;
+        n -= k;
+    }
+}
+
+static void put64(tsc_enc_t *e, uint64_t v, unsigned n){
+    if (n > 32){
+        put(e, (uint32_t)(v >> 32), n - 32);
+        n = 32;
+    }
+    put(e, (uint32_t)v, n);
+}
+
+static bool get(tsc_dec_t *d, unsigned n, uint64_t *v){
+    if (d->end_bits - d->bits < n) return false;
+    uint64_t r = 0;
+    while (n){
+        unsigned off = d->bits & 7, k = 8 - off < n ? 8 - off : n;
+        uint8_t b = d->buf[d->bits >> 3];
+        r = (r << k) | ((b >> (8 - off - k)) & ((1u << k) - 1));
+        d->bits += k;
+        n -= k;
+    }
+    *v = r;
+    return true;
+}
+
+static bool get_bit(tsc_dec_t *d, bool *b){
+    uint64_t v;
+    if (!get(d, 1, &v)) return false;
+    *b = v != 0;
+    return true;
+}
+
+// Time buckets: prefix, payload bits.
+static const uint8_t TB_PREFIX[] = { 0x2, 0x6, 0xE, 0xF };
+static const uint8_t TB_PLEN[] = { 2, 3, 4, 4 };
+static const uint8_t TB_BITS[] = { 7, 12, 20, 64 };
+
+static void put_dod(tsc_enc_t *e, uint64_t v){
+    if (!v){
+        put(e, 0, 1);
+        return;
+    }
+    int b = 0;
+    while (b < 3 && v >> TB_BITS[b]) b++;
+    put(e, TB_PREFIX[b], TB_PLEN[b]);
+    put64(e, v, TB_BITS[b]);
+}
+
+static bool get_dod(tsc_dec_t *d, uint64_t *v){
+    int b = -1;
+    bool one = true;
+    while (one && b < 3){
+        if (!get_bit(d, &one)) return false;
+        if (one) b++;
+    }
+    // b = -1: '0'; 0..2: '1'x(b+1) '0'; 3: '1111'
+    if (b < 0){
+        *v = 0;
+        return true;
+    }
+    return get(d, TB_BITS[b], v);
+}
+
+static void put_val(tsc_enc_t *e, uint8_t *width, uint64_t v){
+    if (!v){
+        put(e, 0, 1);
+        return;
+    }
+    unsigned w = width_of(v);
+    if (*width && w <= *width && *width - w <= 6){
+        put(e, 0x2, 2);
+        put64(e, v, *width);
+        return;
+    }
+    put(e, 0x3, 2);
+    put(e, w - 1, 6);
+    put64(e, v, w);
+    *width = (uint8_t)w;
+}
+
+static bool get_val(tsc_dec_t *d, uint8_t *width, uint64_t *v){
+    bool b;
+    if (!get_bit(d, &b)) return false;
+    if (!b){
+        *v = 0;
+        return true;
+    }
+    if (!get_bit(d, &b)) return false;
+    if (b){
+        uint64_t w;
+        if (!get(d, 6, &w)) return false;
+        *width = (uint8_t)(w + 1);
+    } else if (!*width){
+        return false;
+    }
+    return get(d, *width, v);
+}
+
+esp_err_t tsc_enc_init(tsc_enc_t *e, void *buf, size_t cap, uint32_t period_ms){
+    if (cap < TSC_HEADER_BYTES) return ESP_ERR_INVALID_SIZE;
+    memset(e, 0, sizeof(*e));
+    e->buf = buf;
+    e->cap = cap;
+    e->period_ms = period_ms;
+    e->prev_dt = period_ms;
+    uint8_t h[TSC_HEADER_BYTES] = {
+        TSC_MAGIC, TSC_VERSION, 0, 0,
+        (uint8_t)period_ms, (uint8_t)(period_ms >> 8), (uint8_t)(period_ms >> 16), (uint8_t)(period_ms >> 24),
+    };
+    memcpy(e->buf, h, sizeof(h));
+    e->bits = TSC_HEADER_BYTES * 8;
+    return ESP_OK;
+}
+
+bool tsc_enc_add(tsc_enc_t *e, const sample_t *s){
+    if (e->count == UINT16_MAX) return false;
+    tsc_enc_t saved = *e;
+
+    uint64_t map = map_of(s);
+    if (map == e->prev_map) put(e, 0, 1);
+    else {
+        put(e, 1, 1);
+        put(e, (uint32_t)map & 0xFF, 8);
+        uint64_t ext = (map & ~(MAP_T_US | MAP_EPOCH)) >> 8;
+        if (!ext) put(e, 0, 1);
+        else {
+            unsigned n = width_of(ext);
+            put(e, 1, 1);
+            put(e, n - 1, 5);
+            put64(e, ext, n);
+        }
+        put(e, (uint32_t)(map >> 62), 2);
+    }
+    uint64_t dt = e->prev_dt;
+    if (!e->count) put64(e, s->t_ms, 64);
+    else {
+        dt = s->t_ms - e->prev.t_ms;
+        put_dod(e, zz((int64_t)(dt - e->prev_dt)));
+    }
+    // modulo 2^64 like the fields themselves; signed only to zigzag
+    uint64_t lag = s->t_ms * 1000u - s->t_us, off = s->epoch_us - s->t_us;
+    if (map & MAP_T_US) put_val(e, &e->width[W_LAG], zz((int64_t)(lag - e->prev_lag)));
+    if (map & MAP_EPOCH) put_val(e, &e->width[W_OFF], zz((int64_t)(off - e->prev_off)));
+    if (!dac_changed(s, &e->prev, map)) put(e, 0, 1);
+    else {
+        put(e, 1, 1);
+        put(e, (uint32_t)s->capdac[0] << 24 | (uint32_t)s->capdac[1] << 16 | (uint32_t)s->capdac[2] << 8 | s->capdac[3], 32);
+        for (int c = 8; c < TSC_CHANS; c++) if (map >> c & 1) put(e, s->capdac[c - 4], 8);
+    }
+    for (int c = 0; c < TSC_CHANS; c++)
+        if (map >> c & 1) put_val(e, &e->width[c], zz(chan(s, c) - chan(&e->prev, c)));
+    if (s->flags == e->prev.flags) put(e, 0, 1);
+    else {
+        put(e, 1, 1);
+        put(e, s->flags, 16);
+    }
+
+    if (e->over){
+        // drop the partial record, including its bits in the last byte
+        if (saved.bits & 7) saved.buf[saved.bits >> 3] &= (uint8_t)(0xFF00u >> (saved.bits & 7));
+        *e = saved;
+        return false;
+    }
+    e->count++;
+    e->buf[2] = (uint8_t)e->count;
+    e->buf[3] = (uint8_t)(e->count >> 8);
+    e->prev_dt = dt;
+    e->prev_map = map;
+    if (map & MAP_T_US) e->prev_lag = lag;
+    if (map & MAP_EPOCH) e->prev_off = off;
+    // absent channels keep the last value (and cap_raw[4..] its capdac) as
+    // the base for the next delta
+    sample_t base = *s;
+    for (int c = 0; c < TSC_CHANS; c++){
+        if (map >> c & 1) continue;
+        set_chan(&base, c, chan(&e->prev, c));
+        if (c >= 8) base.capdac[c - 4] = e->prev.capdac[c - 4];
+    }
+    e->prev = base;
+    return true;
+}
+
+esp_err_t tsc_dec_init(tsc_dec_t *d, const void *buf, size_t len){
+    const uint8_t *b = buf;
+    memset(d, 0, sizeof(*d));
+    if (len < TSC_HEADER_BYTES) return ESP_ERR_INVALID_SIZE;
+    if (b[0] != TSC_MAGIC) return ESP_ERR_INVALID_ARG;
+    if (!b[1] || b[1] > TSC_VERSION) return ESP_ERR_INVALID_VERSION;
+    d->version = b[1];
+    d->buf = b;
+    d->bits = TSC_HEADER_BYTES * 8;
+    d->end_bits = len * 8;
+    d->count = d->left = (uint16_t)(b[2] | b[3] << 8);
+    d->period_ms = (uint32_t)b[4] | (uint32_t)b[5] << 8 | (uint32_t)b[6] << 16 | (uint32_t)b[7] << 24;
+    d->prev_dt = d->period_ms;
+    return ESP_OK;
+}
+
+static esp_err_t read_record(tsc_dec_t *d, sample_t *s, uint64_t *map, uint64_t *dt){
+    uint64_t v;
+    bool b;
+    if (!get_bit(d, &b)) return ESP_ERR_INVALID_SIZE;
+    if (b){
+        if (!get(d, 8, &v)) return ESP_ERR_INVALID_SIZE;
+        *map = v;
+        if (d->version > 1){
+            if (!get_bit(d, &b)) return ESP_ERR_INVALID_SIZE;
+            if (b){
+                uint64_t n;
+                if (!get(d, 5, &n) || !get(d, (unsigned)n + 1, &v)) return ESP_ERR_INVALID_SIZE;
+                // a build with more FDC1004s
+                if (n + 1 > TSC_CHANS - 8) return ESP_ERR_NOT_SUPPORTED;
+                *map |= v << 8;
+            }
+        }
+        if (d->version > 2){
+            if (!get(d, 2, &v)) return ESP_ERR_INVALID_SIZE;
+            *map |= v << 62;
+        }
+    }
+    if (d->left == d->count){
+        if (!get(d, 64, &v)) return ESP_ERR_INVALID_SIZE;
+        s->t_ms = v;
+    } else {
+        if (!get_dod(d, &v)) return ESP_ERR_INVALID_SIZE;
+        *dt = d->prev_dt + (uint64_t)unzz(v);
+        s->t_ms = d->prev.t_ms + *dt;
+    }
+    s->t_us = s->epoch_us = 0;
+    if (*map & MAP_T_US){
+        if (!get_val(d, &d->width[W_LAG], &v)) return ESP_ERR_INVALID_SIZE;
+        d->prev_lag += (uint64_t)unzz(v);
+        s->t_us = s->t_ms * 1000u - d->prev_lag;
+    }
+    if (*map & MAP_EPOCH){
+        if (!get_val(d, &d->width[W_OFF], &v)) return ESP_ERR_INVALID_SIZE;
+        d->prev_off += (uint64_t)unzz(v);
+        s->epoch_us = s->t_us + d->prev_off;
+    }
+    if (!get_bit(d, &b)) return ESP_ERR_INVALID_SIZE;
+    if (b){
+        if (!get(d, 32, &v)) return ESP_ERR_INVALID_SIZE;
+        for (int i = 0; i < 4; i++) s->capdac[i] = (uint8_t)(v >> (24 - 8 * i));
+        for (int c = 8; c < TSC_CHANS; c++){
+            if (!(*map >> c & 1)) continue;
+            if (!get(d, 8, &v)) return ESP_ERR_INVALID_SIZE;
+            s->capdac[c - 4] = (uint8_t)v;
+        }
+    }
+    for (int c = 0; c < TSC_CHANS; c++){
+        if (!(*map >> c & 1)) continue;
+        if (!get_val(d, &d->width[c], &v)) return ESP_ERR_INVALID_SIZE;
+        set_chan(s, c, chan(&d->prev, c) + unzz(v));
+    }
+    if (!get_bit(d, &b)) return ESP_ERR_INVALID_SIZE;
+    if (b){
+        if (!get(d, 16, &v)) return ESP_ERR_INVALID_SIZE;
+        s->flags = (uint16_t)v;
+    }
+    return ESP_OK;
+}
+
+esp_err_t tsc_dec_next(tsc_dec_t *d, sample_t *out){
+    if (!d->left) return ESP_ERR_NOT_FOUND;
+    tsc_dec_t saved = *d;
+    sample_t s = d->prev;
+    uint64_t map = d->prev_map;
+    uint64_t dt = d->prev_dt;
+    esp_err_t r = read_record(d, &s, &map, &dt);
+    if (r != ESP_OK){
+        *d = saved;
+        return r;
+    }
+    d->prev = s;
+    d->prev_dt = dt;
+    d->prev_map = map;
+    d->left--;
+
+    *out = s;
+    for (int c = 0; c < 7; c++) if (!(map & (1u << c))) set_chan(out, c, 0);
+    if (!(map & (1u << 7))) out->mc_cpct = WMC_INVALID;
+    for (int c = 8; c < TSC_CHANS; c++)
+        if (!(map >> c & 1)) out->cap_raw[c - 4] = out->capdac[c - 4] = 0;
+    return ESP_OK;
+}
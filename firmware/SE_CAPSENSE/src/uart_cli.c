@@ -3,15 +3,35 @@
 #include "driver/uart.h"
 #include <string.h>
 #include "wifi_svc.h"
+#include "wmc.h"
+#include "stats.h"
+#include "i2ctrace.h"
+#include <stdio.h>
 
 static const char *TAG = "cli";
+
+// Stop the I2C capture and print it as "I2CT <hex>" lines, which
+// host/tools/i2creplay reads back from a saved console log.
+static void i2c_trace_dump(void){
+    const uint8_t *b;
+    size_t len = i2ct_capture_stop((const void **)&b);
+    i2ct_stats_t st;
+    i2ct_get_stats(&st);
+    ESP_LOGI(TAG, "I2C trace: %u transfers, %u dropped, %u bytes", (unsigned)st.records, (unsigned)st.dropped,
+             (unsigned)len);
+    for (size_t i = 0; i < len; i += 32){
+        printf("I2CT ");
+        for (size_t k = i; k < len && k < i + 32; k++) printf("%02x", b[k]);
+        printf("\n");
+    }
+}
 static void cli_task(void *arg){
     (void)arg;
     const int RX_BUF_SIZE = 256;
     uint8_t *data = malloc(RX_BUF_SIZE);
     char line[256];
     int line_pos = 0;
-    ESP_LOGI(TAG, "UART CLI active. Commands: 'wifi set <ssid> <psk>', 'wifi show', 'wifi clear', 'wifi prompt', 'help'");
+    ESP_LOGI(TAG, "UART CLI active. Commands: 'wifi set <ssid> <psk>', 'wifi show', 'wifi clear', 'wifi prompt', 'wmc show', 'wmc species <name>', 'stats', 'i2c trace', 'help'");
 
     // Use UART0 (console)
     uart_driver_install(UART_NUM_0, RX_BUF_SIZE * 2, 0, 0, NULL, 0);
@@ -128,8 +148,21 @@ static void cli_task(void *arg){
                                 }
                             }
                         }
+                    } else if (strcmp(line, "wmc show") == 0){
+                        ESP_LOGI(TAG, "WMC species: %s", wmc_species_name(wmc_get_species()));
+                    } else if (strncmp(line, "wmc species ", 12) == 0){
+                        wmc_species_t sp = wmc_species_from_name(line + 12);
+                        if (wmc_set_species(sp) == ESP_OK){
+                            ESP_LOGI(TAG, "WMC species set to %s", wmc_species_name(sp));
+                        } else {
+                            ESP_LOGI(TAG, "Species: generic, pine, spruce, douglas-fir, oak, beech");
+                        }
+                    } else if (strcmp(line, "stats") == 0){
+                        stats_log();
+                    } else if (strcmp(line, "i2c trace") == 0){
+                        i2c_trace_dump();
                     } else if (strcmp(line, "help") == 0){
-                        ESP_LOGI(TAG, "Commands: 'wifi set <ssid> <psk>', 'wifi show', 'wifi clear', 'wifi prompt', 'help'");
+                        ESP_LOGI(TAG, "Commands: 'wifi set <ssid> <psk>', 'wifi show', 'wifi clear', 'wifi prompt', 'wmc show', 'wmc species <name>', 'stats', 'i2c trace', 'help'");
                     } else {
                         ESP_LOGI(TAG, "Unknown command: %s", line);
                         ESP_LOGI(TAG, "Type 'help' for commands");
@@ -0,0 +1,128 @@
+#include "wmc.h"
+#include "config.h"
+#include <string.h>
+
+// Dielectric model of the wood under the electrodes, after
+// docs/ScyPy_Images/dielectric_vs_moisture.png (3 + 0.8 * MC at SG 0.5):
+//   eps(MC, T) = 1 + 4.0 * SG + 1.6 * SG * MC * (1 + 0.004 * (T - 20))
+// Water per unit volume scales with density, so the moisture term scales with
+// specific gravity; bound-water permittivity rises about 0.4 %/degC. The
+// electrodes see C = WMC_SENSOR_C0_AF + WMC_SENSOR_CE_AF * eps.
+// The expressions below are constant: the compiler folds them into the
+// tables and nothing in this model is evaluated at run time. To use measured
+// calibration curves, replace WMC_EPS.
+
+#define WMC_MC_STEP 200     // 2 % grid, 0.01 % units
+#define WMC_MC_N (WMC_MC_MAX_CPCT / WMC_MC_STEP + 1)
+#define WMC_T_STEP 1000     // 10 degC grid, 0.01 degC units
+#define WMC_T_N ((WMC_T_MAX_CDEG - WMC_T_MIN_CDEG) / WMC_T_STEP + 1)
+
+#define WMC_EPS(sg, mc, t) (1.0 + 4.0 * (sg) + 1.6 * (sg) * (mc) * (1.0 + 0.004 * ((t) - 20.0)))
+#define WMC_CAP(sg, t, mc) (int32_t)(WMC_SENSOR_C0_AF + WMC_SENSOR_CE_AF * WMC_EPS(sg, mc, t) + 0.5),
+
+#define WMC_MC_ROW(sg, t) { WMC_CAP(sg, t, 0) WMC_CAP(sg, t, 2) WMC_CAP(sg, t, 4) WMC_CAP(sg, t, 6) \
+    WMC_CAP(sg, t, 8) WMC_CAP(sg, t, 10) WMC_CAP(sg, t, 12) WMC_CAP(sg, t, 14) WMC_CAP(sg, t, 16) \
+    WMC_CAP(sg, t, 18) WMC_CAP(sg, t, 20) WMC_CAP(sg, t, 22) WMC_CAP(sg, t, 24) WMC_CAP(sg, t, 26) \
+    WMC_CAP(sg, t, 28) WMC_CAP(sg, t, 30) },
+#define WMC_TABLE(sg) { WMC_MC_ROW(sg, -20) WMC_MC_ROW(sg, -10) WMC_MC_ROW(sg, 0) WMC_MC_ROW(sg, 10) \
+    WMC_MC_ROW(sg, 20) WMC_MC_ROW(sg, 30) WMC_MC_ROW(sg, 40) WMC_MC_ROW(sg, 50) WMC_MC_ROW(sg, 60) }
+
+// Capacitance in aF, [species][temperature][moisture]; nominal specific
+// gravities (oven-dry mass, volume at 12 % MC).
+static const int32_t s_cap_af[WMC_SPECIES_COUNT][WMC_T_N][WMC_MC_N] = {
+    [WMC_SPECIES_GENERIC]     = WMC_TABLE(0.50),
+    [WMC_SPECIES_PINE]        = WMC_TABLE(0.51),
+    [WMC_SPECIES_SPRUCE]      = WMC_TABLE(0.43),
+    [WMC_SPECIES_DOUGLAS_FIR] = WMC_TABLE(0.48),
+    [WMC_SPECIES_OAK]         = WMC_TABLE(0.67),
+    [WMC_SPECIES_BEECH]       = WMC_TABLE(0.68),
+};
+
+static const char *const s_names[WMC_SPECIES_COUNT] = {
+    [WMC_SPECIES_GENERIC] = "generic",
+    [WMC_SPECIES_PINE] = "pine",
+    [WMC_SPECIES_SPRUCE] = "spruce",
+    [WMC_SPECIES_DOUGLAS_FIR] = "douglas-fir",
+    [WMC_SPECIES_OAK] = "oak",
+    [WMC_SPECIES_BEECH] = "beech",
+};
+
+static wmc_species_t s_species = WMC_SPECIES;
+
+esp_err_t wmc_set_species(wmc_species_t sp){
+    if ((unsigned)sp >= WMC_SPECIES_COUNT) return ESP_ERR_INVALID_ARG;
+    s_species = sp;
+    return ESP_OK;
+}
+
+wmc_species_t wmc_get_species(void){ return s_species; }
+
+const char *wmc_species_name(wmc_species_t sp){
+    return (unsigned)sp < WMC_SPECIES_COUNT ? s_names[sp] : "?";
+}
+
+wmc_species_t wmc_species_from_name(const char *name){
+    for (int i = 0; i < WMC_SPECIES_COUNT; i++) if (strcmp(name, s_names[i]) == 0) return (wmc_species_t)i;
+    return WMC_SPECIES_COUNT;
+}
+
+#define WMC_FT_BITS 10   // temperature fraction; adjacent rows differ by < 2^21 aF, so 32-bit math
+
+// Temperature row i and the Q10 fraction ft towards row i + 1.
+static void t_index(int32_t t, int *i, int32_t *ft){
+    if (t < WMC_T_MIN_CDEG) t = WMC_T_MIN_CDEG;
+    if (t > WMC_T_MAX_CDEG) t = WMC_T_MAX_CDEG;
+    int32_t off = t - WMC_T_MIN_CDEG;
+    *i = off / WMC_T_STEP;
+    *ft = ((off % WMC_T_STEP) * (1 << WMC_FT_BITS) + WMC_T_STEP / 2) / WMC_T_STEP;
+    if (*i == WMC_T_N - 1){ *i = WMC_T_N - 2; *ft = 1 << WMC_FT_BITS; }
+}
+
+// Table column j interpolated between temperature rows i and i + 1.
+static inline int32_t cap_at(const int32_t (*tab)[WMC_MC_N], int i, int32_t ft, int j){
+    int32_t a = tab[i][j];
+    return a + (((tab[i + 1][j] - a) * ft + (1 << (WMC_FT_BITS - 1))) >> WMC_FT_BITS);
+}
+
+uint16_t wmc_estimate(int32_t cap_af, int32_t temp_cdeg, bool *clamped){
+    const int32_t (*tab)[WMC_MC_N] = s_cap_af[s_species];
+    int i;
+    int32_t ft;
+    t_index(temp_cdeg, &i, &ft);
+
+    // C rises monotonically with MC: bisect for the grid segment, then
+    // interpolate linearly inside it
+    int lo = 0, hi = WMC_MC_N - 1;
+    int32_t c_lo = cap_at(tab, i, ft, lo), c_hi = cap_at(tab, i, ft, hi);
+    bool clip = false;
+    uint16_t mc;
+    if (cap_af <= c_lo){
+        clip = cap_af < c_lo;
+        mc = 0;
+    } else if (cap_af >= c_hi){
+        clip = cap_af > c_hi;
+        mc = WMC_MC_MAX_CPCT;
+    } else {
+        while (hi - lo > 1){
+            int mid = (lo + hi) / 2;
+            int32_t c = cap_at(tab, i, ft, mid);
+            if (c <= cap_af){ lo = mid; c_lo = c; } else { hi = mid; c_hi = c; }
+        }
+        int32_t span = c_hi - c_lo;
+        mc = (uint16_t)(lo * WMC_MC_STEP + ((cap_af - c_lo) * WMC_MC_STEP + span / 2) / span);
+    }
+    if (clamped) *clamped = clip;
+    return mc;
+}
+
+int32_t wmc_model_af(uint16_t mc_cpct, int32_t temp_cdeg){
+    const int32_t (*tab)[WMC_MC_N] = s_cap_af[s_species];
+    int i;
+    int32_t ft;
+    t_index(temp_cdeg, &i, &ft);
+    if (mc_cpct >= WMC_MC_MAX_CPCT) return cap_at(tab, i, ft, WMC_MC_N - 1);
+    int j = mc_cpct / WMC_MC_STEP;
+    int32_t fm = mc_cpct % WMC_MC_STEP;
+    int32_t a = cap_at(tab, i, ft, j), b = cap_at(tab, i, ft, j + 1);
+    return a + ((b - a) * fm + WMC_MC_STEP / 2) / WMC_MC_STEP;
+}
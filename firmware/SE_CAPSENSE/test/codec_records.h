@@ -0,0 +1,86 @@
+#pragma once
+#include <stdlib.h>
+#include <string.h>
+
+// Record sets for the codec suites (test_reccodec, test_tscodec), included
+// after config.h, record.h and wmc.h.
+
+// A record as the sampler makes it at step i: slow drift plus a little noise.
+static sample_t smooth(uint32_t i){
+    sample_t s = {};
+    s.t_ms = 1000ull + i * SAMPLE_PERIOD_MS;
+    s.t_us = s.t_ms * 1000u - 4000u - (uint64_t)(rand() % 100);
+    s.epoch_us = s.t_us + 1767225600000000ull + (i > 100 ? 500u * (i - 100) : 0);   // slewing from record 100
+    for (int c = 0; c < 4; c++) s.cap_raw[c] = 300000 + c * 5000 + (int32_t)(i * 3) + rand() % 40 - 20;
+    s.capdac[0] = s.capdac[1] = 12;
+    s.temp_cdeg = 2150 + (int32_t)(i / 10);
+    s.hum_q10 = 45 * 1024 + rand() % 8;
+    s.pres_q8 = 101325u * 256 + rand() % 64;
+    s.mc_cpct = (uint16_t)(1800 + i / 20);
+    return s;
+}
+
+#define EDGE_RECORDS 12
+
+// Extremes of every field, absent channels, and time wrapping, repeating
+// and going back.
+static void edge_records(sample_t *in){
+    memset(in, 0, EDGE_RECORDS * sizeof(*in));
+    for (int i = 0; i < EDGE_RECORDS; i++) in[i].mc_cpct = WMC_INVALID;
+    in[0].t_ms = UINT64_MAX;
+    in[0].cap_raw[0] = INT32_MAX;
+    in[0].cap_raw[1] = INT32_MIN;
+    in[0].cap_raw[2] = -1;
+    in[0].hum_q10 = UINT32_MAX;
+    in[0].pres_q8 = UINT32_MAX;
+    in[0].temp_cdeg = INT32_MIN;
+    in[0].mc_cpct = 0;                                // valid, not absent
+    in[0].t_us = UINT64_MAX;
+    in[0].epoch_us = 1;
+    in[0].flags = SAMPLE_FLAG_SATURATED | SAMPLE_FLAG_NO_ENV;
+    in[1].t_ms = in[0].t_ms + 1000;                   // wraps; every channel absent
+    in[2].t_ms = in[1].t_ms;                          // duplicate timestamp
+    in[2].cap_raw[0] = INT32_MIN;
+    in[2].cap_raw[3] = INT32_MAX;
+    in[2].capdac[0] = 31;
+    in[3].t_ms = in[2].t_ms + 3600000;                // an hour's gap
+    in[3].cap_raw[0] = INT32_MAX;
+    in[3].capdac[0] = 31;
+    in[3].mc_cpct = 65534;
+    in[3].t_us = 1;                                   // the last t_us and epoch_us were two records ago
+    in[3].epoch_us = UINT64_MAX;
+    in[4].t_ms = in[3].t_ms - 5;                      // clock stepped back
+    in[4].capdac[3] = 255;
+    in[4].flags = 0xFFFF;
+    for (int i = 5; i < EDGE_RECORDS; i++){
+        in[i] = in[i - 1];
+        in[i].t_ms += (uint64_t)(i % 3) * 997;
+        in[i].cap_raw[i % 4] ^= (int32_t)(0x55555555u >> i);
+        in[i].flags = (uint16_t)(i & 1);
+    }
+}
+
+// Random bytes at random magnitudes, made canonical: no padding, and
+// absent channels as the codecs give them back.
+static void random_records(sample_t *in, size_t n, unsigned seed){
+    srand(seed);
+    for (size_t i = 0; i < n; i++){
+        sample_t *s = &in[i];
+        uint8_t *b = (uint8_t *)s;
+        for (size_t k = 0; k < sizeof(*s); k++) b[k] = (uint8_t)rand();
+        sample_t c = {};
+        c.t_ms = s->t_ms >> (rand() % 64);
+        c.t_us = rand() % 4 ? s->t_us >> (rand() % 64) : 0;
+        c.epoch_us = rand() % 4 ? s->epoch_us >> (rand() % 64) : 0;
+        for (int k = 0; k < 4; k++){
+            c.cap_raw[k] = rand() % 4 ? s->cap_raw[k] >> (rand() % 32) : 0;
+            c.capdac[k] = s->capdac[k] & (rand() % 2 ? 0xFF : 0);
+        }
+        c.temp_cdeg = rand() % 4 ? s->temp_cdeg : 0;
+        c.hum_q10 = rand() % 4 ? s->hum_q10 : 0;
+        c.pres_q8 = rand() % 4 ? s->pres_q8 : 0;
+        c.mc_cpct = rand() % 4 ? s->mc_cpct : WMC_INVALID;
+        c.flags = rand() % 4 ? 0 : s->flags;
+        *s = c;
+    }
+}
@@ -0,0 +1,114 @@
+#include <unity.h>
+
+extern "C" {
+#include "acq.h"
+#include "board.h"
+#include "bme280_drv.h"
+#include "config.h"
+#include "fdc1004.h"
+#include "record.h"
+#include "sampler.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "esp_log.h"
+}
+
+// Acquisition task (src/acq.c) on the simulated board. On the host it
+// preempts whatever advances the virtual clock (host/sim/sim_acq.c), which
+// stands in for the loop and the I/O tasks below it.
+
+void setUp(void){
+    sim_board_init();
+    sim_i2c_set_bus_hz(I2C_FREQ_HZ);
+    sample_t s;
+    while (record_pop(&s)) {}
+    TEST_ASSERT_EQUAL(ESP_OK, bme_init());
+    sampler_init();
+}
+
+void tearDown(void){ sim_board_init(); }
+
+static void test_records_stay_on_time_through_io_stalls(void){
+    uint64_t t0_us = sim_clock_now_ns() / 1000u;   // sensor init took bus time
+    TEST_ASSERT_EQUAL(ESP_OK, acq_start());
+    fdc_stats_t f0;
+    fdc_get_stats(&f0);
+    uint64_t conv0 = sim_board_fdc.conversions;
+
+    // the loop is stuck for 300 ms out of every 700 (a slow card, a
+    // blocking publish) and drains the ring in between
+    sample_t s;
+    uint32_t n = 0;
+    for (int i = 0; i < 10; i++){
+        sim_clock_advance_ms(300);
+        sim_clock_advance_ms(400);
+        while (record_pop(&s)){
+            n++;
+            TEST_ASSERT_EQUAL_UINT64((t0_us + n * SAMPLE_PERIOD_MS * 1000ull) / 1000u, s.t_ms);
+        }
+    }
+    // the task's own run time comes on top of the loop's 7 s
+    uint64_t elapsed_us = sim_clock_now_ns() / 1000u - t0_us;
+    TEST_ASSERT_EQUAL_UINT32(elapsed_us / (SAMPLE_PERIOD_MS * 1000u), n);
+
+    acq_stats_t st;
+    acq_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(elapsed_us / (SAMPLE_POLL_MS * 1000u), st.wakeups);
+    TEST_ASSERT_EQUAL_UINT32(0, st.late);
+    TEST_ASSERT_EQUAL_UINT32(0, st.jitter_max_us);
+    TEST_ASSERT_EQUAL_UINT32(0, st.rec_jitter_max_us);
+    TEST_ASSERT_EQUAL_UINT32(n, st.records);
+    TEST_ASSERT_TRUE(st.run_max_us > 0);   // bus time at I2C_FREQ_HZ
+    TEST_ASSERT_TRUE(st.run_max_us < SAMPLE_POLL_MS * 1000u);
+
+    // every conversion was read before the next one of its measurement
+    fdc_stats_t f;
+    fdc_get_stats(&f);
+    TEST_ASSERT_TRUE(sim_board_fdc.conversions - conv0 - (f.results - f0.results) <= 1);
+}
+
+static void test_late_wakeup_skips_to_the_next_period(void){
+    uint64_t t0_ns = sim_clock_now_ns();
+    TEST_ASSERT_EQUAL(ESP_OK, acq_start());
+    sim_clock_set_task(NULL, 0);   // drive the task by hand
+
+    sim_clock_set_ns(t0_ns + 35 * 1000000ull);   // deadline was 10 ms
+    acq_tick();
+    acq_stats_t st;
+    acq_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(1, st.wakeups);
+    TEST_ASSERT_EQUAL_UINT32(1, st.late);
+    TEST_ASSERT_EQUAL_UINT32(25000, st.jitter_max_us);
+
+    // back on the 10 ms grid: 40 ms is on time
+    sim_clock_set_ns(t0_ns + 40 * 1000000ull);
+    acq_tick();
+    acq_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(1, st.late);
+    TEST_ASSERT_EQUAL_UINT64(25000, st.jitter_total_us);
+
+    // the record due at 1 s comes at the first wakeup from then on
+    sim_clock_set_ns(t0_ns + 1003 * 1000000ull);
+    acq_tick();
+    acq_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(1, st.records);
+    TEST_ASSERT_EQUAL_UINT32(3000, st.rec_jitter_max_us);
+    TEST_ASSERT_EQUAL(1, record_count());
+}
+
+static void test_log_sink_takes_every_record(void){
+    sample_t s[3] = {};
+    s[2].flags = SAMPLE_FLAG_NO_ENV;
+    TEST_ASSERT_EQUAL(3, sampler_log_sink(s, 3));
+    TEST_ASSERT_EQUAL(0, sampler_log_sink(s, 0));
+}
+
+int main(void){
+    esp_log_level_set("*", ESP_LOG_NONE);
+    UNITY_BEGIN();
+    RUN_TEST(test_records_stay_on_time_through_io_stalls);
+    RUN_TEST(test_late_wakeup_skips_to_the_next_period);
+    RUN_TEST(test_log_sink_takes_every_record);
+    return UNITY_END();
+}
@@ -0,0 +1,182 @@
+#include <unity.h>
+#include <string.h>
+
+extern "C" {
+#include "acq.h"
+#include "adapt.h"
+#include "board.h"
+#include "bme280_drv.h"
+#include "config.h"
+#include "fdc1004.h"
+#include "record.h"
+#include "sampler.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "esp_log.h"
+}
+
+// Adaptive record period (src/adapt.c) and the sampler and acquisition
+// task following it.
+
+static adapt_cfg_t s_cfg;
+
+static uint32_t step(adapt_t *a, uint64_t t_ms, int32_t cap0, int32_t temp){
+    sample_t s = {};
+    s.t_ms = t_ms;
+    s.cap_raw[0] = cap0;
+    s.temp_cdeg = temp;
+    return adapt_update(a, &s);
+}
+
+void setUp(void){
+    sim_board_init();
+    sim_i2c_set_bus_hz(I2C_FREQ_HZ);
+    sample_t s;
+    while (record_pop(&s)) {}
+    s_cfg = (adapt_cfg_t){
+        .min_ms = 250, .max_ms = 4000, .hold = 3,
+        .rate = { 10000, 10000, 10000, 10000, 5 },
+        .sd = { 2000, 2000, 2000, 2000, 50 },
+        .jump = 100000,
+    };
+}
+
+void tearDown(void){ sim_board_init(); }
+
+static void test_still_signal_backs_off_and_a_step_speeds_up(void){
+    adapt_t a;
+    TEST_ASSERT_EQUAL(ESP_OK, adapt_init(&a, &s_cfg, 1000));
+    uint64_t t = 0;
+    uint32_t p = 1000, seen[8] = {}, k = 0;
+    for (int i = 0; i < 20; i++){
+        uint32_t q = step(&a, t, 1000000 + (i & 1) * 300, 2100);
+        if (q != p && k < 8) seen[k++] = q;
+        p = q;
+        t += p;
+    }
+    // 3 still records per doubling (the first only primes)
+    TEST_ASSERT_EQUAL(2, k);
+    TEST_ASSERT_EQUAL_UINT32(2000, seen[0]);
+    TEST_ASSERT_EQUAL_UINT32(4000, seen[1]);
+    TEST_ASSERT_EQUAL_UINT32(2, a.stats.slowdowns);
+
+    // a 1 pF step: straight to min_ms
+    TEST_ASSERT_EQUAL_UINT32(250, step(&a, t, 1524288, 2100));
+    TEST_ASSERT_EQUAL_UINT32(1, a.stats.speedups);
+    // and it stays there while the step works through the averages
+    t += 250;
+    TEST_ASSERT_EQUAL_UINT32(250, step(&a, t, 1524288, 2100));
+    TEST_ASSERT_EQUAL_UINT32(250, a.stats.period_ms);
+}
+
+static void test_hysteresis_holds_between_the_thresholds(void){
+    adapt_t a;
+    TEST_ASSERT_EQUAL(ESP_OK, adapt_init(&a, &s_cfg, 1000));
+    // temperature falling at 3 (0.01 degC)/s: between 5 / 2 and 5, neither busy nor still
+    uint64_t t = 0;
+    int32_t temp = 2100;
+    for (int i = 0; i < 30; i++, t += 1000, temp -= 3)
+        TEST_ASSERT_EQUAL_UINT32(1000, step(&a, t, 1000000, temp));
+    // twice as fast is busy
+    for (int i = 0; i < 10; i++, t += 1000, temp -= 6) step(&a, t, 1000000, temp);
+    TEST_ASSERT_EQUAL_UINT32(250, a.period_ms);
+    TEST_ASSERT_EQUAL_UINT32(0, a.stats.slowdowns);
+
+    // an ignored channel does nothing: the priming record, then 3 x 3 still ones
+    s_cfg.rate[4] = s_cfg.sd[4] = ADAPT_IGNORE;
+    TEST_ASSERT_EQUAL(ESP_OK, adapt_init(&a, &s_cfg, 250));
+    for (int i = 0; i < 10; i++, t += 250, temp -= 100) step(&a, t, 1000000, temp);
+    TEST_ASSERT_EQUAL_UINT32(2000, a.period_ms);
+
+    s_cfg.min_ms = 255;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, adapt_init(&a, &s_cfg, 1000));
+    s_cfg.min_ms = 8000;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, adapt_init(&a, &s_cfg, 1000));
+}
+
+// A board pushed in: zero to full scale at the top CAPDAC (~2^26 codes) in
+// one record and back out, without the averages overflowing.
+static void test_full_scale_step_is_busy(void){
+    adapt_t a;
+    TEST_ASSERT_EQUAL(ESP_OK, adapt_init(&a, &s_cfg, 4000));
+    sample_t s = {};
+    uint64_t t = 0;
+    for (int i = 0; i < 3; i++, t += 4000){
+        s.t_ms = t;
+        adapt_update(&a, &s);
+    }
+    for (int i = 0; i < 6; i++, t += 250){
+        s.t_ms = t;
+        s.cap_raw[0] = i < 3 ? 8388607 : -8388608;
+        s.capdac[0] = i < 3 ? 31 : 0;
+        TEST_ASSERT_EQUAL_UINT32(250, adapt_update(&a, &s));
+        TEST_ASSERT_TRUE(a.var[0] > 0);
+    }
+    TEST_ASSERT_TRUE(a.slope[0] < 0);
+    TEST_ASSERT_EQUAL_UINT32(1, a.stats.speedups);
+}
+
+static uint64_t s_step_ns;
+
+static float step_input(void *ctx, int cin, uint64_t t_ns){
+    (void)ctx;
+    if (cin == WMC_MEAS && t_ns >= s_step_ns) return 7.0f;
+    return 2.0f + (float)cin;
+}
+
+static void test_acquisition_follows_the_period_and_steps(void){
+    s_step_ns = 40ull * 1000000000u;
+    sim_board_fdc.input = step_input;
+    TEST_ASSERT_EQUAL(ESP_OK, bme_init());
+    sampler_init();
+    TEST_ASSERT_EQUAL(ESP_OK, sampler_set_adapt(&s_cfg));
+    TEST_ASSERT_EQUAL(ESP_OK, acq_start());
+
+    // still board: the records spread out to max_ms
+    sample_t s, prev = {};
+    uint32_t n = 0, dt = 0;
+    while (sim_clock_now_ns() < s_step_ns){
+        sim_clock_advance_ms(10);
+        while (record_pop(&s)){
+            if (n++) dt = (uint32_t)(s.t_ms - prev.t_ms);
+            prev = s;
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(4000, dt);
+    TEST_ASSERT_EQUAL_UINT32(4000, sampler_period_ms());
+
+    // the step is recorded within a few conversions, not at the next 4 s
+    bool got = false;
+    while (!got){
+        sim_clock_advance_ms(10);
+        while (record_pop(&s))
+            if (s.cap_raw[WMC_MEAS] > 6 * FDC_CODES_PER_PF / 2){
+                got = true;
+                break;
+            }
+    }
+    TEST_ASSERT_UINT_WITHIN(100, s_step_ns / 1000000u, s.t_ms);
+    adapt_stats_t st;
+    TEST_ASSERT_TRUE(sampler_get_adapt_stats(&st));
+    TEST_ASSERT_EQUAL_UINT32(1, st.jumps);
+    TEST_ASSERT_EQUAL_UINT32(250, sampler_period_ms());
+    prev = s;
+    sim_clock_advance_ms(1000);
+    TEST_ASSERT_TRUE(record_pop(&s));
+    TEST_ASSERT_EQUAL_UINT64(prev.t_ms + 250, s.t_ms);
+
+    sampler_set_adapt(NULL);
+    TEST_ASSERT_FALSE(sampler_get_adapt_stats(&st));
+    sim_clock_set_task(NULL, 0);
+}
+
+int main(void){
+    esp_log_level_set("*", ESP_LOG_NONE);
+    UNITY_BEGIN();
+    RUN_TEST(test_still_signal_backs_off_and_a_step_speeds_up);
+    RUN_TEST(test_hysteresis_holds_between_the_thresholds);
+    RUN_TEST(test_full_scale_step_is_busy);
+    RUN_TEST(test_acquisition_follows_the_period_and_steps);
+    return UNITY_END();
+}
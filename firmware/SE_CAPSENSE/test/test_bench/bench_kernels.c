@@ -0,0 +1,216 @@
+#include "bench_kernels.h"
+#include "bme280_drv.h"
+#include "cycles.h"
+#include "dsp.h"
+#include "fdc1004.h"
+#include "reccodec.h"
+#include "record.h"
+#include "scheduler.h"
+#include "tscodec.h"
+#include "units.h"
+#include "wmc.h"
+#include <string.h>
+
+#define BATCH 64
+#define SCH_JOBS 8
+
+static volatile int64_t s_sink;
+static sample_t s_recs[BATCH];
+static int32_t s_raw[BATCH];
+static uint8_t s_buf[BATCH * RC_RECORD_MAX];
+
+// A slow drying curve with conversion noise, as the sampler records it.
+static void make_records(void){
+    uint32_t seed = 0x5eed;
+    for (int i = 0; i < BATCH; i++){
+        seed = seed * 1664525u + 1013904223u;
+        int32_t n = (int32_t)(seed >> 24) - 128;
+        sample_t *s = &s_recs[i];
+        memset(s, 0, sizeof(*s));
+        s->t_ms = 1000u * (uint64_t)i + (seed & 3);
+        s->cap_raw[0] = 2 * FDC_CODES_PER_PF - 40 * i + n;
+        s->cap_raw[1] = FDC_CODES_PER_PF + n / 2;
+        s->capdac[0] = 4;
+        s->temp_cdeg = 2150 + i / 8;
+        s->hum_q10 = 55u * 1024u + (uint32_t)(n & 15);
+        s->pres_q8 = 101325u * 256u + (uint32_t)(n & 63);
+        s->mc_cpct = (uint16_t)(1800 - i);
+        s_raw[i] = s->cap_raw[0];
+    }
+}
+
+// Integer arithmetic, loads and stores in the mix the kernels below have,
+// on no firmware code: the machine's own speed, which bench_suite divides
+// the others by.
+static sample_t s_scratch[BATCH];
+static int32_t s_scratch_raw[BATCH];
+
+static void run_calib(void){
+    uint32_t x = (uint32_t)s_sink;
+    for (int i = 0; i < BATCH; i++){
+        sample_t t = s_scratch[(i * 7) & (BATCH - 1)];
+        x = x * 1664525u + (uint32_t)t.cap_raw[0] + (x >> 7);
+        t.cap_raw[1] = (int32_t)x;
+        s_scratch[i ^ 1].temp_cdeg = t.temp_cdeg;
+        s_scratch_raw[i] = t.cap_raw[1];
+    }
+    s_sink = x;
+}
+
+static bool setup_calib(void){
+    make_records();
+    memcpy(s_scratch, s_recs, sizeof(s_scratch));
+    return true;
+}
+
+static bool setup_records(void){
+    make_records();
+    return true;
+}
+
+static void run_ring(void){
+    sample_t out[BATCH / 2];
+    for (int i = 0; i < BATCH / 2; i++) record_push(&s_recs[i]);
+    s_sink += (int64_t)record_pop_batch(out, BATCH / 2);
+}
+
+static bool setup_ring(void){
+    make_records();
+    sample_t s;
+    while (record_pop(&s)) {}
+    return true;
+}
+
+static bool setup_bme(void){
+    int32_t t;
+    uint32_t h, p;
+    return bme_init() == ESP_OK && bme_read(&t, &h, &p) == ESP_OK;
+}
+
+// comp_temp, comp_pres and comp_hum on the last raw reading
+static void run_bme(void){
+    int32_t t;
+    uint32_t h, p;
+    bme_meas_decode(&t, &h, &p);
+    s_sink += t + (int64_t)h + p;
+}
+
+static void run_cap_af(void){
+    int64_t acc = 0;
+    for (int i = 0; i < BATCH; i++) acc += units_cap_af(s_raw[i], (uint8_t)(i & 7));
+    s_sink += acc;
+}
+
+static dsp_chan_t s_dsp;
+
+static bool setup_dsp(void){
+    const dsp_cfg_t cfg = { .median = 3, .decim = 25, .cic_order = 1, .iir_shift = 0 };
+    make_records();
+    return dsp_init(&s_dsp, &cfg) == ESP_OK;
+}
+
+static void run_dsp(void){
+    int32_t y;
+    for (int i = 0; i < BATCH; i++) if (dsp_push(&s_dsp, s_raw[i], &y)) s_sink += y;
+}
+
+static void run_wmc(void){
+    bool clip;
+    for (int i = 0; i < BATCH; i++)
+        s_sink += wmc_estimate(units_cap_af(s_raw[i], 4), 2150, &clip);
+}
+
+static void nop_job(void){ s_sink++; }
+
+static bool setup_sched(void){
+    if (sch_init() != ESP_OK) return false;
+    for (int i = 0; i < SCH_JOBS; i++)
+        if (sch_add("bench", nop_job, 0, SCH_SKIP) < 0) return false;
+    return true;
+}
+
+// every job triggered, then one pass of the loop
+static void run_sched(void){
+    for (int i = 0; i < SCH_JOBS; i++) sch_trigger(i);
+    sch_run_due();
+}
+
+static void run_rc(void){
+    rc_enc_t e;
+    rc_enc_init(&e, s_buf, sizeof(s_buf), 1000);
+    for (int i = 0; i < BATCH; i++) rc_enc_add(&e, &s_recs[i]);
+    s_sink += (int64_t)rc_enc_len(&e);
+}
+
+static void run_tsc(void){
+    tsc_enc_t e;
+    tsc_enc_init(&e, s_buf, sizeof(s_buf), 1000);
+    for (int i = 0; i < BATCH; i++) tsc_enc_add(&e, &s_recs[i]);
+    s_sink += (int64_t)tsc_enc_len(&e);
+}
+
+// Budgets are rough C3 figures with several times headroom: test_bench
+// on the target catches a kernel gone badly wrong, bench_suite's baseline
+// the smaller regressions.
+const bench_kernel_t bench_kernels[] = {
+    { "calib",            BATCH,     5000,   setup_calib,   run_calib },
+    { "record_push_pop",  BATCH / 2, 40000,  setup_ring,    run_ring },
+    { "bme_comp",         1,         600000, setup_bme,     run_bme },
+    { "fdc_cap_af",       BATCH,     6000,   setup_records, run_cap_af },
+    { "dsp_push",         BATCH,     30000,  setup_dsp,     run_dsp },
+    { "wmc_estimate",     BATCH,     80000,  setup_records, run_wmc },
+    { "sch_dispatch",     SCH_JOBS,  300000, setup_sched,   run_sched },
+    { "rc_enc_add",       BATCH,     200000, setup_records, run_rc },
+    { "tsc_enc_add",      BATCH,     400000, setup_records, run_tsc },
+};
+const size_t bench_kernel_count = sizeof(bench_kernels) / sizeof(bench_kernels[0]);
+
+// Runs per timed sample, doubled until a sample takes MIN_SAMPLE_CYC, so
+// that reading the counter is lost in the noise.
+#define MIN_SAMPLE_CYC 20000u
+#define MAX_INNER 4096u
+
+static uint32_t sample(const bench_kernel_t *k, uint32_t inner){
+    uint32_t c0 = cyc_now();
+    for (uint32_t i = 0; i < inner; i++) k->run();
+    return cyc_now() - c0;
+}
+
+static uint32_t per_op(const bench_kernel_t *k, uint32_t inner, uint32_t best){
+    uint64_t ops = (uint64_t)k->ops * inner;
+    uint64_t cpo = ((uint64_t)best * 100u + ops / 2) / ops;
+    return cpo ? (cpo > UINT32_MAX ? UINT32_MAX : (uint32_t)cpo) : 1;
+}
+
+static uint32_t calibrate(const bench_kernel_t *k){
+    uint32_t inner = 1;
+    while (sample(k, inner) < MIN_SAMPLE_CYC && inner < MAX_INNER) inner *= 2;
+    return inner;
+}
+
+uint32_t bench_kernel_measure(const bench_kernel_t *k, unsigned reps){
+    if (!k->setup()) return 0;
+    uint32_t inner = calibrate(k), best = UINT32_MAX;
+    for (unsigned r = 0; r < reps; r++){
+        uint32_t c = sample(k, inner);
+        if (c < best) best = c;
+    }
+    return per_op(k, inner, best);
+}
+
+void bench_measure_all(uint32_t *cpo, unsigned rounds){
+    uint32_t inner[bench_kernel_count], best[bench_kernel_count];
+    for (size_t i = 0; i < bench_kernel_count; i++){
+        const bench_kernel_t *k = &bench_kernels[i];
+        inner[i] = k->setup() ? calibrate(k) : 0;
+        best[i] = UINT32_MAX;
+    }
+    for (unsigned r = 0; r < rounds; r++)
+        for (size_t i = 0; i < bench_kernel_count; i++){
+            if (!inner[i]) continue;
+            uint32_t c = sample(&bench_kernels[i], inner[i]);
+            if (c < best[i]) best[i] = c;
+        }
+    for (size_t i = 0; i < bench_kernel_count; i++)
+        cpo[i] = inner[i] ? per_op(&bench_kernels[i], inner[i], best[i]) : 0;
+}
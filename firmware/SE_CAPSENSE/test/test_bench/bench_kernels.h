@@ -0,0 +1,34 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Core kernels timed by the regression suite: test_bench (Unity, host or
+// target through the PlatformIO test runner) and host/bench/bench_suite
+// (baseline file, pass/fail). Plain C on the firmware modules as built, no
+// host-only code, so the numbers compare across both.
+//
+// A kernel's run does `ops` operations; timing is in CPU cycles
+// (cycles.h), the best of several samples, so preemption and cache
+// warm-up count against none of them.
+
+typedef struct {
+    const char *name;
+    uint32_t ops;                // operations per run
+    uint32_t budget_cpo;         // cycles per operation allowed on the C3, x100
+    bool (*setup)(void);         // false: the kernel cannot run here (no sensor)
+    void (*run)(void);
+} bench_kernel_t;
+
+extern const bench_kernel_t bench_kernels[];
+extern const size_t bench_kernel_count;
+
+// Cycles per operation, x100: the best of reps samples, each long enough
+// (repeated runs) to swamp the cost of reading the counter.
+// 0 when the kernel's setup fails.
+uint32_t bench_kernel_measure(const bench_kernel_t *k, unsigned reps);
+
+// The same for every kernel into cpo[bench_kernel_count], one sample of
+// each per round, so that a slow spell of the machine hits every kernel
+// in a few rounds rather than one kernel in all of its samples.
+void bench_measure_all(uint32_t *cpo, unsigned rounds);
@@ -0,0 +1,57 @@
+#include <unity.h>
+#include <stdio.h>
+
+extern "C" {
+#include "bench_kernels.h"
+#include "record.h"
+#include "esp_log.h"
+#ifndef ESP_PLATFORM
+#include "sim_board.h"
+#endif
+}
+
+// Core kernel timings (bench_kernels.c). Prints one "BENCH <kernel>
+// <cycles/op>" line each, which host/bench/bench_suite -i compares with a
+// baseline; on the target a kernel over its C3 budget fails here.
+//
+//     pio test -e esp32-c3-wroom-02 -f test_bench
+
+#define REPS 15
+
+void setUp(void){
+#ifndef ESP_PLATFORM
+    sim_board_init();
+#endif
+}
+
+void tearDown(void){}
+
+static void test_kernels(void){
+    for (size_t i = 0; i < bench_kernel_count; i++){
+        const bench_kernel_t *k = &bench_kernels[i];
+        uint32_t cpo = bench_kernel_measure(k, REPS);
+        if (!cpo){
+            printf("BENCH %s skipped\n", k->name);
+            continue;
+        }
+        printf("BENCH %s %u.%02u\n", k->name, (unsigned)(cpo / 100), (unsigned)(cpo % 100));
+#ifdef ESP_PLATFORM
+        TEST_ASSERT_TRUE_MESSAGE(cpo <= k->budget_cpo, k->name);
+#endif
+    }
+    sample_t s;
+    while (record_pop(&s)) {}
+}
+
+static int run_tests(void){
+    esp_log_level_set("*", ESP_LOG_NONE);
+    UNITY_BEGIN();
+    RUN_TEST(test_kernels);
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void){ run_tests(); }
+#else
+int main(void){ return run_tests(); }
+#endif
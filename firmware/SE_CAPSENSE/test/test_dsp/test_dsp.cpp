@@ -0,0 +1,171 @@
+#include <unity.h>
+
+extern "C" {
+#include "dsp.h"
+}
+
+void setUp(void){}
+void tearDown(void){}
+
+static dsp_cfg_t cfg(uint8_t median, uint16_t decim, uint8_t order, uint8_t shift){
+    dsp_cfg_t c = {};
+    c.median = median;
+    c.decim = decim;
+    c.cic_order = order;
+    c.iir_shift = shift;
+    return c;
+}
+
+static void test_rejects_bad_config(void){
+    dsp_chan_t ch;
+    dsp_cfg_t c = cfg(4, 10, 1, 0);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, dsp_init(&ch, &c));      // even median window
+    c = cfg(DSP_MEDIAN_MAX + 2, 10, 1, 0);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, dsp_init(&ch, &c));
+    c = cfg(1, 0, 1, 0);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, dsp_init(&ch, &c));
+    c = cfg(1, DSP_DECIM_MAX + 1, 1, 0);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, dsp_init(&ch, &c));
+    c = cfg(1, 10, DSP_CIC_ORDER_MAX + 1, 0);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, dsp_init(&ch, &c));
+    c = cfg(0, 1, 1, 0);
+    TEST_ASSERT_EQUAL(ESP_OK, dsp_init(&ch, &c));
+}
+
+static void test_passthrough(void){
+    dsp_chan_t ch;
+    dsp_cfg_t c = cfg(1, 1, 1, 0);
+    TEST_ASSERT_EQUAL(ESP_OK, dsp_init(&ch, &c));
+    int32_t y;
+    for (int32_t x = -5000000; x < 5000000; x += 123457){
+        TEST_ASSERT_TRUE(dsp_push(&ch, x, &y));
+        TEST_ASSERT_EQUAL_INT32(x, y);
+    }
+}
+
+static void test_boxcar_averages_each_block(void){
+    dsp_chan_t ch;
+    dsp_cfg_t c = cfg(1, 4, 1, 0);
+    TEST_ASSERT_EQUAL(ESP_OK, dsp_init(&ch, &c));
+    int32_t in[] = { 10, 20, 30, 40,  -8, -8, -8, -9,  8388607, 8388607, 8388607, 8388607 };
+    int32_t want[] = { 25, -8, 8388607 };   // -33/4 = -8.25 rounds to -8
+    int outs = 0;
+    for (size_t i = 0; i < sizeof(in) / sizeof(in[0]); i++){
+        int32_t y;
+        if (dsp_push(&ch, in[i], &y)){
+            TEST_ASSERT_EQUAL_INT32(want[outs], y);
+            outs++;
+        }
+    }
+    TEST_ASSERT_EQUAL(3, outs);
+}
+
+static void test_cic_unity_dc_gain_after_fill(void){
+    for (uint8_t order = 1; order <= DSP_CIC_ORDER_MAX; order++){
+        dsp_chan_t ch;
+        dsp_cfg_t c = cfg(1, 400, order, 0);
+        TEST_ASSERT_EQUAL(ESP_OK, dsp_init(&ch, &c));
+        int outs = 0;
+        int32_t y = 0;
+        for (int i = 0; i < 400 * 6; i++) if (dsp_push(&ch, -3000000, &y)) outs++;
+        TEST_ASSERT_EQUAL(6 - (order - 1), outs);
+        TEST_ASSERT_EQUAL_INT32(-3000000, y);
+    }
+}
+
+static void test_cic_integrators_wrap_safely(void){
+    // A long run of full-scale input wraps the 64-bit integrators of an
+    // order-3 CIC many times over; the output must stay exact.
+    dsp_chan_t ch;
+    dsp_cfg_t c = cfg(1, 1024, 3, 0);
+    TEST_ASSERT_EQUAL(ESP_OK, dsp_init(&ch, &c));
+    int32_t y = 0;
+    int outs = 0;
+    for (long i = 0; i < 1024L * 300; i++) if (dsp_push(&ch, 8388607, &y)) outs++;
+    TEST_ASSERT_EQUAL(298, outs);
+    TEST_ASSERT_EQUAL_INT32(8388607, y);
+}
+
+static void test_median_rejects_spikes(void){
+    dsp_chan_t ch;
+    dsp_cfg_t c = cfg(3, 1, 1, 0);
+    TEST_ASSERT_EQUAL(ESP_OK, dsp_init(&ch, &c));
+    int32_t in[] = { 100, 100, 9000000, 100, 101, -9000000, 102, 102 };
+    int32_t y;
+    for (size_t i = 0; i < sizeof(in) / sizeof(in[0]); i++){
+        TEST_ASSERT_TRUE(dsp_push(&ch, in[i], &y));
+        TEST_ASSERT_INT_WITHIN(2, 100, y);
+    }
+
+    // ahead of a boxcar, a single spike per block leaves the mean untouched
+    c = cfg(5, 10, 1, 0);
+    TEST_ASSERT_EQUAL(ESP_OK, dsp_init(&ch, &c));
+    int outs = 0;
+    for (int i = 0; i < 100; i++){
+        int32_t x = (i % 10 == 7) ? 5000000 : 2000;
+        if (dsp_push(&ch, x, &y)){ TEST_ASSERT_EQUAL_INT32(2000, y); outs++; }
+    }
+    TEST_ASSERT_EQUAL(10, outs);
+}
+
+static void test_iir_step_response(void){
+    dsp_chan_t ch;
+    dsp_cfg_t c = cfg(1, 1, 1, 2);     // alpha = 1/4
+    TEST_ASSERT_EQUAL(ESP_OK, dsp_init(&ch, &c));
+    int32_t y;
+    TEST_ASSERT_TRUE(dsp_push(&ch, 0, &y));
+    TEST_ASSERT_EQUAL_INT32(0, y);            // primed with the first output
+    TEST_ASSERT_TRUE(dsp_push(&ch, 1000, &y));
+    TEST_ASSERT_EQUAL_INT32(250, y);
+    TEST_ASSERT_TRUE(dsp_push(&ch, 1000, &y));
+    TEST_ASSERT_EQUAL_INT32(438, y);          // 437.5 rounds up
+    for (int i = 0; i < 60; i++) dsp_push(&ch, 1000, &y);
+    TEST_ASSERT_EQUAL_INT32(1000, y);
+    for (int i = 0; i < 80; i++) dsp_push(&ch, -1000, &y);
+    TEST_ASSERT_EQUAL_INT32(-1000, y);
+}
+
+static void test_averaging_lowers_noise(void){
+    // uniform noise of +-50000 codes around 1e6; 256-input boxcar averages it
+    // down by ~16x
+    dsp_chan_t ch;
+    dsp_cfg_t c = cfg(1, 256, 1, 0);
+    TEST_ASSERT_EQUAL(ESP_OK, dsp_init(&ch, &c));
+    uint32_t seed = 1;
+    int32_t y, worst = 0;
+    for (int i = 0; i < 256 * 50; i++){
+        seed = seed * 1664525u + 1013904223u;
+        int32_t x = 1000000 + (int32_t)((seed >> 8) % 100001) - 50000;
+        if (dsp_push(&ch, x, &y)){
+            int32_t e = y > 1000000 ? y - 1000000 : 1000000 - y;
+            if (e > worst) worst = e;
+        }
+    }
+    TEST_ASSERT_LESS_THAN(50000 / 4, worst);
+}
+
+static void test_reset_discards_partial_block(void){
+    dsp_chan_t ch;
+    dsp_cfg_t c = cfg(3, 4, 2, 0);
+    TEST_ASSERT_EQUAL(ESP_OK, dsp_init(&ch, &c));
+    int32_t y;
+    for (int i = 0; i < 7; i++) dsp_push(&ch, 999999, &y);
+    dsp_reset(&ch);
+    int outs = 0;
+    for (int i = 0; i < 12; i++) if (dsp_push(&ch, 5, &y)){ outs++; TEST_ASSERT_EQUAL_INT32(5, y); }
+    TEST_ASSERT_EQUAL(2, outs);
+}
+
+int main(void){
+    UNITY_BEGIN();
+    RUN_TEST(test_rejects_bad_config);
+    RUN_TEST(test_passthrough);
+    RUN_TEST(test_boxcar_averages_each_block);
+    RUN_TEST(test_cic_unity_dc_gain_after_fill);
+    RUN_TEST(test_cic_integrators_wrap_safely);
+    RUN_TEST(test_median_rejects_spikes);
+    RUN_TEST(test_iir_step_response);
+    RUN_TEST(test_averaging_lowers_noise);
+    RUN_TEST(test_reset_discards_partial_block);
+    return UNITY_END();
+}
@@ -0,0 +1,234 @@
+#include <unity.h>
+
+extern "C" {
+#include "fdc1004.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "esp_log.h"
+}
+
+static fdc_config_t single_ended(fdc_rate_t rate, bool repeat){
+    fdc_config_t c = {};
+    c.rate = rate;
+    c.repeat = repeat;
+    for (int m = 0; m < FDC_NUM_MEAS; m++){
+        c.meas[m].enabled = true;
+        c.meas[m].cha = (fdc_input_t)m;
+        c.meas[m].chb = FDC_IN_DISABLED;
+    }
+    return c;
+}
+
+// Poll every period_us for dur_ms, collecting per-measurement result counts.
+static void run(uint32_t period_us, uint32_t dur_ms, uint32_t count[4], fdc_result_t *last){
+    fdc_result_t res[FDC_NUM_MEAS];
+    for (uint64_t t = 0; t < (uint64_t)dur_ms * 1000; t += period_us){
+        sim_clock_advance_us(period_us);
+        size_t n;
+        TEST_ASSERT_EQUAL(ESP_OK, fdc_poll(res, FDC_NUM_MEAS, &n));
+        for (size_t i = 0; i < n; i++){
+            count[res[i].meas]++;
+            if (last) last[res[i].meas] = res[i];
+        }
+    }
+}
+
+void setUp(void){
+    sim_board_init();
+    for (int i = 0; i < 4; i++) sim_board_fdc.cin_pf[i] = 1.5f * (float)(i + 1);
+    TEST_ASSERT_EQUAL(ESP_OK, fdc_init());
+}
+
+void tearDown(void){}
+
+static void test_init_rejects_wrong_device(void){
+    sim_i2c_detach_all();
+    sim_bme280_attach(&sim_board_bme, FDC1004_I2C_ADDR);  // wrong part at 0x50
+    TEST_ASSERT_TRUE(fdc_init() != ESP_OK);
+}
+
+static void test_single_ended_24bit_results(void){
+    sim_board_fdc.cin_pf[2] = -7.123456f;
+    fdc_config_t c = single_ended(FDC_RATE_100SPS, true);
+    TEST_ASSERT_EQUAL(ESP_OK, fdc_configure(&c));
+    uint32_t count[4] = {0};
+    fdc_result_t last[4];
+    run(1000, 100, count, last);
+    TEST_ASSERT_INT_WITHIN(2, 1500000, fdc_raw_to_af(last[0].raw, 0));
+    TEST_ASSERT_INT_WITHIN(2, 3000000, fdc_raw_to_af(last[1].raw, 1));
+    TEST_ASSERT_INT_WITHIN(2, -7123456, fdc_raw_to_af(last[2].raw, 2));
+    TEST_ASSERT_INT_WITHIN(2, 6000000, fdc_raw_to_af(last[3].raw, 3));
+}
+
+static void test_differential_and_capdac(void){
+    sim_board_fdc.cin_pf[0] = 40.0f;
+    fdc_config_t c = single_ended(FDC_RATE_400SPS, true);
+    c.meas[0].chb = FDC_IN_CAPDAC;      // 40 pF - 12 * 3.125 pF = 2.5 pF at the ADC
+    c.meas[0].capdac = 12;
+    c.meas[1].cha = FDC_CIN4;           // CIN4 - CIN2 = 3 pF
+    c.meas[1].chb = FDC_CIN2;
+    c.meas[2].enabled = c.meas[3].enabled = false;
+    TEST_ASSERT_EQUAL(ESP_OK, fdc_configure(&c));
+
+    uint32_t count[4] = {0};
+    fdc_result_t last[4];
+    run(1000, 50, count, last);
+    TEST_ASSERT_INT_WITHIN(2, (int32_t)(2.5f * FDC_CODES_PER_PF), last[0].raw);
+    TEST_ASSERT_INT_WITHIN(2, 40000000, fdc_raw_to_af(last[0].raw, 0));
+    TEST_ASSERT_INT_WITHIN(2, 3000000, fdc_raw_to_af(last[1].raw, 1));
+    TEST_ASSERT_EQUAL(0, count[2]);
+    TEST_ASSERT_EQUAL(0, count[3]);
+}
+
+static void test_invalid_config_rejected(void){
+    fdc_config_t c = single_ended(FDC_RATE_100SPS, true);
+    c.meas[1].chb = FDC_CIN2;           // CIN2 - CIN2
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, fdc_configure(&c));
+    c = single_ended(FDC_RATE_100SPS, true);
+    c.meas[0].chb = FDC_IN_CAPDAC;
+    c.meas[0].capdac = 32;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, fdc_configure(&c));
+}
+
+static void test_sustains_full_rate_and_reads_only_done(void){
+    fdc_config_t c = single_ended(FDC_RATE_400SPS, true);
+    TEST_ASSERT_EQUAL(ESP_OK, fdc_configure(&c));
+    uint32_t count[4] = {0};
+    run(500, 1000, count, NULL);
+    // 400 conversions/s shared round-robin by four measurements
+    for (int m = 0; m < 4; m++) TEST_ASSERT_INT_WITHIN(1, 100, count[m]);
+    TEST_ASSERT_INT_WITHIN(2, (int32_t)sim_board_fdc.conversions, count[0] + count[1] + count[2] + count[3]);
+
+    fdc_stats_t st;
+    fdc_get_stats(&st);
+    TEST_ASSERT_GREATER_THAN(0, st.idle_polls);
+}
+
+static void test_single_shot_runs_once(void){
+    fdc_config_t c = single_ended(FDC_RATE_200SPS, false);
+    TEST_ASSERT_EQUAL(ESP_OK, fdc_configure(&c));
+    uint32_t count[4] = {0};
+    run(1000, 200, count, NULL);
+    for (int m = 0; m < 4; m++) TEST_ASSERT_EQUAL(1, count[m]);
+    TEST_ASSERT_EQUAL(ESP_OK, fdc_start());
+    run(1000, 200, count, NULL);
+    for (int m = 0; m < 4; m++) TEST_ASSERT_EQUAL(2, count[m]);
+}
+
+static void test_results_carry_completion_timestamps(void){
+    fdc_config_t c = single_ended(FDC_RATE_100SPS, true);
+    c.meas[1].enabled = c.meas[2].enabled = c.meas[3].enabled = false;
+    TEST_ASSERT_EQUAL(ESP_OK, fdc_configure(&c));
+    fdc_result_t res[4];
+    size_t n;
+    sim_clock_advance_us(9000);
+    TEST_ASSERT_EQUAL(ESP_OK, fdc_poll(res, 4, &n));
+    TEST_ASSERT_EQUAL(0, n);
+    sim_clock_advance_us(1500);
+    TEST_ASSERT_EQUAL(ESP_OK, fdc_poll(res, 4, &n));
+    TEST_ASSERT_EQUAL(1, n);
+    TEST_ASSERT_EQUAL(0, res[0].meas);
+    TEST_ASSERT_EQUAL_UINT64(10500, res[0].t_us);
+}
+
+static void test_saturation_detected(void){
+    sim_board_fdc.cin_pf[1] = 20.0f;
+    sim_board_fdc.cin_pf[2] = -15.5f;
+    fdc_config_t c = single_ended(FDC_RATE_400SPS, true);
+    TEST_ASSERT_EQUAL(ESP_OK, fdc_configure(&c));
+    fdc_result_t res[4];
+    size_t n;
+    bool sat[4] = {false};
+    for (int i = 0; i < 20; i++){
+        sim_clock_advance_us(1000);
+        TEST_ASSERT_EQUAL(ESP_OK, fdc_poll(res, 4, &n));
+        for (size_t k = 0; k < n; k++) sat[res[k].meas] = res[k].saturated;
+    }
+    TEST_ASSERT_FALSE(sat[0]);
+    TEST_ASSERT_TRUE(sat[1]);
+    TEST_ASSERT_TRUE(sat[2]);
+    TEST_ASSERT_FALSE(sat[3]);
+    int32_t raw[4];
+    bool any = false;
+    TEST_ASSERT_EQUAL(ESP_OK, fdc_read_raw(raw, &any));
+    TEST_ASSERT_TRUE(any);
+    sim_board_fdc.cin_pf[1] = sim_board_fdc.cin_pf[2] = 1.0f;
+    sim_clock_advance_us(20000);
+    TEST_ASSERT_EQUAL(ESP_OK, fdc_read_raw(raw, &any));
+    TEST_ASSERT_FALSE(any);
+}
+
+// Poll every 500 us for dur_ms: every result must agree with its CAPDAC.
+static void run_ranging(uint32_t dur_ms, float pf){
+    fdc_result_t res[4];
+    size_t n;
+    for (uint32_t t = 0; t < dur_ms * 2; t++){
+        sim_clock_advance_us(500);
+        TEST_ASSERT_EQUAL(ESP_OK, fdc_poll(res, 4, &n));
+        for (size_t k = 0; k < n; k++)
+            if (res[k].meas == 0 && !res[k].saturated)
+                TEST_ASSERT_INT_WITHIN(2, (int32_t)(pf * 1e6f), fdc_raw_to_af(res[k].raw, 0));
+    }
+}
+
+static void test_capdac_follows_the_input(void){
+    fdc_config_t c = single_ended(FDC_RATE_400SPS, true);
+    for (int m = 0; m < FDC_NUM_MEAS; m++) c.meas[m].chb = FDC_IN_CAPDAC;
+    c.autorange = true;
+    fdc_stats_t st0, st;
+    fdc_get_stats(&st0);
+    sim_board_fdc.cin_pf[0] = 40.0f;
+    TEST_ASSERT_EQUAL(ESP_OK, fdc_configure(&c));
+    run_ranging(200, 40.0f);
+    // saturated: up by the range twice, then 8.75 pF off 31.25 pF is in range
+    TEST_ASSERT_EQUAL_UINT8(10, fdc_capdac(0));
+    TEST_ASSERT_EQUAL_UINT8(0, fdc_capdac(1));
+    fdc_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(2, st.offset_changes - st0.offset_changes);
+
+    // 13.75 pF off moves it to the nearest step (43.75 pF); 6.25 pF off
+    // that does not
+    sim_board_fdc.cin_pf[0] = 45.0f;
+    run_ranging(100, 45.0f);
+    TEST_ASSERT_EQUAL_UINT8(14, fdc_capdac(0));
+    sim_board_fdc.cin_pf[0] = 50.0f;
+    run_ranging(100, 50.0f);
+    TEST_ASSERT_EQUAL_UINT8(14, fdc_capdac(0));
+    fdc_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(3, st.offset_changes - st0.offset_changes);
+    TEST_ASSERT_EQUAL(14 << 5, sim_board_fdc.conf_meas[0] & 0x3E0);
+
+    // and back down, as far as CAPDAC 0
+    sim_board_fdc.cin_pf[0] = 0.2f;
+    run_ranging(100, 0.2f);
+    TEST_ASSERT_EQUAL_UINT8(0, fdc_capdac(0));
+}
+
+static void test_no_autorange_without_capdac_input(void){
+    fdc_config_t c = single_ended(FDC_RATE_400SPS, true);   // CHB disabled
+    c.autorange = true;
+    sim_board_fdc.cin_pf[0] = 14.0f;
+    fdc_stats_t st0, st;
+    fdc_get_stats(&st0);
+    TEST_ASSERT_EQUAL(ESP_OK, fdc_configure(&c));
+    run_ranging(50, 14.0f);
+    fdc_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(st0.offset_changes, st.offset_changes);
+}
+
+int main(void){
+    esp_log_level_set("*", ESP_LOG_NONE);
+    UNITY_BEGIN();
+    RUN_TEST(test_init_rejects_wrong_device);
+    RUN_TEST(test_single_ended_24bit_results);
+    RUN_TEST(test_differential_and_capdac);
+    RUN_TEST(test_invalid_config_rejected);
+    RUN_TEST(test_sustains_full_rate_and_reads_only_done);
+    RUN_TEST(test_single_shot_runs_once);
+    RUN_TEST(test_results_carry_completion_timestamps);
+    RUN_TEST(test_saturation_detected);
+    RUN_TEST(test_capdac_follows_the_input);
+    RUN_TEST(test_no_autorange_without_capdac_input);
+    return UNITY_END();
+}
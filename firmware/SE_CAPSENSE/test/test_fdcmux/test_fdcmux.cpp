@@ -0,0 +1,226 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C" {
+#include "config.h"
+#include "record.h"
+#include "sampler.h"
+#include "fdc1004.h"
+#include "bme280_drv.h"
+#include "i2cmux.h"
+#include "reccodec.h"
+#include "tscodec.h"
+#include "units.h"
+#include "wmc.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "esp_log.h"
+}
+
+// Several FDC1004s behind the TCA9548A: the firmware built with
+// FDC_DEVICES=8 (capsense_fw_mux) against sim_board_init_mux.
+
+void setUp(void){
+    sample_t s;
+    while (record_pop(&s)) {}
+}
+
+void tearDown(void){}
+
+static float pf_of(int dev, int meas){ return 1.0f + 0.5f * (float)dev + 0.1f * (float)meas; }
+
+// n devices on the mux, each input at pf_of; one filtered record.
+static sample_t run(int n){
+    sim_board_init_mux(n);
+    for (int d = 0; d < n; d++)
+        for (int m = 0; m < 4; m++) sim_board_fdcs[d].cin_pf[m] = pf_of(d, m);
+    TEST_ASSERT_EQUAL(ESP_OK, bme_init());
+    sampler_init();
+    sample_t s;
+    for (int rec = 0; rec < 3; rec++){
+        for (int t = 0; t < SAMPLE_PERIOD_MS; t += SAMPLE_POLL_MS){
+            sim_clock_advance_ms(SAMPLE_POLL_MS);
+            sampler_poll_job();
+        }
+        sampler_job();
+        TEST_ASSERT_TRUE(record_pop(&s));
+    }
+    return s;
+}
+
+static void test_records_carry_every_device(void){
+    TEST_ASSERT_EQUAL(32, SAMPLE_CAPS);
+    sample_t s = run(8);
+    TEST_ASSERT_FALSE(s.flags & SAMPLE_FLAG_UNFILTERED);
+    TEST_ASSERT_FALSE(s.flags & SAMPLE_FLAG_NO_ENV);
+    for (int c = 0; c < SAMPLE_CAPS; c++)
+        TEST_ASSERT_INT_WITHIN(200, (int32_t)(pf_of(c / 4, c % 4) * 1e6f), units_cap_af(s.cap_raw[c], s.capdac[c]));
+    TEST_ASSERT_INT_WITHIN(1, 2150, s.temp_cdeg);
+    // the devices were read where they sit, one control write per switch
+    TEST_ASSERT_EQUAL(0u, sim_board_mux.misrouted);
+    i2cmux_stats_t ms;
+    i2cmux_get_stats(&ms);
+    TEST_ASSERT_EQUAL(0u, ms.errors);
+    TEST_ASSERT_TRUE(ms.writes < ms.selects);
+}
+
+static void test_missing_devices_leave_zeros(void){
+    sample_t s = run(3);
+    TEST_ASSERT_FALSE(s.flags & SAMPLE_FLAG_UNFILTERED);
+    for (int c = 0; c < 12; c++)
+        TEST_ASSERT_INT_WITHIN(200, (int32_t)(pf_of(c / 4, c % 4) * 1e6f), units_cap_af(s.cap_raw[c], s.capdac[c]));
+    for (int c = 12; c < SAMPLE_CAPS; c++){
+        TEST_ASSERT_EQUAL_INT32(0, s.cap_raw[c]);
+        TEST_ASSERT_EQUAL_UINT8(0, s.capdac[c]);
+    }
+}
+
+static void test_device_zero_missing_keeps_the_rest(void){
+    sim_board_init_mux(4);
+    sim_board_mux.down[0].read = NULL;
+    for (int d = 1; d < 4; d++)
+        for (int m = 0; m < 4; m++) sim_board_fdcs[d].cin_pf[m] = pf_of(d, m);
+    TEST_ASSERT_EQUAL(ESP_OK, bme_init());
+    sampler_init();
+    sim_clock_advance_ms(SAMPLE_PERIOD_MS);
+    sampler_job();
+    sample_t s;
+    TEST_ASSERT_TRUE(record_pop(&s));
+    TEST_ASSERT_FALSE(s.flags & SAMPLE_FLAG_NO_ENV);
+    for (int c = 0; c < 4; c++) TEST_ASSERT_EQUAL_INT32(0, s.cap_raw[c]);
+    for (int c = 4; c < 16; c++)
+        TEST_ASSERT_INT_WITHIN(200, (int32_t)(pf_of(c / 4, c % 4) * 1e6f), units_cap_af(s.cap_raw[c], s.capdac[c]));
+}
+
+// One electrode past the CAPDAC range on another device flags the record
+// but leaves the moisture estimate, which only the WMC_MEAS input blanks.
+static void test_saturation_elsewhere_keeps_moisture(void){
+    sim_board_init_mux(8);
+    for (int d = 0; d < 8; d++)
+        for (int m = 0; m < 4; m++) sim_board_fdcs[d].cin_pf[m] = pf_of(d, m);
+    sim_board_fdcs[5].cin_pf[2] = 200.0f;
+    TEST_ASSERT_EQUAL(ESP_OK, bme_init());
+    sampler_init();
+    sample_t s;
+    for (int rec = 0; rec < 3; rec++){
+        for (int t = 0; t < SAMPLE_PERIOD_MS; t += SAMPLE_POLL_MS){
+            sim_clock_advance_ms(SAMPLE_POLL_MS);
+            sampler_poll_job();
+        }
+        sampler_job();
+        TEST_ASSERT_TRUE(record_pop(&s));
+        TEST_ASSERT_TRUE(s.flags & SAMPLE_FLAG_SATURATED);
+        TEST_ASSERT_TRUE(s.mc_cpct != WMC_INVALID);
+    }
+
+    sim_board_fdcs[WMC_MEAS / 4].cin_pf[WMC_MEAS % 4] = 200.0f;
+    for (int t = 0; t < SAMPLE_PERIOD_MS; t += SAMPLE_POLL_MS){
+        sim_clock_advance_ms(SAMPLE_POLL_MS);
+        sampler_poll_job();
+    }
+    sampler_job();
+    TEST_ASSERT_TRUE(record_pop(&s));
+    TEST_ASSERT_TRUE(s.flags & SAMPLE_FLAG_SATURATED);
+    TEST_ASSERT_EQUAL_UINT16(WMC_INVALID, s.mc_cpct);
+}
+
+static uint8_t s_buf[200 * RC_RECORD_MAX];
+
+// Random records with the extra channels coming and going.
+static void fill(sample_t *in, size_t n){
+    srand(7);
+    memset(in, 0, n * sizeof(*in));
+    for (size_t i = 0; i < n; i++){
+        sample_t *s = &in[i];
+        s->t_ms = 5000 + i * SAMPLE_PERIOD_MS + (uint64_t)(rand() % 3);
+        for (int c = 0; c < SAMPLE_CAPS; c++){
+            bool on = c < 4 || rand() % 8;
+            s->cap_raw[c] = on ? 300000 * (c % 5) + (int32_t)(i * 11) + rand() % 64 - (i % 50 ? 0 : rand()) : 0;
+            s->capdac[c] = on && rand() % 16 == 0 ? (uint8_t)rand() : (i ? in[i - 1].capdac[c] : 0);
+            if (!on) s->capdac[c] = 0;
+        }
+        s->temp_cdeg = 2150 + (int32_t)(i % 7);
+        s->hum_q10 = 45 * 1024;
+        s->pres_q8 = 101325u * 256;
+        s->mc_cpct = i % 9 ? (uint16_t)(1200 + i) : WMC_INVALID;
+        s->flags = (uint16_t)(i % 13 ? 0 : SAMPLE_FLAG_SATURATED);
+    }
+}
+
+static void test_codecs_roundtrip_every_channel(void){
+    static sample_t in[200];
+    fill(in, 200);
+    sample_t s;
+
+    rc_enc_t e;
+    TEST_ASSERT_EQUAL(ESP_OK, rc_enc_init(&e, s_buf, sizeof(s_buf), SAMPLE_PERIOD_MS));
+    for (size_t i = 0; i < 200; i++){
+        size_t before = rc_enc_len(&e);
+        TEST_ASSERT_TRUE(rc_enc_add(&e, &in[i]));
+        TEST_ASSERT_TRUE(rc_enc_len(&e) - before <= RC_RECORD_MAX);
+    }
+    rc_dec_t d;
+    TEST_ASSERT_EQUAL(ESP_OK, rc_dec_init(&d, s_buf, rc_enc_len(&e)));
+    for (size_t i = 0; i < 200; i++){
+        TEST_ASSERT_EQUAL(ESP_OK, rc_dec_next(&d, &s));
+        TEST_ASSERT_EQUAL_MEMORY(&in[i], &s, sizeof(s));
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, rc_dec_next(&d, &s));
+
+    tsc_enc_t te;
+    TEST_ASSERT_EQUAL(ESP_OK, tsc_enc_init(&te, s_buf, sizeof(s_buf), SAMPLE_PERIOD_MS));
+    for (size_t i = 0; i < 200; i++){
+        size_t before = te.bits;
+        TEST_ASSERT_TRUE(tsc_enc_add(&te, &in[i]));
+        TEST_ASSERT_TRUE(te.bits - before <= TSC_RECORD_MAX_BITS);
+    }
+    tsc_dec_t td;
+    TEST_ASSERT_EQUAL(ESP_OK, tsc_dec_init(&td, s_buf, tsc_enc_len(&te)));
+    for (size_t i = 0; i < 200; i++){
+        TEST_ASSERT_EQUAL(ESP_OK, tsc_dec_next(&td, &s));
+        TEST_ASSERT_EQUAL_MEMORY(&in[i], &s, sizeof(s));
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, tsc_dec_next(&td, &s));
+}
+
+static void test_widest_record_fits_the_bounds(void){
+    sample_t s;
+    memset(&s, 0xA5, sizeof(s));
+    for (int c = 0; c < SAMPLE_CAPS; c++) s.cap_raw[c] = c & 1 ? INT32_MIN : INT32_MAX;
+    s.t_ms = UINT64_MAX;
+    s.flags = 0xFFFF;
+    sample_t t = s;
+    for (int c = 0; c < SAMPLE_CAPS; c++){
+        t.cap_raw[c] = -s.cap_raw[c] - 1;
+        t.capdac[c] = 0x5A;
+    }
+    t.t_ms = 0;
+
+    rc_enc_t e;
+    rc_enc_init(&e, s_buf, sizeof(s_buf), SAMPLE_PERIOD_MS);
+    TEST_ASSERT_TRUE(rc_enc_add(&e, &s));
+    size_t before = rc_enc_len(&e);
+    TEST_ASSERT_TRUE(rc_enc_add(&e, &t));
+    TEST_ASSERT_TRUE(rc_enc_len(&e) - before <= RC_RECORD_MAX);
+
+    tsc_enc_t te;
+    tsc_enc_init(&te, s_buf, sizeof(s_buf), SAMPLE_PERIOD_MS);
+    TEST_ASSERT_TRUE(tsc_enc_add(&te, &s));
+    before = te.bits;
+    TEST_ASSERT_TRUE(tsc_enc_add(&te, &t));
+    TEST_ASSERT_TRUE(te.bits - before <= TSC_RECORD_MAX_BITS);
+}
+
+int main(void){
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    UNITY_BEGIN();
+    RUN_TEST(test_records_carry_every_device);
+    RUN_TEST(test_missing_devices_leave_zeros);
+    RUN_TEST(test_device_zero_missing_keeps_the_rest);
+    RUN_TEST(test_saturation_elsewhere_keeps_moisture);
+    RUN_TEST(test_codecs_roundtrip_every_channel);
+    RUN_TEST(test_widest_record_fits_the_bounds);
+    return UNITY_END();
+}
@@ -0,0 +1,180 @@
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+extern "C" {
+#include "config.h"
+#include "drain.h"
+#include "forward.h"
+#include "mqtt_svc.h"
+#include "record.h"
+#include "sd_logger.h"
+#include "sd_port.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_mqtt.h"
+#include "sim_sd.h"
+#include "esp_log.h"
+}
+
+// Store-and-forward (src/forward.c): SD log + MQTT publisher on the fake
+// card and broker, one record per second as in the firmware.
+
+#define IMG "test_forward.img"
+#define MAXREC 4096
+
+static uint32_t s_next;          // t_ms of the next record
+static bool s_got[MAXREC];
+static size_t s_seen_msgs;
+
+// Mark the records the broker has received so far.
+static void collect(void){
+    for (; s_seen_msgs < sim_mqtt_messages(); s_seen_msgs++){
+        const char *p = sim_mqtt_message(s_seen_msgs)->payload;
+        while ((p = strstr(p, "{\"t\":")) != NULL){
+            unsigned long t = strtoul(p + 5, NULL, 10);
+            TEST_ASSERT_TRUE(t < MAXREC);
+            s_got[t] = true;
+            p += 5;
+        }
+    }
+}
+
+// Broker message index holding record t, or -1.
+static long message_of(uint32_t t){
+    char key[32];
+    snprintf(key, sizeof(key), "{\"t\":%u,", (unsigned)t);
+    for (size_t i = 0; i < sim_mqtt_messages(); i++)
+        if (strstr(sim_mqtt_message(i)->payload, key)) return (long)i;
+    return -1;
+}
+
+// One second of firmware: a record, then the 200 ms jobs.
+static void run_s(uint32_t seconds){
+    for (uint32_t i = 0; i < seconds; i++){
+        sample_t s = {};
+        s.t_ms = s_next++;
+        TEST_ASSERT_TRUE(record_push(&s));
+        for (int k = 0; k < 1000 / MQTT_PUB_PERIOD_MS; k++){
+            sim_clock_advance_ms(MQTT_PUB_PERIOD_MS);
+            drain_job();
+            sdlog_job_flush();
+            sim_sd_run_pending();
+            sim_mqtt_run_pending();
+            fwd_job_replay();
+            mqtt_svc_job_drain();
+        }
+    }
+    collect();
+}
+
+static void start(uint32_t card_sectors){
+    sim_sd_set_capacity(card_sectors);
+    TEST_ASSERT_EQUAL(ESP_OK, sdlog_init());
+    sim_mqtt_set_online(false);
+    TEST_ASSERT_EQUAL(ESP_OK, mqtt_svc_init());
+    TEST_ASSERT_EQUAL(ESP_OK, fwd_init());
+    drain_add_sink(sdlog_append);
+    drain_add_sink(fwd_append);
+    fwd_reset_stats();
+    mqtt_svc_reset_stats();
+}
+
+void setUp(void){
+    sim_board_init();
+    sim_sd_reset();
+    sim_sd_set_path(IMG);
+    unlink(IMG);
+    sim_mqtt_reset();
+    sample_t s;
+    while (record_pop(&s)) {}
+    s_next = 0;
+    s_seen_msgs = 0;
+    memset(s_got, 0, sizeof(s_got));
+}
+
+void tearDown(void){
+    sim_sd_reset();
+    unlink(IMG);
+}
+
+static void test_outage_spills_then_replays_behind_live(void){
+    start(64 * SD_FRAME_SECTORS);
+    run_s(600);
+    fwd_stats_t st;
+    fwd_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(MQTT_QUEUE_DEPTH, st.live);   // held in the publisher's queue
+    TEST_ASSERT_EQUAL_UINT32(600 - MQTT_QUEUE_DEPTH, st.spilled);
+    TEST_ASSERT_EQUAL_UINT32(600 - MQTT_QUEUE_DEPTH, st.backlog);
+    TEST_ASSERT_TRUE(record_count() <= 1);   // the ring never backs up
+    TEST_ASSERT_EQUAL(0, sim_mqtt_messages());
+
+    // link back: the queue goes out, the backlog follows at FWD_REPLAY_PER_S
+    sim_mqtt_set_online(true);
+    uint32_t back = s_next;
+    uint32_t secs = 0;
+    do {
+        run_s(1);
+        fwd_get_stats(&st);
+        secs++;
+        TEST_ASSERT_TRUE(secs < 60);
+    } while (st.backlog);
+    uint32_t need = (600 - MQTT_QUEUE_DEPTH) / FWD_REPLAY_PER_S;
+    TEST_ASSERT_TRUE(secs >= need);
+    TEST_ASSERT_TRUE(secs <= need + 2);
+    TEST_ASSERT_EQUAL_UINT32(st.spilled, st.replayed);
+    TEST_ASSERT_EQUAL_UINT32(0, st.lost);
+
+    run_s(MQTT_BATCH_MAX_AGE_MS / 1000 + 1);
+    for (uint32_t t = 0; t < 600; t++) TEST_ASSERT_TRUE(s_got[t]);
+
+    // live records went out while the backlog was still replaying
+    long live = message_of(back + 2), last = message_of(599);
+    TEST_ASSERT_TRUE(live >= 0);
+    TEST_ASSERT_TRUE(live < last);
+}
+
+static void test_damaged_frame_is_skipped(void){
+    start(64 * SD_FRAME_SECTORS);
+    run_s(400);
+    // the first frame past the MQTT queue spilled and then damaged on the card
+    const uint32_t k = MQTT_QUEUE_DEPTH / SDLOG_FRAME_RECORDS + 1;
+    static uint8_t junk[SD_FRAME_SECTORS * SD_SECTOR_SIZE];
+    memset(junk, 0xA5, sizeof(junk));
+    TEST_ASSERT_EQUAL(ESP_OK, sd_port_write(k * SD_FRAME_SECTORS, junk, SD_FRAME_SECTORS));
+
+    sim_mqtt_set_online(true);
+    run_s(30);
+    fwd_stats_t st;
+    fwd_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(0, st.backlog);
+    TEST_ASSERT_EQUAL_UINT32(SDLOG_FRAME_RECORDS, st.lost);
+    for (uint32_t t = 0; t < 400; t++)
+        TEST_ASSERT_EQUAL(t < k * SDLOG_FRAME_RECORDS || t >= (k + 1) * SDLOG_FRAME_RECORDS, s_got[t]);
+}
+
+static void test_wrapped_backlog_counts_lost(void){
+    // 4 frames: the log keeps the last 3 full frames and the open one
+    start(4 * SD_FRAME_SECTORS);
+    run_s(600);
+    sim_mqtt_set_online(true);
+    run_s(30);
+    fwd_stats_t st;
+    fwd_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(0, st.backlog);
+    uint32_t oldest = (600 / SDLOG_FRAME_RECORDS - 3) * SDLOG_FRAME_RECORDS;
+    TEST_ASSERT_EQUAL_UINT32(oldest - MQTT_QUEUE_DEPTH, st.lost);
+    TEST_ASSERT_EQUAL_UINT32(st.spilled - st.lost, st.replayed);
+    for (uint32_t t = 0; t < 600; t++)
+        TEST_ASSERT_EQUAL(t < MQTT_QUEUE_DEPTH || t >= oldest, s_got[t]);
+}
+
+int main(void){
+    esp_log_level_set("*", ESP_LOG_NONE);
+    UNITY_BEGIN();
+    RUN_TEST(test_outage_spills_then_replays_behind_live);
+    RUN_TEST(test_damaged_frame_is_skipped);
+    RUN_TEST(test_wrapped_backlog_counts_lost);
+    return UNITY_END();
+}
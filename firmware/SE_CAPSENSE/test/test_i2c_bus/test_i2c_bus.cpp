@@ -0,0 +1,198 @@
+#include <unity.h>
+
+extern "C" {
+#include "board.h"
+#include "i2c_bus.h"
+#include "fdc1004.h"
+#include "bme280_drv.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "esp_log.h"
+}
+
+// Bus layer (src/i2c_bus.c) over the simulated controller.
+
+#define FDC_REG_MANUF_ID 0xFE
+#define FDC_REG_DEVICE_ID 0xFF
+
+static const i2c_dev_stats_t *find_stats(uint8_t addr){
+    static i2c_dev_stats_t st[I2C_STATS_MAX_DEVS];
+    size_t n = i2c_bus_get_stats(st, I2C_STATS_MAX_DEVS);
+    for (size_t i = 0; i < n; i++) if (st[i].addr == addr) return &st[i];
+    return NULL;
+}
+
+void setUp(void){
+    sim_board_init();
+    i2c_bus_reset_stats();
+}
+
+void tearDown(void){}
+
+static void test_speed_follows_slowest_device(void){
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_bus_init());
+    TEST_ASSERT_EQUAL_UINT32(I2C_FREQ_HZ, i2c_bus_speed_hz());
+    // BME280 alone allows Fast-mode Plus, capped by the controller
+    TEST_ASSERT_EQUAL(ESP_OK, bme_init());
+    TEST_ASSERT_EQUAL_UINT32(I2C_FREQ_MAX_HZ, i2c_bus_speed_hz());
+    TEST_ASSERT_EQUAL_UINT32(I2C_FREQ_MAX_HZ, sim_i2c_port_hz());
+    // the FDC1004 is Fast-mode only and pulls the shared bus back down
+    TEST_ASSERT_EQUAL(ESP_OK, fdc_init());
+    TEST_ASSERT_EQUAL_UINT32(FDC1004_I2C_MAX_HZ, i2c_bus_speed_hz());
+    TEST_ASSERT_EQUAL_UINT32(FDC1004_I2C_MAX_HZ, sim_i2c_port_hz());
+}
+
+static void test_prepared_read_matches_one_off(void){
+    uint8_t a[2] = {0}, b[2] = {0};
+    i2c_txn_id_t id = i2c_txn_prepare_read(FDC1004_I2C_ADDR, FDC_REG_DEVICE_ID, b, 2);
+    TEST_ASSERT_TRUE(id != I2C_TXN_NONE);
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_rd(FDC1004_I2C_ADDR, FDC_REG_DEVICE_ID, a, 2));
+    for (int i = 0; i < 3; i++){
+        b[0] = b[1] = 0;
+        TEST_ASSERT_EQUAL(ESP_OK, i2c_txn_run(id));
+        TEST_ASSERT_EQUAL_MEMORY(a, b, 2);
+    }
+    TEST_ASSERT_EQUAL_HEX8(0x10, b[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x04, b[1]);
+}
+
+static void test_burst_is_one_bus_transaction(void){
+    static uint8_t manuf[2], dev[2];
+    i2c_txn_id_t parts[2] = {
+        i2c_txn_prepare_read(FDC1004_I2C_ADDR, FDC_REG_MANUF_ID, manuf, 2),
+        i2c_txn_prepare_read(FDC1004_I2C_ADDR, FDC_REG_DEVICE_ID, dev, 2),
+    };
+    i2c_txn_id_t burst = i2c_txn_prepare_burst(parts, 2);
+    TEST_ASSERT_TRUE(burst != I2C_TXN_NONE);
+
+    sim_i2c_set_bus_hz(400000);
+    sim_i2c_reset_stats();
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_txn_run(burst));
+    sim_i2c_stats_t bus;
+    sim_i2c_get_stats(&bus);
+    TEST_ASSERT_EQUAL_UINT32(1, bus.xfers);
+    TEST_ASSERT_EQUAL_UINT32(2, bus.segments);
+    TEST_ASSERT_EQUAL_HEX8(0x54, manuf[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x49, manuf[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x10, dev[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x04, dev[1]);
+
+    // one STOP saved against running the parts separately
+    uint64_t burst_ns = bus.wire_ns;
+    sim_i2c_reset_stats();
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_txn_run(parts[0]));
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_txn_run(parts[1]));
+    sim_i2c_get_stats(&bus);
+    TEST_ASSERT_EQUAL_UINT32(2, bus.xfers);
+    TEST_ASSERT_LESS_THAN(bus.wire_ns, burst_ns);
+
+    // bursts are accounted under address 0x00
+    const i2c_dev_stats_t *st = find_stats(0x00);
+    TEST_ASSERT_NOT_NULL(st);
+    TEST_ASSERT_EQUAL_UINT32(1, st->xfers);
+}
+
+static void test_latency_histogram(void){
+    uint8_t b[2];
+    sim_i2c_set_bus_hz(400000);
+    // 5 bytes * 9 clocks + 3 conditions = 48 clocks = 120 us at 400 kHz
+    for (int i = 0; i < 4; i++) TEST_ASSERT_EQUAL(ESP_OK, i2c_rd(FDC1004_I2C_ADDR, FDC_REG_DEVICE_ID, b, 2));
+    const i2c_dev_stats_t *st = find_stats(FDC1004_I2C_ADDR);
+    TEST_ASSERT_NOT_NULL(st);
+    TEST_ASSERT_EQUAL_UINT32(4, st->xfers);
+    TEST_ASSERT_EQUAL_UINT32(120, st->max_us);
+    TEST_ASSERT_EQUAL_UINT64(480, st->total_us);
+    TEST_ASSERT_EQUAL_UINT32(4, st->hist[7]);   // [64, 128) us
+
+    i2c_bus_reset_stats();
+    st = find_stats(FDC1004_I2C_ADDR);
+    TEST_ASSERT_TRUE(st == NULL || st->xfers == 0);
+}
+
+static void test_errors_counted_per_device(void){
+    uint8_t b[2];
+    TEST_ASSERT_FALSE(i2c_bus_probe(0x23));
+    TEST_ASSERT_TRUE(i2c_bus_probe(FDC1004_I2C_ADDR));
+    TEST_ASSERT_EQUAL(ESP_FAIL, i2c_rd(0x23, 0x00, b, 2));
+    sim_i2c_inject_error(BME280_I2C_ADDR, ESP_ERR_TIMEOUT, 2);
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, i2c_rd(BME280_I2C_ADDR, 0xD0, b, 1));
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, i2c_rd(BME280_I2C_ADDR, 0xD0, b, 1));
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_rd(BME280_I2C_ADDR, 0xD0, b, 1));
+    TEST_ASSERT_EQUAL_HEX8(0x60, b[0]);
+
+    const i2c_dev_stats_t *st = find_stats(0x23);
+    TEST_ASSERT_NOT_NULL(st);
+    TEST_ASSERT_EQUAL_UINT32(1, st->xfers);
+    TEST_ASSERT_EQUAL_UINT32(1, st->nacks);
+    st = find_stats(BME280_I2C_ADDR);
+    TEST_ASSERT_NOT_NULL(st);
+    TEST_ASSERT_EQUAL_UINT32(3, st->xfers);
+    TEST_ASSERT_EQUAL_UINT32(2, st->timeouts);
+    TEST_ASSERT_EQUAL_UINT32(0, st->nacks);
+}
+
+static int s_done_calls;
+static esp_err_t s_done_result;
+static i2c_txn_id_t s_done_id;
+
+static void on_done(i2c_txn_id_t id, esp_err_t result, void *arg){
+    s_done_calls++;
+    s_done_id = id;
+    s_done_result = result;
+    *(int *)arg += 1;
+}
+
+static void test_submit_runs_on_bus_task(void){
+    static uint8_t b[2];
+    int arg = 0;
+    i2c_txn_id_t id = i2c_txn_prepare_read(FDC1004_I2C_ADDR, FDC_REG_DEVICE_ID, b, 2);
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_txn_submit(id, on_done, &arg));
+    // one outstanding submit per transaction
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, i2c_txn_submit(id, on_done, &arg));
+    TEST_ASSERT_EQUAL(0, s_done_calls);
+
+    TEST_ASSERT_EQUAL(1, sim_i2c_run_pending());
+    TEST_ASSERT_EQUAL(1, s_done_calls);
+    TEST_ASSERT_EQUAL(1, arg);
+    TEST_ASSERT_EQUAL(id, s_done_id);
+    TEST_ASSERT_EQUAL(ESP_OK, s_done_result);
+    TEST_ASSERT_EQUAL_HEX8(0x10, b[0]);
+
+    // the callback sees failures too, and the transaction can be resubmitted
+    sim_i2c_detach_all();
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_txn_submit(id, on_done, &arg));
+    sim_i2c_run_pending();
+    TEST_ASSERT_EQUAL(2, s_done_calls);
+    TEST_ASSERT_EQUAL(ESP_FAIL, s_done_result);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, i2c_txn_submit(I2C_TXN_NONE, on_done, &arg));
+}
+
+static void test_burst_limits_and_pool_exhaustion(void){
+    static uint8_t b[2];
+    i2c_txn_id_t one = i2c_txn_prepare_read(FDC1004_I2C_ADDR, FDC_REG_DEVICE_ID, b, 2);
+    i2c_txn_id_t many[I2C_BURST_MAX + 1];
+    for (int i = 0; i <= I2C_BURST_MAX; i++) many[i] = one;
+    TEST_ASSERT_EQUAL(I2C_TXN_NONE, i2c_txn_prepare_burst(many, I2C_BURST_MAX + 1));
+    TEST_ASSERT_TRUE(i2c_txn_prepare_burst(many, I2C_BURST_MAX) != I2C_TXN_NONE);
+    TEST_ASSERT_EQUAL(I2C_TXN_NONE, i2c_txn_prepare_read(FDC1004_I2C_ADDR, 0, NULL, 2));
+
+    // runs last: fills the static pool for the rest of the process
+    int added = 0;
+    while (i2c_txn_prepare_read(FDC1004_I2C_ADDR, FDC_REG_DEVICE_ID, b, 2) != I2C_TXN_NONE) added++;
+    TEST_ASSERT_LESS_THAN(I2C_TXN_POOL_SIZE, added);
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_txn_run(one));   // existing transactions are unaffected
+}
+
+int main(void){
+    esp_log_level_set("*", ESP_LOG_NONE);
+    UNITY_BEGIN();
+    RUN_TEST(test_speed_follows_slowest_device);
+    RUN_TEST(test_prepared_read_matches_one_off);
+    RUN_TEST(test_burst_is_one_bus_transaction);
+    RUN_TEST(test_latency_histogram);
+    RUN_TEST(test_errors_counted_per_device);
+    RUN_TEST(test_submit_runs_on_bus_task);
+    RUN_TEST(test_burst_limits_and_pool_exhaustion);
+    return UNITY_END();
+}
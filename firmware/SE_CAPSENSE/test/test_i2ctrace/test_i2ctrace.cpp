@@ -0,0 +1,211 @@
+#include <unity.h>
+#include <string.h>
+
+extern "C" {
+#include "acq.h"
+#include "bme280_drv.h"
+#include "board.h"
+#include "config.h"
+#include "fdc1004.h"
+#include "i2c_bus.h"
+#include "i2ctrace.h"
+#include "record.h"
+#include "sampler.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "sim_replay.h"
+#include "esp_log.h"
+}
+
+// I2C trace capture (src/i2ctrace.c) and replay (host/sim/sim_replay.c).
+
+static uint8_t s_trace[128 * 1024];   // ~2.3 KB per second of sampling
+static size_t s_trace_len;
+
+static void sink(const void *block, size_t len){
+    TEST_ASSERT_TRUE(s_trace_len + len <= sizeof(s_trace));
+    memcpy(s_trace + s_trace_len, block, len);
+    s_trace_len += len;
+}
+
+static void finish(void){
+    const void *last;
+    size_t len = i2ct_capture_stop(&last);
+    sink(last, len);
+}
+
+void setUp(void){
+    sim_board_init();
+    sample_t s;
+    while (record_pop(&s)) {}
+    s_trace_len = 0;
+}
+
+void tearDown(void){
+    i2ct_capture_stop(NULL);
+    sim_replay_unload();
+    sim_clock_set_task(NULL, 0);
+}
+
+static void test_codec_round_trip(void){
+    uint8_t buf[64], data[3] = { 1, 2, 3 };
+    i2ct_enc_t e;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, i2ct_enc_init(&e, buf, I2CT_HEADER_BYTES - 1, 0));
+    TEST_ASSERT_EQUAL(ESP_OK, i2ct_enc_init(&e, buf, sizeof(buf), 1000));
+    i2ct_rec_t w = { 1000, 0x50, 0x0C, false, I2CT_OK, 2, data };
+    i2ct_rec_t r = { 1300, 0x50, 0x00, true, I2CT_OK, 3, data };
+    i2ct_rec_t n = { 100000, 0x76, 0xD0, true, I2CT_NACK, 1, NULL };
+    TEST_ASSERT_TRUE(i2ct_enc_add(&e, &w));
+    TEST_ASSERT_TRUE(i2ct_enc_add(&e, &r));
+    TEST_ASSERT_TRUE(i2ct_enc_add(&e, &n));
+    TEST_ASSERT_FALSE(i2ct_enc_add(&e, &w));        // older than the last
+    size_t len = e.len;
+    i2ct_rec_t big = { 100000, 0x50, 0, false, I2CT_OK, 40, s_trace };
+    TEST_ASSERT_FALSE(i2ct_enc_add(&e, &big));      // does not fit
+    TEST_ASSERT_EQUAL(len, e.len);
+
+    i2ct_dec_t d;
+    i2ct_rec_t o;
+    TEST_ASSERT_EQUAL(ESP_OK, i2ct_dec_init(&d, buf, len));
+    TEST_ASSERT_EQUAL(ESP_OK, i2ct_dec_next(&d, &o));
+    TEST_ASSERT_EQUAL_UINT64(1000, o.t_us);
+    TEST_ASSERT_FALSE(o.read);
+    TEST_ASSERT_EQUAL(2, o.len);
+    TEST_ASSERT_EQUAL_MEMORY(data, o.data, 2);
+    TEST_ASSERT_EQUAL(ESP_OK, i2ct_dec_next(&d, &o));
+    TEST_ASSERT_EQUAL_UINT64(1300, o.t_us);
+    TEST_ASSERT_TRUE(o.read);
+    TEST_ASSERT_EQUAL_MEMORY(data, o.data, 3);
+    TEST_ASSERT_EQUAL(ESP_OK, i2ct_dec_next(&d, &o));
+    TEST_ASSERT_EQUAL_UINT8(0x76, o.addr);
+    TEST_ASSERT_EQUAL_UINT8(I2CT_NACK, o.status);
+    TEST_ASSERT_NULL(o.data);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, i2ct_dec_next(&d, &o));
+    TEST_ASSERT_EQUAL(len, i2ct_dec_used(&d));
+
+    TEST_ASSERT_EQUAL(ESP_OK, i2ct_dec_init(&d, buf, len - 1));   // cut short
+    TEST_ASSERT_EQUAL(ESP_OK, i2ct_dec_next(&d, &o));
+    TEST_ASSERT_EQUAL(ESP_OK, i2ct_dec_next(&d, &o));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, i2ct_dec_next(&d, &o));
+    buf[1] = I2CT_VERSION + 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_VERSION, i2ct_dec_init(&d, buf, len));
+    buf[0] = 'Z';
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, i2ct_dec_init(&d, buf, len));
+}
+
+static void test_capture_records_transfers_and_errors(void){
+    uint8_t block[512];
+    TEST_ASSERT_EQUAL(ESP_OK, i2ct_capture_start(block, sizeof(block), NULL));
+    TEST_ASSERT_TRUE(i2ct_capturing());
+    sim_clock_advance_us(250);
+    uint8_t id[2], cfg[2] = { 0x10, 0x00 };
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_rd(FDC1004_I2C_ADDR, 0xFE, id, 2));
+    TEST_ASSERT_EQUAL(ESP_OK, i2c_wr(FDC1004_I2C_ADDR, 0x08, cfg, 2));
+    sim_i2c_inject_error(BME280_I2C_ADDR, ESP_ERR_TIMEOUT, 1);
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT, i2c_rd(BME280_I2C_ADDR, 0xD0, id, 1));
+    TEST_ASSERT_FALSE(i2c_bus_probe(0x11));
+    size_t len = i2ct_capture_stop(NULL);
+    TEST_ASSERT_FALSE(i2ct_capturing());
+    i2ct_stats_t st;
+    i2ct_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(4, st.records);
+    TEST_ASSERT_EQUAL_UINT32(0, st.dropped);
+
+    i2ct_dec_t d;
+    i2ct_rec_t o;
+    TEST_ASSERT_EQUAL(ESP_OK, i2ct_dec_init(&d, block, len));
+    TEST_ASSERT_EQUAL(ESP_OK, i2ct_dec_next(&d, &o));
+    TEST_ASSERT_EQUAL_UINT64(250, o.t_us);
+    TEST_ASSERT_EQUAL_UINT8(0xFE, o.reg);
+    TEST_ASSERT_TRUE(o.read);
+    TEST_ASSERT_EQUAL(2, o.len);
+    TEST_ASSERT_EQUAL_MEMORY(id, o.data, 2);
+    TEST_ASSERT_EQUAL(ESP_OK, i2ct_dec_next(&d, &o));
+    TEST_ASSERT_FALSE(o.read);
+    TEST_ASSERT_EQUAL_MEMORY(cfg, o.data, 2);
+    TEST_ASSERT_EQUAL(ESP_OK, i2ct_dec_next(&d, &o));
+    TEST_ASSERT_EQUAL_UINT8(I2CT_TIMEOUT, o.status);
+    TEST_ASSERT_NULL(o.data);
+    TEST_ASSERT_EQUAL(ESP_OK, i2ct_dec_next(&d, &o));
+    TEST_ASSERT_EQUAL_UINT8(0x11, o.addr);
+    TEST_ASSERT_EQUAL_UINT8(I2CT_NACK, o.status);
+    TEST_ASSERT_EQUAL(0, o.len);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, i2ct_dec_next(&d, &o));
+
+    // without a sink a full block keeps what it has
+    TEST_ASSERT_EQUAL(ESP_OK, i2ct_capture_start(block, 64, NULL));
+    for (int i = 0; i < 20; i++) i2c_rd(FDC1004_I2C_ADDR, 0xFE, id, 2);
+    i2ct_capture_stop(NULL);
+    i2ct_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(20, st.records + st.dropped);
+    TEST_ASSERT_TRUE(st.dropped > 0);
+    TEST_ASSERT_EQUAL_UINT32(0, st.blocks);
+}
+
+static float ramp(void *ctx, int cin, uint64_t t_ns){
+    (void)ctx;
+    return (float)(2.0 + cin + (double)(t_ns / 1000000u % 60000u) / 60000.0);
+}
+
+static size_t run_sampler(sample_t *out, size_t max, uint64_t until_ms){
+    size_t n = 0;
+    bme_init();
+    sampler_init();
+    acq_start();
+    sample_t s;
+    while (sim_clock_now_ns() / 1000000u < until_ms && !sim_replay_done()){
+        sim_clock_advance_ms(SAMPLE_PERIOD_MS);
+        while (record_pop(&s))
+            if (n < max) out[n++] = s;
+    }
+    sim_clock_set_task(NULL, 0);
+    return n;
+}
+
+static void test_replay_reproduces_the_samples(void){
+    static sample_t a[128], b[128];
+    sim_board_fdc.input = ramp;
+    sim_board_fdc.noise_pf = 0.002f;
+    sim_i2c_set_bus_hz(I2C_FREQ_HZ);
+    uint8_t block[1024];
+    TEST_ASSERT_EQUAL(ESP_OK, i2ct_capture_start(block, sizeof(block), sink));
+    size_t na = run_sampler(a, 128, 30000);
+    finish();
+    i2ct_stats_t st;
+    i2ct_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(0, st.dropped);
+    TEST_ASSERT_TRUE(st.blocks > 1);
+    TEST_ASSERT_TRUE(na > 10);
+
+    // the same firmware on the recorded bus, with the models gone
+    sim_board_init();
+    sim_i2c_set_bus_hz(I2C_FREQ_HZ);
+    TEST_ASSERT_EQUAL(ESP_OK, sim_replay_load(s_trace, s_trace_len));
+    sim_clock_set_ns(sim_replay_t0_us() * 1000u);
+    size_t nb = run_sampler(b, 128, 60000);
+    sim_replay_stats_t rs;
+    sim_replay_get_stats(&rs);
+    TEST_ASSERT_EQUAL_UINT32(0, rs.missed);
+    TEST_ASSERT_EQUAL_UINT32(0, rs.write_diffs);
+    TEST_ASSERT_EQUAL_UINT32(st.records, rs.records);
+    TEST_ASSERT_TRUE(nb >= na - 1 && nb <= na);   // the last poll may be cut off
+    for (size_t i = 0; i < nb; i++){
+        TEST_ASSERT_EQUAL_UINT64(a[i].t_ms, b[i].t_ms);
+        TEST_ASSERT_EQUAL_MEMORY(a[i].cap_raw, b[i].cap_raw, sizeof(a[i].cap_raw));
+        TEST_ASSERT_EQUAL_INT32(a[i].temp_cdeg, b[i].temp_cdeg);
+        TEST_ASSERT_EQUAL_UINT16(a[i].mc_cpct, b[i].mc_cpct);
+        TEST_ASSERT_EQUAL_UINT16(a[i].flags, b[i].flags);
+    }
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, sim_replay_load("Zxxxxxxxxxxx", 12));
+}
+
+int main(void){
+    esp_log_level_set("*", ESP_LOG_NONE);
+    UNITY_BEGIN();
+    RUN_TEST(test_codec_round_trip);
+    RUN_TEST(test_capture_records_transfers_and_errors);
+    RUN_TEST(test_replay_reproduces_the_samples);
+    return UNITY_END();
+}
@@ -0,0 +1,405 @@
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C" {
+#include "config.h"
+#include "drain.h"
+#include "mqtt_svc.h"
+#include "reccodec.h"
+#include "tscodec.h"
+#include "record.h"
+#include "sim_clock.h"
+#include "sim_mqtt.h"
+#include "esp_log.h"
+}
+
+// MQTT publisher (src/mqtt_svc.c) against the fake broker (host/sim/sim_mqtt.c).
+
+#define BATCH MQTT_BATCH_RECORDS
+#define WINDOW MQTT_INFLIGHT_MAX
+
+static uint32_t s_next;   // t_ms of the next generated record
+
+static sample_t mk(uint32_t i){
+    sample_t s = {};
+    s.t_ms = i;
+    for (int c = 0; c < 4; c++) s.cap_raw[c] = (int32_t)(i * 4 + c) - 100;
+    s.temp_cdeg = 2150;
+    s.mc_cpct = 1234;
+    return s;
+}
+
+static size_t append_n(uint32_t n){
+    size_t k = 0;
+    for (uint32_t i = 0; i < n; i++){
+        sample_t s = mk(s_next);
+        if (!mqtt_svc_enqueue(&s)) break;
+        s_next++;
+        k++;
+    }
+    return k;
+}
+
+// Let the broker deliver what is due, then run the publisher.
+static void step(uint32_t ms){
+    sim_clock_advance_ms(ms);
+    sim_mqtt_run_pending();
+    mqtt_svc_job_drain();
+}
+
+// Decoded message: seq and the t_ms of every record in it.
+typedef struct { long seq; uint32_t n; uint32_t t[BATCH]; } decoded_t;
+
+static decoded_t decode(size_t i){
+    const sim_mqtt_msg_t *m = sim_mqtt_message(i);
+    TEST_ASSERT_NOT_NULL(m);
+    decoded_t d = {};
+    const char *p = strstr(m->payload, "\"seq\":");
+    TEST_ASSERT_NOT_NULL(p);
+    d.seq = strtol(p + 6, NULL, 10);
+    for (p = m->payload; (p = strstr(p, "{\"t\":")) != NULL; p += 5){
+        TEST_ASSERT_TRUE(d.n < BATCH);
+        d.t[d.n++] = (uint32_t)strtoul(p + 5, NULL, 10);
+    }
+    TEST_ASSERT_EQUAL_STRING("]}", m->payload + m->len - 2);
+    return d;
+}
+
+// Every record generated so far reached the broker at least once, in order
+// of seq, and no seq carries different records on a repeat.
+static void check_delivered(void){
+    static long seen_seq[4096];
+    static uint32_t seen_first[4096];
+    static bool got[4096];
+    memset(got, 0, sizeof(got));
+    size_t nseq = 0;
+    for (size_t i = 0; i < sim_mqtt_messages(); i++){
+        decoded_t d = decode(i);
+        size_t j = 0;
+        while (j < nseq && seen_seq[j] != d.seq) j++;
+        if (j == nseq){
+            seen_seq[nseq] = d.seq;
+            seen_first[nseq++] = d.t[0];
+        } else {
+            TEST_ASSERT_EQUAL_UINT32(seen_first[j], d.t[0]);
+        }
+        for (uint32_t k = 0; k < d.n; k++){
+            TEST_ASSERT_TRUE(d.t[k] < s_next);
+            if (k) TEST_ASSERT_EQUAL_UINT32(d.t[k - 1] + 1, d.t[k]);
+            got[d.t[k]] = true;
+        }
+    }
+    for (uint32_t i = 0; i < s_next; i++) TEST_ASSERT_TRUE(got[i]);
+}
+
+void setUp(void){
+    sim_mqtt_reset();
+    sample_t s;
+    while (record_pop(&s)) {}
+    s_next = 0;
+    mqtt_svc_set_batch(BATCH);
+    mqtt_svc_set_format(MQTT_FMT_JSON);
+    TEST_ASSERT_EQUAL(ESP_OK, mqtt_svc_init());
+    mqtt_svc_reset_stats();
+    step(0);
+    TEST_ASSERT_TRUE(mqtt_svc_is_connected());
+}
+
+void tearDown(void){}
+
+static void test_records_are_batched(void){
+    TEST_ASSERT_EQUAL(2 * BATCH + 5, append_n(2 * BATCH + 5));
+    step(0);
+    TEST_ASSERT_EQUAL(2, sim_mqtt_messages());
+    const sim_mqtt_msg_t *m = sim_mqtt_message(0);
+    TEST_ASSERT_EQUAL_STRING(MQTT_BASE_TOPIC "/data", m->topic);
+    TEST_ASSERT_EQUAL(MQTT_QOS, m->qos);
+    TEST_ASSERT_NOT_NULL(strstr(m->payload, "\"dev\":\"" MQTT_CLIENT_ID "\""));
+    TEST_ASSERT_NOT_NULL(strstr(m->payload, "{\"t\":0,\"u\":0,\"e\":0,\"cap\":[-100,-99,-98,-97],\"dac\":[0,0,0,0],\"tc\":2150,"
+                                            "\"rh\":0,\"pa\":0,\"mc\":1234,\"f\":0}"));
+    decoded_t d = decode(1);
+    TEST_ASSERT_EQUAL(1, d.seq);
+    TEST_ASSERT_EQUAL_UINT32(BATCH, d.n);
+    TEST_ASSERT_EQUAL_UINT32(BATCH, d.t[0]);
+
+    // the remainder waits for a full batch, or until it is old enough
+    step(MQTT_BATCH_MAX_AGE_MS - 1);
+    TEST_ASSERT_EQUAL(2, sim_mqtt_messages());
+    step(1);
+    TEST_ASSERT_EQUAL(3, sim_mqtt_messages());
+    TEST_ASSERT_EQUAL_UINT32(5, decode(2).n);
+
+    mqtt_stats_t st;
+    mqtt_svc_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(3, st.msgs);
+    TEST_ASSERT_EQUAL_UINT32(2 * BATCH + 5, st.records_sent);
+    TEST_ASSERT_EQUAL_UINT16(BATCH, st.batch_max);
+    TEST_ASSERT_EQUAL_UINT32(0, st.retransmits);
+    check_delivered();
+}
+
+// The age of a partial batch is that of its own oldest record, not of
+// records that already went out in a full batch.
+static void test_remainder_ages_from_its_own_records(void){
+    append_n(5);
+    step(0);
+    step(3000);
+    append_n(BATCH);
+    step(0);
+    TEST_ASSERT_EQUAL(1, sim_mqtt_messages());
+    step(MQTT_BATCH_MAX_AGE_MS - 1);
+    TEST_ASSERT_EQUAL(1, sim_mqtt_messages());
+    step(1);
+    TEST_ASSERT_EQUAL(2, sim_mqtt_messages());
+    TEST_ASSERT_EQUAL_UINT32(5, decode(1).n);
+    check_delivered();
+}
+
+static void test_window_bounds_inflight_and_pushes_back(void){
+    sim_mqtt_set_ack_delay_ms(100);
+    drain_add_sink(mqtt_svc_append);
+
+    // the broker acks nothing for 100 ms: WINDOW messages go out, the queue
+    // fills, and what does not fit stays in the record ring
+    uint32_t pushed = 0;
+    while (pushed < MQTT_QUEUE_DEPTH + RECORD_RING_CAP){
+        sample_t s = mk(pushed);
+        if (!record_push(&s)) break;
+        pushed++;
+        if (record_count() == RECORD_RING_CAP || pushed % 8 == 0){
+            drain_job();
+            step(0);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(MQTT_QUEUE_DEPTH + RECORD_RING_CAP, pushed);
+    TEST_ASSERT_EQUAL(WINDOW, sim_mqtt_messages());
+    TEST_ASSERT_EQUAL(RECORD_RING_CAP, record_count());
+    sample_t extra = mk(pushed);
+    TEST_ASSERT_FALSE(record_push(&extra));   // backpressure reaches the sampler
+    mqtt_stats_t st;
+    mqtt_svc_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT8(WINDOW, st.inflight);
+    TEST_ASSERT_EQUAL_UINT32(MQTT_QUEUE_DEPTH, st.accepted);
+    TEST_ASSERT_TRUE(st.stalls > 0);
+
+    // acks free the window; everything goes out, nothing is lost
+    s_next = pushed;
+    for (int i = 0; i < 200 && (record_count() || st.inflight); i++){
+        drain_job();
+        step(10);
+        mqtt_svc_get_stats(&st);
+        TEST_ASSERT_TRUE(st.inflight <= WINDOW);
+    }
+    step(MQTT_BATCH_MAX_AGE_MS);
+    step(100);
+    mqtt_svc_get_stats(&st);
+    TEST_ASSERT_EQUAL(0, record_count());
+    TEST_ASSERT_EQUAL_UINT8(0, st.inflight);
+    TEST_ASSERT_EQUAL_UINT8(WINDOW, st.inflight_max);
+    TEST_ASSERT_EQUAL_UINT32(pushed, st.records_sent);
+    TEST_ASSERT_EQUAL_UINT32(st.msgs, st.acks);
+    check_delivered();
+}
+
+static void test_lost_ack_is_retransmitted(void){
+    sim_mqtt_drop_acks(1);
+    append_n(3 * BATCH);
+    step(0);
+    TEST_ASSERT_EQUAL(3, sim_mqtt_messages());
+    step(MQTT_ACK_TIMEOUT_MS - 1);
+    mqtt_stats_t st;
+    mqtt_svc_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(2, st.acks);
+    TEST_ASSERT_EQUAL_UINT8(1, st.inflight);   // seq 0 holds the window front
+
+    step(1);
+    TEST_ASSERT_EQUAL(4, sim_mqtt_messages());
+    TEST_ASSERT_EQUAL(0, decode(3).seq);       // same batch, same seq
+    TEST_ASSERT_NOT_NULL(strstr(sim_mqtt_message(3)->payload, "{\"t\":0,"));
+    step(0);
+    mqtt_svc_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(1, st.retransmits);
+    TEST_ASSERT_EQUAL_UINT32(3, st.acks);
+    TEST_ASSERT_EQUAL_UINT8(0, st.inflight);
+    TEST_ASSERT_EQUAL_UINT32(MQTT_ACK_TIMEOUT_MS * 1000u, st.lat_max_us);
+    check_delivered();
+}
+
+static void test_reconnect_republishes_unacked(void){
+    sim_mqtt_set_ack_delay_ms(50);
+    append_n(2 * BATCH);
+    step(0);
+    TEST_ASSERT_EQUAL(2, sim_mqtt_messages());
+
+    // link drops before the acks arrive; new records queue up meanwhile
+    sim_mqtt_set_online(false);
+    step(0);
+    TEST_ASSERT_FALSE(mqtt_svc_is_connected());
+    append_n(BATCH);
+    step(1000);
+    TEST_ASSERT_EQUAL(2, sim_mqtt_messages());
+
+    sim_mqtt_set_online(true);
+    step(50);
+    TEST_ASSERT_TRUE(mqtt_svc_is_connected());
+    TEST_ASSERT_EQUAL(5, sim_mqtt_messages());
+    TEST_ASSERT_EQUAL(0, decode(2).seq);
+    TEST_ASSERT_EQUAL(1, decode(3).seq);
+    TEST_ASSERT_EQUAL(2, decode(4).seq);
+    step(50);
+    mqtt_stats_t st;
+    mqtt_svc_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(2, st.retransmits);
+    TEST_ASSERT_EQUAL_UINT32(3, st.acks);
+    TEST_ASSERT_EQUAL_UINT8(0, st.inflight);
+    check_delivered();
+}
+
+static void test_latency_and_batch_stats(void){
+    sim_mqtt_set_ack_delay_ms(30);
+    mqtt_svc_set_batch(4);
+    append_n(8);
+    step(0);
+    step(30);
+    mqtt_stats_t st;
+    mqtt_svc_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(2, st.msgs);
+    TEST_ASSERT_EQUAL_UINT16(4, st.batch_max);
+    TEST_ASSERT_EQUAL_UINT32(2, st.acks);
+    TEST_ASSERT_EQUAL_UINT32(30000, st.lat_min_us);
+    TEST_ASSERT_EQUAL_UINT32(30000, st.lat_max_us);
+    TEST_ASSERT_EQUAL_UINT64(60000, st.lat_total_us);
+    TEST_ASSERT_EQUAL_UINT64(sim_mqtt_message(0)->len + sim_mqtt_message(1)->len, st.bytes);
+    TEST_ASSERT_EQUAL_UINT32(0, st.age_records);   // no t_us
+
+    // read 10 ms before the append, acknowledged 30 ms after it
+    sample_t s = mk(s_next++);
+    s.t_us = sim_clock_now_ns() / 1000u - 10000u;
+    s.epoch_us = s.t_us + 1700000000000000ull;
+    TEST_ASSERT_TRUE(mqtt_svc_enqueue(&s));
+    mqtt_svc_set_batch(1);
+    step(0);
+    TEST_ASSERT_NOT_NULL(strstr(sim_mqtt_message(2)->payload, "\"e\":17000"));
+    step(30);
+    mqtt_svc_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(1, st.age_records);
+    TEST_ASSERT_EQUAL_UINT32(40000, st.age_max_us);
+    TEST_ASSERT_EQUAL_UINT64(40000, st.age_total_us);
+}
+
+// Two consumers of the ring: a slow second sink holds records back without
+// the publisher seeing any of them twice.
+static size_t s_sink_room;
+static uint32_t s_sink_got;
+static size_t slow_sink(const sample_t *s, size_t n){
+    size_t k = n < s_sink_room ? n : s_sink_room;
+    for (size_t i = 0; i < k; i++) TEST_ASSERT_EQUAL_UINT64(s_sink_got + i, s[i].t_ms);
+    s_sink_got += (uint32_t)k;
+    s_sink_room -= k;
+    return k;
+}
+
+static void test_ring_shared_with_a_slow_sink(void){
+    drain_add_sink(mqtt_svc_append);
+    drain_add_sink(slow_sink);
+    s_sink_got = 0;
+    s_sink_room = 10;
+    for (uint32_t i = 0; i < 40; i++){
+        sample_t s = mk(i);
+        TEST_ASSERT_TRUE(record_push(&s));
+    }
+    drain_job();
+    drain_job();
+    TEST_ASSERT_EQUAL(30, record_count());
+    mqtt_stats_t st;
+    mqtt_svc_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(40, st.accepted);
+
+    s_sink_room = 100;
+    drain_job();
+    TEST_ASSERT_EQUAL(0, record_count());
+    TEST_ASSERT_EQUAL_UINT32(40, s_sink_got);
+    mqtt_svc_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(40, st.accepted);
+    s_sink_room = 0;   // leave the ring to the publisher for later tests
+    s_next = 40;
+    step(MQTT_BATCH_MAX_AGE_MS);
+    check_delivered();
+}
+
+static void test_binary_payload(void){
+    mqtt_svc_set_format(MQTT_FMT_BIN);
+    append_n(BATCH + 3);
+    step(0);
+    step(MQTT_BATCH_MAX_AGE_MS);
+    TEST_ASSERT_EQUAL(2, sim_mqtt_messages());
+    uint32_t next = 0;
+    for (size_t i = 0; i < 2; i++){
+        const sim_mqtt_msg_t *m = sim_mqtt_message(i);
+        TEST_ASSERT_EQUAL_STRING(MQTT_BASE_TOPIC "/rec", m->topic);
+        const uint8_t *p = (const uint8_t *)m->payload;
+        TEST_ASSERT_EQUAL_UINT32(i, p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24);
+        rc_dec_t d;
+        TEST_ASSERT_EQUAL(ESP_OK, rc_dec_init(&d, p + 4, m->len - 4));
+        sample_t s;
+        while (rc_dec_next(&d, &s) == ESP_OK){
+            sample_t want = mk(next++);
+            TEST_ASSERT_EQUAL_MEMORY(&want, &s, sizeof(s));
+        }
+        TEST_ASSERT_EQUAL(0, d.left);
+        TEST_ASSERT_TRUE(m->len < 4 + RC_HEADER_MAX + d.count * 16u);
+    }
+    TEST_ASSERT_EQUAL_UINT32(BATCH + 3, next);
+}
+
+static void test_units_payload(void){
+    mqtt_svc_set_format(MQTT_FMT_UNITS);
+    append_n(3);
+    step(MQTT_BATCH_MAX_AGE_MS);
+    TEST_ASSERT_EQUAL(1, sim_mqtt_messages());
+    const sim_mqtt_msg_t *m = sim_mqtt_message(0);
+    TEST_ASSERT_EQUAL_STRING(MQTT_BASE_TOPIC "/units", m->topic);
+    const char head[] = "{\"dev\":\"" MQTT_CLIENT_ID "\",\"seq\":0,\"recs\":[{\"t\":0,\"e\":0,\"pf\":[-0.000191,";
+    TEST_ASSERT_EQUAL(0, strncmp(head, m->payload, sizeof(head) - 1));
+    TEST_ASSERT_NOT_NULL(strstr(m->payload, "],\"degc\":21.50,\"rh\":0.000,\"hpa\":0.00,\"mc\":12.34,\"f\":0}"));
+    decoded_t d = decode(0);
+    TEST_ASSERT_EQUAL(0, d.seq);
+    TEST_ASSERT_EQUAL_UINT32(3, d.n);
+    for (uint32_t i = 0; i < 3; i++) TEST_ASSERT_EQUAL_UINT32(i, d.t[i]);
+}
+
+static void test_compressed_payload(void){
+    mqtt_svc_set_format(MQTT_FMT_TSC);
+    append_n(BATCH);
+    step(0);
+    TEST_ASSERT_EQUAL(1, sim_mqtt_messages());
+    const sim_mqtt_msg_t *m = sim_mqtt_message(0);
+    TEST_ASSERT_EQUAL_STRING(MQTT_BASE_TOPIC "/tsc", m->topic);
+    tsc_dec_t d;
+    TEST_ASSERT_EQUAL(ESP_OK, tsc_dec_init(&d, m->payload + 4, m->len - 4));
+    TEST_ASSERT_EQUAL_UINT16(BATCH, d.count);
+    sample_t s;
+    for (uint32_t i = 0; i < BATCH; i++){
+        TEST_ASSERT_EQUAL(ESP_OK, tsc_dec_next(&d, &s));
+        sample_t want = mk(i);
+        TEST_ASSERT_EQUAL_MEMORY(&want, &s, sizeof(s));
+    }
+}
+
+int main(void){
+    esp_log_level_set("*", ESP_LOG_NONE);
+    UNITY_BEGIN();
+    RUN_TEST(test_records_are_batched);
+    RUN_TEST(test_remainder_ages_from_its_own_records);
+    RUN_TEST(test_window_bounds_inflight_and_pushes_back);
+    RUN_TEST(test_lost_ack_is_retransmitted);
+    RUN_TEST(test_reconnect_republishes_unacked);
+    RUN_TEST(test_latency_and_batch_stats);
+    RUN_TEST(test_ring_shared_with_a_slow_sink);
+    RUN_TEST(test_binary_payload);
+    RUN_TEST(test_compressed_payload);
+    RUN_TEST(test_units_payload);
+    return UNITY_END();
+}
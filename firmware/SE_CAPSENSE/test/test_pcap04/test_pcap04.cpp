@@ -0,0 +1,154 @@
+#include <unity.h>
+#include <math.h>
+
+extern "C" {
+#include "config.h"
+#include "capfe.h"
+#include "pcap04.h"
+#include "record.h"
+#include "sampler.h"
+#include "bme280_drv.h"
+#include "units.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "esp_log.h"
+}
+
+// The PCAP04 driver against sim_pcap04, and the sampler picking it when no
+// FDC1004 answers.
+
+static float pf_of(int m){ return 2.0f + 1.5f * (float)m; }
+
+void setUp(void){
+    sample_t s;
+    while (record_pop(&s)) {}
+    sim_board_init_pcap();
+    for (int m = 0; m < 4; m++) sim_board_pcap.cin_pf[m] = pf_of(m);
+}
+
+void tearDown(void){}
+
+// Poll every SAMPLE_POLL_MS for dur_ms; result sets seen, the last kept.
+static uint32_t run(uint32_t dur_ms, capfe_result_t last[4], double sd_af[4]){
+    capfe_result_t res[4];
+    double sum[4] = {0}, sq[4] = {0};
+    uint32_t sets = 0;
+    for (uint32_t t = 0; t < dur_ms; t += SAMPLE_POLL_MS){
+        sim_clock_advance_ms(SAMPLE_POLL_MS);
+        uint8_t mask;
+        size_t n;
+        TEST_ASSERT_EQUAL(ESP_OK, pcap_ready(&mask));
+        TEST_ASSERT_EQUAL(ESP_OK, pcap_read_done(mask, res, &n));
+        if (n) sets++;
+        for (size_t i = 0; i < n; i++){
+            double af = units_cap_af(res[i].raw, 0);
+            sum[res[i].meas] += af;
+            sq[res[i].meas] += af * af;
+            if (last) last[res[i].meas] = res[i];
+        }
+    }
+    for (int m = 0; sd_af && m < 4; m++){
+        double mean = sum[m] / sets;
+        sd_af[m] = sqrt(sq[m] / sets - mean * mean);
+    }
+    return sets;
+}
+
+static void test_configure_sets_timer_and_averaging(void){
+    TEST_ASSERT_EQUAL(ESP_OK, pcap_init());
+    TEST_ASSERT_EQUAL(ESP_OK, pcap_configure(100, 15));
+    TEST_ASSERT_EQUAL_UINT32(100, pcap_rate_hz());
+    // 10 ms of 4 x 5 us conversions
+    TEST_ASSERT_EQUAL_UINT16(500, pcap_averaging());
+    TEST_ASSERT_EQUAL_UINT8(15, sim_board_pcap.cfg[5]);
+    TEST_ASSERT_EQUAL_UINT8(0x0F, sim_board_pcap.cfg[6]);
+    TEST_ASSERT_EQUAL_UINT8(1, sim_board_pcap.cfg[47]);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, pcap_configure(100, 32));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, pcap_configure(100000, 15));
+}
+
+static void test_one_set_per_period_in_pf(void){
+    TEST_ASSERT_EQUAL(ESP_OK, pcap_init());
+    TEST_ASSERT_EQUAL(ESP_OK, pcap_configure(50, 15));
+    capfe_result_t last[4];
+    TEST_ASSERT_UINT_WITHIN(1, 50, run(1000, last, NULL));
+    for (int m = 0; m < 4; m++){
+        TEST_ASSERT_EQUAL_UINT8(m, last[m].meas);
+        TEST_ASSERT_INT_WITHIN(50, (int32_t)(pf_of(m) * 1e6f), units_cap_af(last[m].raw, 0));
+    }
+    capfe_stats_t st;
+    pcap_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(0, st.errors);
+    TEST_ASSERT_TRUE(st.idle_polls > 0);
+}
+
+static void test_averaging_lowers_noise(void){
+    sim_board_pcap.noise_pf = 0.01f;
+    double slow[4], fast[4];
+    TEST_ASSERT_EQUAL(ESP_OK, pcap_init());
+    TEST_ASSERT_EQUAL(ESP_OK, pcap_configure(100, 15));   // 500 conversions a set
+    run(2000, NULL, slow);
+    TEST_ASSERT_EQUAL(ESP_OK, pcap_configure(10000, 15));   // 5
+    TEST_ASSERT_EQUAL_UINT16(5, pcap_averaging());
+    run(2000, NULL, fast);
+    for (int m = 0; m < 4; m++){
+        TEST_ASSERT_TRUE(slow[m] < 1000.0);   // 10 fF / sqrt(500)
+        TEST_ASSERT_TRUE(fast[m] > 5.0 * slow[m]);
+    }
+}
+
+static void test_saturates_past_the_fdc_scale(void){
+    sim_board_pcap.cin_pf[2] = 20.0f;
+    TEST_ASSERT_EQUAL(ESP_OK, pcap_init());
+    TEST_ASSERT_EQUAL(ESP_OK, pcap_configure(100, 15));
+    sim_clock_advance_ms(20);
+    int32_t raw[4];
+    bool sat = false;
+    TEST_ASSERT_EQUAL(ESP_OK, pcap_read_raw(raw, &sat));
+    TEST_ASSERT_TRUE(sat);
+    TEST_ASSERT_EQUAL_INT32(8388607, raw[2]);
+    TEST_ASSERT_INT_WITHIN(50, (int32_t)(pf_of(1) * 1e6f), units_cap_af(raw[1], 0));
+}
+
+static void test_sampler_picks_the_pcap04(void){
+    TEST_ASSERT_TRUE(capfe_probe(0) == &capfe_pcap04);
+    TEST_ASSERT_EQUAL(ESP_OK, bme_init());
+    sampler_init();
+    // one filter output per record from PCAP_RATE_HZ sets a second
+    TEST_ASSERT_EQUAL_UINT16(PCAP_RATE_HZ * SAMPLE_PERIOD_MS / 1000, sampler_get_filter()->decim);
+    sample_t s;
+    for (int rec = 0; rec < 2; rec++){
+        for (int t = 0; t < SAMPLE_PERIOD_MS; t += SAMPLE_POLL_MS){
+            sim_clock_advance_ms(SAMPLE_POLL_MS);
+            sampler_poll_job();
+        }
+        sampler_job();
+        TEST_ASSERT_TRUE(record_pop(&s));
+    }
+    TEST_ASSERT_FALSE(s.flags & SAMPLE_FLAG_UNFILTERED);
+    TEST_ASSERT_FALSE(s.flags & SAMPLE_FLAG_NO_ENV);
+    for (int m = 0; m < 4; m++){
+        TEST_ASSERT_EQUAL_UINT8(0, s.capdac[m]);
+        TEST_ASSERT_INT_WITHIN(50, (int32_t)(pf_of(m) * 1e6f), units_cap_af(s.cap_raw[m], s.capdac[m]));
+    }
+}
+
+static void test_fdc1004_still_comes_first(void){
+    sim_board_init();
+    TEST_ASSERT_TRUE(capfe_probe(0) == &capfe_fdc1004);
+    sim_i2c_detach_all();
+    TEST_ASSERT_TRUE(capfe_probe(0) == NULL);
+}
+
+int main(void){
+    esp_log_level_set("*", ESP_LOG_NONE);   // probing the FDC1004 first logs its absence
+    UNITY_BEGIN();
+    RUN_TEST(test_configure_sets_timer_and_averaging);
+    RUN_TEST(test_one_set_per_period_in_pf);
+    RUN_TEST(test_averaging_lowers_noise);
+    RUN_TEST(test_saturates_past_the_fdc_scale);
+    RUN_TEST(test_sampler_picks_the_pcap04);
+    RUN_TEST(test_fdc1004_still_comes_first);
+    return UNITY_END();
+}
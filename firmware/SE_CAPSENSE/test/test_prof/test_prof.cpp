@@ -0,0 +1,146 @@
+#include <unity.h>
+#include <string.h>
+
+extern "C" {
+#include "config.h"
+#include "bme280_drv.h"
+#include "mqtt_svc.h"
+#include "prof.h"
+#include "record.h"
+#include "sampler.h"
+#include "scheduler.h"
+#include "stats.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_mqtt.h"
+#include "esp_log.h"
+}
+
+// Cycle probes (src/prof.c) and the stats snapshot (src/stats.c).
+
+void setUp(void){
+    sim_board_init();
+    sample_t s;
+    while (record_pop(&s)) {}
+    prof_reset();
+}
+
+void tearDown(void){}
+
+static void test_histogram_buckets(void){
+    const uint32_t c[] = { 0, 1, 2, 3, 1000, 0xFFFFFFFFu };
+    for (size_t i = 0; i < sizeof(c) / sizeof(c[0]); i++) prof_record(PROF_BME_READ, c[i]);
+
+    prof_probe_t p;
+    prof_get(PROF_BME_READ, &p);
+    TEST_ASSERT_EQUAL_UINT32(6, p.count);
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFu, p.max);
+    TEST_ASSERT_TRUE(p.total == 1006ull + 0xFFFFFFFFull);
+    TEST_ASSERT_EQUAL_UINT32(1, p.hist[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, p.hist[1]);
+    TEST_ASSERT_EQUAL_UINT32(2, p.hist[2]);
+    TEST_ASSERT_EQUAL_UINT32(1, p.hist[10]);                 // [512, 1024)
+    TEST_ASSERT_EQUAL_UINT32(1, p.hist[PROF_BUCKETS - 1]);   // open-ended
+
+    prof_get(PROF_SCH_LOOP, &p);
+    TEST_ASSERT_EQUAL_UINT32(0, p.count);
+    TEST_ASSERT_EQUAL_STRING("bme_read", prof_name(PROF_BME_READ));
+}
+
+static void test_percentiles(void){
+    prof_probe_t p;
+    prof_get(PROF_SAMPLER_JOB, &p);
+    TEST_ASSERT_EQUAL_UINT32(0, prof_percentile(&p, 50));
+
+    for (int i = 0; i < 99; i++) prof_record(PROF_SAMPLER_JOB, 100);
+    prof_record(PROF_SAMPLER_JOB, 5000);
+    prof_get(PROF_SAMPLER_JOB, &p);
+    TEST_ASSERT_EQUAL_UINT32(127, prof_percentile(&p, 50));    // bucket [64, 128)
+    TEST_ASSERT_EQUAL_UINT32(127, prof_percentile(&p, 99));
+    TEST_ASSERT_EQUAL_UINT32(5000, prof_percentile(&p, 100));  // capped at max
+}
+
+static void probe_count(prof_id_t id, uint32_t *n){
+    prof_probe_t p;
+    prof_get(id, &p);
+    *n = p.count;
+}
+
+static void test_probes_on_the_hot_paths(void){
+#if PROF_ENABLE
+    TEST_ASSERT_EQUAL(ESP_OK, bme_init());
+    sampler_init();
+    prof_reset();
+    uint32_t n;
+
+    sampler_job();
+    probe_count(PROF_SAMPLER_JOB, &n);
+    TEST_ASSERT_EQUAL_UINT32(1, n);
+    probe_count(PROF_I2C_XFER, &n);
+    TEST_ASSERT_TRUE(n >= 1);
+
+    int32_t t;
+    uint32_t h, pa;
+    TEST_ASSERT_EQUAL(ESP_OK, bme_read(&t, &h, &pa));
+    probe_count(PROF_BME_READ, &n);
+    TEST_ASSERT_EQUAL_UINT32(1, n);
+
+    sampler_poll_job();
+    probe_count(PROF_SAMPLER_POLL, &n);
+    TEST_ASSERT_EQUAL_UINT32(1, n);
+
+    TEST_ASSERT_EQUAL(ESP_OK, sch_init());
+    sch_add("poll", sampler_poll_job, SCH_MS(10), SCH_SKIP);
+    sim_clock_advance_ms(10);
+    sch_run_due();
+    sch_run_due();
+    probe_count(PROF_SCH_LOOP, &n);
+    TEST_ASSERT_EQUAL_UINT32(2, n);
+    probe_count(PROF_SAMPLER_POLL, &n);
+    TEST_ASSERT_EQUAL_UINT32(2, n);
+#endif
+}
+
+static void test_snapshot_published_on_stats_topic(void){
+    sim_mqtt_reset();
+    TEST_ASSERT_EQUAL(ESP_OK, mqtt_svc_init());
+    sim_mqtt_run_pending();
+    TEST_ASSERT_EQUAL(ESP_OK, sch_init());
+    sch_add("stats", stats_job_publish, SCH_MS(STATS_PUB_PERIOD_MS), SCH_SKIP);
+    prof_record(PROF_SAMPLER_JOB, 300);
+
+    stats_job_publish();
+    TEST_ASSERT_EQUAL(1, sim_mqtt_messages());
+    const sim_mqtt_msg_t *m = sim_mqtt_message(0);
+    TEST_ASSERT_EQUAL_STRING(MQTT_BASE_TOPIC "/stats", m->topic);
+    TEST_ASSERT_EQUAL(0, m->qos);
+    TEST_ASSERT_EQUAL(0, strncmp(m->payload, "{\"dev\":\"" MQTT_CLIENT_ID "\",\"t\":", 10));
+    TEST_ASSERT_NOT_NULL(strstr(m->payload, "\"ring\":{\"hw\":"));
+    TEST_ASSERT_NOT_NULL(strstr(m->payload, "\"i2c\":{\"xfers\":"));
+    TEST_ASSERT_NOT_NULL(strstr(m->payload, "\"jobs\":{\"stats\":[0,0,0,0],\"acq\":["));
+#if PROF_ENABLE
+    TEST_ASSERT_NOT_NULL(strstr(m->payload, "\"prof\":{\"sampler_job\":[1,300,300,300]}"));
+#endif
+    TEST_ASSERT_EQUAL_STRING("}}", m->payload + m->len - 2);
+
+    // cut short: same length reported, still terminated
+    char small[32];
+    TEST_ASSERT_EQUAL(m->len, stats_format(small, sizeof(small)));
+    TEST_ASSERT_EQUAL(sizeof(small) - 1, strlen(small));
+
+    // nothing while the broker is away
+    sim_mqtt_set_online(false);
+    sim_mqtt_run_pending();
+    stats_job_publish();
+    TEST_ASSERT_EQUAL(1, sim_mqtt_messages());
+}
+
+int main(void){
+    esp_log_level_set("*", ESP_LOG_NONE);
+    UNITY_BEGIN();
+    RUN_TEST(test_histogram_buckets);
+    RUN_TEST(test_percentiles);
+    RUN_TEST(test_probes_on_the_hot_paths);
+    RUN_TEST(test_snapshot_published_on_stats_topic);
+    return UNITY_END();
+}
@@ -0,0 +1,144 @@
+#include <unity.h>
+#include <string.h>
+
+extern "C" {
+#include "config.h"
+#include "forward.h"
+#include "mqtt_svc.h"
+#include "rbe.h"
+#include "record.h"
+#include "sim_board.h"
+#include "sim_mqtt.h"
+#include "wmc.h"
+#include "esp_log.h"
+}
+
+// Report by exception (src/rbe.c) and its place in front of the MQTT queue
+// (src/forward.c).
+
+static rbe_cfg_t s_cfg;
+
+static sample_t rec(uint64_t t_ms, int32_t cap0, uint16_t mc){
+    sample_t s = {};
+    s.t_ms = t_ms;
+    s.cap_raw[0] = cap0;
+    s.temp_cdeg = 2000;
+    s.hum_q10 = 60 << 10;
+    s.pres_q8 = 100000u << 8;
+    s.mc_cpct = mc;
+    return s;
+}
+
+// Offer s; returns why it went out.
+static uint16_t offer(rbe_t *r, const sample_t &s){
+    uint16_t why = rbe_test(r, &s);
+    rbe_note(r, &s, why);
+    return why;
+}
+
+void setUp(void){
+    sim_board_init();
+    rbe_default_cfg(&s_cfg);
+}
+
+void tearDown(void){}
+
+static void test_deadband_against_last_published(void){
+    rbe_t r;
+    s_cfg.heartbeat_ms = 0;
+    rbe_init(&r, &s_cfg);
+    TEST_ASSERT_EQUAL(1u << RBE_FIRST, offer(&r, rec(0, 1000000, 1500)));
+    TEST_ASSERT_EQUAL(0, offer(&r, rec(1000, 1000000 + RBE_CAP_ABS, 1500 + RBE_MC_ABS)));   // on the edge
+    // small steps add up against the last published record, not the last seen
+    TEST_ASSERT_EQUAL(0, offer(&r, rec(2000, 1000000 - RBE_CAP_ABS, 1500)));
+    TEST_ASSERT_EQUAL(1u << 0, offer(&r, rec(3000, 1000000 + RBE_CAP_ABS + 1, 1500)));
+    TEST_ASSERT_EQUAL(0, offer(&r, rec(4000, 1000000 + 2 * RBE_CAP_ABS, 1500)));
+    TEST_ASSERT_EQUAL(1u << 7, offer(&r, rec(5000, 1000000 + RBE_CAP_ABS, 1500 - RBE_MC_ABS - 1)));
+
+    // flags, CAPDAC and a moisture estimate coming or going always go out
+    sample_t s = rec(6000, 1000000 + RBE_CAP_ABS, 1500 - RBE_MC_ABS - 1);
+    s.flags = SAMPLE_FLAG_NO_ENV;
+    TEST_ASSERT_EQUAL(1u << RBE_FLAGS, offer(&r, s));
+    s.t_ms += 1000;
+    s.capdac[2] = 3;
+    TEST_ASSERT_EQUAL(1u << RBE_FLAGS, offer(&r, s));
+    s.t_ms += 1000;
+    s.mc_cpct = WMC_INVALID;
+    TEST_ASSERT_EQUAL(1u << 7, offer(&r, s));
+    s.t_ms += 1000;
+    TEST_ASSERT_EQUAL(0, offer(&r, s));
+
+    TEST_ASSERT_EQUAL_UINT32(10, r.stats.offered);
+    TEST_ASSERT_EQUAL_UINT32(6, r.stats.published);
+    TEST_ASSERT_EQUAL_UINT32(1, r.stats.why[0]);
+    TEST_ASSERT_EQUAL_UINT32(2, r.stats.why[7]);
+    TEST_ASSERT_EQUAL_UINT32(2, r.stats.why[RBE_FLAGS]);
+}
+
+static void test_relative_band_heartbeat_and_ignored_channels(void){
+    rbe_t r;
+    s_cfg.rel_permille[0] = 10;              // 1 % of 1000000 codes beats RBE_CAP_ABS
+    s_cfg.abs[6] = RBE_IGNORE;
+    s_cfg.heartbeat_ms = 60000;
+    rbe_init(&r, &s_cfg);
+    offer(&r, rec(0, 1000000, 1500));
+    TEST_ASSERT_EQUAL(0, offer(&r, rec(1000, 1010000, 1500)));
+    TEST_ASSERT_EQUAL(1u << 0, offer(&r, rec(2000, 1010001, 1500)));
+    sample_t s = rec(3000, 1010001, 1500);
+    s.pres_q8 = 0;                           // ignored
+    TEST_ASSERT_EQUAL(0, offer(&r, s));
+    TEST_ASSERT_EQUAL(0, offer(&r, rec(61999, 1010001, 1500)));
+    TEST_ASSERT_EQUAL(1u << RBE_HEARTBEAT, offer(&r, rec(62000, 1010001, 1500)));
+    TEST_ASSERT_EQUAL(0, offer(&r, rec(63000, 1010001, 1500)));
+    TEST_ASSERT_EQUAL_UINT32(1, r.stats.why[RBE_HEARTBEAT]);
+}
+
+static void test_forward_queues_only_what_passes(void){
+    sim_mqtt_reset();
+    sim_mqtt_set_online(false);              // nothing leaves the queue
+    TEST_ASSERT_EQUAL(ESP_OK, mqtt_svc_init());
+    TEST_ASSERT_EQUAL(ESP_OK, fwd_init());   // no SD log: refused records stay in the ring
+    s_cfg.heartbeat_ms = 0;
+    fwd_set_rbe(&s_cfg);
+    fwd_reset_stats();
+    mqtt_svc_reset_stats();
+
+    // every 10th record moves past the deadband
+    static sample_t in[4 * MQTT_QUEUE_DEPTH];
+    for (size_t i = 0; i < 4 * MQTT_QUEUE_DEPTH; i++)
+        in[i] = rec(i * 1000, 1000000 + (int32_t)(i / 10) * 2 * RBE_CAP_ABS, 1500);
+    TEST_ASSERT_EQUAL(4 * MQTT_QUEUE_DEPTH, fwd_append(in, 4 * MQTT_QUEUE_DEPTH));
+    mqtt_stats_t ms;
+    mqtt_svc_get_stats(&ms);
+    TEST_ASSERT_EQUAL_UINT32(4 * MQTT_QUEUE_DEPTH / 10 + 1, ms.accepted);
+    rbe_stats_t bs;
+    fwd_get_rbe_stats(&bs);
+    TEST_ASSERT_EQUAL_UINT32(4 * MQTT_QUEUE_DEPTH, bs.offered);
+    TEST_ASSERT_EQUAL_UINT32(ms.accepted, bs.published);
+
+    // a full queue stops at the first record it refuses, which is not
+    // counted and is offered again
+    fwd_set_rbe(&s_cfg);
+    fwd_reset_stats();
+    for (size_t i = 0; i < 4 * MQTT_QUEUE_DEPTH; i++) in[i] = rec(i * 1000, (int32_t)i * 2 * RBE_CAP_ABS, 1500);
+    size_t room = mqtt_svc_room();
+    TEST_ASSERT_EQUAL(room, fwd_append(in, 4 * MQTT_QUEUE_DEPTH));
+    fwd_get_rbe_stats(&bs);
+    TEST_ASSERT_EQUAL_UINT32(room, bs.offered);
+    TEST_ASSERT_EQUAL(0, fwd_append(in + room, 1));
+
+    // off: every record queued
+    fwd_set_rbe(NULL);
+    fwd_reset_stats();
+    fwd_get_rbe_stats(&bs);
+    TEST_ASSERT_EQUAL_UINT32(0, bs.offered);
+}
+
+int main(void){
+    esp_log_level_set("*", ESP_LOG_NONE);
+    UNITY_BEGIN();
+    RUN_TEST(test_deadband_against_last_published);
+    RUN_TEST(test_relative_band_heartbeat_and_ignored_channels);
+    RUN_TEST(test_forward_queues_only_what_passes);
+    return UNITY_END();
+}
@@ -0,0 +1,134 @@
+#include <unity.h>
+#include <string.h>
+
+extern "C" {
+#include "config.h"
+#include "reccodec.h"
+#include "wmc.h"
+}
+#include "../codec_records.h"
+
+// Binary record codec (src/reccodec.c).
+
+void setUp(void){}
+void tearDown(void){}
+
+static uint8_t s_buf[500 * RC_RECORD_MAX];
+
+static size_t roundtrip(const sample_t *in, size_t n, uint32_t period_ms){
+    rc_enc_t e;
+    TEST_ASSERT_EQUAL(ESP_OK, rc_enc_init(&e, s_buf, sizeof(s_buf), period_ms));
+    for (size_t i = 0; i < n; i++) TEST_ASSERT_TRUE(rc_enc_add(&e, &in[i]));
+
+    rc_dec_t d;
+    TEST_ASSERT_EQUAL(ESP_OK, rc_dec_init(&d, s_buf, rc_enc_len(&e)));
+    TEST_ASSERT_EQUAL_UINT16(n, d.count);
+    TEST_ASSERT_EQUAL_UINT32(period_ms, d.period_ms);
+    sample_t s;
+    for (size_t i = 0; i < n; i++){
+        TEST_ASSERT_EQUAL(ESP_OK, rc_dec_next(&d, &s));
+        TEST_ASSERT_EQUAL_MEMORY(&in[i], &s, sizeof(s));
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, rc_dec_next(&d, &s));
+    return rc_enc_len(&e);
+}
+
+static void test_smooth_records_are_small(void){
+    static sample_t in[200];
+    for (uint32_t i = 0; i < 200; i++) in[i] = smooth(i);
+    size_t len = roundtrip(in, 200, SAMPLE_PERIOD_MS);
+    TEST_ASSERT_TRUE(len < 200 * 19);   // against 64 for sample_t
+}
+
+static void test_edge_values_roundtrip(void){
+    static sample_t in[EDGE_RECORDS];
+    edge_records(in);
+    roundtrip(in, EDGE_RECORDS, SAMPLE_PERIOD_MS);
+    roundtrip(in, EDGE_RECORDS, 0);
+    roundtrip(in, EDGE_RECORDS, UINT32_MAX);
+}
+
+static void test_random_records_roundtrip(void){
+    static sample_t in[500];
+    random_records(in, 500, 7);
+    roundtrip(in, 500, SAMPLE_PERIOD_MS);
+}
+
+static void test_full_buffer_refuses_the_record(void){
+    uint8_t buf[56];
+    rc_enc_t e;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, rc_enc_init(&e, buf, RC_HEADER_MAX - 1, SAMPLE_PERIOD_MS));
+    TEST_ASSERT_EQUAL(ESP_OK, rc_enc_init(&e, buf, sizeof(buf), SAMPLE_PERIOD_MS));
+    uint16_t n = 0;
+    sample_t s = smooth(0);
+    while (rc_enc_add(&e, &s)) s = smooth(++n);
+    TEST_ASSERT_TRUE(n >= 1);
+    size_t len = rc_enc_len(&e);
+    TEST_ASSERT_TRUE(len <= sizeof(buf));
+    TEST_ASSERT_FALSE(rc_enc_add(&e, &s));
+    TEST_ASSERT_EQUAL(len, rc_enc_len(&e));
+
+    // what is there still decodes
+    rc_dec_t d;
+    TEST_ASSERT_EQUAL(ESP_OK, rc_dec_init(&d, buf, len));
+    TEST_ASSERT_EQUAL_UINT16(n, d.count);
+    sample_t out;
+    for (uint16_t i = 0; i < n; i++) TEST_ASSERT_EQUAL(ESP_OK, rc_dec_next(&d, &out));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, rc_dec_next(&d, &out));
+}
+
+static void test_bad_blocks_are_rejected(void){
+    rc_enc_t e;
+    rc_enc_init(&e, s_buf, sizeof(s_buf), SAMPLE_PERIOD_MS);
+    for (uint32_t i = 0; i < 10; i++){
+        sample_t s = smooth(i);
+        rc_enc_add(&e, &s);
+    }
+    size_t len = rc_enc_len(&e);
+
+    rc_dec_t d;
+    sample_t s;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, rc_dec_init(&d, s_buf, 3));
+    // cut anywhere inside the records: an error, never a bad record past it
+    for (size_t cut = 6; cut < len; cut++){
+        TEST_ASSERT_EQUAL(ESP_OK, rc_dec_init(&d, s_buf, cut));
+        esp_err_t r;
+        int n = 0;
+        while ((r = rc_dec_next(&d, &s)) == ESP_OK) n++;
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, r);
+        TEST_ASSERT_TRUE(n < 10);
+    }
+
+    s_buf[1] = RC_VERSION + 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_VERSION, rc_dec_init(&d, s_buf, len));
+    s_buf[1] = 2;   // no t_us in version 2
+    TEST_ASSERT_EQUAL(ESP_OK, rc_dec_init(&d, s_buf, len));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, rc_dec_next(&d, &s));
+    // version 1 is version 3 without cap_raw[4..], t_us and epoch_us
+    rc_enc_init(&e, s_buf, sizeof(s_buf), SAMPLE_PERIOD_MS);
+    sample_t old = smooth(0);
+    old.t_us = old.epoch_us = 0;
+    rc_enc_add(&e, &old);
+    s_buf[1] = 1;
+    TEST_ASSERT_EQUAL(ESP_OK, rc_dec_init(&d, s_buf, rc_enc_len(&e)));
+    TEST_ASSERT_EQUAL(ESP_OK, rc_dec_next(&d, &s));
+    TEST_ASSERT_EQUAL_MEMORY(&old, &s, sizeof(s));
+    s_buf[1] = RC_VERSION;
+    s_buf[0] = '{';
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rc_dec_init(&d, s_buf, len));
+
+    // cap_raw[4] (map bit 10) from a build with more FDC1004s
+    const uint8_t wide[] = { RC_MAGIC, RC_VERSION, 1, 0, 100, 0x80, 0x08, 0 };
+    TEST_ASSERT_EQUAL(ESP_OK, rc_dec_init(&d, wide, sizeof(wide)));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, rc_dec_next(&d, &s));
+}
+
+int main(void){
+    UNITY_BEGIN();
+    RUN_TEST(test_smooth_records_are_small);
+    RUN_TEST(test_edge_values_roundtrip);
+    RUN_TEST(test_random_records_roundtrip);
+    RUN_TEST(test_full_buffer_refuses_the_record);
+    RUN_TEST(test_bad_blocks_are_rejected);
+    return UNITY_END();
+}
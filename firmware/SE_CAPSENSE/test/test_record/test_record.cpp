@@ -0,0 +1,184 @@
+#include <unity.h>
+#include <pthread.h>
+#include <sched.h>
+
+extern "C" {
+#include "record.h"
+}
+
+static sample_t mk(uint64_t t){
+    sample_t s = {};
+    s.t_ms = t;
+    s.cap_raw[0] = (int32_t)t;
+    return s;
+}
+
+static void drain(void){
+    sample_t s;
+    while (record_pop(&s)) {}
+}
+
+// Move the (empty) ring's read position to storage slot `slot`.
+static void align_tail(size_t slot){
+    for (uint64_t i = 0; i < RECORD_RING_CAP; i++){ sample_t s = mk(i); record_push(&s); }
+    const sample_t *p;
+    size_t pos = RECORD_RING_CAP - record_peek(&p, RECORD_RING_CAP);
+    record_commit(0);
+    drain();
+    for (size_t k = (slot + RECORD_RING_CAP - pos) % RECORD_RING_CAP; k; k--){
+        sample_t s = mk(0);
+        record_push(&s);
+        record_pop(&s);
+    }
+}
+
+void setUp(void){
+    record_set_overflow(RECORD_OVERFLOW_REJECT);
+    drain();
+}
+
+void tearDown(void){}
+
+static void test_fifo_order_across_wrap(void){
+    align_tail(RECORD_RING_CAP / 2);
+    for (uint64_t i = 0; i < RECORD_RING_CAP; i++){
+        sample_t s = mk(100 + i);
+        TEST_ASSERT_TRUE(record_push(&s));
+    }
+    TEST_ASSERT_EQUAL(RECORD_RING_CAP, record_count());
+    for (uint64_t i = 0; i < RECORD_RING_CAP; i++){
+        sample_t s;
+        TEST_ASSERT_TRUE(record_pop(&s));
+        TEST_ASSERT_EQUAL_UINT64(100 + i, s.t_ms);
+    }
+    sample_t s;
+    TEST_ASSERT_FALSE(record_pop(&s));
+}
+
+static void test_reject_policy_keeps_oldest(void){
+    record_stats_t before, after;
+    record_get_stats(&before);
+    for (uint64_t i = 0; i < RECORD_RING_CAP; i++){ sample_t s = mk(i); record_push(&s); }
+    sample_t extra = mk(999);
+    TEST_ASSERT_FALSE(record_push(&extra));
+    record_get_stats(&after);
+    TEST_ASSERT_EQUAL(before.rejected + 1, after.rejected);
+    TEST_ASSERT_EQUAL(RECORD_RING_CAP, after.high_water);
+
+    sample_t s;
+    TEST_ASSERT_TRUE(record_pop(&s));
+    TEST_ASSERT_EQUAL_UINT64(0, s.t_ms);
+}
+
+static void test_drop_oldest_policy_keeps_newest(void){
+    record_set_overflow(RECORD_OVERFLOW_DROP_OLDEST);
+    record_stats_t before, after;
+    record_get_stats(&before);
+    for (uint64_t i = 0; i < RECORD_RING_CAP + 5; i++){
+        sample_t s = mk(i);
+        TEST_ASSERT_TRUE(record_push(&s));
+    }
+    record_get_stats(&after);
+    TEST_ASSERT_EQUAL(before.dropped + 5, after.dropped);
+    TEST_ASSERT_EQUAL(RECORD_RING_CAP, record_count());
+
+    sample_t s;
+    TEST_ASSERT_TRUE(record_pop(&s));
+    TEST_ASSERT_EQUAL_UINT64(5, s.t_ms);
+}
+
+static void test_drop_oldest_never_steals_claimed_records(void){
+    record_set_overflow(RECORD_OVERFLOW_DROP_OLDEST);
+    for (uint64_t i = 0; i < RECORD_RING_CAP; i++){ sample_t s = mk(i); record_push(&s); }
+
+    const sample_t *p;
+    size_t n = record_peek(&p, 4);
+    TEST_ASSERT_EQUAL(4, n);
+    sample_t s = mk(500);
+    TEST_ASSERT_FALSE(record_push(&s));   // oldest is claimed: falls back to reject
+    TEST_ASSERT_EQUAL_UINT64(0, p[0].t_ms);
+    record_commit(n);
+
+    TEST_ASSERT_TRUE(record_push(&s));    // four free slots now
+    TEST_ASSERT_EQUAL(RECORD_RING_CAP - 3, record_count());
+}
+
+static void test_peek_returns_contiguous_run_then_rest(void){
+    align_tail(RECORD_RING_CAP - 2);
+    for (uint64_t i = 0; i < 6; i++){ sample_t s = mk(i); record_push(&s); }
+
+    const sample_t *p;
+    size_t n = record_peek(&p, 16);
+    TEST_ASSERT_EQUAL(2, n);              // up to the end of storage
+    TEST_ASSERT_EQUAL_UINT64(0, p[0].t_ms);
+    TEST_ASSERT_EQUAL_UINT64(1, p[1].t_ms);
+    record_commit(n);
+
+    n = record_peek(&p, 16);
+    TEST_ASSERT_EQUAL(4, n);
+    TEST_ASSERT_EQUAL_UINT64(2, p[0].t_ms);
+    record_commit(1);                     // partial commit
+    TEST_ASSERT_EQUAL(3, record_count());
+}
+
+static void test_pop_batch_spans_wrap(void){
+    align_tail(RECORD_RING_CAP - 3);
+    for (uint64_t i = 0; i < 10; i++){ sample_t s = mk(i); record_push(&s); }
+
+    sample_t out[16];
+    TEST_ASSERT_EQUAL(8, record_pop_batch(out, 8));
+    for (uint64_t i = 0; i < 8; i++) TEST_ASSERT_EQUAL_UINT64(i, out[i].t_ms);
+    TEST_ASSERT_EQUAL(2, record_pop_batch(out, 16));
+    TEST_ASSERT_EQUAL_UINT64(9, out[1].t_ms);
+    TEST_ASSERT_EQUAL(0, record_pop_batch(out, 16));
+}
+
+#define SPSC_N 200000u
+
+static void *producer(void *arg){
+    record_overflow_t pol = *(record_overflow_t *)arg;
+    for (uint64_t i = 0; i < SPSC_N; i++){
+        sample_t s = mk(i);
+        while (!record_push(&s) && pol == RECORD_OVERFLOW_REJECT) sched_yield();
+    }
+    return NULL;
+}
+
+// Producer and consumer on separate threads: no record may be duplicated,
+// reordered or torn, and under REJECT (with retry) none may be lost.
+static void spsc_stress(record_overflow_t pol){
+    record_set_overflow(pol);
+    pthread_t th;
+    pthread_create(&th, NULL, producer, &pol);
+    uint64_t expect = 0, got = 0;
+    sample_t buf[8];
+    while (expect < SPSC_N){
+        size_t n = record_pop_batch(buf, 8);
+        if (!n) sched_yield();
+        for (size_t i = 0; i < n; i++){
+            TEST_ASSERT_TRUE(buf[i].t_ms >= expect);
+            TEST_ASSERT_EQUAL_UINT64(buf[i].t_ms, (uint64_t)buf[i].cap_raw[0]);
+            if (pol == RECORD_OVERFLOW_REJECT) TEST_ASSERT_EQUAL_UINT64(expect, buf[i].t_ms);
+            expect = buf[i].t_ms + 1;
+            got++;
+        }
+    }
+    pthread_join(th, NULL);
+    if (pol == RECORD_OVERFLOW_REJECT) TEST_ASSERT_EQUAL_UINT64(SPSC_N, got);
+}
+
+static void test_spsc_threads_reject(void){ spsc_stress(RECORD_OVERFLOW_REJECT); }
+static void test_spsc_threads_drop_oldest(void){ spsc_stress(RECORD_OVERFLOW_DROP_OLDEST); }
+
+int main(void){
+    UNITY_BEGIN();
+    RUN_TEST(test_fifo_order_across_wrap);
+    RUN_TEST(test_reject_policy_keeps_oldest);
+    RUN_TEST(test_drop_oldest_policy_keeps_newest);
+    RUN_TEST(test_drop_oldest_never_steals_claimed_records);
+    RUN_TEST(test_peek_returns_contiguous_run_then_rest);
+    RUN_TEST(test_pop_batch_spans_wrap);
+    RUN_TEST(test_spsc_threads_reject);
+    RUN_TEST(test_spsc_threads_drop_oldest);
+    return UNITY_END();
+}
@@ -0,0 +1,227 @@
+#include <unity.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C" {
+#include "config.h"
+#include "fdc1004.h"
+#include "rectext.h"
+#include "units.h"
+#include "wmc.h"
+}
+
+// Text record encoder (src/rectext.c).
+
+void setUp(void){}
+void tearDown(void){}
+
+static uint32_t rnd32(void){ return (uint32_t)rand() << 16 ^ (uint32_t)rand(); }
+static uint64_t rnd64(void){ return (uint64_t)rnd32() << 32 | rnd32(); }
+
+static void check_u64(uint64_t v){
+    char want[32], got[RT_NUM_MAX + 1];
+    snprintf(want, sizeof(want), "%" PRIu64, v);
+    *rt_put_u64(got, v) = '\0';
+    TEST_ASSERT_EQUAL_STRING(want, got);
+}
+
+static void check_fixed(int64_t v, unsigned dec){
+    char want[48], got[RT_NUM_MAX + 1];
+    uint64_t u = v < 0 ? 0 - (uint64_t)v : (uint64_t)v, p = 1;
+    for (unsigned i = 0; i < dec; i++) p *= 10;
+    if (dec) snprintf(want, sizeof(want), "%s%" PRIu64 ".%0*" PRIu64, v < 0 ? "-" : "", u / p, (int)dec, u % p);
+    else snprintf(want, sizeof(want), "%" PRId64, v);
+    char *end = rt_put_fixed(got, v, dec);
+    *end = '\0';
+    TEST_ASSERT_EQUAL_STRING(want, got);
+    TEST_ASSERT_LESS_OR_EQUAL(RT_NUM_MAX, end - got);
+}
+
+static void test_numbers_match_printf(void){
+    const uint64_t u[] = { 0, 9, 10, 99, 100, 99999999, 100000000, UINT32_MAX, (uint64_t)UINT32_MAX + 1,
+                           9999999999999999ull, 10000000000000000ull, 1767225600000000ull, UINT64_MAX };
+    for (size_t i = 0; i < sizeof(u) / sizeof(u[0]); i++) check_u64(u[i]);
+    const int64_t f[] = { 0, -5, 5, -1, 100, -100, INT32_MIN, INT32_MAX, (int64_t)UINT32_MAX + 1, INT64_MIN, INT64_MAX };
+    for (size_t i = 0; i < sizeof(f) / sizeof(f[0]); i++)
+        for (unsigned d = 0; d <= 9; d++) check_fixed(f[i], d);
+    srand(3);
+    for (int i = 0; i < 20000; i++){
+        uint64_t v = rnd64() >> (rand() % 64);
+        check_u64(v);
+        check_fixed((int64_t)v * (rand() & 1 ? -1 : 1) / 2, (unsigned)(rand() % 10));
+    }
+}
+
+// The "/data" record as mqtt_svc.c wrote it with snprintf before rectext.c.
+static int codes_printf(char *buf, size_t cap, const sample_t *s){
+    int len = snprintf(buf, cap, "{\"t\":%" PRIu64 ",\"u\":%" PRIu64 ",\"e\":%" PRIu64 ",\"cap\":[", s->t_ms, s->t_us,
+                       s->epoch_us);
+    for (int c = 0; c < SAMPLE_CAPS; c++) len += snprintf(buf + len, cap - (size_t)len, "%s%" PRId32, c ? "," : "", s->cap_raw[c]);
+    len += snprintf(buf + len, cap - (size_t)len, "],\"dac\":[");
+    for (int c = 0; c < SAMPLE_CAPS; c++) len += snprintf(buf + len, cap - (size_t)len, "%s%u", c ? "," : "", s->capdac[c]);
+    len += snprintf(buf + len, cap - (size_t)len, "],\"tc\":%" PRId32 ",\"rh\":%" PRIu32 ",\"pa\":%" PRIu32 ",\"mc\":%u,\"f\":%u}",
+                    s->temp_cdeg, s->hum_q10, s->pres_q8, s->mc_cpct, s->flags);
+    return len;
+}
+
+static sample_t random_sample(void){
+    sample_t s = {};
+    s.t_ms = rnd64();
+    s.t_us = rnd64();
+    s.epoch_us = rnd64();
+    // what the FDC1004 gives: a 24-bit result and a CAPDAC units_cap_af() takes
+    for (int c = 0; c < SAMPLE_CAPS; c++){
+        s.cap_raw[c] = (int32_t)(rnd32() >> 8) - (1 << 23);
+        s.capdac[c] = (uint8_t)(rand() % (FDC_CAPDAC_MAX + 1));
+    }
+    s.temp_cdeg = (int32_t)rnd32();
+    s.hum_q10 = rnd32();
+    s.pres_q8 = rnd32();
+    s.mc_cpct = (uint16_t)rand();
+    s.flags = (uint16_t)rand();
+    return s;
+}
+
+static void test_codes_json_is_the_printf_layout(void){
+    static char got[RT_RECORD_MAX], want[2 * RT_RECORD_MAX];
+    srand(4);
+    for (int i = 0; i < 2000; i++){
+        sample_t s = random_sample();
+        if (i == 0) memset(&s, 0, sizeof(s));
+        int n = codes_printf(want, sizeof(want), &s);
+        rt_enc_t e;
+        TEST_ASSERT_EQUAL(ESP_OK, rt_enc_init(&e, got, sizeof(got), RT_JSON_CODES));
+        TEST_ASSERT_TRUE(rt_enc_add(&e, &s));
+        TEST_ASSERT_EQUAL(n, rt_enc_len(&e));
+        TEST_ASSERT_EQUAL_MEMORY(want, got, (size_t)n);
+    }
+}
+
+static sample_t known(void){
+    sample_t s = {};
+    s.t_ms = 61000;
+    s.t_us = 60995123;
+    s.epoch_us = 1767225660995123ull;
+    s.cap_raw[0] = 2 << 19;                    // 2 pF
+    s.cap_raw[1] = -(1 << 19);                 // -1 pF against 3 CAPDAC steps
+    s.capdac[1] = 3;
+    s.cap_raw[2] = -3;
+    s.temp_cdeg = -5;
+    s.hum_q10 = 45 * 1024 + 512;               // 45.5 %RH
+    s.pres_q8 = 101325u * 256;
+    s.mc_cpct = 1234;
+    s.flags = SAMPLE_FLAG_CAPDAC;
+    return s;
+}
+
+static void test_units_json(void){
+    char buf[2 * RT_RECORD_MAX + 1];
+    rt_enc_t e;
+    TEST_ASSERT_EQUAL(ESP_OK, rt_enc_init(&e, buf, sizeof(buf) - 1, RT_JSON));
+    sample_t s = known();
+    TEST_ASSERT_TRUE(rt_enc_add(&e, &s));
+    s.mc_cpct = WMC_INVALID;
+    TEST_ASSERT_TRUE(rt_enc_add(&e, &s));
+    buf[rt_enc_len(&e)] = '\0';
+    char want[2 * RT_RECORD_MAX], *p = want;
+    for (int k = 0; k < 2; k++){
+        p += sprintf(p, "%s{\"t\":61000,\"e\":1767225660995123,\"pf\":[2.000000,8.375000,-0.000006", k ? "," : "");
+        for (int c = 3; c < SAMPLE_CAPS; c++) p += sprintf(p, ",0.000000");
+        p += sprintf(p, "],\"degc\":-0.05,\"rh\":45.500,\"hpa\":1013.25,\"mc\":%s,\"f\":16}", k ? "null" : "12.34");
+    }
+    TEST_ASSERT_EQUAL_STRING(want, buf);
+    TEST_ASSERT_EQUAL_UINT32(2, e.count);
+}
+
+static void test_csv(void){
+    char buf[1024];
+    size_t n = rt_csv_header(buf, sizeof(buf));
+    TEST_ASSERT_TRUE(n > 0);
+    TEST_ASSERT_EQUAL(0, rt_csv_header(buf, n - 1));
+    rt_enc_t e;
+    TEST_ASSERT_EQUAL(ESP_OK, rt_enc_init(&e, buf + n, sizeof(buf) - n - 1, RT_CSV));
+    sample_t s = known();
+    s.mc_cpct = WMC_INVALID;
+    TEST_ASSERT_TRUE(rt_enc_add(&e, &s));
+    buf[n + rt_enc_len(&e)] = '\0';
+
+    char want[1024], *p = want;
+    p += sprintf(p, "t_ms,epoch_us");
+    for (int c = 0; c < SAMPLE_CAPS; c++) p += sprintf(p, ",cap%d_pf", c);
+    p += sprintf(p, ",temp_c,rh_pct,pres_hpa,mc_pct,flags\n61000,1767225660995123,2.000000,8.375000,-0.000006");
+    for (int c = 3; c < SAMPLE_CAPS; c++) p += sprintf(p, ",0.000000");
+    sprintf(p, ",-0.05,45.500,1013.25,,16\n");
+    TEST_ASSERT_EQUAL_STRING(want, buf);
+}
+
+// Values read back as numbers are the integer fields in units, exactly.
+static void test_units_parse_back(void){
+    static char buf[64 * RT_RECORD_MAX + 1];
+    static sample_t in[64];
+    srand(5);
+    rt_enc_t e;
+    TEST_ASSERT_EQUAL(ESP_OK, rt_enc_init(&e, buf, sizeof(buf) - 1, RT_CSV));
+    for (int i = 0; i < 64; i++){
+        in[i] = random_sample();
+        in[i].cap_raw[0] = (int32_t)(rnd32() >> 8) - (1 << 23);   // the FDC1004's 24 bits
+        in[i].mc_cpct = (uint16_t)(rand() % 3000);
+        TEST_ASSERT_TRUE(rt_enc_add(&e, &in[i]));
+    }
+    buf[rt_enc_len(&e)] = '\0';
+    char *p = buf;
+    for (int i = 0; i < 64; i++){
+        TEST_ASSERT_EQUAL_UINT64(in[i].t_ms, strtoull(p, &p, 10));
+        TEST_ASSERT_EQUAL_UINT64(in[i].epoch_us, strtoull(p + 1, &p, 10));
+        double pf = strtod(p + 1, &p);
+        TEST_ASSERT_EQUAL_INT64(units_cap_af(in[i].cap_raw[0], in[i].capdac[0]), (int64_t)(pf * 1e6 + (pf < 0 ? -0.5 : 0.5)));
+        for (int c = 1; c < SAMPLE_CAPS; c++) strtod(p + 1, &p);
+        double t = strtod(p + 1, &p), rh = strtod(p + 1, &p), hpa = strtod(p + 1, &p), mc = strtod(p + 1, &p);
+        TEST_ASSERT_EQUAL_INT64(in[i].temp_cdeg, (int64_t)(t * 100 + (t < 0 ? -0.5 : 0.5)));
+        TEST_ASSERT_EQUAL_INT64(units_hum_mpct(in[i].hum_q10), (int64_t)(rh * 1000 + (rh < 0 ? -0.5 : 0.5)));
+        TEST_ASSERT_EQUAL_INT64(units_pres_pa(in[i].pres_q8), (int64_t)(hpa * 100 + (hpa < 0 ? -0.5 : 0.5)));
+        TEST_ASSERT_EQUAL_INT64(in[i].mc_cpct, (int64_t)(mc * 100 + 0.5));
+        TEST_ASSERT_EQUAL_UINT64(in[i].flags, strtoull(p + 1, &p, 10));
+        TEST_ASSERT_EQUAL('\n', *p++);
+    }
+    TEST_ASSERT_EQUAL('\0', *p);
+}
+
+// A batch fills the buffer up to the last record that fits; the one that
+// does not is refused whole and the bytes after the batch stay untouched.
+static void test_full_buffer_refuses_the_record(void){
+    for (int fmt = RT_JSON_CODES; fmt <= RT_CSV; fmt++){
+        static char buf[3 * RT_RECORD_MAX];
+        memset(buf, '#', sizeof(buf));
+        size_t cap = 2 * RT_RECORD_MAX + 7;
+        rt_enc_t e;
+        TEST_ASSERT_EQUAL(ESP_OK, rt_enc_init(&e, buf, cap, (rt_fmt_t)fmt));
+        srand(6);
+        sample_t s = random_sample();
+        size_t one = 0, n = 0;
+        while (rt_enc_add(&e, &s)){
+            if (!one) one = rt_enc_len(&e);
+            n++;
+        }
+        TEST_ASSERT_TRUE(n >= 2);
+        TEST_ASSERT_EQUAL_UINT32(n, e.count);
+        // every record but the first has a separator in JSON
+        TEST_ASSERT_EQUAL(n * one + (fmt == RT_CSV ? 0 : n - 1), rt_enc_len(&e));
+        TEST_ASSERT_TRUE(cap - rt_enc_len(&e) < one + 1);
+        for (size_t i = rt_enc_len(&e); i < sizeof(buf); i++) TEST_ASSERT_EQUAL('#', buf[i]);
+    }
+    rt_enc_t e;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, rt_enc_init(&e, NULL, 0, (rt_fmt_t)(RT_CSV + 1)));
+}
+
+int main(void){
+    UNITY_BEGIN();
+    RUN_TEST(test_numbers_match_printf);
+    RUN_TEST(test_codes_json_is_the_printf_layout);
+    RUN_TEST(test_units_json);
+    RUN_TEST(test_csv);
+    RUN_TEST(test_units_parse_back);
+    RUN_TEST(test_full_buffer_refuses_the_record);
+    return UNITY_END();
+}
@@ -0,0 +1,213 @@
+#include <unity.h>
+
+extern "C" {
+#include "board.h"
+#include "config.h"
+#include "record.h"
+#include "sampler.h"
+#include "fdc1004.h"
+#include "bme280_drv.h"
+#include "timebase.h"
+#include "units.h"
+#include "wmc.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "sim_sntp.h"
+#include "esp_log.h"
+}
+
+// Runs against the simulated board from the host build (host/sim).
+
+void setUp(void){
+    sim_board_init();
+    sim_sntp_reset();
+    tb_reset();
+    sample_t s;
+    while (record_pop(&s)) {}
+}
+
+void tearDown(void){}
+
+static void test_fdc_init_probes_ids(void){
+    TEST_ASSERT_EQUAL(ESP_OK, fdc_init());
+    sim_i2c_detach_all();
+    TEST_ASSERT_EQUAL(ESP_FAIL, fdc_init());
+}
+
+static void test_bme_read_matches_environment(void){
+    sim_board_bme.temp_c = 23.4f;
+    sim_board_bme.hum_pct = 55.0f;
+    sim_board_bme.pres_hpa = 990.0f;
+    TEST_ASSERT_EQUAL(ESP_OK, bme_init());
+
+    int32_t t;
+    uint32_t h, p;
+    TEST_ASSERT_EQUAL(ESP_OK, bme_read(&t, &h, &p));
+    TEST_ASSERT_INT_WITHIN(1, 2340, t);
+    TEST_ASSERT_INT_WITHIN(10, 55000, units_hum_mpct(h));
+    TEST_ASSERT_INT_WITHIN(5, 99000, units_pres_pa(p));
+}
+
+static void test_sampler_job_pushes_timestamped_record(void){
+    sim_board_fdc.cin_pf[1] = 2.0f;
+    TEST_ASSERT_EQUAL(ESP_OK, bme_init());
+    sampler_init();
+    sim_clock_advance_ms(1234);
+
+    sampler_job();
+    TEST_ASSERT_EQUAL(1, record_count());
+    TEST_ASSERT_EQUAL(0, gpio_get_level(LED_SENSE_GPIO));
+
+    sample_t s;
+    TEST_ASSERT_TRUE(record_pop(&s));
+    TEST_ASSERT_EQUAL_UINT64(1234, s.t_ms);
+    TEST_ASSERT_INT_WITHIN(1, 2150, s.temp_cdeg);
+    TEST_ASSERT_INT_WITHIN(10, 45000, units_hum_mpct(s.hum_q10));
+    TEST_ASSERT_INT_WITHIN(5, 101325, units_pres_pa(s.pres_q8));
+    TEST_ASSERT_INT_WITHIN(2, 2000000, units_cap_af(s.cap_raw[1], s.capdac[1]));
+}
+
+static void test_records_carry_read_and_wall_clock_times(void){
+    TEST_ASSERT_EQUAL(ESP_OK, bme_init());
+    sampler_init();
+    sim_clock_advance_ms(1000);
+    sampler_job();
+    sample_t s;
+    TEST_ASSERT_TRUE(record_pop(&s));
+    TEST_ASSERT_TRUE(s.t_us > 0 && s.t_us <= s.t_ms * 1000);
+    TEST_ASSERT_EQUAL_UINT64(0, s.epoch_us);   // no SNTP answer yet
+
+    sim_sntp_set_offset_us(1700000000000000ll);
+    TEST_ASSERT_EQUAL(ESP_OK, tb_sntp_start());
+    TEST_ASSERT_EQUAL(1, sim_sntp_run_pending());
+    sim_clock_advance_ms(1000);
+    sampler_job();
+    TEST_ASSERT_TRUE(record_pop(&s));
+    TEST_ASSERT_TRUE(s.t_us <= s.t_ms * 1000);
+    TEST_ASSERT_EQUAL_UINT64(tb_epoch_us(s.t_us), s.epoch_us);
+    TEST_ASSERT_EQUAL_UINT64(1700000000000000ull + s.t_us, s.epoch_us);
+}
+
+static void test_records_carry_filtered_capacitance(void){
+    sim_board_fdc.cin_pf[0] = 4.0f;
+    sim_board_fdc.noise_pf = 0.05f;
+    TEST_ASSERT_EQUAL(ESP_OK, bme_init());
+    sampler_init();
+    // 100 S/s shared by four measurements: 25 conversions per record
+    TEST_ASSERT_EQUAL(25, sampler_get_filter()->decim);
+
+    sampler_job();   // nothing filtered yet: a single conversion
+    sample_t s;
+    TEST_ASSERT_TRUE(record_pop(&s));
+    TEST_ASSERT_TRUE(s.flags & SAMPLE_FLAG_UNFILTERED);
+
+    int32_t worst = 0;
+    for (int rec = 0; rec < 20; rec++){
+        for (int t = 0; t < SAMPLE_PERIOD_MS; t += SAMPLE_POLL_MS){
+            sim_clock_advance_ms(SAMPLE_POLL_MS);
+            sampler_poll_job();
+        }
+        sampler_job();
+        TEST_ASSERT_TRUE(record_pop(&s));
+        TEST_ASSERT_FALSE(s.flags & SAMPLE_FLAG_UNFILTERED);
+        int32_t e = units_cap_af(s.cap_raw[0], s.capdac[0]) - 4000000;
+        if (e < 0) e = -e;
+        if (e > worst) worst = e;
+    }
+    // single conversions scatter by up to 50000 aF; 25-conversion means by ~1/5 of that
+    TEST_ASSERT_LESS_THAN(25000, worst);
+
+    // a failed poll drops back to direct reads rather than repeat stale outputs
+    sim_i2c_detach_all();
+    sampler_poll_job();
+    sampler_job();
+    TEST_ASSERT_TRUE(record_pop(&s));
+    TEST_ASSERT_TRUE(s.flags & SAMPLE_FLAG_UNFILTERED);
+}
+
+static void test_records_carry_moisture_content(void){
+    sim_board_bme.temp_c = 35.0f;
+    sim_board_fdc.cin_pf[WMC_MEAS] = (float)wmc_model_af(1250, 3500) / 1e6f;
+    TEST_ASSERT_EQUAL(ESP_OK, bme_init());
+    sampler_init();
+    sim_clock_advance_ms(SAMPLE_PERIOD_MS);
+    sampler_job();
+    sample_t s;
+    TEST_ASSERT_TRUE(record_pop(&s));
+    TEST_ASSERT_INT_WITHIN(2, 1250, s.mc_cpct);
+    TEST_ASSERT_FALSE(s.flags & SAMPLE_FLAG_MC_CLAMPED);
+
+    // open electrodes read below dry wood: clamped to 0 %
+    sim_board_fdc.cin_pf[WMC_MEAS] = 0.2f;
+    sim_clock_advance_ms(SAMPLE_PERIOD_MS);
+    sampler_job();
+    TEST_ASSERT_TRUE(record_pop(&s));
+    TEST_ASSERT_EQUAL_UINT16(0, s.mc_cpct);
+    TEST_ASSERT_TRUE(s.flags & SAMPLE_FLAG_MC_CLAMPED);
+
+    // no wood temperature, no estimate
+    sim_i2c_inject_error(BME280_I2C_ADDR, ESP_ERR_TIMEOUT, 4);
+    sim_clock_advance_ms(SAMPLE_PERIOD_MS);
+    sampler_job();
+    TEST_ASSERT_TRUE(record_pop(&s));
+    TEST_ASSERT_EQUAL_UINT16(WMC_INVALID, s.mc_cpct);
+}
+
+// 5 pF rising 1 pF/s on CIN1, the others steady.
+static float ramp(void *ctx, int cin, uint64_t t_ns){ return cin ? 3.0f : 5.0f + (float)t_ns / 1e9f; }
+
+static void test_records_follow_the_input_across_capdac_steps(void){
+    sim_board_fdc.input = ramp;
+    TEST_ASSERT_EQUAL(ESP_OK, bme_init());
+    sampler_init();
+    sample_t s;
+    int moves = 0;
+    for (int rec = 0; rec < 60; rec++){
+        for (int t = 0; t < SAMPLE_PERIOD_MS; t += SAMPLE_POLL_MS){
+            sim_clock_advance_ms(SAMPLE_POLL_MS);
+            sampler_poll_job();
+        }
+        sampler_job();
+        TEST_ASSERT_TRUE(record_pop(&s));
+        TEST_ASSERT_FALSE(s.flags & SAMPLE_FLAG_SATURATED);
+        if (s.flags & SAMPLE_FLAG_CAPDAC) moves++;
+        // the filtered value lags the ramp by half a record
+        float now = ramp(NULL, 0, sim_clock_now_ns());
+        TEST_ASSERT_INT_WITHIN(600000, (int32_t)(now * 1e6f), units_cap_af(s.cap_raw[0], s.capdac[0]));
+        TEST_ASSERT_INT_WITHIN(2, 3000000, units_cap_af(s.cap_raw[1], s.capdac[1]));
+        TEST_ASSERT_EQUAL_UINT8(0, s.capdac[1]);
+    }
+    // 5 to 65 pF: once past 12 pF, then every ~12.5 pF
+    TEST_ASSERT_TRUE(s.capdac[0] >= 17 && s.capdac[0] <= 21);
+    TEST_ASSERT_TRUE(moves >= 4 && moves <= 6);
+}
+
+static void test_sampler_job_stops_at_full_ring(void){
+    TEST_ASSERT_EQUAL(ESP_OK, bme_init());
+    sampler_init();
+    for (int i = 0; i < RECORD_RING_CAP + 3; i++){
+        sim_clock_advance_ms(SAMPLE_PERIOD_MS);
+        sampler_job();
+    }
+    TEST_ASSERT_EQUAL(RECORD_RING_CAP, record_count());
+
+    // The oldest record survives; the overflow was rejected.
+    sample_t s;
+    TEST_ASSERT_TRUE(record_pop(&s));
+    TEST_ASSERT_EQUAL_UINT64(SAMPLE_PERIOD_MS, s.t_ms);
+}
+
+int main(void){
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    UNITY_BEGIN();
+    RUN_TEST(test_fdc_init_probes_ids);
+    RUN_TEST(test_bme_read_matches_environment);
+    RUN_TEST(test_sampler_job_pushes_timestamped_record);
+    RUN_TEST(test_records_carry_read_and_wall_clock_times);
+    RUN_TEST(test_records_carry_filtered_capacitance);
+    RUN_TEST(test_records_carry_moisture_content);
+    RUN_TEST(test_records_follow_the_input_across_capdac_steps);
+    RUN_TEST(test_sampler_job_stops_at_full_ring);
+    return UNITY_END();
+}
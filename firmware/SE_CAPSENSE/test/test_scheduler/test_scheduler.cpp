@@ -0,0 +1,185 @@
+#include <unity.h>
+#include <string.h>
+
+extern "C" {
+#include "scheduler.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_sch.h"
+#include "esp_log.h"
+}
+
+// Scheduler (src/scheduler.c) on the virtual clock: sch_wait_us sleeps by
+// advancing it (host/sim/sim_sch.c).
+
+static char s_order[64];
+static size_t s_norder;
+static uint32_t s_hog_ms;   // next run of the hog job takes this long
+
+static void note(char c){ if (s_norder < sizeof(s_order) - 1) s_order[s_norder++] = c; }
+static void job_a(void){ note('a'); }
+static void job_b(void){ note('b'); }
+static void job_c(void){ note('c'); }
+static void job_hog(void){
+    sim_clock_advance_ms(s_hog_ms);
+    s_hog_ms = 0;
+}
+
+// app_main's loop for `ms` of virtual time.
+static void loop_ms(uint32_t ms){
+    uint64_t end = sim_clock_now_ns() + (uint64_t)ms * 1000000u;
+    while (sim_clock_now_ns() < end){
+        uint32_t us = sch_run_due();
+        uint64_t left = (end - sim_clock_now_ns()) / 1000u;
+        sch_wait_us(us < left ? us : (uint32_t)left);
+    }
+}
+
+void setUp(void){
+    sim_board_init();
+    sim_sch_reset();
+    TEST_ASSERT_EQUAL(ESP_OK, sch_init());
+    memset(s_order, 0, sizeof(s_order));
+    s_norder = 0;
+    s_hog_ms = 0;
+}
+
+void tearDown(void){}
+
+static void test_sleeps_until_the_next_deadline(void){
+    int a = sch_add("a", job_a, 3000, SCH_SKIP);
+    int b = sch_add("b", job_b, SCH_MS(10), SCH_SKIP);
+    loop_ms(100);
+
+    sch_job_stats_t st;
+    TEST_ASSERT_TRUE(sch_get_job_stats(a, &st));
+    TEST_ASSERT_EQUAL_UINT32(33, st.runs);
+    TEST_ASSERT_EQUAL_UINT32(0, st.jitter_max_us);
+    TEST_ASSERT_TRUE(sch_get_job_stats(b, &st));
+    TEST_ASSERT_EQUAL_UINT32(9, st.runs);
+    TEST_ASSERT_EQUAL_UINT32(0, st.missed);
+
+    // one wakeup per distinct deadline (a and b coincide at 30, 60, 90 ms),
+    // none in between
+    sch_stats_t s;
+    sch_get_stats(&s);
+    TEST_ASSERT_EQUAL_UINT32(39, s.wakeups - s.idle_wakeups);
+    TEST_ASSERT_TRUE(s.idle_wakeups <= 1);
+    TEST_ASSERT_EQUAL_UINT32(42, s.dispatches);
+}
+
+static void test_same_deadline_runs_in_add_order(void){
+    sch_add("c", job_c, SCH_MS(5), SCH_SKIP);
+    sch_add("a", job_a, SCH_MS(5), SCH_SKIP);
+    sch_add("b", job_b, SCH_MS(10), SCH_SKIP);
+    loop_ms(21);
+    TEST_ASSERT_EQUAL_STRING("cacabcacab", s_order);
+}
+
+static void test_overrun_skip_keeps_phase(void){
+    int a = sch_add("a", job_a, SCH_MS(10), SCH_SKIP);
+    sch_add("hog", job_hog, SCH_MS(5), SCH_SKIP);
+    s_hog_ms = 35;   // 5 ms -> 40 ms: a's 10, 20, 30 and 40 ms deadlines pass
+    loop_ms(100);
+
+    sch_job_stats_t st;
+    sch_get_job_stats(a, &st);
+    TEST_ASSERT_EQUAL_UINT32(1, st.missed);
+    TEST_ASSERT_EQUAL_UINT32(3, st.skipped);
+    TEST_ASSERT_EQUAL_UINT32(30000, st.jitter_max_us);
+    // ran at 40 ms for the 10 ms slot, then on the 10 ms grid again
+    TEST_ASSERT_EQUAL_UINT32(6, st.runs);
+}
+
+static void test_overrun_catch_up_runs_every_period(void){
+    int a = sch_add("a", job_a, SCH_MS(10), SCH_CATCH_UP);
+    sch_add("hog", job_hog, SCH_MS(5), SCH_SKIP);
+    s_hog_ms = 35;
+    loop_ms(100);
+
+    sch_job_stats_t st;
+    sch_get_job_stats(a, &st);
+    TEST_ASSERT_EQUAL_UINT32(9, st.runs);   // 10..90 ms
+    TEST_ASSERT_EQUAL_UINT32(0, st.skipped);
+    TEST_ASSERT_EQUAL_UINT32(3, st.missed);   // the 10, 20 and 30 ms runs, all at 40 ms
+    TEST_ASSERT_EQUAL_UINT32(30000, st.jitter_max_us);
+
+    sch_get_job_stats(1, &st);
+    TEST_ASSERT_EQUAL_UINT32(35000, st.run_max_us);
+}
+
+static void test_trigger_wakes_the_loop(void){
+    int ev = sch_add("ev", job_c, 0, SCH_SKIP);
+    sch_add("a", job_a, SCH_MS(100), SCH_SKIP);
+
+    uint32_t us = sch_run_due();
+    TEST_ASSERT_EQUAL_UINT32(100000, us);
+    sch_trigger(ev);
+    sch_trigger(ev);   // coalesced with the first
+    sch_wait_us(us);
+    TEST_ASSERT_EQUAL_UINT64(0, sim_clock_now_ns());   // woken, not timed out
+    sch_run_due();
+    TEST_ASSERT_EQUAL_STRING("c", s_order);
+
+    sim_sch_stats_t ss;
+    sim_sch_get_stats(&ss);
+    TEST_ASSERT_EQUAL_UINT32(1, ss.woken);
+    sch_job_stats_t st;
+    sch_get_job_stats(ev, &st);
+    TEST_ASSERT_EQUAL_UINT32(1, st.runs);
+    TEST_ASSERT_EQUAL_UINT32(1, st.triggered);
+
+    // an event job never comes due on its own
+    loop_ms(1001);
+    TEST_ASSERT_EQUAL_STRING("caaaaaaaaaa", s_order);
+}
+
+static int s_self;
+static void job_self_slows(void){
+    note('s');
+    sch_set_period(s_self, SCH_MS(30));
+}
+
+static void test_set_period_rearms_from_the_last_deadline(void){
+    int a = sch_add("a", job_a, SCH_MS(10), SCH_SKIP);
+    s_self = sch_add("s", job_self_slows, SCH_MS(10), SCH_SKIP);
+    int e = sch_add("e", job_c, 0, SCH_SKIP);
+    loop_ms(25);                       // a at 10, 20; s at 10, now every 30
+    TEST_ASSERT_EQUAL(ESP_OK, sch_set_period(a, SCH_MS(50)));
+    loop_ms(75);                       // a at 70 (20 + 50); s at 40, 70
+    TEST_ASSERT_EQUAL_STRING("asasas", s_order);
+    sch_job_stats_t st;
+    sch_get_job_stats(a, &st);
+    TEST_ASSERT_EQUAL_UINT32(SCH_MS(50), st.period_us);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, sch_set_period(e, SCH_MS(10)));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, sch_set_period(a, 0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, sch_set_period(7, SCH_MS(10)));
+}
+
+static void test_table_full_is_refused(void){
+    for (int i = 0; i < SCH_MAX_JOBS; i++) TEST_ASSERT_EQUAL(i, sch_add("a", job_a, SCH_MS(1), SCH_SKIP));
+    TEST_ASSERT_EQUAL(-1, sch_add("b", job_b, SCH_MS(1), SCH_SKIP));
+    TEST_ASSERT_EQUAL(SCH_MAX_JOBS, sch_job_count());
+    loop_ms(2);
+    TEST_ASSERT_EQUAL(SCH_MAX_JOBS, (int)strlen(s_order));
+
+    sch_reset_stats();
+    sch_job_stats_t st;
+    sch_get_job_stats(0, &st);
+    TEST_ASSERT_EQUAL_UINT32(0, st.runs);
+    TEST_ASSERT_EQUAL_STRING("a", st.name);
+    TEST_ASSERT_FALSE(sch_get_job_stats(SCH_MAX_JOBS, &st));
+}
+
+int main(void){
+    esp_log_level_set("*", ESP_LOG_NONE);
+    UNITY_BEGIN();
+    RUN_TEST(test_sleeps_until_the_next_deadline);
+    RUN_TEST(test_same_deadline_runs_in_add_order);
+    RUN_TEST(test_overrun_skip_keeps_phase);
+    RUN_TEST(test_overrun_catch_up_runs_every_period);
+    RUN_TEST(test_trigger_wakes_the_loop);
+    RUN_TEST(test_set_period_rearms_from_the_last_deadline);
+    RUN_TEST(test_table_full_is_refused);
+    return UNITY_END();
+}
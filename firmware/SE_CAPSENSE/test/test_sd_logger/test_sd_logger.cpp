@@ -0,0 +1,307 @@
+#include <unity.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C" {
+#include "board.h"
+#include "config.h"
+#include "drain.h"
+#include "record.h"
+#include "sd_logger.h"
+#include "sd_port.h"
+#include "sim_board.h"
+#include "sim_clock.h"
+#include "sim_sd.h"
+#include "esp_log.h"
+}
+
+// SD logger (src/sd_logger.c) over the file-backed card (host/sim/sim_sd.c).
+
+#define IMG "test_sd_logger.img"
+#define FRAME SDLOG_FRAME_RECORDS
+
+static uint32_t s_next;   // t_ms of the next generated record
+
+static sample_t mk(uint32_t i){
+    sample_t s = {};
+    s.t_ms = i;
+    for (int c = 0; c < 4; c++) s.cap_raw[c] = (int32_t)(i * 4 + c);
+    s.temp_cdeg = (int32_t)i;
+    s.flags = (uint16_t)i;
+    return s;
+}
+
+// Push n new records through the ring into the logger; writes run as they
+// are queued unless hold is set.
+static void log_n(uint32_t n, bool hold = false){
+    while (n){
+        while (n && record_count() < RECORD_RING_CAP){
+            sample_t s = mk(s_next++);
+            TEST_ASSERT_TRUE(record_push(&s));
+            n--;
+        }
+        drain_job();
+        sdlog_job_flush();
+        if (!hold) sim_sd_run_pending();
+        else if (record_count() == RECORD_RING_CAP) break;
+    }
+}
+
+static void flush_now(void){
+    TEST_ASSERT_EQUAL(ESP_OK, sdlog_flush());
+    sim_sd_run_pending();
+}
+
+static void check_slot(uint32_t slot, uint32_t want_seq, uint32_t first, size_t want_n){
+    static sample_t out[FRAME];
+    size_t n = 0;
+    uint32_t seq = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, sdlog_read_slot(slot, out, FRAME, &n, &seq));
+    TEST_ASSERT_EQUAL_UINT32(want_seq, seq);
+    TEST_ASSERT_EQUAL(want_n, n);
+    for (size_t i = 0; i < n; i++){
+        sample_t e = mk(first + (uint32_t)i);
+        TEST_ASSERT_EQUAL_MEMORY(&e, &out[i], sizeof(sample_t));
+    }
+}
+
+void setUp(void){
+    sim_board_init();
+    sim_sd_reset();
+    sim_sd_set_path(IMG);
+    unlink(IMG);
+    sample_t s;
+    while (record_pop(&s)) {}
+    s_next = 0;
+    sdlog_reset_stats();
+    drain_add_sink(sdlog_append);
+}
+
+void tearDown(void){
+    sim_sd_reset();
+    unlink(IMG);
+}
+
+static void test_init_preallocates_the_log(void){
+    TEST_ASSERT_EQUAL(ESP_OK, sdlog_init());
+    struct stat st;
+    TEST_ASSERT_EQUAL(0, stat(IMG, &st));
+    TEST_ASSERT_EQUAL_UINT64((uint64_t)SD_LOG_SECTORS * SD_SECTOR_SIZE, (uint64_t)st.st_size);
+    TEST_ASSERT_EQUAL_UINT32(SD_LOG_SECTORS / SD_FRAME_SECTORS, sdlog_slots());
+    TEST_ASSERT_EQUAL_UINT32(0, sdlog_slot());
+
+    // a card too small for two frames is refused
+    sim_sd_set_capacity(SD_FRAME_SECTORS);
+    unlink(IMG);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, sdlog_init());
+    TEST_ASSERT_FALSE(sdlog_ready());
+}
+
+static void test_records_round_trip(void){
+    sim_sd_set_capacity(16 * SD_FRAME_SECTORS);
+    TEST_ASSERT_EQUAL(ESP_OK, sdlog_init());
+    log_n(2 * FRAME + 32);
+    flush_now();
+    TEST_ASSERT_EQUAL(0, record_count());
+
+    check_slot(0, 0, 0, FRAME);
+    check_slot(1, 1, FRAME, FRAME);
+    check_slot(2, 2, 2 * FRAME, 32);
+    sample_t out[1];
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_CRC, sdlog_read_slot(3, out, 1, NULL, NULL));
+
+    sdlog_stats_t st;
+    sdlog_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(2 * FRAME + 32, st.records);
+    TEST_ASSERT_EQUAL_UINT32(2, st.frames);
+    TEST_ASSERT_EQUAL_UINT32(3, st.writes);
+    TEST_ASSERT_EQUAL_UINT32(0, st.write_errors);
+    // full frames are whole frames; the open one only its used sectors
+    uint32_t tail = (uint32_t)((sizeof(sdlog_hdr_t) + 32 * sizeof(sample_t) + SD_SECTOR_SIZE - 1) / SD_SECTOR_SIZE);
+    TEST_ASSERT_EQUAL_UINT64((uint64_t)(2 * SD_FRAME_SECTORS + tail) * SD_SECTOR_SIZE, st.bytes);
+
+    // any damage is caught by the CRC
+    static uint8_t frame[SDLOG_FRAME_BYTES];
+    TEST_ASSERT_EQUAL(ESP_OK, sd_port_read(SD_FRAME_SECTORS, frame, SD_FRAME_SECTORS));
+    TEST_ASSERT_NOT_NULL(sdlog_frame_check(frame, sizeof(frame)));
+    frame[sizeof(sdlog_hdr_t) + 100] ^= 0x10;
+    TEST_ASSERT_NULL(sdlog_frame_check(frame, sizeof(frame)));
+}
+
+static void test_open_frame_flushed_on_period(void){
+    sim_sd_set_capacity(16 * SD_FRAME_SECTORS);
+    TEST_ASSERT_EQUAL(ESP_OK, sdlog_init());
+    sim_sd_reset_stats();
+
+    log_n(3);
+    TEST_ASSERT_EQUAL(0, sim_sd_pending());   // buffered, period not up
+    sim_clock_advance_ms(SD_FLUSH_PERIOD_MS);
+    sdlog_job_flush();
+    TEST_ASSERT_EQUAL(1, sim_sd_run_pending());
+    sim_sd_stats_t ss;
+    sim_sd_get_stats(&ss);
+    TEST_ASSERT_EQUAL_UINT64(1, ss.sectors_written);
+    TEST_ASSERT_EQUAL_UINT32(1, ss.syncs);
+    check_slot(0, 0, 0, 3);
+
+    // nothing new: nothing written
+    sim_clock_advance_ms(SD_FLUSH_PERIOD_MS);
+    sdlog_job_flush();
+    TEST_ASSERT_EQUAL(0, sim_sd_pending());
+
+    // the period since the last write is up: the next records go out with
+    // the job that takes them, rewriting the open frame in place
+    sim_sd_reset_stats();
+    log_n(20);
+    sim_sd_get_stats(&ss);
+    TEST_ASSERT_EQUAL_UINT32(1, ss.writes);
+    check_slot(0, 0, 0, 23);
+    TEST_ASSERT_EQUAL_UINT32(0, sdlog_slot());
+}
+
+static void test_backpressure_while_writer_busy(void){
+    sim_sd_set_capacity(16 * SD_FRAME_SECTORS);
+    TEST_ASSERT_EQUAL(ESP_OK, sdlog_init());
+    // writer stalled: one frame in flight, the second fills, then the ring
+    log_n(3 * FRAME + RECORD_RING_CAP, true);
+    sdlog_stats_t st;
+    sdlog_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(2 * FRAME, st.records);
+    TEST_ASSERT_TRUE(st.stalls > 0);
+    TEST_ASSERT_EQUAL(RECORD_RING_CAP, record_count());
+
+    // once the writer catches up nothing has been lost
+    while (record_count()){
+        sim_sd_run_pending();
+        drain_job();
+    }
+    sim_sd_run_pending();
+    uint32_t rest = s_next;
+    log_n(4 * FRAME - rest);
+    flush_now();
+    check_slot(0, 0, 0, FRAME);
+    check_slot(1, 1, FRAME, FRAME);
+    check_slot(2, 2, 2 * FRAME, FRAME);
+}
+
+static void test_power_cut_loses_at_most_one_frame(void){
+    sim_sd_set_capacity(16 * SD_FRAME_SECTORS);
+    TEST_ASSERT_EQUAL(ESP_OK, sdlog_init());
+    log_n(2 * FRAME + 10);
+    flush_now();
+
+    // reboot with an intact open frame: it is reopened and extended
+    TEST_ASSERT_EQUAL(ESP_OK, sdlog_init());
+    TEST_ASSERT_EQUAL_UINT32(2, sdlog_slot());
+    log_n(5);
+    flush_now();
+    check_slot(2, 2, 2 * FRAME, 15);
+
+    // power fails one sector into rewriting that frame
+    log_n(40);
+    TEST_ASSERT_EQUAL(ESP_OK, sdlog_flush());
+    sim_sd_cut_power_after(1);
+    sim_sd_run_pending();
+    sdlog_stats_t st;
+    sdlog_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(1, st.write_errors);
+
+    // after the reboot the torn frame is found and rewritten with its seq;
+    // the frames before it are intact
+    sample_t out[1];
+    TEST_ASSERT_EQUAL(ESP_OK, sdlog_init());
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_CRC, sdlog_read_slot(2, out, 1, NULL, NULL));
+    TEST_ASSERT_EQUAL_UINT32(2, sdlog_slot());
+    check_slot(0, 0, 0, FRAME);
+    check_slot(1, 1, FRAME, FRAME);
+    uint32_t first = s_next;
+    log_n(7);
+    flush_now();
+    check_slot(2, 2, first, 7);
+}
+
+static void test_log_wraps_and_resumes(void){
+    sim_sd_set_capacity(4 * SD_FRAME_SECTORS);
+    TEST_ASSERT_EQUAL(ESP_OK, sdlog_init());
+    TEST_ASSERT_EQUAL_UINT32(4, sdlog_slots());
+    log_n(5 * FRAME + 7);
+    flush_now();
+    sdlog_stats_t st;
+    sdlog_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(1, st.wraps);
+    check_slot(0, 4, 4 * FRAME, FRAME);
+    check_slot(1, 5, 5 * FRAME, 7);
+    check_slot(2, 2, 2 * FRAME, FRAME);   // oldest surviving frame
+
+    TEST_ASSERT_EQUAL(ESP_OK, sdlog_init());
+    TEST_ASSERT_EQUAL_UINT32(1, sdlog_slot());
+    log_n(FRAME - 7 + 1);
+    flush_now();
+    check_slot(1, 5, 5 * FRAME, FRAME);
+    check_slot(2, 6, 6 * FRAME, 1);
+}
+
+static void test_write_errors_counted(void){
+    sim_sd_set_capacity(16 * SD_FRAME_SECTORS);
+    TEST_ASSERT_EQUAL(ESP_OK, sdlog_init());
+    log_n(4);
+    sim_sd_inject_error(ESP_ERR_TIMEOUT, 1);
+    flush_now();
+    sdlog_stats_t st;
+    sdlog_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(1, st.write_errors);
+    TEST_ASSERT_EQUAL(0, gpio_get_level(LED_SD_GPIO));
+
+    // the open frame is written again by the next flush
+    flush_now();
+    check_slot(0, 0, 0, 4);
+}
+
+static void test_failed_frame_is_written_again(void){
+    sim_sd_set_capacity(16 * SD_FRAME_SECTORS);
+    TEST_ASSERT_EQUAL(ESP_OK, sdlog_init());
+    // the write of full frame 0 fails; its records stay readable from RAM
+    sim_sd_inject_error(ESP_ERR_TIMEOUT, 1);
+    log_n(FRAME + 1);
+    sdlog_stats_t st;
+    sdlog_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(1, st.write_errors);
+    static sample_t out[FRAME];
+    size_t n = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, sdlog_read_records(0, out, FRAME, &n));
+    TEST_ASSERT_EQUAL(FRAME, n);
+
+    // closing frame 1 writes frame 0 again first; the writer then refuses
+    // frame 2, which is kept for the close of frame 3
+    log_n(FRAME);
+    sim_sd_refuse_defer(1);
+    log_n(2 * FRAME);
+    drain_job();   // the record that closed frame 3 waited for the rewrite
+    sim_sd_run_pending();
+    TEST_ASSERT_EQUAL(0, record_count());
+    flush_now();
+    sdlog_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(2, st.write_errors);
+    TEST_ASSERT_EQUAL_UINT32(2, st.rewrites);
+    TEST_ASSERT_EQUAL_UINT32(4, st.frames);
+
+    // after a reboot every record is on the card
+    TEST_ASSERT_EQUAL(ESP_OK, sdlog_init());
+    for (uint32_t f = 0; f < 4; f++) check_slot(f, f, f * FRAME, FRAME);
+    check_slot(4, 4, 4 * FRAME, 1);
+}
+
+int main(void){
+    esp_log_level_set("*", ESP_LOG_NONE);
+    UNITY_BEGIN();
+    RUN_TEST(test_init_preallocates_the_log);
+    RUN_TEST(test_records_round_trip);
+    RUN_TEST(test_open_frame_flushed_on_period);
+    RUN_TEST(test_backpressure_while_writer_busy);
+    RUN_TEST(test_power_cut_loses_at_most_one_frame);
+    RUN_TEST(test_log_wraps_and_resumes);
+    RUN_TEST(test_write_errors_counted);
+    RUN_TEST(test_failed_frame_is_written_again);
+    return UNITY_END();
+}
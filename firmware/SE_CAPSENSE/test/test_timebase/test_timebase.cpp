@@ -0,0 +1,125 @@
+#include <unity.h>
+
+extern "C" {
+#include "config.h"
+#include "sim_clock.h"
+#include "sim_sntp.h"
+#include "timebase.h"
+#include "esp_log.h"
+}
+
+// Wall clock over SNTP (src/timebase.c) against the stand-in server.
+
+#define EPOCH_2026_US 1767225600000000ull
+
+void setUp(void){
+    sim_clock_set_ns(0);
+    sim_sntp_reset();
+    tb_reset();
+}
+
+void tearDown(void){}
+
+static int64_t error_us(void){ return (int64_t)(tb_epoch_us(tb_now_us()) - sim_sntp_now_us()); }
+
+static void test_wall_clock_from_the_first_answer(void){
+    sim_clock_advance_ms(2500);
+    TEST_ASSERT_FALSE(tb_synced());
+    TEST_ASSERT_EQUAL_UINT64(0, tb_epoch_us(tb_now_us()));
+    TEST_ASSERT_EQUAL(0, sim_sntp_run_pending());   // not started
+
+    sim_sntp_set_offset_us((int64_t)EPOCH_2026_US);
+    TEST_ASSERT_EQUAL(ESP_OK, tb_sntp_start());
+    TEST_ASSERT_EQUAL(1, sim_sntp_run_pending());
+    TEST_ASSERT_EQUAL(0, sim_sntp_run_pending());   // next one in TB_SNTP_INTERVAL_MS
+    TEST_ASSERT_TRUE(tb_synced());
+    TEST_ASSERT_EQUAL_UINT64(EPOCH_2026_US + 2500000u, tb_epoch_us(tb_now_us()));
+    // any recent monotonic time maps across
+    TEST_ASSERT_EQUAL_UINT64(EPOCH_2026_US + 2000000u, tb_epoch_us(2000000u));
+
+    tb_stats_t st;
+    tb_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(1, st.syncs);
+    TEST_ASSERT_EQUAL_UINT32(1, st.steps);
+}
+
+static void test_small_error_is_slewed_out(void){
+    sim_sntp_set_offset_us((int64_t)EPOCH_2026_US);
+    tb_sntp_start();
+    sim_sntp_run_pending();
+
+    // the server turns out 20 ms ahead at the next poll
+    sim_clock_advance_ms(TB_SNTP_INTERVAL_MS);
+    sim_sntp_set_offset_us((int64_t)EPOCH_2026_US + 20000);
+    uint64_t before = tb_epoch_us(tb_now_us());
+    TEST_ASSERT_EQUAL(1, sim_sntp_run_pending());
+    TEST_ASSERT_EQUAL_UINT64(before, tb_epoch_us(tb_now_us()));   // no jump
+    tb_stats_t st;
+    tb_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(1, st.steps);
+    TEST_ASSERT_EQUAL_INT32(-20000, st.last_err_us);
+    TEST_ASSERT_EQUAL_INT32(20000, st.slew_us);
+
+    // TB_SLEW_PPM: 20 ms take 40 s, the clock running a little fast meanwhile
+    uint64_t prev = before;
+    for (int s = 1; s <= 50; s++){
+        sim_clock_advance_ms(1000);
+        uint64_t t = tb_epoch_us(tb_now_us());
+        uint64_t gain = (uint64_t)(s <= 40 ? TB_SLEW_PPM : 0);
+        TEST_ASSERT_EQUAL_UINT64(1000000u + gain, t - prev);
+        prev = t;
+    }
+    TEST_ASSERT_EQUAL_INT64(0, error_us());
+    tb_get_stats(&st);
+    TEST_ASSERT_EQUAL_INT32(0, st.slew_us);
+}
+
+static void test_large_error_is_stepped(void){
+    sim_sntp_set_offset_us((int64_t)EPOCH_2026_US);
+    tb_sntp_start();
+    sim_sntp_run_pending();
+    sim_clock_advance_ms(TB_SNTP_INTERVAL_MS);
+    sim_sntp_set_offset_us((int64_t)EPOCH_2026_US - 3000000);
+    sim_sntp_run_pending();
+    TEST_ASSERT_EQUAL_INT64(0, error_us());
+    tb_stats_t st;
+    tb_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(2, st.syncs);
+    TEST_ASSERT_EQUAL_UINT32(2, st.steps);
+    TEST_ASSERT_EQUAL_INT32(3000000, st.last_err_us);
+}
+
+static void test_drifting_oscillator_is_tracked(void){
+    // the board's crystal 100 ppm slow against the server
+    sim_sntp_set_offset_us((int64_t)EPOCH_2026_US);
+    sim_sntp_set_drift_ppm(100);
+    tb_sntp_start();
+    uint64_t prev = 0;
+    int64_t worst = 0;
+    for (int s = 0; s < 4 * 3600; s++){
+        sim_sntp_run_pending();
+        uint64_t t = tb_epoch_us(tb_now_us());
+        TEST_ASSERT_TRUE(t > prev);
+        prev = t;
+        int64_t e = error_us();
+        if (e < 0) e = -e;
+        if (e > worst) worst = e;
+        sim_clock_advance_ms(1000);
+    }
+    // 100 ppm over one poll, and no step after the first answer
+    TEST_ASSERT_LESS_OR_EQUAL((int64_t)TB_SNTP_INTERVAL_MS / 10, worst);
+    tb_stats_t st;
+    tb_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(1, st.steps);
+    TEST_ASSERT_TRUE(st.syncs >= 16);
+}
+
+int main(void){
+    esp_log_level_set("*", ESP_LOG_NONE);
+    UNITY_BEGIN();
+    RUN_TEST(test_wall_clock_from_the_first_answer);
+    RUN_TEST(test_small_error_is_slewed_out);
+    RUN_TEST(test_large_error_is_stepped);
+    RUN_TEST(test_drifting_oscillator_is_tracked);
+    return UNITY_END();
+}
@@ -0,0 +1,140 @@
+#include <unity.h>
+#include <inttypes.h>
+#include <string.h>
+
+extern "C" {
+#include "config.h"
+#include "sim_clock.h"
+#include "trace.h"
+#include "esp_log.h"
+}
+
+// Deferred binary log (src/trace.c).
+
+static const char *TAG = "test";
+
+void setUp(void){
+    sim_clock_set_ns(0);
+    trace_level = TRACE_LEVEL;
+    trace_init();
+}
+
+void tearDown(void){ trace_level = TRACE_LEVEL; }
+
+static void warn(int32_t r, uint32_t n){ TRACE_W(TAG, "read failed: %" PRId32 " after %" PRIu32, r, n); }
+
+static void test_events_keep_id_time_and_arguments(void){
+    sim_clock_advance_ms(1234);
+    warn(-5, 7);
+    warn(3, 8);
+    TRACE_I(TAG, "no arguments");
+    TRACE_D(TAG, "below the level %d", 1);
+
+    trace_ev_t ev[4];
+    TEST_ASSERT_EQUAL(3, trace_pop(ev, 4));
+    TEST_ASSERT_EQUAL_UINT16(ev[0].id, ev[1].id);   // one call site, one format
+    TEST_ASSERT_TRUE(ev[0].id != ev[2].id);
+    TEST_ASSERT_EQUAL_UINT32(1234, ev[0].t_ms);
+    TEST_ASSERT_EQUAL_UINT8(2, ev[0].nargs);
+    TEST_ASSERT_EQUAL_INT32(-5, (int32_t)ev[0].arg[0]);
+    TEST_ASSERT_EQUAL_UINT32(8, ev[1].arg[1]);
+    TEST_ASSERT_EQUAL_UINT8(0, ev[2].nargs);
+    const trace_fmt_t *f = trace_fmt(ev[0].id);
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_EQUAL_STRING("test", f->tag);
+    TEST_ASSERT_EQUAL_UINT8(ESP_LOG_WARN, f->level);
+    TEST_ASSERT_NULL(trace_fmt(0));
+
+    trace_level = ESP_LOG_DEBUG;
+    TRACE_D(TAG, "at the level %d", 2);
+    TEST_ASSERT_EQUAL(1, trace_pop(ev, 4));
+}
+
+static void test_full_ring_drops_new_events(void){
+    for (uint32_t i = 0; i < TRACE_RING_LEN + 10; i++) warn(0, i);
+    trace_stats_t st;
+    trace_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(TRACE_RING_LEN, st.events);
+    TEST_ASSERT_EQUAL_UINT32(10, st.dropped);
+    TEST_ASSERT_EQUAL_UINT32(TRACE_RING_LEN, st.high_water);
+
+    trace_ev_t ev;
+    TEST_ASSERT_EQUAL(1, trace_pop(&ev, 1));
+    TEST_ASSERT_EQUAL_UINT32(0, ev.arg[1]);   // the oldest survive
+    trace_job_flush();
+    trace_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(TRACE_RING_LEN - 1, st.formatted);
+    TEST_ASSERT_EQUAL(0, trace_pop(&ev, 1));
+}
+
+static void test_format_conversions(void){
+    char out[96];
+    const uint32_t a[] = { (uint32_t)-42, 7, 0xAB, 'A' };
+    TEST_ASSERT_EQUAL(23, trace_format(out, sizeof(out), "%05d|%-4u|%#x|%c|%%|%ld|%hu", a, 4));
+    TEST_ASSERT_EQUAL_STRING("-0042|7   |0xab|A|%|?|?", out);
+    trace_format(out, sizeof(out), "%" PRId32 " %" PRIu32 " %" PRIX32 " %s", a, 4);
+    TEST_ASSERT_EQUAL_STRING("-42 7 AB ?", out);   // no strings
+
+    // cut short like snprintf
+    TEST_ASSERT_EQUAL(3, trace_format(out, 3, "%d", a, 1));
+    TEST_ASSERT_EQUAL_STRING("-4", out);
+    TEST_ASSERT_EQUAL(7, trace_format(out, 6, "abc%udef", a + 1, 1));
+    TEST_ASSERT_EQUAL_STRING("abc7d", out);
+}
+
+static char s_lines[8][96];
+static int s_nlines;
+static void collect(void *ctx, const char *text){
+    (void)ctx;
+    if (s_nlines < 8) strcpy(s_lines[s_nlines], text);
+    s_nlines++;
+}
+
+static void test_export_decodes_on_the_host(void){
+    sim_clock_advance_ms(500);
+    warn(-1, 2);
+    sim_clock_advance_ms(20);
+    TRACE_E("bme", "i2c read meas failed: %d", 0x107);
+    TRACE_I(TAG, "first record %u ms after boot", 1008u);
+
+    uint8_t blob[256];
+    size_t len = trace_export(blob, sizeof(blob));
+    TEST_ASSERT_TRUE(len > 0);
+    s_nlines = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, trace_decode(blob, len, collect, NULL));
+    TEST_ASSERT_EQUAL(3, s_nlines);
+    TEST_ASSERT_EQUAL_STRING("W (500) test: read failed: -1 after 2", s_lines[0]);
+    TEST_ASSERT_EQUAL_STRING("E (520) bme: i2c read meas failed: 263", s_lines[1]);
+    TEST_ASSERT_EQUAL_STRING("I (520) test: first record 1008 ms after boot", s_lines[2]);
+    trace_ev_t ev;
+    TEST_ASSERT_EQUAL(0, trace_pop(&ev, 1));   // exported events are taken
+
+    s_nlines = 0;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, trace_decode(blob, len - 1, collect, NULL));
+    TEST_ASSERT_EQUAL(2, s_nlines);
+    blob[0] = 'X';
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, trace_decode(blob, len, collect, NULL));
+
+    // a small buffer takes what fits and leaves the rest queued
+    size_t dict = trace_export(blob, sizeof(blob));   // no events: formats only
+    for (uint32_t i = 0; i < 10; i++) warn(0, i);
+    len = trace_export(blob, dict + 2 * 15 + 14);      // an event is 7 + 4 per argument
+    TEST_ASSERT_EQUAL(dict + 2 * 15, len);
+    s_nlines = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, trace_decode(blob, len, collect, NULL));
+    TEST_ASSERT_EQUAL(2, s_nlines);
+    TEST_ASSERT_EQUAL_STRING("W (520) test: read failed: 0 after 1", s_lines[1]);
+    trace_ev_t rest[10];
+    TEST_ASSERT_EQUAL(8, trace_pop(rest, 10));
+    TEST_ASSERT_EQUAL(0, trace_export(blob, 8));   // formats do not fit
+}
+
+int main(void){
+    esp_log_level_set("*", ESP_LOG_NONE);
+    UNITY_BEGIN();
+    RUN_TEST(test_events_keep_id_time_and_arguments);
+    RUN_TEST(test_full_ring_drops_new_events);
+    RUN_TEST(test_format_conversions);
+    RUN_TEST(test_export_decodes_on_the_host);
+    return UNITY_END();
+}
@@ -0,0 +1,223 @@
+#include <unity.h>
+#include <string.h>
+
+extern "C" {
+#include "config.h"
+#include "reccodec.h"
+#include "tscodec.h"
+#include "wmc.h"
+}
+#include "../codec_records.h"
+
+// Streaming compression codec (src/tscodec.c). The record sets are shared
+// with test_reccodec; the rest checks the bit stream itself.
+
+void setUp(void){}
+void tearDown(void){}
+
+static uint8_t s_buf[500 * TSC_RECORD_MAX];
+
+// Encode in[] into s_buf, every record within TSC_RECORD_MAX_BITS, and
+// decode it back. Returns the largest record in bits.
+static size_t roundtrip(const sample_t *in, size_t n, uint32_t period_ms){
+    tsc_enc_t e;
+    TEST_ASSERT_EQUAL(ESP_OK, tsc_enc_init(&e, s_buf, sizeof(s_buf), period_ms));
+    size_t worst = 0;
+    for (size_t i = 0; i < n; i++){
+        size_t bits = e.bits;
+        TEST_ASSERT_TRUE(tsc_enc_add(&e, &in[i]));
+        if (e.bits - bits > worst) worst = e.bits - bits;
+    }
+    TEST_ASSERT_TRUE(worst <= TSC_RECORD_MAX_BITS);
+
+    tsc_dec_t d;
+    TEST_ASSERT_EQUAL(ESP_OK, tsc_dec_init(&d, s_buf, tsc_enc_len(&e)));
+    TEST_ASSERT_EQUAL_UINT16(n, d.count);
+    TEST_ASSERT_EQUAL_UINT32(period_ms, d.period_ms);
+    sample_t s;
+    for (size_t i = 0; i < n; i++){
+        TEST_ASSERT_EQUAL(ESP_OK, tsc_dec_next(&d, &s));
+        TEST_ASSERT_EQUAL_MEMORY(&in[i], &s, sizeof(s));
+    }
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, tsc_dec_next(&d, &s));
+    return worst;
+}
+
+static void test_smooth_records_beat_the_byte_codec(void){
+    static sample_t in[200];
+    for (uint32_t i = 0; i < 200; i++) in[i] = smooth(i);
+    roundtrip(in, 200, SAMPLE_PERIOD_MS);
+    tsc_enc_t e;
+    tsc_enc_init(&e, s_buf, sizeof(s_buf), SAMPLE_PERIOD_MS);
+    for (int i = 0; i < 200; i++) tsc_enc_add(&e, &in[i]);
+
+    static uint8_t rbuf[200 * RC_RECORD_MAX];
+    rc_enc_t r;
+    rc_enc_init(&r, rbuf, sizeof(rbuf), SAMPLE_PERIOD_MS);
+    for (int i = 0; i < 200; i++) rc_enc_add(&r, &in[i]);
+    TEST_ASSERT_TRUE(tsc_enc_len(&e) < rc_enc_len(&r) * 3 / 4);
+    TEST_ASSERT_TRUE(tsc_enc_len(&e) < 200 * 10);
+}
+
+static void test_shared_records_roundtrip(void){
+    static sample_t in[500];
+    edge_records(in);
+    roundtrip(in, EDGE_RECORDS, SAMPLE_PERIOD_MS);
+    roundtrip(in, EDGE_RECORDS, 0);
+    roundtrip(in, EDGE_RECORDS, UINT32_MAX);
+    random_records(in, 500, 11);
+    roundtrip(in, 500, SAMPLE_PERIOD_MS);
+}
+
+// cap_raw[0] alone: its width after each record, in the encoder and the
+// decoder.
+static void test_width_grows_shrinks_and_resets(void){
+    // zigzagged deltas 2000 (11 bits), 2, 200, 20, 0, 2, 1
+    static const int32_t CAP[] = { 1000, 1001, 1101, 1111, 1111, 1112, 1111 };
+    static const uint8_t WIDTH[] = { 11, 2, 8, 8, 8, 8, 1 };
+    static sample_t in[7];
+    for (int i = 0; i < 7; i++){
+        in[i] = (sample_t){};
+        in[i].t_ms = 1000u * (uint64_t)i;
+        in[i].cap_raw[0] = CAP[i];
+        in[i].mc_cpct = WMC_INVALID;
+    }
+    tsc_enc_t e;
+    tsc_enc_init(&e, s_buf, sizeof(s_buf), 1000);
+    for (int i = 0; i < 7; i++){
+        tsc_enc_add(&e, &in[i]);
+        TEST_ASSERT_EQUAL_UINT8(WIDTH[i], e.width[0]);
+    }
+    tsc_dec_t d;
+    TEST_ASSERT_EQUAL(ESP_OK, tsc_dec_init(&d, s_buf, tsc_enc_len(&e)));
+    sample_t s;
+    for (int i = 0; i < 7; i++){
+        TEST_ASSERT_EQUAL(ESP_OK, tsc_dec_next(&d, &s));
+        TEST_ASSERT_EQUAL_INT32(CAP[i], s.cap_raw[0]);
+        TEST_ASSERT_EQUAL_UINT8(WIDTH[i], d.width[0]);
+    }
+
+    // a new block starts without widths: the first value carries its own
+    tsc_enc_init(&e, s_buf, sizeof(s_buf), 1000);
+    TEST_ASSERT_EQUAL_UINT8(0, e.width[0]);
+    sample_t one = in[6];
+    one.cap_raw[0] = 1;   // zigzag 2: '11', 6-bit width, 2 bits
+    tsc_enc_add(&e, &one);
+    TEST_ASSERT_EQUAL_UINT8(2, e.width[0]);
+    TEST_ASSERT_EQUAL(TSC_HEADER_BYTES * 8 + 12 + 64 + 1 + 10 + 1, e.bits);
+}
+
+// Time costs per delta of delta, on records with nothing else in them:
+// map, capdac and flags unchanged are a bit each.
+static void test_dod_buckets(void){
+    static const struct { int64_t dod; unsigned bits; } B[] = {
+        { 0, 1 },
+        { -64, 2 + 7 }, { 64, 3 + 12 },                 // zigzag 127, 128
+        { -2048, 3 + 12 }, { 2048, 4 + 20 },            // 4095, 4096
+        { -(1 << 19), 4 + 20 }, { 1 << 19, 4 + 64 },    // 2^20 - 1, 2^20
+        { INT64_MIN / 2, 4 + 64 },
+    };
+    const size_t n = sizeof(B) / sizeof(B[0]);
+    static sample_t in[1 + sizeof(B) / sizeof(B[0])];
+    uint64_t t = 5000, dt = 1000;
+    for (size_t i = 0; i <= n; i++){
+        if (i){
+            dt += (uint64_t)B[i - 1].dod;
+            t += dt;
+        }
+        in[i] = (sample_t){};
+        in[i].t_ms = t;
+        in[i].mc_cpct = WMC_INVALID;
+    }
+    tsc_enc_t e;
+    tsc_enc_init(&e, s_buf, sizeof(s_buf), 1000);
+    TEST_ASSERT_TRUE(tsc_enc_add(&e, &in[0]));
+    TEST_ASSERT_EQUAL(TSC_HEADER_BYTES * 8 + 3 + 64, e.bits);
+    for (size_t i = 0; i < n; i++){
+        size_t bits = e.bits;
+        TEST_ASSERT_TRUE(tsc_enc_add(&e, &in[i + 1]));
+        TEST_ASSERT_EQUAL(3 + B[i].bits, e.bits - bits);
+    }
+    roundtrip(in, n + 1, 1000);
+}
+
+// Every field at its most expensive at once: the map, capdac and flags
+// change on every record, time jumps by 2^62 back and forth, and each
+// value's width swings wide and narrow so it is re-sent each time. The
+// bound also covers 64-bit deltas on the 32-bit channels, which sample_t
+// cannot produce, so these come to a little over half of it.
+static void test_adversarial_records_stay_in_bound(void){
+    static sample_t in[64];
+    static const int32_t V[] = { 0, INT32_MIN, INT32_MIN + 1, 1 };
+    for (int i = 0; i < 64; i++){
+        sample_t s = {};
+        s.t_ms = i & 1 ? 1ull << 62 : 0;
+        s.t_us = i & 1 ? 1 : 1ull << 63 | (uint64_t)(i & 2);
+        s.epoch_us = i & 2 ? UINT64_MAX : 1;
+        for (int c = 0; c < 4; c++){
+            s.cap_raw[c] = V[(i + c) % 4];
+            s.capdac[c] = (uint8_t)(i + c);
+        }
+        s.temp_cdeg = V[i % 4];
+        s.hum_q10 = (uint32_t)V[(i + 1) % 4];
+        s.pres_q8 = (uint32_t)V[(i + 2) % 4];
+        s.mc_cpct = i & 1 ? WMC_INVALID : (uint16_t)(i & 2 ? 0xFFFE : 1);
+        s.flags = (uint16_t)~i;
+        in[i] = s;
+    }
+    size_t worst = roundtrip(in, 64, 1000);
+    TEST_ASSERT_TRUE(worst > TSC_RECORD_MAX_BITS / 2);
+}
+
+// Blocks filled to the last byte, cut short, or not tscodec at all.
+static void test_full_cut_and_foreign_blocks(void){
+    uint8_t buf[83];
+    tsc_enc_t e;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, tsc_enc_init(&e, buf, TSC_HEADER_BYTES - 1, SAMPLE_PERIOD_MS));
+    TEST_ASSERT_EQUAL(ESP_OK, tsc_enc_init(&e, buf, sizeof(buf), SAMPLE_PERIOD_MS));
+    uint16_t n = 0;
+    sample_t s = smooth(0);
+    while (tsc_enc_add(&e, &s)) s = smooth(++n);
+    TEST_ASSERT_TRUE(n >= 2);
+    size_t len = tsc_enc_len(&e);
+    TEST_ASSERT_TRUE(len <= sizeof(buf));
+    TEST_ASSERT_EQUAL(len, tsc_enc_len(&e));
+    // the refused record left nothing behind, not even bits after the last one
+    if (e.bits & 7) TEST_ASSERT_EQUAL_HEX8(0, buf[len - 1] & (0xFF >> (e.bits & 7)));
+
+    tsc_dec_t d;
+    sample_t out;
+    TEST_ASSERT_EQUAL(ESP_OK, tsc_dec_init(&d, buf, len));
+    TEST_ASSERT_EQUAL_UINT16(n, d.count);
+    for (uint16_t i = 0; i < n; i++) TEST_ASSERT_EQUAL(ESP_OK, tsc_dec_next(&d, &out));
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, tsc_dec_next(&d, &out));
+    TEST_ASSERT_TRUE(d.end_bits - d.bits < 8);   // only padding left
+
+    // cut anywhere inside the records: an error, never a bad record past it
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, tsc_dec_init(&d, buf, TSC_HEADER_BYTES - 1));
+    for (size_t cut = TSC_HEADER_BYTES; cut < len; cut++){
+        TEST_ASSERT_EQUAL(ESP_OK, tsc_dec_init(&d, buf, cut));
+        esp_err_t r;
+        int k = 0;
+        while ((r = tsc_dec_next(&d, &out)) == ESP_OK) k++;
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, r);
+        TEST_ASSERT_TRUE(k < n);
+    }
+
+    buf[1] = TSC_VERSION + 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_VERSION, tsc_dec_init(&d, buf, len));
+    buf[1] = TSC_VERSION;
+    buf[0] = RC_MAGIC;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, tsc_dec_init(&d, buf, len));
+}
+
+int main(void){
+    UNITY_BEGIN();
+    RUN_TEST(test_smooth_records_beat_the_byte_codec);
+    RUN_TEST(test_shared_records_roundtrip);
+    RUN_TEST(test_width_grows_shrinks_and_resets);
+    RUN_TEST(test_dod_buckets);
+    RUN_TEST(test_adversarial_records_stay_in_bound);
+    RUN_TEST(test_full_cut_and_foreign_blocks);
+    return UNITY_END();
+}
@@ -0,0 +1,128 @@
+#include <unity.h>
+#include <stdio.h>
+
+extern "C" {
+#include "units.h"
+#include "cycles.h"
+#include "record.h"
+#include "fdc1004.h"
+}
+
+// Fixed-point unit conversions against a double reference, and the cost of
+// assembling one sample the old float way vs the integer way. Runs on the
+// host build and, through the PlatformIO test runner, on the ESP32-C3.
+
+void setUp(void){}
+void tearDown(void){}
+
+static void test_cap_af_matches_reference(void){
+    static const uint8_t capdacs[] = { 0, 1, 12, FDC_CAPDAC_MAX };
+    for (size_t c = 0; c < sizeof(capdacs); c++){
+        for (int32_t raw = -(1 << 23); raw < (1 << 23); raw += 4099){
+            double ref = (double)raw * 1e6 / FDC_CODES_PER_PF + capdacs[c] * 3125000.0;
+            double err = (double)units_cap_af(raw, capdacs[c]) - ref;
+            TEST_ASSERT_TRUE(err <= 0.5 && err >= -0.5);
+        }
+    }
+    TEST_ASSERT_EQUAL_INT32(16000000 - 2, units_cap_af((1 << 23) - 1, 0));   // full scale: +16 pF less one code
+    TEST_ASSERT_EQUAL_INT32(-16000000, units_cap_af(-(1 << 23), 0));
+    TEST_ASSERT_EQUAL_INT32(96875000 + 16000000 - 2, units_cap_af((1 << 23) - 1, FDC_CAPDAC_MAX));
+}
+
+static void test_bme_units_match_reference(void){
+    for (uint32_t q10 = 0; q10 <= 100u * 1024u; q10 += 7){
+        double err = (double)units_hum_mpct(q10) - (double)q10 * 1000.0 / 1024.0;
+        TEST_ASSERT_TRUE(err <= 0.5 && err >= -0.5);
+    }
+    for (uint32_t q8 = 30000u * 256u; q8 <= 110000u * 256u; q8 += 251){
+        double err = (double)units_pres_pa(q8) - (double)q8 / 256.0;
+        TEST_ASSERT_TRUE(err <= 0.5 && err >= -0.5);
+    }
+}
+
+// ---- per-sample cost: previous float path vs integer path ----
+
+typedef struct {
+    uint64_t t_ms;
+    float cap_pf[4];
+    float temp_c, hum_pct, pres_hpa;
+    uint16_t flags;
+} float_sample_t;
+
+typedef struct {
+    int32_t raw[4];
+    uint8_t capdac[4];
+    int32_t t;
+    uint32_t h, p;
+} inputs_t;
+
+// External linkage keeps the stores from being optimised away.
+float_sample_t g_fsink;
+sample_t g_isink;
+int32_t g_dsink;
+
+// What fdc_read_pf/bme_read/sampler_job did per sample before.
+static void __attribute__((noinline)) assemble_float(const inputs_t *in){
+    float_sample_t s = {};
+    for (int i = 0; i < 4; i++)
+        s.cap_pf[i] = (float)in->raw[i] / 524288.0f + (float)in->capdac[i] * 3.125f;
+    s.temp_c = (float)in->t / 100.0f;
+    s.pres_hpa = (float)in->p / 256.0f / 100.0f;
+    s.hum_pct = (float)in->h / 1024.0f;
+    g_fsink = s;
+}
+
+// What sampler_job does now: codes and scales are stored as read.
+static void __attribute__((noinline)) assemble_fixed(const inputs_t *in){
+    sample_t s = {};
+    for (int i = 0; i < 4; i++){ s.cap_raw[i] = in->raw[i]; s.capdac[i] = in->capdac[i]; }
+    s.temp_cdeg = in->t;
+    s.hum_q10 = in->h;
+    s.pres_q8 = in->p;
+    g_isink = s;
+}
+
+// Conversion to decimal units, as an encoder does it for every sample.
+static void __attribute__((noinline)) convert_fixed(const inputs_t *in){
+    int32_t acc = 0;
+    for (int i = 0; i < 4; i++) acc += units_cap_af(in->raw[i], in->capdac[i]);
+    acc += units_hum_mpct(in->h) + units_pres_pa(in->p) + in->t;
+    g_dsink = acc;
+}
+
+#define COST_N 2000
+
+static uint32_t cost(void (*fn)(const inputs_t *), inputs_t *in){
+    uint32_t best = UINT32_MAX;
+    for (int rep = 0; rep < 5; rep++){
+        uint32_t c0 = cyc_now();
+        for (int i = 0; i < COST_N; i++){ in->raw[i & 3] += i; fn(in); }
+        uint32_t c = cyc_now() - c0;
+        if (c < best) best = c;
+    }
+    return best / COST_N;
+}
+
+static void test_report_cycles_per_sample(void){
+    inputs_t in = { { 1048576, -524288, 3932160, 123 }, { 0, 0, 12, 0 }, 2150, 46080, 25939200 };
+    uint32_t f = cost(assemble_float, &in);
+    uint32_t a = cost(assemble_fixed, &in);
+    uint32_t c = cost(convert_fixed, &in);
+    printf("cycles/sample: float path %u, fixed path %u, fixed + decimal conversion %u\n",
+           (unsigned)f, (unsigned)a, (unsigned)(a + c));
+    TEST_ASSERT_TRUE(f > 0);
+}
+
+static int run_all(void){
+    UNITY_BEGIN();
+    RUN_TEST(test_cap_af_matches_reference);
+    RUN_TEST(test_bme_units_match_reference);
+    RUN_TEST(test_report_cycles_per_sample);
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void){ run_all(); }
+#else
+int main(void){ return run_all(); }
+#endif
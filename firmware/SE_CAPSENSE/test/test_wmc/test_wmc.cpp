@@ -0,0 +1,149 @@
+#include <unity.h>
+#include <stdio.h>
+
+extern "C" {
+#include "config.h"
+#include "wmc.h"
+#include "cycles.h"
+}
+
+// Moisture tables (src/wmc.c) against the closed-form model evaluated in
+// double. Runs on the host build and, through the PlatformIO test runner,
+// on the ESP32-C3.
+
+static const double SG[WMC_SPECIES_COUNT] = { 0.50, 0.51, 0.43, 0.48, 0.67, 0.68 };
+
+static double ref_cap_af(double sg, double mc_pct, double t_c){
+    double eps = 1.0 + 4.0 * sg + 1.6 * sg * mc_pct * (1.0 + 0.004 * (t_c - 20.0));
+    return WMC_SENSOR_C0_AF + WMC_SENSOR_CE_AF * eps;
+}
+
+static double ref_mc_pct(double sg, double cap_af, double t_c){
+    double eps = (cap_af - WMC_SENSOR_C0_AF) / WMC_SENSOR_CE_AF;
+    return (eps - 1.0 - 4.0 * sg) / (1.6 * sg * (1.0 + 0.004 * (t_c - 20.0)));
+}
+
+void setUp(void){ wmc_set_species(WMC_SPECIES_GENERIC); }
+void tearDown(void){}
+
+static void test_estimate_matches_reference(void){
+    for (int sp = 0; sp < WMC_SPECIES_COUNT; sp++){
+        TEST_ASSERT_EQUAL(ESP_OK, wmc_set_species((wmc_species_t)sp));
+        for (int t = WMC_T_MIN_CDEG; t <= WMC_T_MAX_CDEG; t += 370){
+            for (int mc = 0; mc <= WMC_MC_MAX_CPCT; mc += 37){
+                double cap = ref_cap_af(SG[sp], mc / 100.0, t / 100.0);
+                bool clamped = true;
+                uint16_t est = wmc_estimate((int32_t)(cap + 0.5), t, &clamped);
+                TEST_ASSERT_INT_WITHIN(1, mc, est);
+                TEST_ASSERT_FALSE(clamped);
+            }
+        }
+    }
+}
+
+static void test_model_round_trips(void){
+    for (int t = -1500; t <= 5500; t += 1234){
+        int32_t prev = 0;
+        for (int mc = 0; mc <= WMC_MC_MAX_CPCT; mc += 50){
+            int32_t c = wmc_model_af((uint16_t)mc, t);
+            TEST_ASSERT_TRUE(c > prev);   // strictly increasing in moisture
+            prev = c;
+            TEST_ASSERT_INT_WITHIN(1, mc, wmc_estimate(c, t, NULL));
+        }
+    }
+}
+
+static void test_temperature_compensation(void){
+    // 15 % MC wood reads higher at 50 degC than at 20 degC
+    int32_t c20 = wmc_model_af(1500, 2000), c50 = wmc_model_af(1500, 5000);
+    TEST_ASSERT_TRUE(c50 > c20);
+    TEST_ASSERT_INT_WITHIN(1, 1500, wmc_estimate(c50, 5000, NULL));
+    // read at the wrong temperature, the same capacitance is 1.7 % off
+    uint16_t uncomp = wmc_estimate(c50, 2000, NULL);
+    double want = ref_mc_pct(0.50, c50, 20.0) * 100.0;
+    TEST_ASSERT_INT_WITHIN(2, (int)(want + 0.5), uncomp);
+    TEST_ASSERT_TRUE(uncomp > 1650);
+}
+
+static void test_out_of_range_is_clamped(void){
+    bool clamped = false;
+    TEST_ASSERT_EQUAL_UINT16(0, wmc_estimate(0, 2000, &clamped));
+    TEST_ASSERT_TRUE(clamped);
+    TEST_ASSERT_EQUAL_UINT16(WMC_MC_MAX_CPCT, wmc_estimate(100000000, 2000, &clamped));
+    TEST_ASSERT_TRUE(clamped);
+    TEST_ASSERT_EQUAL_UINT16(0, wmc_estimate(wmc_model_af(0, 2000), 2000, &clamped));
+    TEST_ASSERT_FALSE(clamped);
+
+    // temperatures beyond the table use its edge
+    int32_t c = wmc_model_af(1000, WMC_T_MAX_CDEG);
+    TEST_ASSERT_EQUAL_UINT16(wmc_estimate(c, WMC_T_MAX_CDEG, NULL), wmc_estimate(c, 9000, NULL));
+    c = wmc_model_af(1000, WMC_T_MIN_CDEG);
+    TEST_ASSERT_EQUAL_UINT16(wmc_estimate(c, WMC_T_MIN_CDEG, NULL), wmc_estimate(c, -4000, NULL));
+}
+
+static void test_species_selection(void){
+    int32_t c = wmc_model_af(1200, 2000);   // generic wood at 12 %
+    TEST_ASSERT_EQUAL(ESP_OK, wmc_set_species(WMC_SPECIES_OAK));
+    TEST_ASSERT_EQUAL(WMC_SPECIES_OAK, wmc_get_species());
+    // denser wood holds more water per volume: the same reading is drier oak
+    TEST_ASSERT_LESS_THAN(1000, wmc_estimate(c, 2000, NULL));
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, wmc_set_species(WMC_SPECIES_COUNT));
+    TEST_ASSERT_EQUAL(WMC_SPECIES_OAK, wmc_get_species());
+    TEST_ASSERT_EQUAL(WMC_SPECIES_SPRUCE, wmc_species_from_name("spruce"));
+    TEST_ASSERT_EQUAL(WMC_SPECIES_COUNT, wmc_species_from_name("balsa"));
+    TEST_ASSERT_EQUAL_STRING("douglas-fir", wmc_species_name(WMC_SPECIES_DOUGLAS_FIR));
+}
+
+// ---- cost per estimate: tables vs evaluating the model in float ----
+
+volatile int32_t g_cap = 2000000;
+volatile int32_t g_temp = 2150;
+uint32_t g_sink;
+
+static void __attribute__((noinline)) est_table(void){ g_sink += wmc_estimate(g_cap, g_temp, NULL); }
+
+static void __attribute__((noinline)) est_float(void){
+    float sg = 0.50f, t = (float)g_temp / 100.0f;
+    float eps = ((float)g_cap - (float)WMC_SENSOR_C0_AF) / (float)WMC_SENSOR_CE_AF;
+    float mc = (eps - 1.0f - 4.0f * sg) / (1.6f * sg * (1.0f + 0.004f * (t - 20.0f)));
+    if (mc < 0.0f) mc = 0.0f;
+    if (mc > 30.0f) mc = 30.0f;
+    g_sink += (uint32_t)(mc * 100.0f + 0.5f);
+}
+
+#define COST_N 2000
+
+static uint32_t cost(void (*fn)(void)){
+    uint32_t best = UINT32_MAX;
+    for (int rep = 0; rep < 5; rep++){
+        uint32_t c0 = cyc_now();
+        for (int i = 0; i < COST_N; i++){ g_cap = 2000000 + i * 997; fn(); }
+        uint32_t c = cyc_now() - c0;
+        if (c < best) best = c;
+    }
+    return best / COST_N;
+}
+
+static void test_report_cycles_per_estimate(void){
+    uint32_t t = cost(est_table), f = cost(est_float);
+    printf("cycles/estimate: tables %u, float model %u\n", (unsigned)t, (unsigned)f);
+    TEST_ASSERT_TRUE(t > 0);
+}
+
+static int run_all(void){
+    UNITY_BEGIN();
+    RUN_TEST(test_estimate_matches_reference);
+    RUN_TEST(test_model_round_trips);
+    RUN_TEST(test_temperature_compensation);
+    RUN_TEST(test_out_of_range_is_clamped);
+    RUN_TEST(test_species_selection);
+    RUN_TEST(test_report_cycles_per_estimate);
+    return UNITY_END();
+}
+
+#ifdef ESP_PLATFORM
+extern "C" void app_main(void){ run_all(); }
+#else
+int main(void){ return run_all(); }
+#endif